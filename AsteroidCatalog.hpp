@@ -0,0 +1,594 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_ASTEROIDCATALOG_HPP_
+#define INCLUDE_SOLAR_SYSTEM_ASTEROIDCATALOG_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "Calendar.hpp"
+#include "Kepler.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Orbits of the Minor Planet Center's catalog (MPCORB.DAT) as structure-of-arrays.
+ *
+ * The text file is memory-mapped and cut into line-aligned chunks that the thread pool
+ * parses in place: a first pass counts the lines of every chunk so each one knows where
+ * its orbits go, a second parses the fixed-width columns straight into the arrays without
+ * allocating or going through the C library, and lines that are not orbits (the header,
+ * blank separators) are squeezed out at the end.
+ *
+ * The result is written next to the source as a binary cache, a header followed by one
+ * 64 byte aligned array per field. Later loads map the cache and read the arrays where
+ * they lie, so a warm start costs little more than the mapping; the cache is rebuilt when
+ * the source's size or modification time changes.
+ *
+ * Angles are in radians, the mean motion in radians per day and epochs in days since J2000.
+ * update() propagates the orbits into points for drawing, around the sun at the origin.
+ */
+class AsteroidCatalog {
+public:
+    static const std::uint32_t VERSION = 1;
+    static const std::size_t DESIGNATION_SIZE = 8;      // packed designation and terminator
+    static const std::size_t CHUNK = 1024;              // orbits per propagation batch
+    static const std::size_t PARSE_CHUNK = 1 << 20;     // bytes of text per parse task
+
+    enum Field {
+        EPOCH = 0, MEAN_ANOMALY, PERIHELION, NODE, INCLINATION, ECCENTRICITY, MEAN_MOTION, SEMI_MAJOR_AXIS,
+        MAGNITUDE, FIELDS
+    };
+
+    AsteroidCatalog() : p_Count(0), p_Designations(NULL), p_FromCache(false), p_SceneScale(0.0f), p_Cursor(0),
+                        p_CostPerOrbit(0.0), p_LastCount(0) {
+        for (int f = 0; f < FIELDS; f++)
+            p_Fields[f] = NULL;
+    }
+
+    /**
+     * @brief Loads the catalog from the cache at path + ".cache" or, if it is missing or stale,
+     * parses path and writes the cache
+     *
+     * @return false if neither could be read
+     */
+    bool load(ThreadPool& pool, const std::string& path) {
+        const std::string cachePath = path + ".cache";
+        std::uint64_t size = 0;
+        std::int64_t modified = 0;
+        const bool hasSource = sourceStamp(path, size, modified);
+        if (readCache(cachePath, hasSource, size, modified))
+            return true;
+        if (!hasSource) {
+            std::cerr << "Could not open asteroid catalog " << path << std::endl;
+            return false;
+        }
+        if (!parse(pool, path))
+            return false;
+        if (!writeCache(cachePath, size, modified))
+            std::cerr << "Could not write asteroid cache " << cachePath << std::endl;
+        return true;
+    }
+
+    /**
+     * @brief Parses an MPCORB text file, false if it cannot be mapped
+     */
+    bool parse(ThreadPool& pool, const std::string& path) {
+        MappedFile file;
+        if (!file.open(path)) {
+            std::cerr << "Could not open asteroid catalog " << path << std::endl;
+            return false;
+        }
+        clear();
+        const char* text = reinterpret_cast<const char*>(file.data());
+        const char* end = text + file.size();
+        const char* first = skipHeader(text, end);
+
+        // Chunk boundaries move forward to the next line start
+        std::vector<const char*> bounds(1, first);
+        while (bounds.back() < end) {
+            const char* next = bounds.back() + PARSE_CHUNK;
+            if (next >= end) {
+                next = end;
+            } else {
+                const char* newline = static_cast<const char*>(std::memchr(next, '\n', end - next));
+                next = newline != NULL ? newline + 1 : end;
+            }
+            bounds.push_back(next);
+        }
+        const std::size_t chunks = bounds.size() - 1;
+
+        std::vector<std::size_t> offsets(chunks + 1, 0), parsed(chunks, 0);
+        pool.parallelFor(0, chunks, 1, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+            for (std::size_t c = chunkBegin; c < chunkEnd; c++)
+                offsets[c + 1] = countLines(bounds[c], bounds[c + 1]);
+        });
+        for (std::size_t c = 0; c < chunks; c++)
+            offsets[c + 1] += offsets[c];
+
+        resizeOwned(offsets[chunks]);
+        pool.parallelFor(0, chunks, 1, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+            for (std::size_t c = chunkBegin; c < chunkEnd; c++)
+                parsed[c] = parseChunk(bounds[c], bounds[c + 1], offsets[c]);
+        });
+
+        // Close the gaps the rejected lines left at the end of every chunk
+        std::size_t count = 0;
+        for (std::size_t c = 0; c < chunks; c++) {
+            if (count != offsets[c] && parsed[c] > 0) {
+                for (int f = 0; f < FIELDS; f++)
+                    std::memmove(&p_Owned[f][count], &p_Owned[f][offsets[c]], parsed[c] * sizeof(double));
+                std::memmove(&p_OwnedDesignations[count * DESIGNATION_SIZE],
+                             &p_OwnedDesignations[offsets[c] * DESIGNATION_SIZE], parsed[c] * DESIGNATION_SIZE);
+            }
+            count += parsed[c];
+        }
+        resizeOwned(count);
+        return true;
+    }
+
+    /**
+     * @brief Writes the binary cache to path + ".tmp" and renames it over path once complete
+     *
+     * @param[in] sourceSize, sourceModified stamp of the text file the cache stands for
+     */
+    bool writeCache(const std::string& path, std::uint64_t sourceSize, std::int64_t sourceModified) const {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = VERSION;
+        header.headerSize = sizeof(Header);
+        header.count = p_Count;
+        header.sourceSize = sourceSize;
+        header.sourceModified = sourceModified;
+
+        std::string temporary = path + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (file == NULL)
+            return false;
+
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        static const char padding[ALIGNMENT] = { 0 };
+        std::size_t offset = sizeof(header);
+        for (int f = 0; f <= FIELDS && ok; f++) {
+            const std::size_t aligned = alignUp(offset);
+            const std::size_t bytes = f < FIELDS ? p_Count * sizeof(double) : p_Count * DESIGNATION_SIZE;
+            const void* data = f < FIELDS ? static_cast<const void*>(p_Fields[f]) : p_Designations;
+            ok = std::fwrite(padding, 1, aligned - offset, file) == aligned - offset;
+            ok = ok && (bytes == 0 || std::fwrite(data, 1, bytes, file) == bytes);
+            offset = aligned + bytes;
+        }
+        ok = std::fclose(file) == 0 && ok;
+
+        if (ok) {
+#if defined(_WIN32)
+            // rename() only replaces existing files atomically on POSIX
+            std::remove(path.c_str());
+#endif
+            ok = std::rename(temporary.c_str(), path.c_str()) == 0;
+        }
+        if (!ok)
+            std::remove(temporary.c_str());
+        return ok;
+    }
+
+    /**
+     * @brief Maps a cache and uses its arrays in place
+     *
+     * @param[in] checkSource whether the cache has to match sourceSize and sourceModified
+     * @return false if the cache is missing, invalid or stale
+     */
+    bool readCache(const std::string& path, bool checkSource, std::uint64_t sourceSize, std::int64_t sourceModified) {
+        MappedFile& file = p_Cache;
+        clear();
+        if (!file.open(path))
+            return false;
+        Header header;
+        if (file.size() < sizeof(Header)) {
+            file.close();
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, magic(), sizeof(header.magic)) != 0 || header.version != VERSION ||
+            header.headerSize != sizeof(Header) ||
+            (checkSource && (header.sourceSize != sourceSize || header.sourceModified != sourceModified))) {
+            file.close();
+            return false;
+        }
+
+        // A count the file cannot hold would overflow the offsets below
+        if (header.count > file.size() / (FIELDS * sizeof(double) + DESIGNATION_SIZE)) {
+            std::cerr << "Asteroid cache is truncated: " << path << std::endl;
+            file.close();
+            return false;
+        }
+        const std::size_t n = static_cast<std::size_t>(header.count);
+        std::size_t offset = sizeof(header);
+        for (int f = 0; f < FIELDS; f++)
+            offset = alignUp(offset) + n * sizeof(double);
+        offset = alignUp(offset) + n * DESIGNATION_SIZE;
+        if (offset > file.size()) {
+            std::cerr << "Asteroid cache is truncated: " << path << std::endl;
+            file.close();
+            return false;
+        }
+
+        offset = sizeof(header);
+        for (int f = 0; f < FIELDS; f++) {
+            offset = alignUp(offset);
+            p_Fields[f] = reinterpret_cast<const double*>(file.data() + offset);
+            offset += n * sizeof(double);
+        }
+        p_Designations = reinterpret_cast<const char*>(file.data() + alignUp(offset));
+        p_Count = n;
+        p_FromCache = true;
+        return true;
+    }
+
+    void clear() {
+        p_Cache.close();
+        for (int f = 0; f < FIELDS; f++) {
+            p_Owned[f].clear();
+            p_Fields[f] = NULL;
+        }
+        p_OwnedDesignations.clear();
+        p_Designations = NULL;
+        p_Count = 0;
+        p_FromCache = false;
+        p_SceneScale = 0.0f;
+        p_Positions.clear();
+        p_Cursor = 0;
+        p_CostPerOrbit = 0.0;
+    }
+
+    std::size_t size() const { return p_Count; }
+    bool empty() const { return p_Count == 0; }
+
+    /**
+     * @brief Whether the last load mapped the binary cache instead of parsing text
+     */
+    bool fromCache() const { return p_FromCache; }
+
+    /**
+     * @brief One field of every orbit; the absolute magnitude is NaN where the catalog has none
+     */
+    const double* field(Field f) const { return p_Fields[f]; }
+
+    /**
+     * @brief Packed designation as in the catalog, e.g. "00001" for Ceres or "K24A00B"
+     */
+    std::string designation(std::size_t i) const {
+        return std::string(p_Designations + i * DESIGNATION_SIZE);
+    }
+
+    /**
+     * @brief Orbit i as elements with the mean anomaly referred to J2000, e.g. for OrbitRenderer
+     */
+    KeplerElements elements(std::size_t i) const {
+        KeplerElements orbit;
+        orbit.semiMajorAxis = p_Fields[SEMI_MAJOR_AXIS][i];
+        orbit.eccentricity = p_Fields[ECCENTRICITY][i];
+        orbit.inclination = p_Fields[INCLINATION][i];
+        orbit.ascendingNode = p_Fields[NODE][i];
+        orbit.argumentOfPeriapsis = p_Fields[PERIHELION][i];
+        orbit.meanMotion = p_Fields[MEAN_MOTION][i];
+        orbit.meanAnomalyAtEpoch = p_Fields[MEAN_ANOMALY][i] - orbit.meanMotion * p_Fields[EPOCH][i];
+        return orbit;
+    }
+
+    /**
+     * @brief Propagates as many orbits as fit in budget seconds, taking turns from where the last
+     * call stopped; all of them while the measured cost allows
+     *
+     * The first call after loading or a change of scale sets up the orbits for propagation
+     * and places every one of them.
+     *
+     * @param[in] days time in days since J2000
+     * @param[in] sceneScale scene units per AU
+     * @return number of orbits propagated
+     */
+    std::size_t update(ThreadPool& pool, double days, float sceneScale, double budget) {
+        const std::size_t n = size();
+        if (n == 0)
+            return 0;
+        if (sceneScale != p_SceneScale || p_Positions.size() != 3 * n)
+            prepare(pool, sceneScale);
+
+        std::size_t count = n;
+        if (p_CostPerOrbit > 0.0 && budget < p_CostPerOrbit * n) {
+            count = static_cast<std::size_t>(budget / p_CostPerOrbit);
+            count = count < CHUNK ? CHUNK : count;
+            count = count < n ? count : n;
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+        const std::size_t first = count == n ? 0 : p_Cursor;
+        const std::size_t wrapped = first + count > n ? first + count - n : 0;
+        propagateRange(pool, days, first, first + count - wrapped);
+        propagateRange(pool, days, 0, wrapped);
+        p_Cursor = (first + count) % n;
+        p_LastCount = count;
+
+        const double cost = std::chrono::duration<double>(Clock::now() - start).count() / count;
+        p_CostPerOrbit = p_CostPerOrbit > 0.0 ? 0.8 * p_CostPerOrbit + 0.2 * cost : cost;
+        return count;
+    }
+
+    /**
+     * @brief Scene positions after the last update(), packed as x, y, z
+     */
+    const float* positions() const { return p_Positions.data(); }
+    std::size_t lastCount() const { return p_LastCount; }
+
+    /**
+     * @brief Size and modification time of a file, false if it does not exist
+     */
+    static bool sourceStamp(const std::string& path, std::uint64_t& size, std::int64_t& modified) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return false;
+        size = static_cast<std::uint64_t>(info.st_size);
+        modified = static_cast<std::int64_t>(info.st_mtime);
+        return true;
+    }
+
+private:
+    static const std::size_t ALIGNMENT = 64;
+    // Shortest line holding every field up to the semi-major axis
+    static const std::size_t MIN_LINE = 103;
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::uint64_t count;
+        std::uint64_t sourceSize;
+        std::int64_t sourceModified;
+    };
+
+    // Either the parsed arrays or the mapped cache backs p_Fields and p_Designations
+    std::vector<double> p_Owned[FIELDS];
+    std::vector<char> p_OwnedDesignations;
+    MappedFile p_Cache;
+    const double* p_Fields[FIELDS];
+    std::size_t p_Count;
+    const char* p_Designations;
+    bool p_FromCache;
+
+    // Propagation, set up by prepare() in the scene frame
+    float p_SceneScale;
+    std::vector<double> p_MeanAnomalyAtJ2000;
+    std::vector<float> p_SemiMajorAxis, p_SemiMinorAxis, p_Eccentricity;
+    std::vector<float> p_Px, p_Py, p_Pz, p_Qx, p_Qy, p_Qz;
+    std::vector<float> p_Positions;
+    std::size_t p_Cursor;
+    double p_CostPerOrbit;
+    std::size_t p_LastCount;
+
+    static const char* magic() {
+        return "SOLMPCO";   // 8 bytes with the terminator
+    }
+
+    static std::size_t alignUp(std::size_t offset) {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    void resizeOwned(std::size_t count) {
+        for (int f = 0; f < FIELDS; f++) {
+            p_Owned[f].resize(count);
+            p_Fields[f] = p_Owned[f].data();
+        }
+        p_OwnedDesignations.resize(count * DESIGNATION_SIZE);
+        p_Designations = p_OwnedDesignations.data();
+        p_Count = count;
+    }
+
+    /**
+     * @brief Start of the orbits: after the line of dashes ending the header, if there is one
+     */
+    static const char* skipHeader(const char* text, const char* end) {
+        const std::size_t window = end - text < 65536 ? static_cast<std::size_t>(end - text) : 65536;
+        for (const char* p = text; p + 10 <= text + window; p++) {
+            if ((p == text || p[-1] == '\n') && std::memcmp(p, "----------", 10) == 0) {
+                const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                return newline != NULL ? newline + 1 : end;
+            }
+        }
+        return text;
+    }
+
+    static std::size_t countLines(const char* p, const char* end) {
+        std::size_t lines = 0;
+        while (p < end) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            lines++;
+            p = newline != NULL ? newline + 1 : end;
+        }
+        return lines;
+    }
+
+    /**
+     * @brief Parses the lines in [p, end) into the slots from first on, valid orbits packed to the front
+     *
+     * @return number of orbits
+     */
+    std::size_t parseChunk(const char* p, const char* end, std::size_t first) {
+        std::size_t slot = first;
+        double* fields[FIELDS];
+        for (int f = 0; f < FIELDS; f++)
+            fields[f] = p_Owned[f].data();
+        char* designations = p_OwnedDesignations.data();
+
+        while (p < end) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            const char* line = p;
+            const std::size_t length = (newline != NULL ? newline : end) - line;
+            p = newline != NULL ? newline + 1 : end;
+            if (length < MIN_LINE)
+                continue;
+
+            double epoch, M, peri, node, incl, e, n, a, H;
+            if (!packedEpoch(line + 20, epoch) || !fixed(line + 26, 9, M) || !fixed(line + 37, 9, peri) ||
+                !fixed(line + 48, 9, node) || !fixed(line + 59, 9, incl) || !fixed(line + 70, 9, e) ||
+                !fixed(line + 80, 11, n) || !fixed(line + 92, 11, a))
+                continue;
+            if (!(a > 0.0 && n > 0.0 && e >= 0.0 && e < 1.0) || line[0] == ' ')
+                continue;
+            if (!fixed(line + 8, 5, H))
+                H = std::numeric_limits<double>::quiet_NaN();
+
+            fields[EPOCH][slot] = epoch;
+            fields[MEAN_ANOMALY][slot] = M * DEG_TO_RAD;
+            fields[PERIHELION][slot] = peri * DEG_TO_RAD;
+            fields[NODE][slot] = node * DEG_TO_RAD;
+            fields[INCLINATION][slot] = incl * DEG_TO_RAD;
+            fields[ECCENTRICITY][slot] = e;
+            fields[MEAN_MOTION][slot] = n * DEG_TO_RAD;
+            fields[SEMI_MAJOR_AXIS][slot] = a;
+            fields[MAGNITUDE][slot] = H;
+            char* designation = designations + slot * DESIGNATION_SIZE;
+            std::size_t k = 0;
+            for (; k < 7 && line[k] != ' '; k++)
+                designation[k] = line[k];
+            std::memset(designation + k, 0, DESIGNATION_SIZE - k);
+            slot++;
+        }
+        return slot - first;
+    }
+
+    /**
+     * @brief Reads a fixed-width decimal such as "  231.53975", false if it is blank or malformed
+     *
+     * The digits are gathered into an integer and divided by a power of ten once, which gives
+     * the correctly rounded value for the up to 15 significant digits the catalog uses.
+     */
+    static bool fixed(const char* p, int width, double& value) {
+        static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+                                         1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+        const char* end = p + width;
+        while (p < end && *p == ' ')
+            p++;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        std::uint64_t mantissa = 0;
+        int digits = 0, decimals = -1;
+        for (; p < end && *p != ' '; p++) {
+            if (*p == '.' && decimals < 0) {
+                decimals = 0;
+                continue;
+            }
+            const unsigned int digit = static_cast<unsigned int>(*p - '0');
+            if (digit > 9)
+                return false;
+            mantissa = mantissa * 10 + digit;
+            digits++;
+            decimals += decimals >= 0;
+        }
+        for (; p < end; p++) {
+            if (*p != ' ')
+                return false;
+        }
+        if (digits == 0 || digits > 18)
+            return false;
+        value = static_cast<double>(mantissa) / POWERS[decimals > 0 ? decimals : 0];
+        value = negative ? -value : value;
+        return true;
+    }
+
+    /**
+     * @brief Reads a packed date such as "K24AH" (2024-10-17), 0h TT in days since J2000
+     */
+    static bool packedEpoch(const char* p, double& days) {
+        const int century = p[0] - 'I' + 18;
+        const int month = packedDigit(p[3]), day = packedDigit(p[4]);
+        if (century < 18 || century > 21 || p[1] < '0' || p[1] > '9' || p[2] < '0' || p[2] > '9' || month < 1 ||
+            month > 12 || day < 1 || day > 31)
+            return false;
+        days = calendar::daysFromDate(century * 100 + (p[1] - '0') * 10 + (p[2] - '0'), month, day);
+        return true;
+    }
+
+    // 1 - 9, then A = 10 to V = 31
+    static int packedDigit(char c) {
+        return c >= '1' && c <= '9' ? c - '0' : c >= 'A' && c <= 'V' ? c - 'A' + 10 : 0;
+    }
+
+    /**
+     * @brief Orbit axes in the scene frame and scale for KeplerSolver, mean anomalies referred to J2000
+     */
+    void prepare(ThreadPool& pool, float sceneScale) {
+        const std::size_t n = size();
+        p_SceneScale = sceneScale;
+        p_MeanAnomalyAtJ2000.resize(n);
+        p_SemiMajorAxis.resize(n); p_SemiMinorAxis.resize(n); p_Eccentricity.resize(n);
+        p_Px.resize(n); p_Py.resize(n); p_Pz.resize(n);
+        p_Qx.resize(n); p_Qy.resize(n); p_Qz.resize(n);
+        p_Positions.assign(3 * n, 0.0f);
+        p_Cursor = 0;
+        p_CostPerOrbit = 0.0;
+
+        pool.parallelFor(0, n, CHUNK * 4, [this, sceneScale](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                const KeplerElements orbit = elements(i);
+                double P[3], Q[3];
+                orbitBasis(orbit, P, Q);
+                const double e = orbit.eccentricity;
+                const double a = orbit.semiMajorAxis * sceneScale;
+                p_MeanAnomalyAtJ2000[i] = orbit.meanAnomalyAtEpoch;
+                p_SemiMajorAxis[i] = static_cast<float>(a);
+                p_SemiMinorAxis[i] = static_cast<float>(a * std::sqrt(1.0 - e * e));
+                p_Eccentricity[i] = static_cast<float>(e);
+
+                // ecliptic (x, y, z) -> scene (x, z, -y)
+                p_Px[i] = static_cast<float>(P[0]);
+                p_Py[i] = static_cast<float>(P[2]);
+                p_Pz[i] = static_cast<float>(-P[1]);
+                p_Qx[i] = static_cast<float>(Q[0]);
+                p_Qy[i] = static_cast<float>(Q[2]);
+                p_Qz[i] = static_cast<float>(-Q[1]);
+            }
+        });
+    }
+
+    void propagateRange(ThreadPool& pool, double days, std::size_t begin, std::size_t end) {
+        if (end <= begin)
+            return;
+        pool.parallelFor(begin, end, CHUNK * 4, [this, days](std::size_t chunkBegin, std::size_t chunkEnd) {
+            for (std::size_t i = chunkBegin; i < chunkEnd; i += CHUNK)
+                propagateChunk(days, i, i + CHUNK < chunkEnd ? i + CHUNK : chunkEnd);
+        });
+    }
+
+    void propagateChunk(double days, std::size_t begin, std::size_t end) {
+        float meanAnomaly[CHUNK], x[CHUNK], y[CHUNK], z[CHUNK];
+        const std::size_t n = end - begin;
+        KeplerSolver::meanAnomalies(n, &p_MeanAnomalyAtJ2000[begin], p_Fields[MEAN_MOTION] + begin, days,
+                                    meanAnomaly);
+        KeplerSolver::propagate(n, meanAnomaly, &p_Eccentricity[begin], &p_SemiMajorAxis[begin],
+                                &p_SemiMinorAxis[begin], &p_Px[begin], &p_Py[begin], &p_Pz[begin], &p_Qx[begin],
+                                &p_Qy[begin], &p_Qz[begin], x, y, z);
+        float* out = &p_Positions[3 * begin];
+        for (std::size_t k = 0; k < n; k++) {
+            out[3 * k + 0] = x[k];
+            out[3 * k + 1] = y[k];
+            out[3 * k + 2] = z[k];
+        }
+    }
+
+    // The cache mapping has a single owner
+    AsteroidCatalog(const AsteroidCatalog&);
+    AsteroidCatalog& operator=(const AsteroidCatalog&);
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_ASTEROIDCATALOG_HPP_
@@ -0,0 +1,444 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_BARNESHUT_HPP_
+#define INCLUDE_SOLAR_SYSTEM_BARNESHUT_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "DirectGravity.hpp"
+#include "Morton.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Barnes-Hut octree for approximate gravity in O(N log N).
+ *
+ * build() sorts the sources along a Morton curve with a parallel radix sort and splits
+ * the sorted range into octants; the subtrees below PARALLEL_DEPTH are built concurrently.
+ * accelerations() sorts the targets the same way, walks the tree once per group of
+ * neighbouring targets and hands the resulting interaction list (monopoles of far cells,
+ * particles of near leaves) to the SIMD kernel of DirectGravity.
+ *
+ * A cell is accepted as a monopole when size < theta * distance, measured from the
+ * cell's centre of mass to the nearest point of the target group's bounding box.
+ */
+class BarnesHutGravity {
+public:
+    static const std::size_t LEAF_SIZE = 16;
+    static const std::size_t GROUP_SIZE = 32;
+    static const int PARALLEL_DEPTH = 2;
+
+    /**
+     * @param[in] theta opening angle, smaller is more accurate and slower (0 is direct summation)
+     */
+    explicit BarnesHutGravity(double theta = 0.5) : p_Theta(theta) {}
+
+    void setTheta(double theta) { p_Theta = theta; }
+    double getTheta() const { return p_Theta; }
+    std::size_t nodeCount() const { return p_Nodes.size(); }
+
+    /**
+     * @brief Builds the tree over ns sources
+     *
+     * @param[in] sextent optional size of each source when it stands for a whole cell, see essentialSources()
+     */
+    void build(ThreadPool& pool, std::size_t ns,
+               const double* sx, const double* sy, const double* sz, const double* sgm,
+               const double* sextent = NULL) {
+        p_Nodes.clear();
+        if (ns == 0)
+            return;
+
+        p_Box = MortonBox::around(ns, sx, sy, sz);
+        sortAlongCurve(pool, ns, sx, sy, sz, p_Codes, p_Order);
+
+        p_X.resize(ns); p_Y.resize(ns); p_Z.resize(ns); p_GM.resize(ns);
+        p_Extent.resize(sextent != NULL ? ns : 0);
+        pool.parallelFor(0, ns, 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                std::uint32_t j = p_Order[i];
+                p_X[i] = sx[j]; p_Y[i] = sy[j]; p_Z[i] = sz[j]; p_GM[i] = sgm[j];
+                if (sextent != NULL)
+                    p_Extent[i] = sextent[j];
+            }
+        });
+
+        // Top of the tree serially, deeper subtrees become tasks
+        std::vector<Task> tasks;
+        std::vector<std::uint32_t> topInternal;
+        p_Nodes.push_back(Node());
+        buildTop(0, 0, ns, 0, p_Box.size, tasks, topInternal);
+
+        std::vector<std::vector<Node> > subtrees(tasks.size());
+        pool.parallelFor(0, tasks.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t t = begin; t < end; t++) {
+                subtrees[t].push_back(Node());
+                buildSubtree(subtrees[t], 0, tasks[t].begin, tasks[t].end, tasks[t].level, tasks[t].size);
+            }
+        });
+
+        // Stitch the subtrees in, local node k > 0 ends up at offset + k - 1
+        for (std::size_t t = 0; t < tasks.size(); t++) {
+            const std::vector<Node>& local = subtrees[t];
+            std::uint32_t offset = static_cast<std::uint32_t>(p_Nodes.size());
+            Node root = local[0];
+            if (root.childCount > 0)
+                root.firstChild += offset - 1;
+            p_Nodes[tasks[t].node] = root;
+            for (std::size_t k = 1; k < local.size(); k++) {
+                Node node = local[k];
+                if (node.childCount > 0)
+                    node.firstChild += offset - 1;
+                p_Nodes.push_back(node);
+            }
+        }
+
+        // Children always come after their parents, so a reverse pass sees them first
+        for (std::size_t k = topInternal.size(); k-- > 0;)
+            combineChildren(p_Nodes, topInternal[k]);
+    }
+
+    /**
+     * @brief Accelerations of n targets due to the sources of the last build()
+     *
+     * @param[in] accumulate add to the accelerations instead of overwriting them
+     */
+    void accelerations(ThreadPool& pool, double softening2,
+                       std::size_t n, const double* x, const double* y, const double* z,
+                       double* ax, double* ay, double* az, bool accumulate = false) {
+        if (n == 0)
+            return;
+        if (p_Nodes.empty()) {
+            if (!accumulate) {
+                std::fill(ax, ax + n, 0.0);
+                std::fill(ay, ay + n, 0.0);
+                std::fill(az, az + n, 0.0);
+            }
+            return;
+        }
+
+        sortAlongCurve(pool, n, x, y, z, p_TargetCodes, p_TargetOrder);
+
+        p_TargetX.resize(n); p_TargetY.resize(n); p_TargetZ.resize(n);
+        p_TargetAx.assign(n, 0.0); p_TargetAy.assign(n, 0.0); p_TargetAz.assign(n, 0.0);
+        pool.parallelFor(0, n, 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                std::uint32_t j = p_TargetOrder[i];
+                p_TargetX[i] = x[j]; p_TargetY[i] = y[j]; p_TargetZ[i] = z[j];
+            }
+        });
+
+        std::size_t groups = (n + GROUP_SIZE - 1) / GROUP_SIZE;
+        pool.parallelFor(0, groups, 8, [&](std::size_t groupBegin, std::size_t groupEnd) {
+            InteractionList list;
+            std::vector<std::uint32_t> stack;
+            for (std::size_t g = groupBegin; g < groupEnd; g++) {
+                std::size_t begin = g * GROUP_SIZE;
+                std::size_t end = std::min(begin + GROUP_SIZE, n);
+                collectInteractions(begin, end, list, stack);
+                DirectGravity::accumulateTile(softening2, begin, end,
+                                              p_TargetX.data(), p_TargetY.data(), p_TargetZ.data(),
+                                              0, list.gm.size(),
+                                              list.x.data(), list.y.data(), list.z.data(), list.gm.data(),
+                                              p_TargetAx.data(), p_TargetAy.data(), p_TargetAz.data());
+            }
+        });
+
+        pool.parallelFor(0, n, 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                std::uint32_t j = p_TargetOrder[i];
+                if (accumulate) {
+                    ax[j] += p_TargetAx[i]; ay[j] += p_TargetAy[i]; az[j] += p_TargetAz[i];
+                } else {
+                    ax[j] = p_TargetAx[i]; ay[j] = p_TargetAy[i]; az[j] = p_TargetAz[i];
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Sources that stand in for the whole tree anywhere inside some boxes, appended as x, y, z, gm, size
+     *
+     * Boxes are given as min x, y, z then max x, y, z; inside-out ones are skipped. Cells
+     * pass as monopoles only when they would for a target group filling the nearest box, so
+     * every group inside the boxes gets at least as accurate an answer from these as from
+     * the tree. Used to send another process the part of this tree its particles need; the
+     * sizes, 0 for plain sources, go to build() there so its cells account for them.
+     */
+    void essentialSources(const double* boxes, std::size_t count, std::vector<double>& out) const {
+        if (p_Nodes.empty())
+            return;
+        std::vector<std::uint32_t> stack;
+        walk(boxes, count, stack, [&](double x, double y, double z, double gm, double extent) {
+            out.push_back(x); out.push_back(y); out.push_back(z); out.push_back(gm); out.push_back(extent);
+        });
+    }
+
+    /**
+     * @brief Tight boxes around the sources of up to count cells that together hold all of them
+     *
+     * Splits the most populated cell until count would be exceeded, then appends each
+     * cell's box as min x, y, z then max x, y, z.
+     */
+    void sourceBoxes(std::size_t count, std::vector<double>& out) const {
+        if (p_Nodes.empty())
+            return;
+        std::vector<std::uint32_t> cells(1, 0);
+        for (;;) {
+            std::size_t largest = 0;
+            for (std::size_t k = 1; k < cells.size(); k++) {
+                const Node& node = p_Nodes[cells[k]];
+                if (node.end - node.begin > p_Nodes[cells[largest]].end - p_Nodes[cells[largest]].begin)
+                    largest = k;
+            }
+            const Node& node = p_Nodes[cells[largest]];
+            if (node.childCount == 0 || cells.size() - 1 + node.childCount > count)
+                break;
+            cells[largest] = node.firstChild;
+            for (std::uint32_t k = 1; k < node.childCount; k++)
+                cells.push_back(node.firstChild + k);
+        }
+        for (std::size_t k = 0; k < cells.size(); k++) {
+            const Node& node = p_Nodes[cells[k]];
+            double box[6] = { p_X[node.begin], p_Y[node.begin], p_Z[node.begin],
+                              p_X[node.begin], p_Y[node.begin], p_Z[node.begin] };
+            for (std::uint32_t i = node.begin + 1; i < node.end; i++) {
+                box[0] = std::min(box[0], p_X[i]); box[3] = std::max(box[3], p_X[i]);
+                box[1] = std::min(box[1], p_Y[i]); box[4] = std::max(box[4], p_Y[i]);
+                box[2] = std::min(box[2], p_Z[i]); box[5] = std::max(box[5], p_Z[i]);
+            }
+            out.insert(out.end(), box, box + 6);
+        }
+    }
+
+private:
+    struct Node {
+        double x, y, z, gm;         // centre of mass and total GM
+        double size;                // edge length of the cell
+        std::uint32_t firstChild;   // children are stored contiguously
+        std::uint32_t childCount;   // 0 for leaves
+        std::uint32_t begin, end;   // source range in Morton order
+
+        Node() : x(0.0), y(0.0), z(0.0), gm(0.0), size(0.0), firstChild(0), childCount(0), begin(0), end(0) {}
+    };
+
+    struct Task {
+        std::uint32_t node;
+        std::size_t begin, end;
+        int level;
+        double size;
+    };
+
+    struct InteractionList {
+        std::vector<double> x, y, z, gm;
+
+        void clear() { x.clear(); y.clear(); z.clear(); gm.clear(); }
+        void add(double px, double py, double pz, double pgm) {
+            x.push_back(px); y.push_back(py); z.push_back(pz); gm.push_back(pgm);
+        }
+    };
+
+    double p_Theta;
+    MortonBox p_Box;
+    std::vector<Node> p_Nodes;
+
+    // Sources in Morton order
+    std::vector<std::uint64_t> p_Codes;
+    std::vector<std::uint32_t> p_Order;
+    std::vector<double> p_X, p_Y, p_Z, p_GM;
+    std::vector<double> p_Extent;   // empty unless build() was given sizes
+
+    // Targets in Morton order
+    std::vector<std::uint64_t> p_TargetCodes;
+    std::vector<std::uint32_t> p_TargetOrder;
+    std::vector<double> p_TargetX, p_TargetY, p_TargetZ;
+    std::vector<double> p_TargetAx, p_TargetAy, p_TargetAz;
+
+    void sortAlongCurve(ThreadPool& pool, std::size_t n, const double* x, const double* y, const double* z,
+                        std::vector<std::uint64_t>& codes, std::vector<std::uint32_t>& order) const {
+        codes.resize(n);
+        order.resize(n);
+        const MortonBox box = p_Box;
+        pool.parallelFor(0, n, 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                codes[i] = box.code(x[i], y[i], z[i]);
+                order[i] = static_cast<std::uint32_t>(i);
+            }
+        });
+        radixSort(pool, codes, order);
+    }
+
+    bool isLeaf(std::size_t begin, std::size_t end, int level) const {
+        return end - begin <= LEAF_SIZE || level >= MORTON_BITS;
+    }
+
+    /**
+     * @brief Splits a sorted range into its non-empty octants, returns their count
+     */
+    int splitOctants(std::size_t begin, std::size_t end, int level, std::size_t bounds[9], int octants[8]) const {
+        const int shift = 3 * (MORTON_BITS - 1 - level);
+        const std::uint64_t* codes = p_Codes.data();
+        int count = 0;
+        std::size_t first = begin;
+        for (int octant = 0; octant < 8 && first < end; octant++) {
+            std::size_t last = std::partition_point(codes + first, codes + end, [=](std::uint64_t c) {
+                return static_cast<int>((c >> shift) & 7) <= octant;
+            }) - codes;
+            if (last > first) {
+                bounds[count] = first;
+                octants[count] = octant;
+                count++;
+            }
+            first = last;
+        }
+        bounds[count] = end;
+        return count;
+    }
+
+    void makeLeaf(Node& node, std::size_t begin, std::size_t end, double size) const {
+        // A source standing for a cell makes the leaf as large as that cell, for the opening test
+        node.size = size;
+        for (std::size_t i = begin; i < end && !p_Extent.empty(); i++)
+            node.size = std::max(node.size, size + p_Extent[i]);
+        node.begin = static_cast<std::uint32_t>(begin);
+        node.end = static_cast<std::uint32_t>(end);
+        node.childCount = 0;
+        double gm = 0.0, x = 0.0, y = 0.0, z = 0.0;
+        for (std::size_t i = begin; i < end; i++) {
+            gm += p_GM[i];
+            x += p_GM[i] * p_X[i]; y += p_GM[i] * p_Y[i]; z += p_GM[i] * p_Z[i];
+        }
+        node.gm = gm;
+        if (gm > 0.0) {
+            node.x = x / gm; node.y = y / gm; node.z = z / gm;
+        } else {
+            node.x = p_X[begin]; node.y = p_Y[begin]; node.z = p_Z[begin];
+        }
+    }
+
+    static void combineChildren(std::vector<Node>& nodes, std::uint32_t index) {
+        double gm = 0.0, x = 0.0, y = 0.0, z = 0.0, size = nodes[index].size;
+        const Node& parent = nodes[index];
+        for (std::uint32_t k = 0; k < parent.childCount; k++) {
+            const Node& child = nodes[parent.firstChild + k];
+            gm += child.gm;
+            x += child.gm * child.x; y += child.gm * child.y; z += child.gm * child.z;
+            // Whatever a child grew by beyond its half of the cell, the parent grows by too
+            size = std::max(size, child.size + 0.5 * parent.size);
+        }
+        Node& node = nodes[index];
+        node.gm = gm;
+        node.size = size;
+        if (gm > 0.0) {
+            node.x = x / gm; node.y = y / gm; node.z = z / gm;
+        }
+    }
+
+    void buildTop(std::uint32_t index, std::size_t begin, std::size_t end, int level, double size,
+                  std::vector<Task>& tasks, std::vector<std::uint32_t>& topInternal) {
+        if (isLeaf(begin, end, level)) {
+            makeLeaf(p_Nodes[index], begin, end, size);
+            return;
+        }
+        if (level >= PARALLEL_DEPTH) {
+            Task task = { index, begin, end, level, size };
+            tasks.push_back(task);
+            return;
+        }
+
+        std::size_t bounds[9];
+        int octants[8];
+        int count = splitOctants(begin, end, level, bounds, octants);
+
+        std::uint32_t first = static_cast<std::uint32_t>(p_Nodes.size());
+        p_Nodes[index].size = size;
+        p_Nodes[index].begin = static_cast<std::uint32_t>(begin);
+        p_Nodes[index].end = static_cast<std::uint32_t>(end);
+        p_Nodes[index].firstChild = first;
+        p_Nodes[index].childCount = count;
+        p_Nodes.resize(p_Nodes.size() + count);
+        topInternal.push_back(index);
+
+        for (int k = 0; k < count; k++)
+            buildTop(first + k, bounds[k], bounds[k + 1], level + 1, 0.5 * size, tasks, topInternal);
+    }
+
+    void buildSubtree(std::vector<Node>& nodes, std::uint32_t index, std::size_t begin, std::size_t end,
+                      int level, double size) const {
+        if (isLeaf(begin, end, level)) {
+            makeLeaf(nodes[index], begin, end, size);
+            return;
+        }
+
+        std::size_t bounds[9];
+        int octants[8];
+        int count = splitOctants(begin, end, level, bounds, octants);
+
+        std::uint32_t first = static_cast<std::uint32_t>(nodes.size());
+        nodes[index].size = size;
+        nodes[index].begin = static_cast<std::uint32_t>(begin);
+        nodes[index].end = static_cast<std::uint32_t>(end);
+        nodes[index].firstChild = first;
+        nodes[index].childCount = count;
+        nodes.resize(nodes.size() + count);
+
+        for (int k = 0; k < count; k++)
+            buildSubtree(nodes, first + k, bounds[k], bounds[k + 1], level + 1, 0.5 * size);
+        combineChildren(nodes, index);
+    }
+
+    /**
+     * @brief Walks the tree for targets [begin, end) and fills the interaction list
+     */
+    void collectInteractions(std::size_t begin, std::size_t end, InteractionList& list,
+                             std::vector<std::uint32_t>& stack) const {
+        double box[6] = { p_TargetX[begin], p_TargetY[begin], p_TargetZ[begin],
+                          p_TargetX[begin], p_TargetY[begin], p_TargetZ[begin] };
+        for (std::size_t i = begin + 1; i < end; i++) {
+            box[0] = std::min(box[0], p_TargetX[i]); box[3] = std::max(box[3], p_TargetX[i]);
+            box[1] = std::min(box[1], p_TargetY[i]); box[4] = std::max(box[4], p_TargetY[i]);
+            box[2] = std::min(box[2], p_TargetZ[i]); box[5] = std::max(box[5], p_TargetZ[i]);
+        }
+        list.clear();
+        walk(box, 1, stack, [&](double x, double y, double z, double gm, double) { list.add(x, y, z, gm); });
+    }
+
+    /**
+     * @brief Hands add() the monopoles of cells accepted for every point of the boxes and the sources of the rest
+     */
+    template <typename Add>
+    void walk(const double* boxes, std::size_t count, std::vector<std::uint32_t>& stack, Add add) const {
+        const double theta2 = p_Theta * p_Theta;
+        stack.clear();
+        stack.push_back(0);
+        while (!stack.empty()) {
+            const Node& node = p_Nodes[stack.back()];
+            stack.pop_back();
+
+            // Distance from the centre of mass to the nearest point of the boxes
+            double d2 = std::numeric_limits<double>::max();
+            for (std::size_t b = 0; b < count; b++) {
+                const double* box = boxes + 6 * b;
+                if (box[0] > box[3])
+                    continue;
+                double dx = std::max(std::max(box[0] - node.x, node.x - box[3]), 0.0);
+                double dy = std::max(std::max(box[1] - node.y, node.y - box[4]), 0.0);
+                double dz = std::max(std::max(box[2] - node.z, node.z - box[5]), 0.0);
+                d2 = std::min(d2, dx * dx + dy * dy + dz * dz);
+            }
+
+            if (node.size * node.size < theta2 * d2) {
+                add(node.x, node.y, node.z, node.gm, node.size);
+            } else if (node.childCount == 0) {
+                for (std::uint32_t i = node.begin; i < node.end; i++)
+                    add(p_X[i], p_Y[i], p_Z[i], p_GM[i], p_Extent.empty() ? 0.0 : p_Extent[i]);
+            } else {
+                for (std::uint32_t k = 0; k < node.childCount; k++)
+                    stack.push_back(node.firstChild + k);
+            }
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_BARNESHUT_HPP_
@@ -0,0 +1,197 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_BATCHEPHEMERIS_HPP_
+#define INCLUDE_SOLAR_SYSTEM_BATCHEPHEMERIS_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Kepler.hpp"
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Headless double precision orbit evaluation for arrays of (body, time) queries.
+ *
+ * Holds the same Kepler orbits the renderer's Ephemeris draws (Ephemeris::batch() copies
+ * them), without any OpenGL or windowing dependency. positions() answers "where is body
+ * b[i] at time t[i]" for every i: queries are split into chunks over the thread pool,
+ * each chunk gathers its orbits into small stack arrays and solves Kepler's equation on
+ * SIMD lanes in double precision. Nothing is allocated per call.
+ *
+ * Moons are evaluated relative to their parent and the parent's position at the same
+ * time is added, so every result is heliocentric, in ecliptic coordinates and AU.
+ */
+class BatchEphemeris {
+public:
+    static const std::uint32_t NO_PARENT = 0xffffffffu;
+    static const std::size_t CHUNK = 256;
+    static const int NEWTON_ITERATIONS = 8;
+
+    /**
+     * @brief Adds a body and returns its index for the query arrays
+     *
+     * @param[in] orbit elements relative to the parent, or heliocentric
+     * @param[in] parent index of an already added body, NO_PARENT for the sun
+     */
+    std::uint32_t addBody(const KeplerElements& orbit, std::uint32_t parent = NO_PARENT) {
+        double P[3], Q[3];
+        orbitBasis(orbit, P, Q);
+        const double e = orbit.eccentricity;
+        p_MeanAnomalyAtEpoch.push_back(orbit.meanAnomalyAtEpoch);
+        p_MeanMotion.push_back(orbit.meanMotion);
+        p_Eccentricity.push_back(e);
+        p_SemiMajorAxis.push_back(orbit.semiMajorAxis);
+        p_SemiMinorAxis.push_back(orbit.semiMajorAxis * std::sqrt(1.0 - e * e));
+        p_Px.push_back(P[0]); p_Py.push_back(P[1]); p_Pz.push_back(P[2]);
+        p_Qx.push_back(Q[0]); p_Qy.push_back(Q[1]); p_Qz.push_back(Q[2]);
+        if (parent >= p_Parent.size())
+            parent = NO_PARENT;
+        p_Parent.push_back(parent);
+        return static_cast<std::uint32_t>(p_Parent.size() - 1);
+    }
+
+    std::size_t size() const {
+        return p_Parent.size();
+    }
+
+    /**
+     * @brief Heliocentric positions of bodies[i] at days[i] for i < count
+     *
+     * @param[in] pool threads to spread the queries over
+     * @param[in] bodies body indices, all below size()
+     * @param[in] days times in days since J2000 (TDB)
+     * @param[out] x, y, z ecliptic positions in AU, count elements each
+     */
+    void positions(ThreadPool& pool, std::size_t count, const std::uint32_t* bodies, const double* days,
+                   double* x, double* y, double* z) const {
+        Query query = { this, bodies, days, x, y, z };
+        const Query* q = &query;
+        pool.parallelFor(0, count, CHUNK * 16, [q](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i += CHUNK)
+                q->self->evaluateChunk(*q, i, i + CHUNK < end ? i + CHUNK : end);
+        });
+    }
+
+private:
+    struct Query {
+        const BatchEphemeris* self;
+        const std::uint32_t* bodies;
+        const double* days;
+        double* x;
+        double* y;
+        double* z;
+    };
+
+    std::vector<double> p_MeanAnomalyAtEpoch;
+    std::vector<double> p_MeanMotion;           // rad / day
+    std::vector<double> p_Eccentricity;
+    std::vector<double> p_SemiMajorAxis;
+    std::vector<double> p_SemiMinorAxis;
+    std::vector<double> p_Px, p_Py, p_Pz;
+    std::vector<double> p_Qx, p_Qy, p_Qz;
+    std::vector<std::uint32_t> p_Parent;
+
+    /**
+     * @brief Answers queries [begin, end), at most CHUNK of them
+     */
+    void evaluateChunk(const Query& query, std::size_t begin, std::size_t end) const {
+        const std::size_t n = end - begin;
+        double x[CHUNK], y[CHUNK], z[CHUNK];
+        evaluate(n, query.bodies + begin, query.days + begin, query.x + begin, query.y + begin, query.z + begin);
+
+        // Walk up the hierarchy, one level per pass, for the queries that still have a parent
+        std::uint32_t parents[CHUNK], slots[CHUNK];
+        double days[CHUNK];
+        std::size_t pending = 0;
+        for (std::size_t k = 0; k < n; k++) {
+            std::uint32_t parent = p_Parent[query.bodies[begin + k]];
+            if (parent != NO_PARENT) {
+                parents[pending] = parent;
+                slots[pending] = static_cast<std::uint32_t>(k);
+                days[pending] = query.days[begin + k];
+                pending++;
+            }
+        }
+        while (pending > 0) {
+            evaluate(pending, parents, days, x, y, z);
+            std::size_t next = 0;
+            for (std::size_t k = 0; k < pending; k++) {
+                const std::size_t slot = begin + slots[k];
+                query.x[slot] += x[k];
+                query.y[slot] += y[k];
+                query.z[slot] += z[k];
+                std::uint32_t parent = p_Parent[parents[k]];
+                if (parent != NO_PARENT) {
+                    parents[next] = parent;
+                    slots[next] = slots[k];
+                    days[next] = days[k];
+                    next++;
+                }
+            }
+            pending = next;
+        }
+    }
+
+    /**
+     * @brief Positions of bodies[k] relative to their parents at days[k], n <= CHUNK
+     */
+    void evaluate(std::size_t n, const std::uint32_t* bodies, const double* days,
+                  double* x, double* y, double* z) const {
+        // Gather the orbits, mean anomalies wrapped into [-pi, pi] so the lanes need no reduction
+        double M[CHUNK], e[CHUNK], sinE[CHUNK], cosE[CHUNK];
+        const double inverseTwoPi = 1.0 / TWO_PI;
+        for (std::size_t k = 0; k < n; k++) {
+            const std::uint32_t b = bodies[k];
+            double mean = p_MeanAnomalyAtEpoch[b] + p_MeanMotion[b] * days[k];
+            M[k] = mean - TWO_PI * std::floor(mean * inverseTwoPi + 0.5);
+            e[k] = p_Eccentricity[b];
+        }
+
+        std::size_t k = 0;
+#if defined(SOLAR_SYSTEM_SIMD)
+        using namespace simd;
+        for (; k + DOUBLE_WIDTH <= n; k += DOUBLE_WIDTH) {
+            vdouble s, c;
+            solveLanes(load(M + k), load(e + k), s, c);
+            store(sinE + k, s);
+            store(cosE + k, c);
+        }
+#endif
+        for (; k < n; k++) {
+            double E = solveKepler(M[k], e[k]);
+            sinE[k] = std::sin(E);
+            cosE[k] = std::cos(E);
+        }
+
+        for (std::size_t k = 0; k < n; k++) {
+            const std::uint32_t b = bodies[k];
+            const double u = p_SemiMajorAxis[b] * (cosE[k] - e[k]);
+            const double v = p_SemiMinorAxis[b] * sinE[k];
+            x[k] = u * p_Px[b] + v * p_Qx[b];
+            y[k] = u * p_Py[b] + v * p_Qy[b];
+            z[k] = u * p_Pz[b] + v * p_Qz[b];
+        }
+    }
+
+#if defined(SOLAR_SYSTEM_SIMD)
+    /**
+     * @brief Fixed Newton iterations from Danby's start, enough for double precision up to e = 0.99
+     */
+    static void solveLanes(simd::vdouble M, simd::vdouble e, simd::vdouble& sinE, simd::vdouble& cosE) {
+        using namespace simd;
+        const vdouble one = set1d(1.0);
+        const vdouble step = mul(set1d(0.85), e);
+        vdouble E = add(M, select(less(M, set1d(0.0)), sub(set1d(0.0), step), step));
+        for (int k = 0; k < NEWTON_ITERATIONS; k++) {
+            sincos(E, sinE, cosE);
+            vdouble f = sub(sub(E, mul(e, sinE)), M);
+            vdouble fPrime = sub(one, mul(e, cosE));
+            E = sub(E, div(f, fPrime));
+        }
+        sincos(E, sinE, cosE);
+    }
+#endif
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_BATCHEPHEMERIS_HPP_
@@ -0,0 +1,127 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_BLOCKTIMESTEP_HPP_
+#define INCLUDE_SOLAR_SYSTEM_BLOCKTIMESTEP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Power-of-two timestep levels for a set of bodies.
+ *
+ * A block of length blockDt is divided into 2^maxLevel ticks. A body on level L steps
+ * every 2^(maxLevel - L) ticks, so all levels meet again at the end of the block. A body
+ * may move to a finer level at the end of any of its steps, but to a coarser one only
+ * where the coarser grid lines up with the current tick.
+ */
+class BlockScheduler {
+public:
+    /**
+     * @param[in] maxLevel finest level, steps are at least blockDt / 2^maxLevel
+     */
+    explicit BlockScheduler(int maxLevel = 12) : p_MaxLevel(maxLevel), p_Counts(maxLevel + 1, 0) {}
+
+    void setMaxLevel(int maxLevel) {
+        // Everyone goes back to level 0, the old levels are meaningless on the new grid
+        p_MaxLevel = maxLevel;
+        p_Levels.assign(p_Levels.size(), 0);
+        p_Counts.assign(maxLevel + 1, 0);
+        p_Counts[0] = p_Levels.size();
+    }
+
+    int getMaxLevel() const { return p_MaxLevel; }
+
+    /**
+     * @brief Tracks n bodies, new ones start on level 0
+     */
+    void resize(std::size_t n) {
+        for (std::size_t i = n; i < p_Levels.size(); i++)
+            p_Counts[p_Levels[i]]--;
+        if (n > p_Levels.size())
+            p_Counts[0] += n - p_Levels.size();
+        p_Levels.resize(n, 0);
+    }
+
+    std::size_t size() const { return p_Levels.size(); }
+    int getLevel(std::size_t i) const { return p_Levels[i]; }
+
+    /**
+     * @brief Number of bodies on each level, index 0 is the full block step
+     */
+    const std::vector<std::size_t>& levelCounts() const { return p_Counts; }
+
+    /**
+     * @brief Finest level that holds any body
+     */
+    int deepestLevel() const {
+        for (int level = p_MaxLevel; level > 0; level--) {
+            if (p_Counts[level] > 0)
+                return level;
+        }
+        return 0;
+    }
+
+    std::uint64_t ticksPerBlock() const { return std::uint64_t(1) << p_MaxLevel; }
+    std::uint64_t stepTicks(int level) const { return std::uint64_t(1) << (p_MaxLevel - level); }
+
+    /**
+     * @brief Smallest level whose step blockDt / 2^level does not exceed dt
+     */
+    int levelFor(double dt, double blockDt) const {
+        int level = 0;
+        while (level < p_MaxLevel && blockDt > dt) {
+            blockDt *= 0.5;
+            level++;
+        }
+        return level;
+    }
+
+    /**
+     * @brief True when body i starts or ends a step at tick
+     */
+    bool onBoundary(std::size_t i, std::uint64_t tick) const {
+        return tick % stepTicks(p_Levels[i]) == 0;
+    }
+
+    /**
+     * @brief Next tick after tick at which any body is on a boundary
+     */
+    std::uint64_t nextTick(std::uint64_t tick) const {
+        std::uint64_t step = stepTicks(deepestLevel());
+        return (tick / step + 1) * step;
+    }
+
+    /**
+     * @brief Moves body i to any level, only valid while all bodies are synchronised
+     */
+    void setLevel(std::size_t i, int level) {
+        if (level > p_MaxLevel)
+            level = p_MaxLevel;
+        p_Counts[p_Levels[i]]--;
+        p_Counts[level]++;
+        p_Levels[i] = level;
+    }
+
+    /**
+     * @brief Moves body i, which just finished a step at tick, towards the wanted level
+     *
+     * Finer levels are always allowed. Coarser ones are taken one at a time, as far as the
+     * coarser step boundaries coincide with tick.
+     */
+    void requestLevel(std::size_t i, int wanted, std::uint64_t tick) {
+        int level = p_Levels[i];
+        if (wanted >= level) {
+            setLevel(i, wanted);
+            return;
+        }
+        while (level > wanted && tick % stepTicks(level - 1) == 0)
+            level--;
+        setLevel(i, level);
+    }
+
+private:
+    int p_MaxLevel;
+    std::vector<int> p_Levels;
+    std::vector<std::size_t> p_Counts;
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_BLOCKTIMESTEP_HPP_
@@ -0,0 +1,128 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_BRENT_HPP_
+#define INCLUDE_SOLAR_SYSTEM_BRENT_HPP_
+
+#include <algorithm>
+#include <cmath>
+
+#include "Kepler.hpp"
+
+/**
+ * @brief Brent's root finder on [a, b] with f(a) and f(b) of opposite signs, to a second
+ */
+template <typename Function>
+inline double brentRoot(const Function& f, double a, double b, double fa, double fb) {
+    const double tolerance = 1.0 / SECONDS_PER_DAY;
+    double c = a, fc = fa, d = b - a, e = d;
+    for (int iteration = 0; iteration < 100; iteration++) {
+        if ((fb > 0.0) == (fc > 0.0)) {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (std::fabs(fc) < std::fabs(fb)) {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+        const double tol = 2.0 * 1e-15 * std::fabs(b) + 0.5 * tolerance;
+        const double m = 0.5 * (c - b);
+        if (std::fabs(m) <= tol || fb == 0.0)
+            return b;
+        if (std::fabs(e) >= tol && std::fabs(fa) > std::fabs(fb)) {
+            // Secant or inverse quadratic interpolation
+            double p, q, s = fb / fa;
+            if (a == c) {
+                p = 2.0 * m * s;
+                q = 1.0 - s;
+            } else {
+                const double r = fb / fc, t = fa / fc;
+                p = s * (2.0 * m * t * (t - r) - (b - a) * (r - 1.0));
+                q = (t - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0)
+                q = -q;
+            else
+                p = -p;
+            if (2.0 * p < std::min(3.0 * m * q - std::fabs(tol * q), std::fabs(e * q))) {
+                e = d;
+                d = p / q;
+            } else {
+                d = m;
+                e = m;
+            }
+        } else {
+            d = m;
+            e = m;
+        }
+        a = b;
+        fa = fb;
+        b += std::fabs(d) > tol ? d : (m > 0.0 ? tol : -tol);
+        fb = f(b);
+    }
+    return b;
+}
+
+/**
+ * @brief Brent's minimiser (golden section with parabolic steps) on [a, b], to a second
+ */
+template <typename Function>
+inline double brentMinimum(const Function& f, double a, double b, double& least) {
+    const double golden = 0.3819660112501051;
+    const double tolerance = 1.0 / SECONDS_PER_DAY;
+    double x = a + golden * (b - a), w = x, v = x;
+    double fx = f(x), fw = fx, fv = fx;
+    double d = 0.0, e = 0.0;
+    for (int iteration = 0; iteration < 100; iteration++) {
+        const double middle = 0.5 * (a + b);
+        const double tol = 1e-15 * std::fabs(x) + tolerance / 3.0;
+        if (std::fabs(x - middle) <= 2.0 * tol - 0.5 * (b - a))
+            break;
+        bool parabolic = false;
+        if (std::fabs(e) > tol) {
+            double r = (x - w) * (fx - fv);
+            double q = (x - v) * (fx - fw);
+            double p = (x - v) * q - (x - w) * r;
+            q = 2.0 * (q - r);
+            if (q > 0.0)
+                p = -p;
+            else
+                q = -q;
+            if (std::fabs(p) < std::fabs(0.5 * q * e) && p > q * (a - x) && p < q * (b - x)) {
+                e = d;
+                d = p / q;
+                if ((x + d) - a < 2.0 * tol || b - (x + d) < 2.0 * tol)
+                    d = x < middle ? tol : -tol;
+                parabolic = true;
+            }
+        }
+        if (!parabolic) {
+            e = (x < middle ? b : a) - x;
+            d = golden * e;
+        }
+        const double u = x + (std::fabs(d) >= tol ? d : (d > 0.0 ? tol : -tol));
+        const double fu = f(u);
+        if (fu <= fx) {
+            if (u < x)
+                b = x;
+            else
+                a = x;
+            v = w; fv = fw;
+            w = x; fw = fx;
+            x = u; fx = fu;
+        } else {
+            if (u < x)
+                a = u;
+            else
+                b = u;
+            if (fu <= fw || w == x) {
+                v = w; fv = fw;
+                w = u; fw = fu;
+            } else if (fu <= fv || v == x || v == w) {
+                v = u; fv = fu;
+            }
+        }
+    }
+    least = fx;
+    return x;
+}
+
+#endif  // INCLUDE_SOLAR_SYSTEM_BRENT_HPP_
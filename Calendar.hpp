@@ -0,0 +1,74 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_CALENDAR_HPP_
+#define INCLUDE_SOLAR_SYSTEM_CALENDAR_HPP_
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * @brief Conversions between days since J2000 and proleptic Gregorian calendar dates.
+ *
+ * Uses Howard Hinnant's days_from_civil / civil_from_days; J2000 (2000-01-01 12:00) is
+ * day 10957.5 after 1970-01-01. No time scale conversion is done, the dates are in the
+ * scale the days are in (TDB for the ephemerides).
+ */
+namespace calendar {
+
+inline double daysFromDate(int year, int month, int day, double hours = 0.0) {
+    year -= month <= 2;
+    const long era = (year >= 0 ? year : year - 399) / 400;
+    const long yearOfEra = year - era * 400;
+    const long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097.0 + dayOfEra - 719468.0 - 10957.5 + hours / 24.0;
+}
+
+inline void dateFromDays(double days, int& year, int& month, int& day, double& hours) {
+    const double shifted = days + 10957.5;
+    const double whole = std::floor(shifted);
+    hours = (shifted - whole) * 24.0;
+    const long z = static_cast<long>(whole) + 719468;
+    const long era = (z >= 0 ? z : z - 146096) / 146097;
+    const long dayOfEra = z - era * 146097;
+    const long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const long mp = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(yearOfEra + era * 400 + (month <= 2));
+}
+
+/**
+ * @brief YYYY-MM-DD, followed by hh:mm when withTime is set
+ */
+inline std::string format(double days, bool withTime = false) {
+    int year, month, day;
+    double hours;
+    dateFromDays(days, year, month, day, hours);
+    int minutes = static_cast<int>(std::floor(hours * 60.0 + 0.5));
+    if (withTime && minutes == 24 * 60) {
+        dateFromDays(std::floor(days + 0.5) + 0.5, year, month, day, hours);
+        minutes = 0;
+    }
+    char text[64];
+    if (withTime)
+        std::snprintf(text, sizeof(text), "%04d-%02d-%02d %02d:%02d", year, month, day, minutes / 60, minutes % 60);
+    else
+        std::snprintf(text, sizeof(text), "%04d-%02d-%02d", year, month, day);
+    return text;
+}
+
+/**
+ * @brief Days since J2000 from YYYY-MM-DD (at 0h) or a plain number of days
+ */
+inline double parse(const char* text) {
+    int year, month, day;
+    if (std::sscanf(text, "%d-%d-%d", &year, &month, &day) == 3)
+        return daysFromDate(year, month, day);
+    return std::atof(text);
+}
+
+}  // namespace calendar
+
+#endif  // INCLUDE_SOLAR_SYSTEM_CALENDAR_HPP_
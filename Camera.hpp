@@ -100,6 +100,16 @@ public:
         updateCameraVectors();
     }
 
+    // restores a saved view, e.g. from a snapshot
+    void SetView(glm::vec3 position, float yaw, float pitch, float zoom) {
+        Position = position;
+        Yaw = yaw;
+        Pitch = pitch;
+        Zoom = zoom;
+        isOrbiting = false;
+        updateCameraVectors();
+    }
+
     // process input from keyboard-like
     void ProcessKeyboard(Camera_Movement direction, float deltaTime) {
         float velocity = MovementSpeed * deltaTime;
@@ -0,0 +1,478 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_CLOSEAPPROACHES_HPP_
+#define INCLUDE_SOLAR_SYSTEM_CLOSEAPPROACHES_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AsteroidCatalog.hpp"
+#include "Brent.hpp"
+#include "Calendar.hpp"
+#include "Kepler.hpp"
+#include "Morton.hpp"
+#include "ThreadPool.hpp"
+
+const double APPROACH_DUPLICATE_DAYS = 0.01;      // minima closer than this are the same approach
+const double APPROACH_STEP_DAYS = 1.0 / 1440.0;   // one minute, to tell a minimum from a slope
+
+/**
+ * @brief An object within the screening distance of the body, at its closest
+ */
+struct CloseApproach {
+    std::uint32_t object;       // index into the orbits the index was built from
+    double days;                // days since J2000
+    double distance;            // AU
+    double speed;               // relative speed, AU / day
+};
+
+/**
+ * @brief Time-bucketed bounding volume hierarchies over a large set of two-body orbits, for
+ * screening them against one body's path.
+ *
+ * The span the index covers is cut into buckets of equal length. In every bucket each
+ * orbit gets the box swept by its arc: the box around both end positions, grown by
+ * A dt^2 / 8, the farthest an arc with acceleration at most A (the sun's pull at
+ * perihelion) strays from its chord. The boxes are sorted along a Morton curve of their
+ * centres with the parallel radix sort, LEAF of them make a leaf and the tree is built
+ * bottom up by pairing neighbours, so it needs no pointers: level k holds half as many
+ * nodes as level k - 1. A bucket stores the object order and the node boxes, in floats
+ * rounded outwards.
+ *
+ * A query sweeps the body's box through the buckets, grown by the screening distance, and
+ * refines the objects whose own box it meets. The refinement is exact: the distance is
+ * sampled SAMPLES times per bucket, a sample interval is only searched with Brent's
+ * method when the largest relative speed could bring the distance below the limit within
+ * it, and a local minimum under the limit is an approach. Building and queries both run
+ * on the thread pool, and scan() gives the same answer without the index.
+ *
+ * Memory is about 9 bytes per orbit and bucket, plus 88 bytes per orbit.
+ */
+class CloseApproachIndex {
+public:
+    static const std::size_t LEAF = 16;
+    static const int SAMPLES = 16;
+    static const std::size_t GRAIN = 4096;
+
+    CloseApproachIndex() : p_First(0.0), p_Last(0.0), p_BucketDays(0.0), p_Buckets(0), p_NodesPerBucket(0) {}
+
+    /**
+     * @brief Takes the orbits of an asteroid catalog, dropping any index built before
+     */
+    void setOrbits(ThreadPool& pool, const AsteroidCatalog& catalog) {
+        resize(catalog.size());
+        pool.parallelFor(0, catalog.size(), GRAIN, [this, &catalog](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                p_Orbits[i] = Orbit(catalog.elements(i));
+        });
+    }
+
+    void setOrbits(const std::vector<KeplerElements>& orbits) {
+        resize(orbits.size());
+        for (std::size_t i = 0; i < orbits.size(); i++)
+            p_Orbits[i] = Orbit(orbits[i]);
+    }
+
+    /**
+     * @brief Builds the trees for [first, last] in days since J2000, one per bucketDays
+     */
+    void build(ThreadPool& pool, double first, double last, double bucketDays) {
+        const std::size_t n = p_Orbits.size();
+        p_First = first;
+        p_BucketDays = bucketDays;
+        p_Buckets = n > 0 && last > first && bucketDays > 0.0
+                        ? static_cast<std::size_t>(std::ceil((last - first) / bucketDays)) : 0;
+        p_Last = p_Buckets > 0 ? last : first;
+        p_Levels.clear();
+        std::size_t count = (n + LEAF - 1) / LEAF, offset = 0;
+        while (count > 0) {
+            p_Levels.push_back(Level(offset, count));
+            offset += count;
+            count = count > 1 ? (count + 1) / 2 : 0;
+        }
+        p_NodesPerBucket = offset;
+        p_Order.resize(p_Buckets * n);
+        p_Nodes.resize(p_Buckets * p_NodesPerBucket);
+
+        std::vector<Box> boxes(n);
+        std::vector<double> cx(n), cy(n), cz(n);
+        std::vector<std::uint64_t> keys(n);
+        std::vector<std::uint32_t> order(n);
+        // Positions at the bucket boundaries, each one is the end of a bucket and the start of the next
+        std::vector<double> starts(3 * n), ends(3 * n);
+        pool.parallelFor(0, p_Buckets > 0 ? n : 0, GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                p_Orbits[i].position(first, &starts[3 * i]);
+        });
+        for (std::size_t b = 0; b < p_Buckets; b++) {
+            const double t0 = first + b * bucketDays, t1 = std::min(t0 + bucketDays, last);
+            pool.parallelFor(0, n, GRAIN, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; i++) {
+                    double lo[3], hi[3];
+                    p_Orbits[i].position(t1, &ends[3 * i]);
+                    Orbit::bound(&starts[3 * i], &ends[3 * i], p_Orbits[i].chordMargin(t1 - t0), lo, hi);
+                    boxes[i] = Box(lo, hi);
+                    cx[i] = 0.5 * (lo[0] + hi[0]);
+                    cy[i] = 0.5 * (lo[1] + hi[1]);
+                    cz[i] = 0.5 * (lo[2] + hi[2]);
+                }
+            });
+            const MortonBox cube = MortonBox::around(n, cx.data(), cy.data(), cz.data());
+            pool.parallelFor(0, n, GRAIN, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; i++) {
+                    keys[i] = cube.code(cx[i], cy[i], cz[i]);
+                    order[i] = static_cast<std::uint32_t>(i);
+                }
+            });
+            starts.swap(ends);
+            radixSort(pool, keys, order);
+            std::copy(order.begin(), order.end(), p_Order.begin() + b * n);
+
+            Box* nodes = &p_Nodes[b * p_NodesPerBucket];
+            pool.parallelFor(0, p_Levels[0].count, GRAIN / LEAF, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t leaf = begin; leaf < end; leaf++) {
+                    const std::size_t stop = std::min((leaf + 1) * LEAF, n);
+                    Box box = boxes[order[leaf * LEAF]];
+                    for (std::size_t k = leaf * LEAF + 1; k < stop; k++)
+                        box.grow(boxes[order[k]]);
+                    nodes[leaf] = box;
+                }
+            });
+            for (std::size_t level = 1; level < p_Levels.size(); level++) {
+                const Level below = p_Levels[level - 1], here = p_Levels[level];
+                pool.parallelFor(0, here.count, GRAIN, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t k = begin; k < end; k++) {
+                        Box box = nodes[below.offset + 2 * k];
+                        if (2 * k + 1 < below.count)
+                            box.grow(nodes[below.offset + 2 * k + 1]);
+                        nodes[here.offset + k] = box;
+                    }
+                });
+            }
+        }
+    }
+
+    /**
+     * @brief Every approach of an orbit to within distance AU of the body during [first, last],
+     * clipped to the span the index was built for, in time order
+     *
+     * @return number of approaches
+     */
+    std::size_t query(ThreadPool& pool, const KeplerElements& body, double first, double last, double distance,
+                      std::vector<CloseApproach>& approaches) const {
+        return search(pool, body, first, last, distance, approaches, true, 0);
+    }
+
+    /**
+     * @brief query() without the index, refining each of the first count orbits in every bucket
+     */
+    std::size_t scan(ThreadPool& pool, const KeplerElements& body, double first, double last, double distance,
+                     std::vector<CloseApproach>& approaches, std::size_t count) const {
+        return search(pool, body, first, last, distance, approaches, false, std::min(count, p_Orbits.size()));
+    }
+
+    /**
+     * @brief Writes approaches as CSV with dates, distances in AU and speeds in km/s
+     *
+     * @param[in] catalog source of the designations, NULL to write orbit indices instead
+     */
+    static bool write(const std::string& path, const std::vector<CloseApproach>& approaches,
+                      const AsteroidCatalog* catalog, double kmPerAu) {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == NULL)
+            return false;
+        std::fprintf(file, "object,date,days,distance_au,speed_km_s\n");
+        for (std::size_t i = 0; i < approaches.size(); i++) {
+            const CloseApproach& a = approaches[i];
+            if (catalog != NULL)
+                std::fprintf(file, "%s", catalog->designation(a.object).c_str());
+            else
+                std::fprintf(file, "%u", a.object);
+            std::fprintf(file, ",%s,%.6f,%.8f,%.4f\n", calendar::format(a.days, true).c_str(), a.days, a.distance,
+                         a.speed * kmPerAu / SECONDS_PER_DAY);
+        }
+        return std::fclose(file) == 0;
+    }
+
+    std::size_t size() const { return p_Orbits.size(); }
+    std::size_t buckets() const { return p_Buckets; }
+    double first() const { return p_First; }
+    double last() const { return p_Last; }
+
+    /**
+     * @brief Bytes held by the orbits and the trees
+     */
+    std::size_t memory() const {
+        return p_Orbits.size() * sizeof(Orbit) + p_Order.size() * sizeof(std::uint32_t) + p_Nodes.size() * sizeof(Box);
+    }
+
+private:
+    /**
+     * @brief Two-body orbit around the sun with its basis vectors, evaluated in double precision
+     */
+    struct Orbit {
+        double P[3], Q[3];
+        double a, b, e, n, M0;
+
+        Orbit() : a(0.0), b(0.0), e(0.0), n(0.0), M0(0.0) {
+            P[0] = P[1] = P[2] = Q[0] = Q[1] = Q[2] = 0.0;
+        }
+
+        explicit Orbit(const KeplerElements& orbit)
+            : a(orbit.semiMajorAxis), b(orbit.semiMajorAxis * std::sqrt(1.0 - orbit.eccentricity * orbit.eccentricity)),
+              e(orbit.eccentricity), n(orbit.meanMotion), M0(orbit.meanAnomalyAtEpoch) {
+            orbitBasis(orbit, P, Q);
+        }
+
+        void position(double t, double r[3]) const {
+            const double E = solveKepler(M0 + n * t, e);
+            const double u = a * (std::cos(E) - e), v = b * std::sin(E);
+            for (int k = 0; k < 3; k++)
+                r[k] = u * P[k] + v * Q[k];
+        }
+
+        void velocity(double t, double v[3]) const {
+            const double E = solveKepler(M0 + n * t, e);
+            const double scale = a * n / (1.0 - e * std::cos(E));
+            const double u = -scale * std::sin(E), w = scale * std::sqrt(1.0 - e * e) * std::cos(E);
+            for (int k = 0; k < 3; k++)
+                v[k] = u * P[k] + w * Q[k];
+        }
+
+        // Speed at perihelion, the fastest on the orbit
+        double topSpeed() const {
+            return a * n * std::sqrt((1.0 + e) / (1.0 - e));
+        }
+
+        /**
+         * @brief Farthest an arc of dt days strays from its chord, with the acceleration at perihelion
+         */
+        double chordMargin(double dt) const {
+            const double q = a * (1.0 - e);
+            return q > 0.0 ? a * a * a * n * n / (q * q) * dt * dt / 8.0 : 0.0;
+        }
+
+        /**
+         * @brief Box around the arc over [t0, t1], grown by margin
+         */
+        void sweep(double t0, double t1, double margin, double lo[3], double hi[3]) const {
+            double r0[3], r1[3];
+            position(t0, r0);
+            position(t1, r1);
+            bound(r0, r1, margin + chordMargin(t1 - t0), lo, hi);
+        }
+
+        static void bound(const double r0[3], const double r1[3], double grow, double lo[3], double hi[3]) {
+            for (int k = 0; k < 3; k++) {
+                lo[k] = std::min(r0[k], r1[k]) - grow;
+                hi[k] = std::max(r0[k], r1[k]) + grow;
+            }
+        }
+    };
+
+    struct Box {
+        float lo[3], hi[3];
+
+        Box() {
+            lo[0] = lo[1] = lo[2] = hi[0] = hi[1] = hi[2] = 0.0f;
+        }
+
+        Box(const double l[3], const double h[3]) {
+            for (int k = 0; k < 3; k++) {
+                lo[k] = lower(l[k]);
+                hi[k] = upper(h[k]);
+            }
+        }
+
+        void grow(const Box& other) {
+            for (int k = 0; k < 3; k++) {
+                lo[k] = std::min(lo[k], other.lo[k]);
+                hi[k] = std::max(hi[k], other.hi[k]);
+            }
+        }
+
+        bool overlaps(const Box& other) const {
+            return lo[0] <= other.hi[0] && other.lo[0] <= hi[0] && lo[1] <= other.hi[1] && other.lo[1] <= hi[1] &&
+                   lo[2] <= other.hi[2] && other.lo[2] <= hi[2];
+        }
+
+        // Floats that keep the double box inside
+        static float lower(double v) {
+            const float f = static_cast<float>(v);
+            return f > v ? std::nextafter(f, -HUGE_VALF) : f;
+        }
+
+        static float upper(double v) {
+            const float f = static_cast<float>(v);
+            return f < v ? std::nextafter(f, HUGE_VALF) : f;
+        }
+    };
+
+    struct Level {
+        std::size_t offset, count;
+        Level(std::size_t o, std::size_t c) : offset(o), count(c) {}
+    };
+
+    // Distance between an orbit and the body, handed to brentMinimum()
+    struct Separation {
+        const Orbit* object;
+        const Orbit* body;
+        double operator()(double t) const {
+            double r[3], s[3];
+            object->position(t, r);
+            body->position(t, s);
+            return std::sqrt((r[0] - s[0]) * (r[0] - s[0]) + (r[1] - s[1]) * (r[1] - s[1]) +
+                             (r[2] - s[2]) * (r[2] - s[2]));
+        }
+    };
+
+    std::vector<Orbit> p_Orbits;
+    double p_First;
+    double p_Last;                          // end of the span, the last bucket stops there
+    double p_BucketDays;
+    std::size_t p_Buckets;
+    std::vector<Level> p_Levels;
+    std::size_t p_NodesPerBucket;
+    std::vector<std::uint32_t> p_Order;     // bucket-major, object order along the Morton curve
+    std::vector<Box> p_Nodes;               // bucket-major, leaves first and the root last
+
+    void resize(std::size_t n) {
+        p_Orbits.assign(n, Orbit());
+        p_Buckets = 0;
+        p_Last = p_First;
+        p_Order.clear();
+        p_Nodes.clear();
+    }
+
+    std::size_t search(ThreadPool& pool, const KeplerElements& bodyElements, double first, double last,
+                       double distance, std::vector<CloseApproach>& approaches, bool indexed,
+                       std::size_t count) const {
+        const Orbit body(bodyElements);
+        first = std::max(first, this->first());
+        last = std::min(last, this->last());
+        approaches.clear();
+        if (!(last > first) || p_Buckets == 0)
+            return 0;
+        const std::size_t firstBucket = static_cast<std::size_t>((first - p_First) / p_BucketDays);
+        const std::size_t lastBucket =
+            std::min(p_Buckets, static_cast<std::size_t>(std::ceil((last - p_First) / p_BucketDays)));
+
+        std::vector<std::vector<CloseApproach> > found(lastBucket - firstBucket);
+        pool.parallelFor(firstBucket, lastBucket, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; b++) {
+                const double t0 = std::max(first, p_First + b * p_BucketDays);
+                const double t1 = std::min(last, p_First + (b + 1) * p_BucketDays);
+                std::vector<CloseApproach>& out = found[b - firstBucket];
+                if (indexed) {
+                    searchBucket(b, body, t0, t1, first, last, distance, out);
+                } else {
+                    for (std::size_t i = 0; i < count; i++)
+                        refine(static_cast<std::uint32_t>(i), body, t0, t1, first, last, distance, out);
+                }
+            }
+        });
+
+        for (std::size_t k = 0; k < found.size(); k++)
+            approaches.insert(approaches.end(), found[k].begin(), found[k].end());
+        // A minimum on a bucket or sample boundary is found from both sides
+        std::sort(approaches.begin(), approaches.end(), [](const CloseApproach& a, const CloseApproach& b) {
+            return a.object != b.object ? a.object < b.object : a.days < b.days;
+        });
+        std::size_t kept = 0;
+        for (std::size_t k = 0; k < approaches.size(); k++) {
+            if (kept > 0 && approaches[kept - 1].object == approaches[k].object &&
+                approaches[k].days - approaches[kept - 1].days < APPROACH_DUPLICATE_DAYS) {
+                if (approaches[k].distance < approaches[kept - 1].distance)
+                    approaches[kept - 1] = approaches[k];
+                continue;
+            }
+            approaches[kept++] = approaches[k];
+        }
+        approaches.resize(kept);
+        std::sort(approaches.begin(), approaches.end(), [](const CloseApproach& a, const CloseApproach& b) {
+            return a.days < b.days;
+        });
+        return approaches.size();
+    }
+
+    /**
+     * @brief Descends bucket b's tree with the body's box over [t0, t1] and refines what it meets
+     */
+    void searchBucket(std::size_t b, const Orbit& body, double t0, double t1, double first, double last,
+                      double distance, std::vector<CloseApproach>& out) const {
+        const std::size_t n = p_Orbits.size();
+        double lo[3], hi[3];
+        body.sweep(t0, t1, distance, lo, hi);
+        const Box reach(lo, hi);
+        const Box* nodes = &p_Nodes[b * p_NodesPerBucket];
+        const std::uint32_t* order = &p_Order[b * n];
+
+        std::vector<std::pair<std::size_t, std::size_t> > stack(1, std::make_pair(p_Levels.size() - 1, 0));
+        while (!stack.empty()) {
+            const std::size_t level = stack.back().first, k = stack.back().second;
+            stack.pop_back();
+            if (!nodes[p_Levels[level].offset + k].overlaps(reach))
+                continue;
+            if (level > 0) {
+                stack.push_back(std::make_pair(level - 1, 2 * k));
+                if (2 * k + 1 < p_Levels[level - 1].count)
+                    stack.push_back(std::make_pair(level - 1, 2 * k + 1));
+                continue;
+            }
+            const std::size_t end = std::min((k + 1) * LEAF, n);
+            for (std::size_t j = k * LEAF; j < end; j++) {
+                double objectLo[3], objectHi[3];
+                p_Orbits[order[j]].sweep(t0, t1, 0.0, objectLo, objectHi);
+                if (Box(objectLo, objectHi).overlaps(reach))
+                    refine(order[j], body, t0, t1, first, last, distance, out);
+            }
+        }
+    }
+
+    /**
+     * @brief Local minima of the distance below the limit during [t0, t1]; the ends of the
+     * query window count as minima, the object may be inside the limit when it starts or ends
+     */
+    void refine(std::uint32_t object, const Orbit& body, double t0, double t1, double first, double last,
+                double distance, std::vector<CloseApproach>& out) const {
+        const Orbit& orbit = p_Orbits[object];
+        const Separation separation = { &orbit, &body };
+        const double h = (t1 - t0) / SAMPLES;
+        const double speed = orbit.topSpeed() + body.topSpeed();
+        double previous = separation(t0);
+        for (int k = 0; k < SAMPLES; k++) {
+            const double a = t0 + k * h, b = k + 1 == SAMPLES ? t1 : a + h;
+            const double next = separation(b);
+            // The distance changes no faster than the relative speed
+            const bool reachable = 0.5 * (previous + next - speed * (b - a)) <= distance;
+            previous = next;
+            if (!reachable)
+                continue;
+
+            double least;
+            const double t = brentMinimum(separation, a, b, least);
+            const bool atWindowEdge = t - first < APPROACH_STEP_DAYS || last - t < APPROACH_STEP_DAYS;
+            if (!(least <= distance) ||
+                (!atWindowEdge && (separation(t - APPROACH_STEP_DAYS) < least || separation(t + APPROACH_STEP_DAYS) < least)))
+                continue;
+
+            CloseApproach approach;
+            approach.object = object;
+            approach.days = t;
+            approach.distance = least;
+            double v[3], w[3];
+            orbit.velocity(t, v);
+            body.velocity(t, w);
+            approach.speed = std::sqrt((v[0] - w[0]) * (v[0] - w[0]) + (v[1] - w[1]) * (v[1] - w[1]) +
+                                       (v[2] - w[2]) * (v[2] - w[2]));
+            out.push_back(approach);
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_CLOSEAPPROACHES_HPP_
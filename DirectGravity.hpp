@@ -0,0 +1,104 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_DIRECTGRAVITY_HPP_
+#define INCLUDE_SOLAR_SYSTEM_DIRECTGRAVITY_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Direct O(N^2) summation of gravitational accelerations.
+ *
+ * Targets are split into blocks across the thread pool. Each block walks the sources
+ * in cache sized tiles and keeps DOUBLE_WIDTH targets per SIMD register, so the inner
+ * loop only broadcasts one source at a time and needs no horizontal reductions.
+ */
+class DirectGravity {
+public:
+    static const std::size_t TARGET_BLOCK = 256;
+    static const std::size_t SOURCE_TILE = 512;
+
+    /**
+     * @brief Accelerations of all n targets due to the ns sources
+     *
+     * @param[in] softening2 squared softening length, zero for point masses
+     * @param[in] accumulate add to the accelerations instead of overwriting them
+     */
+    static void accelerations(ThreadPool& pool, double softening2,
+                              std::size_t n, const double* x, const double* y, const double* z,
+                              std::size_t ns, const double* sx, const double* sy, const double* sz,
+                              const double* sgm,
+                              double* ax, double* ay, double* az, bool accumulate = false) {
+        pool.parallelFor(0, n, TARGET_BLOCK, [=](std::size_t begin, std::size_t end) {
+            if (!accumulate) {
+                for (std::size_t i = begin; i < end; i++)
+                    ax[i] = ay[i] = az[i] = 0.0;
+            }
+
+            for (std::size_t j0 = 0; j0 < ns; j0 += SOURCE_TILE) {
+                std::size_t j1 = j0 + SOURCE_TILE < ns ? j0 + SOURCE_TILE : ns;
+                accumulateTile(softening2, begin, end, x, y, z, j0, j1, sx, sy, sz, sgm, ax, ay, az);
+            }
+        });
+    }
+
+    /**
+     * @brief Adds the pull of sources [j0, j1) to targets [begin, end), single threaded
+     *
+     * This is the inner kernel of accelerations(); tree codes call it on their interaction lists.
+     */
+    static void accumulateTile(double softening2,
+                               std::size_t begin, std::size_t end,
+                               const double* x, const double* y, const double* z,
+                               std::size_t j0, std::size_t j1,
+                               const double* sx, const double* sy, const double* sz, const double* sgm,
+                               double* ax, double* ay, double* az) {
+        std::size_t i = begin;
+#if defined(SOLAR_SYSTEM_SIMD)
+        using namespace simd;
+        const vdouble eps2 = set1d(softening2);
+        const vdouble zero = set1d(0.0);
+        const vdouble one = set1d(1.0);
+        for (; i + DOUBLE_WIDTH <= end; i += DOUBLE_WIDTH) {
+            vdouble xi = load(x + i), yi = load(y + i), zi = load(z + i);
+            vdouble axi = load(ax + i), ayi = load(ay + i), azi = load(az + i);
+            for (std::size_t j = j0; j < j1; j++) {
+                vdouble dx = sub(set1d(sx[j]), xi);
+                vdouble dy = sub(set1d(sy[j]), yi);
+                vdouble dz = sub(set1d(sz[j]), zi);
+                vdouble r2 = fmadd(dx, dx, fmadd(dy, dy, fmadd(dz, dz, eps2)));
+                vdouble inv = div(one, sqrt(r2));
+                vdouble f = mul(set1d(sgm[j]), mul(inv, mul(inv, inv)));
+                // A body does not attract itself
+                f = select(less(zero, r2), f, zero);
+                axi = fmadd(dx, f, axi);
+                ayi = fmadd(dy, f, ayi);
+                azi = fmadd(dz, f, azi);
+            }
+            store(ax + i, axi);
+            store(ay + i, ayi);
+            store(az + i, azi);
+        }
+#endif
+        for (; i < end; i++) {
+            double axi = ax[i], ayi = ay[i], azi = az[i];
+            for (std::size_t j = j0; j < j1; j++) {
+                double dx = sx[j] - x[i], dy = sy[j] - y[i], dz = sz[j] - z[i];
+                double r2 = dx * dx + dy * dy + dz * dz + softening2;
+                if (r2 <= 0.0)
+                    continue;
+                double inv = 1.0 / std::sqrt(r2);
+                double f = sgm[j] * inv * inv * inv;
+                axi += dx * f;
+                ayi += dy * f;
+                azi += dz * f;
+            }
+            ax[i] = axi;
+            ay[i] = ayi;
+            az[i] = azi;
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_DIRECTGRAVITY_HPP_
@@ -0,0 +1,424 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_DISTRIBUTEDNBODY_HPP_
+#define INCLUDE_SOLAR_SYSTEM_DISTRIBUTEDNBODY_HPP_
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BarnesHut.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Time spent and data moved by one process of a DistributedNBody, summed over its steps
+ */
+struct DistributedStats {
+    double decompose;           // seconds choosing domains and moving particles to them
+    double exchange;            // seconds finding and swapping ghost sources
+    double gravity;             // seconds building trees and walking them
+    double integrate;           // seconds in kicks and drifts
+    std::uint64_t migrated;     // particles sent to another process
+    std::uint64_t ghosts;       // sources received from other processes
+    int decompositions;
+
+    DistributedStats()
+        : decompose(0.0), exchange(0.0), gravity(0.0), integrate(0.0), migrated(0), ghosts(0),
+          decompositions(0) {}
+};
+
+/**
+ * @brief Barnes-Hut N-body system spread over MPI processes, for runs too large for one machine.
+ *
+ * Each process owns the particles of one box of an orthogonal recursive bisection:
+ * decompose() cuts space along its longest axis so both halves carry the weight of their
+ * share of the processes, and again within each half until every process has a box. A
+ * particle weighs what it cost in the last force evaluation, and all particles move to
+ * their new process with one all-to-all exchange.
+ *
+ * For the forces each process builds a BarnesHutGravity tree over its own particles and
+ * sends every other process the ghost sources its particles need: monopoles of the cells
+ * far enough from that process's domain, described by tight boxes around a few cells of
+ * its tree, and the particles of the near ones. The
+ * ghosts go into a second tree, so a process never holds more than its own particles and
+ * a thin halo. Exported cells carry their size, so that tree opens them as the sender's
+ * would have, and forces come out close to one Barnes-Hut tree over all particles.
+ *
+ * Steps are kick-drift-kick leapfrog. Domains are redrawn every rebalance interval and
+ * whenever the slowest process spends more than the tolerance over the average on gravity.
+ * Every call except addParticle() and the accessors is collective.
+ */
+class DistributedNBody {
+public:
+    static const std::size_t DOMAIN_BOXES = 32;
+    static const int CUT_ITERATIONS = 52;
+
+    /**
+     * @param[in] pool threads this process uses for its trees
+     * @param[in] comm processes sharing the system
+     * @param[in] theta opening angle of the trees
+     * @param[in] softening softening length
+     */
+    DistributedNBody(ThreadPool& pool, MPI_Comm comm, double theta = 0.5, double softening = 0.0)
+        : p_Pool(pool), p_Comm(comm), p_Softening2(softening * softening), p_Local(theta), p_Ghosts(theta),
+          p_Time(0.0), p_Steps(0), p_Prepared(false), p_RebalanceInterval(50), p_Tolerance(1.25),
+          p_Cost(0.0), p_Imbalance(1.0) {
+        MPI_Comm_rank(p_Comm, &p_Rank);
+        MPI_Comm_size(p_Comm, &p_Ranks);
+        MPI_Type_contiguous(sizeof(Particle), MPI_BYTE, &p_ParticleType);
+        MPI_Type_commit(&p_ParticleType);
+    }
+
+    ~DistributedNBody() {
+        MPI_Type_free(&p_ParticleType);
+    }
+
+    /**
+     * @brief Redraws domains every interval steps, and sooner when gravity time is more than tolerance times the mean
+     */
+    void setRebalance(int interval, double tolerance) {
+        p_RebalanceInterval = interval;
+        p_Tolerance = tolerance;
+    }
+
+    /**
+     * @brief Adds a particle on this process, any process will do; all of them before prepare()
+     */
+    void addParticle(std::uint64_t id, double gm, const double position[3], const double velocity[3]) {
+        p_X.push_back(position[0]); p_Y.push_back(position[1]); p_Z.push_back(position[2]);
+        p_Vx.push_back(velocity[0]); p_Vy.push_back(velocity[1]); p_Vz.push_back(velocity[2]);
+        p_GM.push_back(gm);
+        p_Id.push_back(id);
+    }
+
+    /**
+     * @brief Draws the first domains and computes the first accelerations, done by step() otherwise
+     */
+    void prepare() {
+        decompose();
+        accelerations();
+        p_Prepared = true;
+    }
+
+    /**
+     * @brief One kick-drift-kick leapfrog step, rebalancing between the drift and the second kick
+     */
+    void step(double dt) {
+        if (!p_Prepared)
+            prepare();
+
+        double start = MPI_Wtime();
+        const double halfDt = 0.5 * dt;
+        kick(halfDt);
+        const std::size_t n = size();
+        p_Pool.parallelFor(0, n, 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                p_X[i] += p_Vx[i] * dt;
+                p_Y[i] += p_Vy[i] * dt;
+                p_Z[i] += p_Vz[i] * dt;
+            }
+        });
+        p_Stats.integrate += MPI_Wtime() - start;
+
+        p_Steps++;
+        if ((p_RebalanceInterval > 0 && p_Steps % p_RebalanceInterval == 0) || p_Imbalance > p_Tolerance)
+            decompose();
+        accelerations();
+
+        start = MPI_Wtime();
+        kick(halfDt);
+        p_Time += dt;
+        p_Stats.integrate += MPI_Wtime() - start;
+    }
+
+    /**
+     * @brief Moves every particle to the process owning its part of space
+     */
+    void decompose() {
+        const double start = MPI_Wtime();
+        const std::size_t n = size();
+
+        // Particles on one process cost the same, what the last force evaluation took per particle
+        const double weight = p_Cost > 0.0 && n > 0 ? p_Cost / n : 1.0;
+
+        // Every group of processes cuts its particles in two along its longest axis, until groups are single processes
+        std::vector<Group> groups(1);
+        groups[0].first = 0;
+        groups[0].count = p_Ranks;
+        std::vector<std::uint32_t> group(n, 0);
+        std::vector<double> coordinate(n);
+        std::vector<std::uint32_t> order(n);
+        while (groups.size() < static_cast<std::size_t>(p_Ranks)) {
+            const std::size_t count = groups.size();
+
+            // Extent and weight of every group, maxima negated so one reduction does both
+            std::vector<double> extent(6 * count, 1e300), total(count, 0.0);
+            for (std::size_t i = 0; i < n; i++) {
+                double* e = &extent[6 * group[i]];
+                e[0] = std::min(e[0], p_X[i]); e[3] = std::min(e[3], -p_X[i]);
+                e[1] = std::min(e[1], p_Y[i]); e[4] = std::min(e[4], -p_Y[i]);
+                e[2] = std::min(e[2], p_Z[i]); e[5] = std::min(e[5], -p_Z[i]);
+                total[group[i]] += weight;
+            }
+            MPI_Allreduce(MPI_IN_PLACE, extent.data(), static_cast<int>(extent.size()), MPI_DOUBLE, MPI_MIN, p_Comm);
+            MPI_Allreduce(MPI_IN_PLACE, total.data(), static_cast<int>(count), MPI_DOUBLE, MPI_SUM, p_Comm);
+
+            // Coordinates along each group's axis, sorted within the group
+            std::vector<int> axis(count, 0);
+            std::vector<double> lo(count), hi(count), target(count), below(count);
+            for (std::size_t g = 0; g < count; g++) {
+                const double* e = &extent[6 * g];
+                for (int k = 1; k < 3; k++) {
+                    if (-e[3 + k] - e[k] > -e[3 + axis[g]] - e[axis[g]])
+                        axis[g] = k;
+                }
+                lo[g] = e[axis[g]];
+                hi[g] = -e[3 + axis[g]];
+                target[g] = total[g] * (groups[g].count / 2) / groups[g].count;
+            }
+            for (std::size_t i = 0; i < n; i++) {
+                const int k = axis[group[i]];
+                coordinate[i] = k == 0 ? p_X[i] : k == 1 ? p_Y[i] : p_Z[i];
+                order[i] = static_cast<std::uint32_t>(i);
+            }
+            std::sort(order.begin(), order.end(), [&](std::uint32_t i, std::uint32_t j) {
+                return group[i] != group[j] ? group[i] < group[j] : coordinate[i] < coordinate[j];
+            });
+            std::vector<std::size_t> groupBegin(count + 1, 0);
+            for (std::size_t i = 0; i < n; i++)
+                groupBegin[group[i] + 1]++;
+            for (std::size_t g = 0; g < count; g++)
+                groupBegin[g + 1] += groupBegin[g];
+            std::vector<double> sorted(n);
+            for (std::size_t k = 0; k < n; k++)
+                sorted[k] = coordinate[order[k]];
+
+            // Bisect every cut at once: the first coordinate with the left processes' share of the weight below it
+            for (int iteration = 0; iteration < CUT_ITERATIONS; iteration++) {
+                for (std::size_t g = 0; g < count; g++) {
+                    const double mid = 0.5 * (lo[g] + hi[g]);
+                    const double* first = sorted.data() + groupBegin[g];
+                    const double* last = sorted.data() + groupBegin[g + 1];
+                    below[g] = weight * (std::lower_bound(first, last, mid) - first);
+                }
+                MPI_Allreduce(MPI_IN_PLACE, below.data(), static_cast<int>(count), MPI_DOUBLE, MPI_SUM, p_Comm);
+                for (std::size_t g = 0; g < count; g++) {
+                    if (below[g] >= target[g])
+                        hi[g] = 0.5 * (lo[g] + hi[g]);
+                    else
+                        lo[g] = 0.5 * (lo[g] + hi[g]);
+                }
+            }
+
+            // Left halves become group 2g, right halves 2g + 1; single processes keep one
+            std::vector<Group> next;
+            std::vector<std::uint32_t> left(count), right(count);
+            for (std::size_t g = 0; g < count; g++) {
+                left[g] = right[g] = static_cast<std::uint32_t>(next.size());
+                if (groups[g].count == 1) {
+                    next.push_back(groups[g]);
+                    continue;
+                }
+                Group half = { groups[g].first, groups[g].count / 2 };
+                next.push_back(half);
+                right[g] = static_cast<std::uint32_t>(next.size());
+                Group rest = { groups[g].first + half.count, groups[g].count - half.count };
+                next.push_back(rest);
+            }
+            for (std::size_t i = 0; i < n; i++)
+                group[i] = coordinate[i] < hi[group[i]] ? left[group[i]] : right[group[i]];
+            groups.swap(next);
+        }
+
+        std::vector<int> sendCounts(p_Ranks, 0), sendOffsets(p_Ranks, 0);
+        for (std::size_t i = 0; i < n; i++)
+            sendCounts[groups[group[i]].first]++;
+        for (int r = 1; r < p_Ranks; r++)
+            sendOffsets[r] = sendOffsets[r - 1] + sendCounts[r - 1];
+        std::vector<Particle> outgoing(n);
+        std::vector<int> cursor = sendOffsets;
+        for (std::size_t i = 0; i < n; i++) {
+            Particle& p = outgoing[cursor[groups[group[i]].first]++];
+            p.x = p_X[i]; p.y = p_Y[i]; p.z = p_Z[i];
+            p.vx = p_Vx[i]; p.vy = p_Vy[i]; p.vz = p_Vz[i];
+            p.gm = p_GM[i];
+            p.id = p_Id[i];
+        }
+        p_Stats.migrated += n - sendCounts[p_Rank];
+
+        std::vector<int> receiveCounts(p_Ranks), receiveOffsets(p_Ranks, 0);
+        MPI_Alltoall(sendCounts.data(), 1, MPI_INT, receiveCounts.data(), 1, MPI_INT, p_Comm);
+        for (int k = 1; k < p_Ranks; k++)
+            receiveOffsets[k] = receiveOffsets[k - 1] + receiveCounts[k - 1];
+        const std::size_t received = static_cast<std::size_t>(receiveOffsets[p_Ranks - 1]) + receiveCounts[p_Ranks - 1];
+        std::vector<Particle> incoming(received);
+        MPI_Alltoallv(outgoing.data(), sendCounts.data(), sendOffsets.data(), p_ParticleType,
+                      incoming.data(), receiveCounts.data(), receiveOffsets.data(), p_ParticleType, p_Comm);
+
+        p_X.resize(received); p_Y.resize(received); p_Z.resize(received);
+        p_Vx.resize(received); p_Vy.resize(received); p_Vz.resize(received);
+        p_GM.resize(received); p_Id.resize(received);
+        for (std::size_t i = 0; i < received; i++) {
+            const Particle& p = incoming[i];
+            p_X[i] = p.x; p_Y[i] = p.y; p_Z[i] = p.z;
+            p_Vx[i] = p.vx; p_Vy[i] = p.vy; p_Vz[i] = p.vz;
+            p_GM[i] = p.gm;
+            p_Id[i] = p.id;
+        }
+        p_Ax.assign(received, 0.0); p_Ay.assign(received, 0.0); p_Az.assign(received, 0.0);
+        p_Imbalance = 1.0;
+        p_Stats.decompositions++;
+        p_Stats.decompose += MPI_Wtime() - start;
+    }
+
+    /**
+     * @brief Accelerations of this process's particles due to all particles
+     */
+    void accelerations() {
+        double start = MPI_Wtime();
+        const std::size_t n = size();
+        p_Local.build(p_Pool, n, p_X.data(), p_Y.data(), p_Z.data(), p_GM.data());
+
+        // Everyone's domain as the boxes of a few cells of their trees, unused ones inside out
+        std::vector<double> boxes(6 * DOMAIN_BOXES * p_Ranks);
+        std::vector<double> own;
+        p_Local.sourceBoxes(DOMAIN_BOXES, own);
+        for (std::size_t b = own.size() / 6; b < DOMAIN_BOXES; b++) {
+            const double empty[6] = { 1e300, 1e300, 1e300, -1e300, -1e300, -1e300 };
+            own.insert(own.end(), empty, empty + 6);
+        }
+        std::copy(own.begin(), own.end(), &boxes[6 * DOMAIN_BOXES * p_Rank]);
+        MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, boxes.data(), static_cast<int>(6 * DOMAIN_BOXES), MPI_DOUBLE, p_Comm);
+        const double localSeconds = MPI_Wtime() - start;
+
+        start = MPI_Wtime();
+        std::vector<std::vector<double> > lists(p_Ranks);
+        p_Pool.parallelFor(0, p_Ranks, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; k++) {
+                if (static_cast<int>(k) != p_Rank)
+                    p_Local.essentialSources(&boxes[6 * DOMAIN_BOXES * k], DOMAIN_BOXES, lists[k]);
+            }
+        });
+        std::vector<int> sendCounts(p_Ranks), sendOffsets(p_Ranks, 0);
+        std::vector<double> outgoing;
+        for (int k = 0; k < p_Ranks; k++) {
+            sendCounts[k] = static_cast<int>(lists[k].size());
+            sendOffsets[k] = static_cast<int>(outgoing.size());
+            outgoing.insert(outgoing.end(), lists[k].begin(), lists[k].end());
+        }
+        std::vector<int> receiveCounts(p_Ranks), receiveOffsets(p_Ranks, 0);
+        MPI_Alltoall(sendCounts.data(), 1, MPI_INT, receiveCounts.data(), 1, MPI_INT, p_Comm);
+        for (int k = 1; k < p_Ranks; k++)
+            receiveOffsets[k] = receiveOffsets[k - 1] + receiveCounts[k - 1];
+        std::vector<double> incoming(static_cast<std::size_t>(receiveOffsets[p_Ranks - 1]) + receiveCounts[p_Ranks - 1]);
+        MPI_Alltoallv(outgoing.data(), sendCounts.data(), sendOffsets.data(), MPI_DOUBLE,
+                      incoming.data(), receiveCounts.data(), receiveOffsets.data(), MPI_DOUBLE, p_Comm);
+
+        const std::size_t ghosts = incoming.size() / 5;
+        p_GhostX.resize(ghosts); p_GhostY.resize(ghosts); p_GhostZ.resize(ghosts);
+        p_GhostGM.resize(ghosts); p_GhostSize.resize(ghosts);
+        for (std::size_t i = 0; i < ghosts; i++) {
+            p_GhostX[i] = incoming[5 * i];
+            p_GhostY[i] = incoming[5 * i + 1];
+            p_GhostZ[i] = incoming[5 * i + 2];
+            p_GhostGM[i] = incoming[5 * i + 3];
+            p_GhostSize[i] = incoming[5 * i + 4];
+        }
+        p_Stats.ghosts += ghosts;
+        p_Stats.exchange += MPI_Wtime() - start;
+
+        start = MPI_Wtime();
+        p_Ax.resize(n); p_Ay.resize(n); p_Az.resize(n);
+        p_Local.accelerations(p_Pool, p_Softening2, n, p_X.data(), p_Y.data(), p_Z.data(),
+                              p_Ax.data(), p_Ay.data(), p_Az.data());
+        p_Ghosts.build(p_Pool, ghosts, p_GhostX.data(), p_GhostY.data(), p_GhostZ.data(), p_GhostGM.data(),
+                       p_GhostSize.data());
+        p_Ghosts.accelerations(p_Pool, p_Softening2, n, p_X.data(), p_Y.data(), p_Z.data(),
+                               p_Ax.data(), p_Ay.data(), p_Az.data(), true);
+        p_Cost = localSeconds + MPI_Wtime() - start;
+        p_Stats.gravity += p_Cost;
+
+        double cost[2] = { p_Cost, p_Cost };
+        MPI_Allreduce(MPI_IN_PLACE, &cost[0], 1, MPI_DOUBLE, MPI_MAX, p_Comm);
+        MPI_Allreduce(MPI_IN_PLACE, &cost[1], 1, MPI_DOUBLE, MPI_SUM, p_Comm);
+        p_Imbalance = cost[1] > 0.0 ? cost[0] * p_Ranks / cost[1] : 1.0;
+    }
+
+    /**
+     * @brief Particles on all processes together
+     */
+    std::uint64_t globalSize() const {
+        std::uint64_t n = size(), total = 0;
+        MPI_Allreduce(&n, &total, 1, MPI_UINT64_T, MPI_SUM, p_Comm);
+        return total;
+    }
+
+    std::size_t size() const { return p_X.size(); }
+    int rank() const { return p_Rank; }
+    int ranks() const { return p_Ranks; }
+    double getTime() const { return p_Time; }
+    /** @brief Slowest process's gravity time over the mean, as of the last force evaluation */
+    double imbalance() const { return p_Imbalance; }
+    const DistributedStats& stats() const { return p_Stats; }
+
+    const std::uint64_t* ids() const { return p_Id.data(); }
+    const double* x() const { return p_X.data(); }
+    const double* y() const { return p_Y.data(); }
+    const double* z() const { return p_Z.data(); }
+    const double* vx() const { return p_Vx.data(); }
+    const double* vy() const { return p_Vy.data(); }
+    const double* vz() const { return p_Vz.data(); }
+    const double* gm() const { return p_GM.data(); }
+    const double* ax() const { return p_Ax.data(); }
+    const double* ay() const { return p_Ay.data(); }
+    const double* az() const { return p_Az.data(); }
+
+private:
+    // Processes [first, first + count) sharing a part of space while it is cut up
+    struct Group {
+        int first, count;
+    };
+
+    // What moves between processes when domains change
+    struct Particle {
+        double x, y, z, vx, vy, vz, gm;
+        std::uint64_t id;
+    };
+
+    ThreadPool& p_Pool;
+    MPI_Comm p_Comm;
+    MPI_Datatype p_ParticleType;
+    int p_Rank, p_Ranks;
+    double p_Softening2;
+    BarnesHutGravity p_Local, p_Ghosts;
+
+    std::vector<double> p_X, p_Y, p_Z, p_Vx, p_Vy, p_Vz, p_Ax, p_Ay, p_Az, p_GM;
+    std::vector<std::uint64_t> p_Id;
+    std::vector<double> p_GhostX, p_GhostY, p_GhostZ, p_GhostGM, p_GhostSize;
+
+    double p_Time;
+    int p_Steps;
+    bool p_Prepared;
+    int p_RebalanceInterval;
+    double p_Tolerance;
+    double p_Cost;          // this process's last gravity time
+    double p_Imbalance;
+    DistributedStats p_Stats;
+
+    DistributedNBody(const DistributedNBody&);
+    DistributedNBody& operator=(const DistributedNBody&);
+
+    void kick(double dt) {
+        const std::size_t n = size();
+        p_Pool.parallelFor(0, n, 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                p_Vx[i] += p_Ax[i] * dt;
+                p_Vy[i] += p_Ay[i] * dt;
+                p_Vz[i] += p_Az[i] * dt;
+            }
+        });
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_DISTRIBUTEDNBODY_HPP_
@@ -9,9 +9,9 @@
 
 class Earth : public Planet {
 public:
-    Earth(const std::string& ModelPath, const std::string& dayTexturePath, const std::string& nightTexturePath, const std::string& cloudTexturePath, float scale, float orbitalRadius, float orbitalSpeed, float axialSpeed, float axialTiltAngle, float ellipticity,
+    Earth(Ephemeris& ephemeris, const std::string& ModelPath, const std::string& dayTexturePath, const std::string& nightTexturePath, const std::string& cloudTexturePath, float scale, const KeplerElements& orbit, float axialSpeed, float axialTiltAngle,
            bool hasGlow = false, float glowScale = 0.0f, glm::vec4 glowTint = glm::vec4(0.0f))
-        : Planet(ModelPath, scale, orbitalRadius, orbitalSpeed, axialSpeed, axialTiltAngle, hasGlow, glowScale, glowTint, ellipticity) 
+        : Planet(ephemeris, ModelPath, scale, orbit, axialSpeed, axialTiltAngle, hasGlow, glowScale, glowTint) 
     {
         p_dayTextureID = model.loadTexture(dayTexturePath);
         p_nightTextureID = model.loadTexture(nightTexturePath);
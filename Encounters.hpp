@@ -0,0 +1,424 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_ENCOUNTERS_HPP_
+#define INCLUDE_SOLAR_SYSTEM_ENCOUNTERS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Kepler.hpp"
+#include "Morton.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Two bodies within an encounter distance of each other
+ */
+struct Encounter {
+    std::uint32_t first, second;    // body indices, first < second
+    double distance;                // closest approach during the checked interval, AU
+    bool collision;                 // within the sum of the radii, the bodies should merge
+    bool entering;                  // not an encounter at the previous check
+};
+
+/**
+ * @brief Finds close encounters and collisions with a uniform grid broadphase.
+ *
+ * A pair is an encounter while its distance is below the larger of the two Hill radii
+ * (relative to the central body, times a factor) and a collision while it is below the
+ * sum of the physical radii. The test uses the closest approach of straight-line motion
+ * over the interval since the last check, so fast bodies do not tunnel through each other.
+ *
+ * Each body gets a search radius covering both tests plus the distance it moved. The few
+ * with radii far above the rest (the Sun and planets with their wide Hill spheres) are
+ * checked against all bodies in a linear sweep. The others are binned into cubic cells
+ * twice the largest of their radii: the cell keys are radix sorted every check and the
+ * bodies are copied into key order, so a cell's bodies sit next to each other in memory.
+ * Each cell is paired with itself and the 13 neighbours ahead of it, so every pair is seen
+ * once. With x in the low bits of the key, the neighbour along x is the next cell, and the
+ * four rows ahead are found by cursors that only move forward as the cells are walked in
+ * order. Everything is linear in the number of bodies and runs on the thread pool.
+ */
+class EncounterDetector {
+public:
+    static const std::size_t MAX_LARGE = 64;
+    static const int LARGE_RATIO = 2;
+    static const std::size_t GRAIN = 4096;
+
+    /**
+     * @param[in] hillFactor encounter distance in Hill radii
+     * @param[in] density kg/m^3, gives the radius of bodies without a fixed one
+     */
+    explicit EncounterDetector(double hillFactor = 1.0, double density = 2000.0)
+        : p_HillFactor(hillFactor), p_Density(density), p_Central(0), p_CellSize(0.0) {}
+
+    /**
+     * @brief Fixed radii in AU for the first bodies, e.g. the Sun and planets; the rest follow from GM
+     */
+    void setRadii(std::size_t count, const double* radii) {
+        p_FixedRadius.assign(radii, radii + count);
+    }
+
+    /**
+     * @brief Body the Hill radii are measured against, 0 by default
+     */
+    void setCentralBody(std::size_t index) { p_Central = index; }
+
+    /**
+     * @brief Radius in AU of a sphere with the given GM and density
+     */
+    static double radiusFromGM(double gm, double density) {
+        const double KG_PER_SOLAR_MASS = 1.98892e30;
+        const double M_PER_AU = 1.495978707e11;
+        if (gm <= 0.0)
+            return 0.0;
+        double kg = gm / GM_SUN * KG_PER_SOLAR_MASS;
+        return std::cbrt(3.0 * kg / (2.0 * TWO_PI * density)) / M_PER_AU;
+    }
+
+    /**
+     * @brief Finds the encounters at the current state
+     *
+     * @param[in] pool threads to run on
+     * @param[in] n number of bodies
+     * @param[in] x,y,z positions in AU
+     * @param[in] vx,vy,vz velocities in AU/day
+     * @param[in] gm GM in AU^3/day^2, 0 for test particles
+     * @param[in] dt days since the last check, negative when time runs backwards, 0 to only test the current positions
+     */
+    void detect(ThreadPool& pool, std::size_t n, const double* x, const double* y, const double* z,
+                const double* vx, const double* vy, const double* vz, const double* gm, double dt) {
+        p_Previous.swap(p_Keys);
+        p_Keys.clear();
+        p_Encounters.clear();
+        if (n < 2 || p_Central >= n)
+            return;
+        p_Chunks.resize(std::max(p_Chunks.size(), (n + GRAIN - 1) / GRAIN));
+
+        p_Encounter.resize(n);
+        p_Radius.resize(n);
+        p_Search.resize(n);
+
+        // Encounter distance, radius and search radius of every body
+        const double centralGM = gm[p_Central];
+        pool.parallelFor(0, n, GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                double hill = 0.0;
+                if (i != p_Central && gm[i] > 0.0 && centralGM > 0.0) {
+                    double dx = x[i] - x[p_Central], dy = y[i] - y[p_Central], dz = z[i] - z[p_Central];
+                    hill = std::sqrt(dx * dx + dy * dy + dz * dz) * std::cbrt(gm[i] / (3.0 * centralGM));
+                }
+                p_Encounter[i] = p_HillFactor * hill;
+                p_Radius[i] = i < p_FixedRadius.size() ? p_FixedRadius[i] : radiusFromGM(gm[i], p_Density);
+                double speed = std::sqrt(vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+                p_Search[i] = std::max(p_Encounter[i], p_Radius[i]) + speed * std::fabs(dt);
+            }
+        });
+
+        // Search radii well above the bulk are swept, the largest of the rest sets the cell size
+        double threshold = 0.0;
+        if (n > MAX_LARGE) {
+            p_Scratch.assign(p_Search.begin(), p_Search.end());
+            std::nth_element(p_Scratch.begin(), p_Scratch.begin() + MAX_LARGE, p_Scratch.end(), std::greater<double>());
+            const double bulk = p_Scratch[MAX_LARGE];
+            threshold = bulk;
+            for (std::size_t k = 0; k < MAX_LARGE; k++) {
+                if (p_Scratch[k] <= LARGE_RATIO * bulk)
+                    threshold = std::max(threshold, p_Scratch[k]);
+            }
+        }
+        p_Large.clear();
+        p_IsLarge.assign(n, 0);
+        for (std::size_t i = 0; i < n; i++) {
+            if (p_Search[i] > threshold) {
+                p_Large.push_back(static_cast<std::uint32_t>(i));
+                p_IsLarge[i] = 1;
+            }
+        }
+
+        // Small bodies with a zero search radius can only meet large ones
+        p_CellSize = 2.0 * threshold;
+        if (p_CellSize > 0.0) {
+            sortIntoCells(pool, n, x, y, z, vx, vy, vz);
+            const Columns sorted = { p_SortedX.data(), p_SortedY.data(), p_SortedZ.data(),
+                                     p_SortedVx.data(), p_SortedVy.data(), p_SortedVz.data(),
+                                     p_SortedSearch.data(), p_SortedRadius.data(), p_SortedEncounter.data(),
+                                     p_SortedBodies.data(), dt };
+            const std::size_t cells = p_CellKeys.size();
+            const std::size_t grain = std::max<std::size_t>(1, cells * GRAIN / std::max<std::size_t>(1, n));
+            p_CellChunks.resize(std::max(p_CellChunks.size(), (cells + grain - 1) / grain));
+            pool.parallelFor(0, cells, grain, [&](std::size_t begin, std::size_t end) {
+                searchCells(begin, end, sorted, p_CellChunks[begin / grain]);
+            });
+            collect(p_CellChunks, (cells + grain - 1) / grain);
+        }
+
+        if (!p_Large.empty()) {
+            const Columns bodies = { x, y, z, vx, vy, vz, p_Search.data(), p_Radius.data(), p_Encounter.data(),
+                                     NULL, dt };
+            pool.parallelFor(0, n, GRAIN, [&](std::size_t begin, std::size_t end) {
+                sweepLarge(begin, end, bodies, p_Chunks[begin / GRAIN]);
+            });
+            collect(p_Chunks, (n + GRAIN - 1) / GRAIN);
+        }
+
+        // Mark the pairs that were not encounters at the previous check
+        std::sort(p_Encounters.begin(), p_Encounters.end(), byPair);
+        p_Keys.resize(p_Encounters.size());
+        for (std::size_t k = 0; k < p_Encounters.size(); k++) {
+            p_Keys[k] = pairKey(p_Encounters[k].first, p_Encounters[k].second);
+            p_Encounters[k].entering = !std::binary_search(p_Previous.begin(), p_Previous.end(), p_Keys[k]);
+        }
+    }
+
+    /**
+     * @brief Encounters of the last detect(), sorted by body indices
+     */
+    const std::vector<Encounter>& encounters() const { return p_Encounters; }
+
+    /**
+     * @brief Collisions of the last detect() as index pairs, for NBodySystem::mergeBodies()
+     */
+    std::vector<std::pair<std::uint32_t, std::uint32_t> > collisions() const {
+        std::vector<std::pair<std::uint32_t, std::uint32_t> > pairs;
+        for (std::size_t k = 0; k < p_Encounters.size(); k++) {
+            if (p_Encounters[k].collision)
+                pairs.push_back(std::make_pair(p_Encounters[k].first, p_Encounters[k].second));
+        }
+        return pairs;
+    }
+
+    /**
+     * @brief Follows bodies that were renumbered or removed, so ongoing encounters stay known
+     *
+     * @param[in] remap new index of every old index, or UINT32_MAX for removed bodies
+     */
+    void renumber(const std::vector<std::uint32_t>& remap) {
+        std::size_t kept = 0;
+        for (std::size_t k = 0; k < p_Keys.size(); k++) {
+            std::uint32_t first = remap[static_cast<std::uint32_t>(p_Keys[k] >> 32)];
+            std::uint32_t second = remap[static_cast<std::uint32_t>(p_Keys[k])];
+            if (first == UINT32_MAX || second == UINT32_MAX || first == second)
+                continue;
+            p_Keys[kept++] = first < second ? pairKey(first, second) : pairKey(second, first);
+        }
+        p_Keys.resize(kept);
+        std::sort(p_Keys.begin(), p_Keys.end());
+        p_Keys.erase(std::unique(p_Keys.begin(), p_Keys.end()), p_Keys.end());
+    }
+
+    /**
+     * @brief Forgets the previous encounters, e.g. when the simulation restarts
+     */
+    void reset() {
+        p_Keys.clear();
+        p_Encounters.clear();
+    }
+
+    /**
+     * @brief Edge length of the cells in AU at the last check, 0 if no grid was needed
+     */
+    double cellSize() const { return p_CellSize; }
+
+    /**
+     * @brief Bodies checked against everything at the last check
+     */
+    std::size_t largeCount() const { return p_Large.size(); }
+
+private:
+    /**
+     * @brief Per-body data a pair test reads, either in body order or in cell order
+     */
+    struct Columns {
+        const double *x, *y, *z, *vx, *vy, *vz;
+        const double *search, *radius, *encounter;
+        const std::uint32_t* body;      // body index of each entry, NULL when entries are bodies
+        double dt;
+    };
+
+    double p_HillFactor;
+    double p_Density;
+    std::size_t p_Central;
+    std::vector<double> p_FixedRadius;
+
+    std::vector<double> p_Encounter, p_Radius, p_Search, p_Scratch;
+    std::vector<std::uint32_t> p_Large;
+    std::vector<unsigned char> p_IsLarge;
+
+    // Small bodies in cell order, and the cells with the first entry of each
+    double p_CellSize;
+    std::vector<std::uint64_t> p_SortedKeys;
+    std::vector<std::uint32_t> p_SortedBodies;
+    std::vector<double> p_SortedX, p_SortedY, p_SortedZ, p_SortedVx, p_SortedVy, p_SortedVz;
+    std::vector<double> p_SortedSearch, p_SortedRadius, p_SortedEncounter;
+    std::vector<std::uint64_t> p_CellKeys;
+    std::vector<std::uint32_t> p_CellStart;
+
+    std::vector<std::vector<Encounter> > p_Chunks, p_CellChunks;
+    std::vector<Encounter> p_Encounters;
+    std::vector<std::uint64_t> p_Keys, p_Previous;     // sorted pairs of this and the previous check
+
+    static std::uint64_t pairKey(std::uint32_t first, std::uint32_t second) {
+        return static_cast<std::uint64_t>(first) << 32 | second;
+    }
+
+    static bool byPair(const Encounter& a, const Encounter& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    }
+
+    /**
+     * @brief Cell coordinate along one axis in MORTON_BITS bits, so the keys fit the radix sort
+     *
+     * Far bodies are clamped into the edge cells, which keeps neighbouring cells neighbours.
+     * The clamp stays one cell inside the range so every cell's neighbours have keys too.
+     */
+    std::uint64_t cellCoordinate(double v) const {
+        const double half = static_cast<double>(1 << (MORTON_BITS - 1));
+        double c = std::floor(v / p_CellSize) + half;
+        c = c < 1.0 ? 1.0 : c > 2.0 * half - 2.0 ? 2.0 * half - 2.0 : c;
+        return static_cast<std::uint64_t>(c);
+    }
+
+    /**
+     * @brief Radix sorts the small bodies by cell and copies their data into that order
+     */
+    void sortIntoCells(ThreadPool& pool, std::size_t n, const double* x, const double* y, const double* z,
+                       const double* vx, const double* vy, const double* vz) {
+        p_SortedKeys.clear();
+        p_SortedBodies.clear();
+        for (std::size_t i = 0; i < n; i++) {
+            if (p_IsLarge[i])
+                continue;
+            p_SortedKeys.push_back(cellCoordinate(x[i]) | cellCoordinate(y[i]) << MORTON_BITS |
+                                   cellCoordinate(z[i]) << (2 * MORTON_BITS));
+            p_SortedBodies.push_back(static_cast<std::uint32_t>(i));
+        }
+        radixSort(pool, p_SortedKeys, p_SortedBodies);
+
+        const std::size_t m = p_SortedBodies.size();
+        p_SortedX.resize(m); p_SortedY.resize(m); p_SortedZ.resize(m);
+        p_SortedVx.resize(m); p_SortedVy.resize(m); p_SortedVz.resize(m);
+        p_SortedSearch.resize(m); p_SortedRadius.resize(m); p_SortedEncounter.resize(m);
+        pool.parallelFor(0, m, GRAIN, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; k++) {
+                const std::uint32_t i = p_SortedBodies[k];
+                p_SortedX[k] = x[i]; p_SortedY[k] = y[i]; p_SortedZ[k] = z[i];
+                p_SortedVx[k] = vx[i]; p_SortedVy[k] = vy[i]; p_SortedVz[k] = vz[i];
+                p_SortedSearch[k] = p_Search[i];
+                p_SortedRadius[k] = p_Radius[i];
+                p_SortedEncounter[k] = p_Encounter[i];
+            }
+        });
+
+        p_CellKeys.clear();
+        p_CellStart.clear();
+        for (std::size_t k = 0; k < m; k++) {
+            if (k == 0 || p_SortedKeys[k] != p_SortedKeys[k - 1]) {
+                p_CellKeys.push_back(p_SortedKeys[k]);
+                p_CellStart.push_back(static_cast<std::uint32_t>(k));
+            }
+        }
+        p_CellStart.push_back(static_cast<std::uint32_t>(m));
+    }
+
+    /**
+     * @brief Pairs each cell of [begin, end) with itself and the 13 cells ahead of it
+     */
+    void searchCells(std::size_t begin, std::size_t end, const Columns& s, std::vector<Encounter>& found) const {
+        const std::size_t cells = p_CellKeys.size();
+        const std::uint64_t ROW = std::uint64_t(1) << MORTON_BITS;
+        const std::uint64_t LAYER = std::uint64_t(1) << (2 * MORTON_BITS);
+        // Rows ahead: (y + 1, z), then (y - 1, z + 1), (y, z + 1) and (y + 1, z + 1)
+        const std::uint64_t rows[4] = { ROW, LAYER - ROW, LAYER, LAYER + ROW };
+        std::size_t cursor[4];
+        for (int r = 0; r < 4; r++)
+            cursor[r] = static_cast<std::size_t>(
+                std::lower_bound(p_CellKeys.begin(), p_CellKeys.end(), p_CellKeys[begin] + rows[r] - 1) -
+                p_CellKeys.begin());
+
+        for (std::size_t c = begin; c < end; c++) {
+            const std::uint64_t key = p_CellKeys[c];
+            const std::size_t first = p_CellStart[c], last = p_CellStart[c + 1];
+
+            for (std::size_t a = first; a < last; a++) {
+                for (std::size_t b = a + 1; b < last; b++)
+                    test(s, a, b, found);
+            }
+            if (c + 1 < cells && p_CellKeys[c + 1] == key + 1)
+                testCells(s, first, last, p_CellStart[c + 1], p_CellStart[c + 2], found);
+
+            for (int r = 0; r < 4; r++) {
+                const std::uint64_t low = key + rows[r] - 1, high = key + rows[r] + 1;
+                while (cursor[r] < cells && p_CellKeys[cursor[r]] < low)
+                    cursor[r]++;
+                for (std::size_t q = cursor[r]; q < cells && p_CellKeys[q] <= high; q++)
+                    testCells(s, first, last, p_CellStart[q], p_CellStart[q + 1], found);
+            }
+        }
+    }
+
+    static void testCells(const Columns& s, std::size_t firstA, std::size_t lastA, std::size_t firstB,
+                          std::size_t lastB, std::vector<Encounter>& found) {
+        for (std::size_t a = firstA; a < lastA; a++) {
+            for (std::size_t b = firstB; b < lastB; b++)
+                test(s, a, b, found);
+        }
+    }
+
+    /**
+     * @brief Tests bodies [begin, end) against every large body, pairs of large bodies from the lower index
+     */
+    void sweepLarge(std::size_t begin, std::size_t end, const Columns& s, std::vector<Encounter>& found) const {
+        for (std::size_t j = begin; j < end; j++) {
+            for (std::size_t k = 0; k < p_Large.size(); k++) {
+                const std::uint32_t l = p_Large[k];
+                if (l == j || (p_IsLarge[j] && j < l))
+                    continue;
+                test(s, l, j, found);
+            }
+        }
+    }
+
+    /**
+     * @brief Exact test of entries a and b, appends them to found if they meet
+     */
+    static void test(const Columns& s, std::size_t a, std::size_t b, std::vector<Encounter>& found) {
+        double px = s.x[a] - s.x[b], py = s.y[a] - s.y[b], pz = s.z[a] - s.z[b];
+        const double reach = s.search[a] + s.search[b];
+        if (std::fabs(px) > reach || std::fabs(py) > reach || std::fabs(pz) > reach)
+            return;
+
+        // Closest approach of straight-line relative motion during the last dt, at time -tau
+        double wx = s.vx[a] - s.vx[b], wy = s.vy[a] - s.vy[b], wz = s.vz[a] - s.vz[b];
+        double w2 = wx * wx + wy * wy + wz * wz;
+        double tau = w2 > 0.0 ? (px * wx + py * wy + pz * wz) / w2 : 0.0;
+        if (s.dt >= 0.0)
+            tau = tau < 0.0 ? 0.0 : tau > s.dt ? s.dt : tau;
+        else
+            tau = tau > 0.0 ? 0.0 : tau < s.dt ? s.dt : tau;
+        px -= wx * tau; py -= wy * tau; pz -= wz * tau;
+        const double distance = std::sqrt(px * px + py * py + pz * pz);
+
+        const bool collision = distance < s.radius[a] + s.radius[b];
+        if (!collision && distance >= std::max(s.encounter[a], s.encounter[b]))
+            return;
+        std::uint32_t i = s.body != NULL ? s.body[a] : static_cast<std::uint32_t>(a);
+        std::uint32_t j = s.body != NULL ? s.body[b] : static_cast<std::uint32_t>(b);
+        Encounter encounter = { std::min(i, j), std::max(i, j), distance, collision, false };
+        found.push_back(encounter);
+    }
+
+    /**
+     * @brief Appends the per-chunk results in chunk order, so the output does not depend on the threads
+     */
+    void collect(std::vector<std::vector<Encounter> >& chunks, std::size_t count) {
+        for (std::size_t c = 0; c < count; c++) {
+            p_Encounters.insert(p_Encounters.end(), chunks[c].begin(), chunks[c].end());
+            chunks[c].clear();
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_ENCOUNTERS_HPP_
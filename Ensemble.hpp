@@ -0,0 +1,388 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_ENSEMBLE_HPP_
+#define INCLUDE_SOLAR_SYSTEM_ENSEMBLE_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Kepler.hpp"
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
+
+const double ENSEMBLE_MAX_ECCENTRICITY = 0.95;   // perturbed orbits stay clear of parabolic
+
+/**
+ * @brief Many copies of one small system, each with slightly different parameters.
+ *
+ * Stability studies run the same planets again and again with perturbed masses and
+ * orbits. Here every copy, a variant, is an independent universe: a central body and up
+ * to MAX_BODIES - 1 orbiters in barycentric ecliptic coordinates (AU, days, GM in
+ * AU^3 / day^2). All variants share the fixed step of a kick-drift-kick leapfrog, so
+ * they advance in lockstep: the state is stored body by body with the variants side by
+ * side, LANES variants are integrated together with one variant per SIMD lane, and those
+ * groups are spread over the thread pool.
+ *
+ * Every CHECK_STEPS steps each orbiter's osculating eccentricity about the central body
+ * is taken; a variant becomes unstable the first time an orbiter is no longer bound to it
+ * or gets further away than the escape distance. It keeps being integrated with the
+ * others, its results just stop meaning much.
+ */
+class EnsembleSystem {
+public:
+    static const std::size_t MAX_BODIES = 16;
+    static const std::size_t LANES = 8;
+    static const std::size_t CHECK_STEPS = 16;
+
+    /**
+     * @param[in] pool threads the groups of variants are spread over
+     * @param[in] escapeDistance distance from the central body in AU past which a variant is unstable
+     */
+    explicit EnsembleSystem(ThreadPool& pool, double escapeDistance = 100.0)
+        : p_Pool(pool), p_EscapeDistance(escapeDistance), p_CentralGM(GM_SUN), p_Count(0), p_Capacity(0),
+          p_Time(0.0) {}
+
+    /**
+     * @brief Sets the mass of the central body, the sun by default
+     */
+    void setCentral(double gm) {
+        p_CentralGM = gm;
+    }
+
+    /**
+     * @brief Adds an orbiter to the nominal system, before createVariants()
+     *
+     * @param[in] name column label in the output
+     * @param[in] orbit orbit about the central body
+     * @param[in] gm gravitational parameter in AU^3 / day^2
+     * @return false once MAX_BODIES - 1 orbiters were added
+     */
+    bool addBody(const std::string& name, const KeplerElements& orbit, double gm) {
+        if (p_Names.size() + 1 >= MAX_BODIES) {
+            std::cerr << "EnsembleSystem: at most " << MAX_BODIES - 1 << " orbiters" << std::endl;
+            return false;
+        }
+        p_Names.push_back(name);
+        p_Orbits.push_back(orbit);
+        p_NominalGM.push_back(gm);
+        return true;
+    }
+
+    /**
+     * @brief Replaces the variants with count new ones at the given time
+     *
+     * Variant 0 is the nominal system. In the others every orbiter's GM is scaled by
+     * 1 + massSpread * N(0, 1) and its eccentricity moved by eccentricitySpread * N(0, 1),
+     * kept within [0, ENSEMBLE_MAX_ECCENTRICITY]; the rest of its elements are left alone.
+     * Each variant is then moved to its own barycentre.
+     */
+    void createVariants(std::size_t count, double massSpread, double eccentricitySpread, double days,
+                        std::uint64_t seed = 1) {
+        const std::size_t bodies = p_Names.size() + 1;
+        p_Count = count;
+        p_Capacity = (count + LANES - 1) / LANES * LANES;
+        p_Time = days;
+        const std::size_t total = bodies * p_Capacity;
+        p_X.assign(total, 0.0); p_Y.assign(total, 0.0); p_Z.assign(total, 0.0);
+        p_VX.assign(total, 0.0); p_VY.assign(total, 0.0); p_VZ.assign(total, 0.0);
+        p_GM.assign(total, 0.0);
+        p_Eccentricity0.assign(total, 0.0);
+        p_MaxEccentricity.assign(total, 0.0);
+        p_Energy0.assign(p_Capacity, 0.0);
+        p_Energy.assign(p_Capacity, 0.0);
+        p_Unstable.assign(p_Capacity, -1.0);
+
+        std::mt19937_64 rng(seed);
+        std::normal_distribution<double> normal(0.0, 1.0);
+        for (std::size_t v = 0; v < p_Capacity; v++) {
+            // Padding lanes repeat the last variant
+            if (v >= count && count > 0) {
+                for (std::size_t b = 0; b < bodies; b++)
+                    copyVariant(b, count - 1, v);
+                continue;
+            }
+            p_GM[v] = p_CentralGM;
+            double momentum[6] = {}, mass = p_CentralGM;
+            for (std::size_t b = 1; b < bodies; b++) {
+                KeplerElements orbit = p_Orbits[b - 1];
+                double gm = p_NominalGM[b - 1];
+                if (v > 0) {
+                    gm *= std::max(0.0, 1.0 + massSpread * normal(rng));
+                    orbit.eccentricity = std::min(ENSEMBLE_MAX_ECCENTRICITY,
+                                                  std::max(0.0, orbit.eccentricity + eccentricitySpread * normal(rng)));
+                }
+                double r[3], u[3];
+                elementsToState(orbit, days, p_CentralGM + gm, r, u);
+                const std::size_t i = b * p_Capacity + v;
+                p_X[i] = r[0]; p_Y[i] = r[1]; p_Z[i] = r[2];
+                p_VX[i] = u[0]; p_VY[i] = u[1]; p_VZ[i] = u[2];
+                p_GM[i] = gm;
+                p_Eccentricity0[i] = p_MaxEccentricity[i] = orbit.eccentricity;
+                for (int k = 0; k < 3; k++) {
+                    momentum[k] += gm * r[k];
+                    momentum[3 + k] += gm * u[k];
+                }
+                mass += gm;
+            }
+            for (std::size_t b = 0; b < bodies; b++) {
+                const std::size_t i = b * p_Capacity + v;
+                p_X[i] -= momentum[0] / mass; p_Y[i] -= momentum[1] / mass; p_Z[i] -= momentum[2] / mass;
+                p_VX[i] -= momentum[3] / mass; p_VY[i] -= momentum[4] / mass; p_VZ[i] -= momentum[5] / mass;
+            }
+        }
+
+        Group g;
+        for (std::size_t first = 0; first < p_Capacity; first += LANES) {
+            load(g, bodies, first);
+            energy(g, bodies, &p_Energy0[first]);
+        }
+        p_Energy = p_Energy0;
+    }
+
+    /**
+     * @brief Integrates every variant over days with steps of at most step days
+     */
+    void run(double days, double step) {
+        if (p_Count == 0 || !(days > 0.0) || !(step > 0.0))
+            return;
+        const std::size_t steps = static_cast<std::size_t>(std::ceil(days / step));
+        const double dt = days / steps;
+        p_Pool.parallelFor(0, p_Capacity / LANES, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t group = begin; group < end; group++)
+                runGroup(group * LANES, steps, dt);
+        });
+        p_Time += days;
+    }
+
+    /**
+     * @brief Writes one line per variant as CSV: stability, energy error, then each orbiter's GM and eccentricities
+     */
+    bool write(const std::string& path) const {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == NULL)
+            return false;
+        bool ok = std::fprintf(file, "variant,unstable_days,energy_error") > 0;
+        for (std::size_t b = 0; b < p_Names.size() && ok; b++) {
+            const char* name = p_Names[b].c_str();
+            ok = std::fprintf(file, ",%s_gm,%s_e0,%s_e_max", name, name, name) > 0;
+        }
+        ok = ok && std::fprintf(file, "\n") > 0;
+        for (std::size_t v = 0; v < p_Count && ok; v++) {
+            ok = p_Unstable[v] < 0.0 ? std::fprintf(file, "%zu,,%.3e", v, energyError(v)) > 0
+                                     : std::fprintf(file, "%zu,%.3f,%.3e", v, p_Unstable[v], energyError(v)) > 0;
+            for (std::size_t b = 1; b <= p_Names.size() && ok; b++)
+                ok = std::fprintf(file, ",%.9e,%.6f,%.6f", gm(v, b), eccentricity0(v, b), maxEccentricity(v, b)) > 0;
+            ok = ok && std::fprintf(file, "\n") > 0;
+        }
+        return std::fclose(file) == 0 && ok;
+    }
+
+    std::size_t size() const { return p_Count; }
+    std::size_t bodies() const { return p_Names.size() + 1; }
+    double getTime() const { return p_Time; }
+
+    /** @brief GM of body b in variant v, body 0 is the central one */
+    double gm(std::size_t v, std::size_t b) const { return p_GM[b * p_Capacity + v]; }
+    /** @brief Eccentricity body b started with in variant v */
+    double eccentricity0(std::size_t v, std::size_t b) const { return p_Eccentricity0[b * p_Capacity + v]; }
+    /** @brief Largest osculating eccentricity body b reached in variant v */
+    double maxEccentricity(std::size_t v, std::size_t b) const { return p_MaxEccentricity[b * p_Capacity + v]; }
+    /** @brief Time variant v became unstable, negative while it is not */
+    double unstableAt(std::size_t v) const { return p_Unstable[v]; }
+    /** @brief Relative energy change of variant v since createVariants() */
+    double energyError(std::size_t v) const { return std::fabs((p_Energy[v] - p_Energy0[v]) / p_Energy0[v]); }
+
+    const double* x(std::size_t b) const { return &p_X[b * p_Capacity]; }
+    const double* y(std::size_t b) const { return &p_Y[b * p_Capacity]; }
+    const double* z(std::size_t b) const { return &p_Z[b * p_Capacity]; }
+    const double* vx(std::size_t b) const { return &p_VX[b * p_Capacity]; }
+    const double* vy(std::size_t b) const { return &p_VY[b * p_Capacity]; }
+    const double* vz(std::size_t b) const { return &p_VZ[b * p_Capacity]; }
+
+private:
+    // One group of LANES variants, small enough to stay in L1 while it is integrated
+    struct Group {
+        double x[MAX_BODIES][LANES], y[MAX_BODIES][LANES], z[MAX_BODIES][LANES];
+        double vx[MAX_BODIES][LANES], vy[MAX_BODIES][LANES], vz[MAX_BODIES][LANES];
+        double ax[MAX_BODIES][LANES], ay[MAX_BODIES][LANES], az[MAX_BODIES][LANES];
+        double gm[MAX_BODIES][LANES];
+    };
+
+    ThreadPool& p_Pool;
+    double p_EscapeDistance;
+    double p_CentralGM;
+    std::vector<std::string> p_Names;
+    std::vector<KeplerElements> p_Orbits;
+    std::vector<double> p_NominalGM;
+
+    std::size_t p_Count;
+    std::size_t p_Capacity;  // p_Count rounded up to LANES
+    double p_Time;
+    // [body * p_Capacity + variant]
+    std::vector<double> p_X, p_Y, p_Z, p_VX, p_VY, p_VZ, p_GM;
+    std::vector<double> p_Eccentricity0, p_MaxEccentricity;
+    // [variant]
+    std::vector<double> p_Energy0, p_Energy, p_Unstable;
+
+    EnsembleSystem(const EnsembleSystem&);
+    EnsembleSystem& operator=(const EnsembleSystem&);
+
+    void copyVariant(std::size_t b, std::size_t from, std::size_t to) {
+        const std::size_t i = b * p_Capacity + from, j = b * p_Capacity + to;
+        p_X[j] = p_X[i]; p_Y[j] = p_Y[i]; p_Z[j] = p_Z[i];
+        p_VX[j] = p_VX[i]; p_VY[j] = p_VY[i]; p_VZ[j] = p_VZ[i];
+        p_GM[j] = p_GM[i];
+        p_Eccentricity0[j] = p_Eccentricity0[i];
+        p_MaxEccentricity[j] = p_MaxEccentricity[i];
+    }
+
+    void runGroup(std::size_t first, std::size_t steps, double dt) {
+        const std::size_t n = bodies();
+        Group g;
+        load(g, n, first);
+
+        const double halfDt = 0.5 * dt;
+        accelerations(g, n);
+        for (std::size_t s = 1; s <= steps; s++) {
+            for (std::size_t b = 0; b < n; b++) {
+                for (std::size_t l = 0; l < LANES; l++) {
+                    g.vx[b][l] += halfDt * g.ax[b][l];
+                    g.vy[b][l] += halfDt * g.ay[b][l];
+                    g.vz[b][l] += halfDt * g.az[b][l];
+                    g.x[b][l] += dt * g.vx[b][l];
+                    g.y[b][l] += dt * g.vy[b][l];
+                    g.z[b][l] += dt * g.vz[b][l];
+                }
+            }
+            accelerations(g, n);
+            for (std::size_t b = 0; b < n; b++) {
+                for (std::size_t l = 0; l < LANES; l++) {
+                    g.vx[b][l] += halfDt * g.ax[b][l];
+                    g.vy[b][l] += halfDt * g.ay[b][l];
+                    g.vz[b][l] += halfDt * g.az[b][l];
+                }
+            }
+            if (s % CHECK_STEPS == 0 || s == steps)
+                check(g, n, first, p_Time + s * dt);
+        }
+
+        energy(g, n, &p_Energy[first]);
+        store(g, n, first);
+    }
+
+    void load(Group& g, std::size_t n, std::size_t first) const {
+        for (std::size_t b = 0; b < n; b++) {
+            const std::size_t i = b * p_Capacity + first;
+            std::copy(&p_X[i], &p_X[i] + LANES, g.x[b]);
+            std::copy(&p_Y[i], &p_Y[i] + LANES, g.y[b]);
+            std::copy(&p_Z[i], &p_Z[i] + LANES, g.z[b]);
+            std::copy(&p_VX[i], &p_VX[i] + LANES, g.vx[b]);
+            std::copy(&p_VY[i], &p_VY[i] + LANES, g.vy[b]);
+            std::copy(&p_VZ[i], &p_VZ[i] + LANES, g.vz[b]);
+            std::copy(&p_GM[i], &p_GM[i] + LANES, g.gm[b]);
+        }
+    }
+
+    void store(const Group& g, std::size_t n, std::size_t first) {
+        for (std::size_t b = 0; b < n; b++) {
+            const std::size_t i = b * p_Capacity + first;
+            std::copy(g.x[b], g.x[b] + LANES, &p_X[i]);
+            std::copy(g.y[b], g.y[b] + LANES, &p_Y[i]);
+            std::copy(g.z[b], g.z[b] + LANES, &p_Z[i]);
+            std::copy(g.vx[b], g.vx[b] + LANES, &p_VX[i]);
+            std::copy(g.vy[b], g.vy[b] + LANES, &p_VY[i]);
+            std::copy(g.vz[b], g.vz[b] + LANES, &p_VZ[i]);
+        }
+    }
+
+    /**
+     * @brief Pairwise accelerations of every body, one variant per lane
+     */
+    static void accelerations(Group& g, std::size_t n) {
+        for (std::size_t b = 0; b < n; b++) {
+            std::fill(g.ax[b], g.ax[b] + LANES, 0.0);
+            std::fill(g.ay[b], g.ay[b] + LANES, 0.0);
+            std::fill(g.az[b], g.az[b] + LANES, 0.0);
+        }
+        for (std::size_t i = 0; i < n; i++) {
+            for (std::size_t j = i + 1; j < n; j++) {
+                std::size_t l = 0;
+#if defined(SOLAR_SYSTEM_SIMD)
+                for (; l + simd::DOUBLE_WIDTH <= LANES; l += simd::DOUBLE_WIDTH) {
+                    const simd::vdouble dx = simd::sub(simd::load(&g.x[j][l]), simd::load(&g.x[i][l]));
+                    const simd::vdouble dy = simd::sub(simd::load(&g.y[j][l]), simd::load(&g.y[i][l]));
+                    const simd::vdouble dz = simd::sub(simd::load(&g.z[j][l]), simd::load(&g.z[i][l]));
+                    const simd::vdouble r2 = simd::fmadd(dz, dz, simd::fmadd(dy, dy, simd::mul(dx, dx)));
+                    const simd::vdouble inv3 = simd::div(simd::set1d(1.0), simd::mul(r2, simd::sqrt(r2)));
+                    const simd::vdouble si = simd::mul(simd::load(&g.gm[j][l]), inv3);
+                    const simd::vdouble sj = simd::mul(simd::load(&g.gm[i][l]), inv3);
+                    simd::store(&g.ax[i][l], simd::fmadd(si, dx, simd::load(&g.ax[i][l])));
+                    simd::store(&g.ay[i][l], simd::fmadd(si, dy, simd::load(&g.ay[i][l])));
+                    simd::store(&g.az[i][l], simd::fmadd(si, dz, simd::load(&g.az[i][l])));
+                    simd::store(&g.ax[j][l], simd::sub(simd::load(&g.ax[j][l]), simd::mul(sj, dx)));
+                    simd::store(&g.ay[j][l], simd::sub(simd::load(&g.ay[j][l]), simd::mul(sj, dy)));
+                    simd::store(&g.az[j][l], simd::sub(simd::load(&g.az[j][l]), simd::mul(sj, dz)));
+                }
+#endif
+                for (; l < LANES; l++) {
+                    const double dx = g.x[j][l] - g.x[i][l];
+                    const double dy = g.y[j][l] - g.y[i][l];
+                    const double dz = g.z[j][l] - g.z[i][l];
+                    const double r2 = dx * dx + dy * dy + dz * dz;
+                    const double inv3 = 1.0 / (r2 * std::sqrt(r2));
+                    const double si = g.gm[j][l] * inv3, sj = g.gm[i][l] * inv3;
+                    g.ax[i][l] += si * dx; g.ay[i][l] += si * dy; g.az[i][l] += si * dz;
+                    g.ax[j][l] -= sj * dx; g.ay[j][l] -= sj * dy; g.az[j][l] -= sj * dz;
+                }
+            }
+        }
+    }
+
+    static void energy(const Group& g, std::size_t n, double* out) {
+        for (std::size_t l = 0; l < LANES; l++) {
+            double kinetic = 0.0, potential = 0.0;
+            for (std::size_t i = 0; i < n; i++) {
+                kinetic += 0.5 * g.gm[i][l] * (g.vx[i][l] * g.vx[i][l] + g.vy[i][l] * g.vy[i][l] + g.vz[i][l] * g.vz[i][l]);
+                for (std::size_t j = i + 1; j < n; j++) {
+                    const double dx = g.x[i][l] - g.x[j][l], dy = g.y[i][l] - g.y[j][l], dz = g.z[i][l] - g.z[j][l];
+                    potential -= g.gm[i][l] * g.gm[j][l] / std::sqrt(dx * dx + dy * dy + dz * dz);
+                }
+            }
+            out[l] = kinetic + potential;
+        }
+    }
+
+    /**
+     * @brief Tracks the orbiters' eccentricities about body 0 and marks variants that lost one
+     */
+    void check(const Group& g, std::size_t n, std::size_t first, double days) {
+        for (std::size_t b = 1; b < n; b++) {
+            double* maxEccentricity = &p_MaxEccentricity[b * p_Capacity + first];
+            for (std::size_t l = 0; l < LANES; l++) {
+                const double r[3] = { g.x[b][l] - g.x[0][l], g.y[b][l] - g.y[0][l], g.z[b][l] - g.z[0][l] };
+                const double u[3] = { g.vx[b][l] - g.vx[0][l], g.vy[b][l] - g.vy[0][l], g.vz[b][l] - g.vz[0][l] };
+                const double mu = g.gm[0][l] + g.gm[b][l];
+                const double distance = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+                const double speed2 = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+                const double radial = r[0] * u[0] + r[1] * u[1] + r[2] * u[2];
+                double e2 = 0.0;
+                for (int k = 0; k < 3; k++) {
+                    const double ek = ((speed2 - mu / distance) * r[k] - radial * u[k]) / mu;
+                    e2 += ek * ek;
+                }
+                const double e = std::sqrt(e2);
+                maxEccentricity[l] = std::max(maxEccentricity[l], e);
+                // Also catches NaN from a collision
+                if (!(e < 1.0 && distance < p_EscapeDistance) && p_Unstable[first + l] < 0.0)
+                    p_Unstable[first + l] = days;
+            }
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_ENSEMBLE_HPP_
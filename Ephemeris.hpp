@@ -0,0 +1,750 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_EPHEMERIS_HPP_
+#define INCLUDE_SOLAR_SYSTEM_EPHEMERIS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BatchEphemeris.hpp"
+#include "Kepler.hpp"
+#include "Simd.hpp"
+
+// Simulated days per wall-clock second at normal speed, gives the 25 second Earth year we had before
+const double DAYS_PER_SECOND = 14.5;
+
+// Bounds of the key intervals of Ephemeris::updateMultiRate(), in days
+const double MAX_KEY_INTERVAL = 36525.0;
+const double MIN_KEY_INTERVAL = 1e-6;
+// Fraction of its distance the camera may close on a body before the body's schedule is redone
+const float DISTANCE_MARGIN = 0.75f;
+
+/**
+ * @brief Central store for the orbit and spin parameters of every body.
+ *
+ * Parameters are kept as structure-of-arrays so that update() can evaluate all
+ * bodies in one tight loop per frame. Planets only keep an index into this table
+ * and read the cached model matrix instead of recomputing it on every call.
+ *
+ * Orbits are true Kepler ellipses around the sun at the origin, or around a parent body for
+ * moons. Ecliptic coordinates are mapped to the scene with the ecliptic pole pointing up (+y).
+ *
+ * Bodies form a hierarchy flattened into the arrays: a parent is always added before its
+ * children, so one pass in index order sees every parent's world position before the
+ * bodies that depend on it. A body's world position is its parent's plus its own orbit
+ * offset; its tilt, spin and scale are its own. Bodies whose offset and spin did not change
+ * and whose ancestors did not move keep their cached model matrix. The bodies without a
+ * parent are the roots, the ones a simulation or the JPL kernel provides positions for.
+ *
+ * update() is meant to be called once per fixed simulation step. The previous step is
+ * kept, so interpolate() can place the bodies at any time in between when drawing.
+ * updateMultiRate() instead evaluates each orbit only as often as the camera could tell,
+ * see there.
+ */
+class Ephemeris {
+public:
+    static const std::size_t NO_PARENT = SIZE_MAX;
+
+    /**
+     * @param[in] sceneScale scene units per AU
+     */
+    explicit Ephemeris(float sceneScale = 1.0f)
+        : p_SceneScale(sceneScale), p_Days(0.0), p_PreviousDays(0.0), p_HasPrevious(false), p_Rebuilt(0),
+          p_KeysValid(false), p_LastDays(0.0), p_LastBudget(0.0f), p_LastCamera(0.0f), p_CameraPath(0.0),
+          p_Evaluated(0) {}
+
+    /**
+     * @brief Registers a body and returns its index into the cached results
+     *
+     * @param[in] orbit heliocentric orbital elements, default constructed elements keep the body at the origin
+     * @param[in] scale model scale
+     * @param[in] axialSpeed spin in degrees per second at normal speed
+     * @param[in] axialTiltAngle tilt of the spin axis in degrees
+     * @param[in] parent body the orbit is around, must already be added; NO_PARENT for the sun
+     * @param[in] orbitScale stretches the drawn orbit, e.g. so moons clear their enlarged planet
+     */
+    std::size_t addBody(const KeplerElements& orbit,
+                        float scale,
+                        float axialSpeed,
+                        float axialTiltAngle,
+                        std::size_t parent = NO_PARENT,
+                        float orbitScale = 1.0f) {
+        if (parent != NO_PARENT && parent >= p_Scale.size())
+            parent = NO_PARENT;
+        if (parent == NO_PARENT)
+            p_Roots.push_back(p_Scale.size());
+        p_Parent.push_back(parent);
+
+        double P[3], Q[3];
+        orbitBasis(orbit, P, Q);
+
+        // ecliptic (x, y, z) -> scene (x, z, -y)
+        p_Px.push_back(static_cast<float>(P[0]));
+        p_Py.push_back(static_cast<float>(P[2]));
+        p_Pz.push_back(static_cast<float>(-P[1]));
+        p_Qx.push_back(static_cast<float>(Q[0]));
+        p_Qy.push_back(static_cast<float>(Q[2]));
+        p_Qz.push_back(static_cast<float>(-Q[1]));
+
+        p_Orbits.push_back(orbit);
+        p_GM.push_back(0.0);
+
+        double e = orbit.eccentricity;
+        double a = orbit.semiMajorAxis * p_SceneScale * orbitScale;
+        p_SemiMajorAxis.push_back(static_cast<float>(a));
+        p_SemiMinorAxis.push_back(static_cast<float>(a * std::sqrt(1.0 - e * e)));
+        p_Eccentricity.push_back(static_cast<float>(e));
+        p_MeanAnomalyAtEpoch.push_back(orbit.meanAnomalyAtEpoch);
+        p_MeanMotion.push_back(orbit.meanMotion);
+
+        // Largest acceleration along the orbit, at periapsis, and the longest key interval
+        const double n = std::fabs(orbit.meanMotion);
+        p_MaxAcceleration.push_back(static_cast<float>(n * n * a / ((1.0 - e) * (1.0 - e))));
+        p_MaxKeyInterval.push_back(n > 0.0 ? std::min(0.25 * TWO_PI / n, MAX_KEY_INTERVAL) : MAX_KEY_INTERVAL);
+
+        p_Scale.push_back(scale);
+        p_AxialSpeed.push_back(glm::radians(axialSpeed) / DAYS_PER_SECOND);
+
+        // The tilt never changes, so its sine and cosine are only computed once
+        p_CosTilt.push_back(std::cos(glm::radians(axialTiltAngle)));
+        p_SinTilt.push_back(std::sin(glm::radians(axialTiltAngle)));
+
+        p_MeanAnomaly.push_back(0.0f);
+        p_PosX.push_back(0.0f);
+        p_PosY.push_back(0.0f);
+        p_PosZ.push_back(0.0f);
+        p_PreviousX.push_back(0.0f);
+        p_PreviousY.push_back(0.0f);
+        p_PreviousZ.push_back(0.0f);
+        p_RenderX.push_back(0.0f);
+        p_RenderY.push_back(0.0f);
+        p_RenderZ.push_back(0.0f);
+        p_WorldX.push_back(0.0f);
+        p_WorldY.push_back(0.0f);
+        p_WorldZ.push_back(0.0f);
+        p_Moved.push_back(1);
+        p_HasPrevious = false;
+        p_Spin.push_back(-1.0f);
+        if (axialSpeed != 0.0f)
+            p_Spinning.push_back(p_Scale.size() - 1);
+        p_CosSpin.push_back(1.0f);
+        p_SinSpin.push_back(0.0f);
+        p_ModelMatrices.push_back(glm::mat4(1.0f));
+
+        p_KeyStart.push_back(HUGE_VAL);
+        p_KeyEnd.push_back(-HUGE_VAL);
+        p_Deadline.push_back(-HUGE_VAL);
+        p_CameraLimit.push_back(-HUGE_VAL);
+        if (parent != NO_PARENT)
+            p_Moons.push_back(p_Scale.size() - 1);
+        p_StartX.push_back(0.0f);
+        p_StartY.push_back(0.0f);
+        p_StartZ.push_back(0.0f);
+        p_EndX.push_back(0.0f);
+        p_EndY.push_back(0.0f);
+        p_EndZ.push_back(0.0f);
+        p_ChordSpeed.push_back(0.0f);
+        p_Sagitta.push_back(0.0f);
+        p_Share.clear();
+
+        return p_Scale.size() - 1;
+    }
+
+    /**
+     * @brief Evaluates every body at the given time and caches the results
+     *
+     * @param[in] days days since J2000
+     */
+    void update(double days) {
+        keepPrevious(days);
+        propagate(days);
+        finishStep();
+    }
+
+    /**
+     * @brief Same as update(), but takes the root positions from a simulation instead of the orbits
+     *
+     * Moons keep following their orbits around the simulated positions of their parents.
+     *
+     * @param[in] days days since J2000
+     * @param[in] x, y, z heliocentric ecliptic positions in AU of the rootCount() roots, in order
+     */
+    void update(double days, const double* x, const double* y, const double* z) {
+        const std::size_t roots = p_Roots.size();
+        const float scale = p_SceneScale;
+        keepPrevious(days);
+        if (roots < p_Scale.size())
+            propagate(days);
+        for (std::size_t k = 0; k < roots; k++) {
+            const std::size_t i = p_Roots[k];
+            p_PosX[i] = static_cast<float>(x[k]) * scale;
+            p_PosY[i] = static_cast<float>(z[k]) * scale;
+            p_PosZ[i] = static_cast<float>(-y[k]) * scale;
+        }
+
+        finishStep();
+    }
+
+    /**
+     * @brief Places every body at the given time to within tolerance pixels, touching few of them
+     *
+     * Each body is drawn on the chord between two exact positions, its keys, moving along it
+     * at constant speed. Linear interpolation strays at most accel h^2 / 8 from the orbit over
+     * a key interval h, so slow or distant bodies get long intervals and new keys rarely.
+     * The drawn position is only refreshed when the body has moved far enough along the
+     * chord to be seen. Both limits are set for a camera up to DISTANCE_MARGIN closer than
+     * it was; a body is looked at again when its deadline passes or the camera has travelled
+     * far enough to break that assumption, so a frame only touches the bodies that are due
+     * and the bound holds while the camera moves. Moons split the tolerance with their parents.
+     *
+     * Call it once per frame instead of update(); update() and the simulation overloads
+     * discard the schedule.
+     *
+     * @param[in] days days since J2000
+     * @param[in] camera camera position in scene units
+     * @param[in] pixelsPerRadian viewport height over the vertical field of view, near the view axis
+     * @param[in] tolerance largest distance in pixels between a drawn body and its orbit position
+     */
+    void updateMultiRate(double days, const glm::vec3& camera, float pixelsPerRadian, float tolerance = 0.5f) {
+        const std::size_t n = p_Scale.size();
+        if (p_Share.size() != n)
+            computeShares();
+
+        // Scene units a body may be off per scene unit of distance, for the chord and the lag each
+        const float budget = 0.5f * tolerance / pixelsPerRadian;
+        const glm::vec3 moved = camera - p_LastCamera;
+        p_CameraPath += std::sqrt(glm::dot(moved, moved));
+        p_LastCamera = camera;
+        if (!p_KeysValid || days < p_LastDays || budget < p_LastBudget) {
+            // New schedule after other updates, a jump back in time or a zoom in
+            if (!p_KeysValid) {
+                std::fill(p_KeyStart.begin(), p_KeyStart.end(), HUGE_VAL);
+                std::fill(p_KeyEnd.begin(), p_KeyEnd.end(), -HUGE_VAL);
+            }
+            std::fill(p_Deadline.begin(), p_Deadline.end(), -HUGE_VAL);
+            p_KeysValid = true;
+        }
+        p_LastDays = days;
+        p_LastBudget = budget;
+
+        p_Due.clear();
+        const double path = p_CameraPath;
+        for (std::size_t i = 0; i < n; i++) {
+            if (days >= p_Deadline[i] || path >= p_CameraLimit[i])
+                p_Due.push_back(i);
+        }
+
+        // New keys where the chord is over or no longer close enough to the orbit for this distance
+        p_KeyBody.clear();
+        p_KeyDistance.clear();
+        p_DueDistance.resize(p_Due.size());
+        for (std::size_t k = 0; k < p_Due.size(); k++) {
+            const std::size_t i = p_Due[k];
+            const glm::vec3 offset = glm::vec3(p_WorldX[i], p_WorldY[i], p_WorldZ[i]) - camera;
+            const float distance = std::sqrt(glm::dot(offset, offset));
+            p_DueDistance[k] = distance;
+            if (days < p_KeyStart[i] || days > p_KeyEnd[i] ||
+                p_Sagitta[i] > p_Share[i] * budget * DISTANCE_MARGIN * distance) {
+                p_KeyBody.push_back(i);
+                p_KeyDistance.push_back(distance);
+            }
+        }
+        p_KeyTime.clear();
+        if (!p_KeyBody.empty())
+            newKeys(days, budget);
+        p_Evaluated = p_KeyTime.size();
+
+        for (std::size_t k = 0; k < p_Due.size(); k++) {
+            const std::size_t i = p_Due[k];
+            const float alpha = static_cast<float>((days - p_KeyStart[i]) / (p_KeyEnd[i] - p_KeyStart[i]));
+            p_RenderX[i] = p_StartX[i] + alpha * (p_EndX[i] - p_StartX[i]);
+            p_RenderY[i] = p_StartY[i] + alpha * (p_EndY[i] - p_StartY[i]);
+            p_RenderZ[i] = p_StartZ[i] + alpha * (p_EndZ[i] - p_StartZ[i]);
+            p_Moved[i] |= 1;
+
+            const float lag = p_Share[i] * budget * DISTANCE_MARGIN * p_DueDistance[k];
+            double deadline = p_KeyEnd[i];
+            if (p_ChordSpeed[i] > 0.0f)
+                deadline = std::min(deadline, days + lag / p_ChordSpeed[i]);
+            p_Deadline[i] = deadline;
+            p_CameraLimit[i] = path + (1.0f - DISTANCE_MARGIN) * p_DueDistance[k];
+        }
+
+        // p_PosX/Y/Z are stale now, a later update() starts a new history
+        p_HasPrevious = false;
+        updateSpin(days);
+        updateDirtyTransforms();
+    }
+
+    /**
+     * @brief Orbits evaluated by the last updateMultiRate(), to measure the scheduling
+     */
+    std::size_t evaluatedOrbits() const {
+        return p_Evaluated;
+    }
+
+    /**
+     * @brief Forgets the previous update, so the next one is not interpolated across a jump in time
+     */
+    void resetHistory() {
+        p_HasPrevious = false;
+    }
+
+    /**
+     * @brief Places the bodies between the last two update() calls and rebuilds their matrices
+     *
+     * @param[in] alpha 0 for the previous update, 1 for the last one
+     */
+    void interpolate(double alpha) {
+        const std::size_t n = p_Scale.size();
+        const float a = static_cast<float>(alpha);
+        for (std::size_t i = 0; i < n; i++) {
+            const float x = p_PreviousX[i] + a * (p_PosX[i] - p_PreviousX[i]);
+            const float y = p_PreviousY[i] + a * (p_PosY[i] - p_PreviousY[i]);
+            const float z = p_PreviousZ[i] + a * (p_PosZ[i] - p_PreviousZ[i]);
+            p_Moved[i] |= x != p_RenderX[i] || y != p_RenderY[i] || z != p_RenderZ[i];
+            p_RenderX[i] = x;
+            p_RenderY[i] = y;
+            p_RenderZ[i] = z;
+        }
+
+        updateTransforms(p_PreviousDays + alpha * (p_Days - p_PreviousDays));
+    }
+
+    /**
+     * @brief Returns the model matrix cached by the last update() or interpolate()
+     */
+    const glm::mat4& getModelMatrix(std::size_t index) const {
+        return p_ModelMatrices[index];
+    }
+
+    /**
+     * @brief Returns the world position cached by the last update() or interpolate()
+     */
+    glm::vec3 getPosition(std::size_t index) const {
+        return glm::vec3(p_WorldX[index], p_WorldY[index], p_WorldZ[index]);
+    }
+
+    std::size_t size() const {
+        return p_Scale.size();
+    }
+
+    /**
+     * @brief Number of bodies without a parent, in the order simulations and the kernel use
+     */
+    std::size_t rootCount() const {
+        return p_Roots.size();
+    }
+
+    /**
+     * @brief Index of the k-th root
+     */
+    std::size_t root(std::size_t k) const {
+        return p_Roots[k];
+    }
+
+    std::size_t getParent(std::size_t index) const {
+        return p_Parent[index];
+    }
+
+    /**
+     * @brief Model matrices rebuilt by the last update() or interpolate(), to measure the caching
+     */
+    std::size_t rebuiltMatrices() const {
+        return p_Rebuilt;
+    }
+
+    float getSceneScale() const {
+        return p_SceneScale;
+    }
+
+    /**
+     * @brief Position (AU) and velocity (AU/day) of a body from its orbit, relative to its parent or the sun
+     */
+    void getState(std::size_t index, double days, double position[3], double velocity[3]) const {
+        const double central = p_Parent[index] == NO_PARENT ? GM_SUN : p_GM[p_Parent[index]];
+        elementsToState(p_Orbits[index], days, central + p_GM[index], position, velocity);
+    }
+
+    /**
+     * @brief Sets the gravitational parameter GM (AU^3 / day^2) used by simulations
+     */
+    void setGM(std::size_t index, double gm) {
+        p_GM[index] = gm;
+    }
+
+    double getGM(std::size_t index) const {
+        return p_GM[index];
+    }
+
+    const KeplerElements& getOrbit(std::size_t index) const {
+        return p_Orbits[index];
+    }
+
+    /**
+     * @brief Copies the orbits into a headless evaluator with the same body indices
+     */
+    BatchEphemeris batch() const {
+        BatchEphemeris batch;
+        for (std::size_t i = 0; i < p_Orbits.size(); i++) {
+            std::uint32_t parent = p_Parent[i] == NO_PARENT ? BatchEphemeris::NO_PARENT
+                                                            : static_cast<std::uint32_t>(p_Parent[i]);
+            batch.addBody(p_Orbits[i], parent);
+        }
+        return batch;
+    }
+
+    /**
+     * @brief Orbit axes as drawn, in scene units: periapsis direction times a, 90 degrees ahead times b
+     */
+    void getOrbitAxes(std::size_t index, glm::vec3& major, glm::vec3& minor, float& eccentricity) const {
+        const float a = p_SemiMajorAxis[index], b = p_SemiMinorAxis[index];
+        major = glm::vec3(p_Px[index], p_Py[index], p_Pz[index]) * a;
+        minor = glm::vec3(p_Qx[index], p_Qy[index], p_Qz[index]) * b;
+        eccentricity = p_Eccentricity[index];
+    }
+
+private:
+    float p_SceneScale;
+
+    // Hierarchy, parents always come before their children
+    std::vector<std::size_t> p_Parent;
+    std::vector<std::size_t> p_Roots;
+
+    // Original elements and masses, only read when a simulation is (re)started
+    std::vector<KeplerElements> p_Orbits;
+    std::vector<double> p_GM;
+
+    // Orbit, semi-axes already in scene units and P/Q already in the scene frame
+    std::vector<float> p_SemiMajorAxis;
+    std::vector<float> p_SemiMinorAxis;
+    std::vector<float> p_Eccentricity;
+    std::vector<float> p_Px, p_Py, p_Pz;
+    std::vector<float> p_Qx, p_Qy, p_Qz;
+    std::vector<double> p_MeanAnomalyAtEpoch;
+    std::vector<double> p_MeanMotion;   // rad / day
+
+    // Spin and shape
+    std::vector<float> p_Scale;
+    std::vector<double> p_AxialSpeed;   // rad / day
+    std::vector<float> p_CosTilt;
+    std::vector<float> p_SinTilt;
+
+    // Results of the last two steps and the interpolated positions that are drawn
+    double p_Days;
+    double p_PreviousDays;
+    bool p_HasPrevious;
+    std::vector<float> p_MeanAnomaly;
+    std::vector<float> p_PosX;
+    std::vector<float> p_PosY;
+    std::vector<float> p_PosZ;
+    std::vector<float> p_PreviousX, p_PreviousY, p_PreviousZ;
+    std::vector<float> p_RenderX, p_RenderY, p_RenderZ;    // offsets from the parent
+    std::vector<float> p_WorldX, p_WorldY, p_WorldZ;
+    std::vector<unsigned char> p_Moved;                     // render offset changed since the last matrices
+    std::size_t p_Rebuilt;
+    std::vector<float> p_Spin;
+    std::vector<std::size_t> p_Spinning;                    // bodies with a spin, the others keep angle 0
+    std::vector<float> p_SpinAngle, p_SpinSin, p_SpinCos;   // gathered for the batched sincos
+    std::vector<float> p_CosSpin;
+    std::vector<float> p_SinSpin;
+    std::vector<glm::mat4> p_ModelMatrices;
+
+    // Schedule of updateMultiRate(): exact offsets at the two keys and when each body is due again
+    bool p_KeysValid;
+    double p_LastDays;
+    float p_LastBudget;
+    glm::vec3 p_LastCamera;
+    double p_CameraPath;                    // distance the camera has travelled, never decreases
+    std::vector<float> p_MaxAcceleration;   // scene units / day^2
+    std::vector<double> p_MaxKeyInterval;   // days, a quarter period
+    std::vector<float> p_Share;             // fraction of the tolerance, shared along each chain of moons
+    std::vector<double> p_KeyStart, p_KeyEnd;
+    std::vector<double> p_Deadline;         // days
+    std::vector<double> p_CameraLimit;      // p_CameraPath at which the camera may have come too close
+    std::vector<std::size_t> p_Moons;       // bodies with a parent, in index order
+    std::vector<float> p_StartX, p_StartY, p_StartZ;
+    std::vector<float> p_EndX, p_EndY, p_EndZ;
+    std::vector<float> p_ChordSpeed;        // scene units / day along the chord
+    std::vector<float> p_Sagitta;           // largest distance between the chord and the orbit
+    std::size_t p_Evaluated;
+
+    // Scratch for one updateMultiRate(), kept so frames do not allocate
+    std::vector<std::size_t> p_Due;
+    std::vector<float> p_DueDistance;
+    std::vector<std::size_t> p_Extra;
+    std::vector<std::size_t> p_Dirty;
+    std::vector<std::size_t> p_KeyBody;
+    std::vector<float> p_KeyDistance;
+    std::vector<std::size_t> p_KeySlot;     // 2 * body for the start key, 2 * body + 1 for the end key
+    std::vector<double> p_KeyTime;
+    std::vector<float> p_KeyMeanAnomaly, p_KeyEccentricity, p_KeySemiMajorAxis, p_KeySemiMinorAxis;
+    std::vector<float> p_KeyPx, p_KeyPy, p_KeyPz, p_KeyQx, p_KeyQy, p_KeyQz;
+    std::vector<float> p_KeyX, p_KeyY, p_KeyZ;
+
+    /**
+     * @brief Splits the tolerance so the shares along any chain from a root to a moon add up to at most one
+     */
+    void computeShares() {
+        const std::size_t n = p_Scale.size();
+        std::vector<unsigned> depth(n, 0), height(n, 0);
+        for (std::size_t i = 0; i < n; i++) {
+            if (p_Parent[i] != NO_PARENT)
+                depth[i] = depth[p_Parent[i]] + 1;
+        }
+        for (std::size_t i = n; i-- > 0;) {
+            if (p_Parent[i] != NO_PARENT)
+                height[p_Parent[i]] = std::max(height[p_Parent[i]], height[i] + 1);
+        }
+        p_Share.resize(n);
+        for (std::size_t i = 0; i < n; i++)
+            p_Share[i] = 1.0f / static_cast<float>(depth[i] + height[i] + 1);
+    }
+
+    /**
+     * @brief Chooses key intervals for the bodies in p_KeyBody and evaluates their orbits at the new keys
+     *
+     * A body whose end key just passed continues from it, which costs one evaluation;
+     * otherwise both keys are placed from now on.
+     */
+    void newKeys(double days, float budget) {
+        p_KeySlot.clear();
+        p_KeyTime.clear();
+        for (std::size_t k = 0; k < p_KeyBody.size(); k++) {
+            const std::size_t i = p_KeyBody[k];
+            // Half the allowed gap, so refreshes at a slightly different distance keep the keys
+            const double allowed = 0.5 * p_Share[i] * budget * DISTANCE_MARGIN * p_KeyDistance[k];
+            double h = p_MaxKeyInterval[i];
+            if (p_MaxAcceleration[i] > 0.0f)
+                h = std::min(h, std::sqrt(8.0 * allowed / p_MaxAcceleration[i]));
+            h = std::max(h, MIN_KEY_INTERVAL);
+
+            if (days > p_KeyEnd[i] && days <= p_KeyEnd[i] + h) {
+                p_KeyStart[i] = p_KeyEnd[i];
+                p_StartX[i] = p_EndX[i];
+                p_StartY[i] = p_EndY[i];
+                p_StartZ[i] = p_EndZ[i];
+            } else {
+                p_KeyStart[i] = days;
+                p_KeySlot.push_back(2 * i);
+                p_KeyTime.push_back(days);
+            }
+            p_KeyEnd[i] = p_KeyStart[i] + h;
+            p_KeySlot.push_back(2 * i + 1);
+            p_KeyTime.push_back(p_KeyEnd[i]);
+            p_Sagitta[i] = static_cast<float>(p_MaxAcceleration[i] * h * h / 8.0);
+        }
+
+        evaluateKeys();
+
+        for (std::size_t k = 0; k < p_KeyBody.size(); k++) {
+            const std::size_t i = p_KeyBody[k];
+            const float dx = p_EndX[i] - p_StartX[i], dy = p_EndY[i] - p_StartY[i], dz = p_EndZ[i] - p_StartZ[i];
+            p_ChordSpeed[i] = static_cast<float>(std::sqrt(dx * dx + dy * dy + dz * dz) / (p_KeyEnd[i] - p_KeyStart[i]));
+        }
+    }
+
+    /**
+     * @brief Gathers the orbits of the new keys and runs them through the batched solver in one go
+     */
+    void evaluateKeys() {
+        const std::size_t m = p_KeySlot.size();
+        p_KeyMeanAnomaly.resize(m);
+        p_KeyEccentricity.resize(m);
+        p_KeySemiMajorAxis.resize(m);
+        p_KeySemiMinorAxis.resize(m);
+        p_KeyPx.resize(m); p_KeyPy.resize(m); p_KeyPz.resize(m);
+        p_KeyQx.resize(m); p_KeyQy.resize(m); p_KeyQz.resize(m);
+        p_KeyX.resize(m); p_KeyY.resize(m); p_KeyZ.resize(m);
+
+        const double inverseTwoPi = 1.0 / TWO_PI;
+        for (std::size_t k = 0; k < m; k++) {
+            const std::size_t i = p_KeySlot[k] / 2;
+            double M = p_MeanAnomalyAtEpoch[i] + p_MeanMotion[i] * p_KeyTime[k];
+            M -= TWO_PI * std::floor(M * inverseTwoPi + 0.5);
+            p_KeyMeanAnomaly[k] = static_cast<float>(M);
+            p_KeyEccentricity[k] = p_Eccentricity[i];
+            p_KeySemiMajorAxis[k] = p_SemiMajorAxis[i];
+            p_KeySemiMinorAxis[k] = p_SemiMinorAxis[i];
+            p_KeyPx[k] = p_Px[i]; p_KeyPy[k] = p_Py[i]; p_KeyPz[k] = p_Pz[i];
+            p_KeyQx[k] = p_Qx[i]; p_KeyQy[k] = p_Qy[i]; p_KeyQz[k] = p_Qz[i];
+        }
+        KeplerSolver::propagate(m, p_KeyMeanAnomaly.data(), p_KeyEccentricity.data(),
+                                p_KeySemiMajorAxis.data(), p_KeySemiMinorAxis.data(),
+                                p_KeyPx.data(), p_KeyPy.data(), p_KeyPz.data(),
+                                p_KeyQx.data(), p_KeyQy.data(), p_KeyQz.data(),
+                                p_KeyX.data(), p_KeyY.data(), p_KeyZ.data());
+
+        for (std::size_t k = 0; k < m; k++) {
+            const std::size_t i = p_KeySlot[k] / 2;
+            if (p_KeySlot[k] & 1) {
+                p_EndX[i] = p_KeyX[k];
+                p_EndY[i] = p_KeyY[k];
+                p_EndZ[i] = p_KeyZ[k];
+            } else {
+                p_StartX[i] = p_KeyX[k];
+                p_StartY[i] = p_KeyY[k];
+                p_StartZ[i] = p_KeyZ[k];
+            }
+        }
+    }
+
+    /**
+     * @brief Evaluates every orbit at the given time into p_PosX/Y/Z
+     */
+    void propagate(double days) {
+        const std::size_t n = p_Scale.size();
+        KeplerSolver::meanAnomalies(n, p_MeanAnomalyAtEpoch.data(), p_MeanMotion.data(), days,
+                                    p_MeanAnomaly.data());
+        KeplerSolver::propagate(n, p_MeanAnomaly.data(), p_Eccentricity.data(),
+                                p_SemiMajorAxis.data(), p_SemiMinorAxis.data(),
+                                p_Px.data(), p_Py.data(), p_Pz.data(),
+                                p_Qx.data(), p_Qy.data(), p_Qz.data(),
+                                p_PosX.data(), p_PosY.data(), p_PosZ.data());
+    }
+
+    /**
+     * @brief Moves the last step into the previous slot before a new one is computed
+     *
+     */
+    void keepPrevious(double days) {
+        p_KeysValid = false;
+        p_PreviousX.swap(p_PosX);
+        p_PreviousY.swap(p_PosY);
+        p_PreviousZ.swap(p_PosZ);
+        p_PreviousDays = p_Days;
+        p_Days = days;
+    }
+
+    /**
+     * @brief Shows the new step, the very first one has no predecessor and is used as its own
+     */
+    void finishStep() {
+        if (!p_HasPrevious) {
+            p_PreviousX = p_PosX;
+            p_PreviousY = p_PosY;
+            p_PreviousZ = p_PosZ;
+            p_PreviousDays = p_Days;
+            p_HasPrevious = true;
+        }
+        interpolate(1.0);
+    }
+
+    /**
+     * @brief World positions, spin and model matrices from the offsets already in p_RenderX/Y/Z
+     */
+    void updateTransforms(double days) {
+        const std::size_t n = p_Scale.size();
+        updateSpin(days);
+
+        // Parents come first, so their world position and moved flag are final when a child reads them
+        for (std::size_t i = 0; i < n; i++) {
+            const std::size_t parent = p_Parent[i];
+            if (parent != NO_PARENT)
+                p_Moved[i] |= p_Moved[parent] & 1;
+            if (p_Moved[i] & 1)
+                placeBody(i);
+        }
+
+        p_Rebuilt = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            if (p_Moved[i])
+                buildMatrix(i);
+        }
+    }
+
+    /**
+     * @brief Same as updateTransforms() after updateSpin(), for the bodies flagged in p_Moved
+     *
+     * Only looks at the refreshed bodies in p_Due, the spinning bodies and the moons.
+     */
+    void updateDirtyTransforms() {
+        // p_Due is in index order; the few other bodies are sorted and merged in, parents before children
+        p_Extra.clear();
+        for (std::size_t k = 0; k < p_Spinning.size(); k++) {
+            if (p_Moved[p_Spinning[k]] && !(p_Moved[p_Spinning[k]] & 1))
+                p_Extra.push_back(p_Spinning[k]);
+        }
+        for (std::size_t k = 0; k < p_Moons.size(); k++) {
+            const std::size_t i = p_Moons[k];
+            if ((p_Moved[p_Parent[i]] & 1) && !(p_Moved[i] & 1)) {
+                p_Moved[i] |= 1;
+                p_Extra.push_back(i);
+            }
+        }
+        std::sort(p_Extra.begin(), p_Extra.end());
+        p_Extra.erase(std::unique(p_Extra.begin(), p_Extra.end()), p_Extra.end());
+        p_Dirty.resize(p_Due.size() + p_Extra.size());
+        std::merge(p_Due.begin(), p_Due.end(), p_Extra.begin(), p_Extra.end(), p_Dirty.begin());
+
+        for (std::size_t k = 0; k < p_Dirty.size(); k++) {
+            if (p_Moved[p_Dirty[k]] & 1)
+                placeBody(p_Dirty[k]);
+        }
+        p_Rebuilt = 0;
+        for (std::size_t k = 0; k < p_Dirty.size(); k++)
+            buildMatrix(p_Dirty[k]);
+    }
+
+    /**
+     * @brief Spin angles at the given time, flags the bodies whose angle changed
+     */
+    void updateSpin(double days) {
+        // Reduced in double precision so that long runs don't eat the float mantissa; bodies that
+        // do not spin are skipped, so crowds of asteroids cost nothing here
+        const std::size_t spinning = p_Spinning.size();
+        const double inverseTwoPi = 1.0 / TWO_PI;
+        p_SpinAngle.resize(spinning);
+        p_SpinSin.resize(spinning);
+        p_SpinCos.resize(spinning);
+        for (std::size_t k = 0; k < spinning; k++) {
+            double angle = days * p_AxialSpeed[p_Spinning[k]];
+            p_SpinAngle[k] = static_cast<float>(angle - TWO_PI * std::floor(angle * inverseTwoPi));
+        }
+        simd::sincos(p_SpinAngle.data(), p_SpinSin.data(), p_SpinCos.data(), spinning);
+        for (std::size_t k = 0; k < spinning; k++) {
+            const std::size_t i = p_Spinning[k];
+            p_Moved[i] |= (p_SpinAngle[k] != p_Spin[i]) << 1;
+            p_Spin[i] = p_SpinAngle[k];
+            p_SinSpin[i] = p_SpinSin[k];
+            p_CosSpin[i] = p_SpinCos[k];
+        }
+    }
+
+    /**
+     * @brief World position from the render offset and the parent's world position
+     */
+    void placeBody(std::size_t i) {
+        const std::size_t parent = p_Parent[i];
+        p_WorldX[i] = p_RenderX[i];
+        p_WorldY[i] = p_RenderY[i];
+        p_WorldZ[i] = p_RenderZ[i];
+        if (parent != NO_PARENT) {
+            p_WorldX[i] += p_WorldX[parent];
+            p_WorldY[i] += p_WorldY[parent];
+            p_WorldZ[i] += p_WorldZ[parent];
+        }
+    }
+
+    /**
+     * @brief Assembles translate * rotateZ(tilt) * rotateY(spin) * scale directly and clears the moved flags
+     */
+    void buildMatrix(std::size_t i) {
+        p_Moved[i] = 0;
+        p_Rebuilt++;
+        const float s = p_Scale[i];
+        const float ct = p_CosTilt[i], st = p_SinTilt[i];
+        const float cs = p_CosSpin[i], ss = p_SinSpin[i];
+
+        glm::mat4& m = p_ModelMatrices[i];
+        m[0] = glm::vec4(ct * cs * s, st * cs * s, -ss * s, 0.0f);
+        m[1] = glm::vec4(-st * s, ct * s, 0.0f, 0.0f);
+        m[2] = glm::vec4(ct * ss * s, st * ss * s, cs * s, 0.0f);
+        m[3] = glm::vec4(p_WorldX[i], p_WorldY[i], p_WorldZ[i], 1.0f);
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_EPHEMERIS_HPP_
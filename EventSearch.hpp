@@ -0,0 +1,364 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_EVENTSEARCH_HPP_
+#define INCLUDE_SOLAR_SYSTEM_EVENTSEARCH_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Brent.hpp"
+#include "Calendar.hpp"
+#include "SkyEphemeris.hpp"
+#include "ThreadPool.hpp"
+
+const double EVENT_CHUNK_DAYS = 365.25;     // span one thread scans at a time
+const double EVENT_STEP_DAYS = 1.0;         // grid the separations are sampled on
+const double EARTH_EQUATORIAL_RADIUS_KM = 6378.137;
+const double EARTH_SHADOW_ENLARGEMENT = 1.02;   // the atmosphere widens the shadow by about 2%
+
+/**
+ * @brief One eclipse, transit or conjunction, times in days since J2000
+ */
+struct SkyEvent {
+    enum Type { SOLAR_ECLIPSE, LUNAR_ECLIPSE, TRANSIT, CONJUNCTION };
+    enum Kind { NONE, PENUMBRAL, PARTIAL, ANNULAR, TOTAL };
+
+    Type type;
+    Kind kind;
+    SkyEphemeris::Body first;
+    SkyEphemeris::Body second;
+    double days;            // greatest eclipse, mid transit or conjunction in longitude
+    double begin;           // first and last contact, equal to days for conjunctions
+    double end;
+    double separation;      // degrees between the bodies (the moon and the shadow axis) at days
+
+    static const char* typeName(Type type) {
+        static const char* const names[] = { "solar eclipse", "lunar eclipse", "transit", "conjunction" };
+        return names[type];
+    }
+
+    static const char* kindName(Kind kind) {
+        static const char* const names[] = { "", "penumbral", "partial", "annular", "total" };
+        return names[kind];
+    }
+
+    bool operator<(const SkyEvent& other) const {
+        return days < other.days;
+    }
+};
+
+/**
+ * @brief Finds eclipses, transits of Mercury and Venus and planetary conjunctions over a time span.
+ *
+ * The span is cut into chunks of EVENT_CHUNK_DAYS spread over the thread pool. Each chunk samples
+ * the geocentric positions on a global EVENT_STEP_DAYS grid and looks for sign changes of
+ * longitude differences: sun - moon (new moon), moon - anti-sun (full moon), sun - Mercury and
+ * sun - Venus (inferior and superior conjunctions) and every pair of planets. Each change is
+ * refined with Brent's method; eclipses and transits then minimise the shadow or disk
+ * separation around it and solve for the contacts on either side. Grid intervals belong to
+ * exactly one chunk, so no event is reported twice.
+ *
+ * Geometry is geometric and geocentric: no light time, no refraction and a spherical earth,
+ * which puts contact times within a few minutes of the published ones.
+ */
+class EventSearch {
+public:
+    explicit EventSearch(const SkyEphemeris& sky) : p_Sky(sky) {}
+
+    /**
+     * @brief Appends the events between first and last to events, sorted by time
+     */
+    void search(ThreadPool& pool, double first, double last, std::vector<SkyEvent>& events) const {
+        if (last <= first)
+            return;
+        const std::size_t steps = static_cast<std::size_t>(std::ceil((last - first) / EVENT_STEP_DAYS));
+        const std::size_t stepsPerChunk = static_cast<std::size_t>(EVENT_CHUNK_DAYS / EVENT_STEP_DAYS);
+        const std::size_t chunks = (steps + stepsPerChunk - 1) / stepsPerChunk;
+        std::vector<std::vector<SkyEvent> > found(chunks);
+        pool.parallelFor(0, chunks, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t chunk = begin; chunk < end; chunk++) {
+                const std::size_t i1 = (chunk + 1) * stepsPerChunk < steps ? (chunk + 1) * stepsPerChunk : steps;
+                scanChunk(first, chunk * stepsPerChunk, i1, last, found[chunk]);
+            }
+        });
+
+        const std::size_t start = events.size();
+        for (std::size_t chunk = 0; chunk < chunks; chunk++)
+            events.insert(events.end(), found[chunk].begin(), found[chunk].end());
+        std::stable_sort(events.begin() + start, events.end());
+    }
+
+    /**
+     * @brief Writes the events as CSV, dates as YYYY-MM-DD hh:mm
+     */
+    static bool write(const std::string& path, const std::vector<SkyEvent>& events) {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == NULL)
+            return false;
+        bool ok = std::fprintf(file, "date,type,kind,first,second,begin,end,days,separation_deg\n") > 0;
+        for (std::size_t i = 0; i < events.size() && ok; i++) {
+            const SkyEvent& e = events[i];
+            ok = std::fprintf(file, "%s,%s,%s,%s,%s,%s,%s,%.5f,%.5f\n", calendar::format(e.days, true).c_str(),
+                              SkyEvent::typeName(e.type), SkyEvent::kindName(e.kind), SkyEphemeris::name(e.first),
+                              SkyEphemeris::name(e.second), calendar::format(e.begin, true).c_str(),
+                              calendar::format(e.end, true).c_str(), e.days, e.separation) > 0;
+        }
+        return std::fclose(file) == 0 && ok;
+    }
+
+private:
+    typedef SkyEphemeris::Body Body;
+
+    // Pairs whose longitude difference is watched, the moon - sun pair is offset by half a turn
+    enum Pair { NEW_MOON, FULL_MOON, MERCURY_SUN, VENUS_SUN, FIRST_PLANET_PAIR };
+    static const int PLANETS = SkyEphemeris::BODIES - SkyEphemeris::MERCURY;
+    static const int PAIRS = FIRST_PLANET_PAIR + PLANETS * (PLANETS - 1) / 2;
+
+    const SkyEphemeris& p_Sky;
+
+    static double wrap(double angle) {
+        angle = std::fmod(angle, TWO_PI);
+        if (angle > TWO_PI / 2)
+            angle -= TWO_PI;
+        else if (angle <= -TWO_PI / 2)
+            angle += TWO_PI;
+        return angle;
+    }
+
+    static double length(const double* v) {
+        return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    }
+
+    static double angleBetween(const double* a, const double* b) {
+        const double cross[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+        return std::atan2(length(cross), a[0] * b[0] + a[1] * b[1] + a[2] * b[2]);
+    }
+
+    static void pairBodies(int pair, Body& first, Body& second) {
+        if (pair < FIRST_PLANET_PAIR) {
+            static const Body firsts[FIRST_PLANET_PAIR] = { SkyEphemeris::SUN, SkyEphemeris::SUN, SkyEphemeris::SUN,
+                                                            SkyEphemeris::SUN };
+            static const Body seconds[FIRST_PLANET_PAIR] = { SkyEphemeris::MOON, SkyEphemeris::MOON,
+                                                             SkyEphemeris::MERCURY, SkyEphemeris::VENUS };
+            first = firsts[pair];
+            second = seconds[pair];
+            return;
+        }
+        int k = pair - FIRST_PLANET_PAIR;
+        int a = 0;
+        while (k >= PLANETS - 1 - a) {
+            k -= PLANETS - 1 - a;
+            a++;
+        }
+        first = static_cast<Body>(SkyEphemeris::MERCURY + a);
+        second = static_cast<Body>(SkyEphemeris::MERCURY + a + 1 + k);
+    }
+
+    /**
+     * @brief Longitude difference of a pair, zero at conjunction (opposition for FULL_MOON)
+     */
+    static double pairAngle(int pair, const double xyz[3 * SkyEphemeris::BODIES]) {
+        Body first, second;
+        pairBodies(pair, first, second);
+        const double a = std::atan2(xyz[3 * first + 1], xyz[3 * first]);
+        const double b = std::atan2(xyz[3 * second + 1], xyz[3 * second]);
+        return wrap(b - a - (pair == FULL_MOON ? TWO_PI / 2 : 0.0));
+    }
+
+    // Functions of time handed to the Brent routines
+    struct PairAngle {
+        const SkyEphemeris* sky;
+        int pair;
+        double operator()(double days) const {
+            double xyz[3 * SkyEphemeris::BODIES];
+            sky->positions(days, xyz);
+            return pairAngle(pair, xyz);
+        }
+    };
+
+    /**
+     * @brief Margin in AU between the earth and the moon's penumbra (negative inside), also
+     * reports whether the umbra or antumbra reaches the earth and which of the two it is
+     */
+    struct SolarShadow {
+        const SkyEphemeris* sky;
+        double operator()(double days) const {
+            bool central, total;
+            double separation;
+            return evaluate(days, central, total, separation);
+        }
+
+        double evaluate(double days, bool& central, bool& total, double& separation) const {
+            double xyz[3 * SkyEphemeris::BODIES];
+            sky->positions(days, xyz);
+            const double* sun = &xyz[3 * SkyEphemeris::SUN];
+            const double* moon = &xyz[3 * SkyEphemeris::MOON];
+            separation = angleBetween(sun, moon) / DEG_TO_RAD;
+            const double axis[3] = { moon[0] - sun[0], moon[1] - sun[1], moon[2] - sun[2] };
+            const double D = length(axis);
+            // Earth relative to the moon, split along and across the shadow axis
+            const double along = -(moon[0] * axis[0] + moon[1] * axis[1] + moon[2] * axis[2]) / D;
+            double across[3];
+            for (int k = 0; k < 3; k++)
+                across[k] = -moon[k] - along * axis[k] / D;
+            const double d = length(across);
+            const double sunRadius = SkyEphemeris::radiusKm(SkyEphemeris::SUN) / KM_PER_AU;
+            const double moonRadius = SkyEphemeris::radiusKm(SkyEphemeris::MOON) / KM_PER_AU;
+            const double earthRadius = EARTH_EQUATORIAL_RADIUS_KM / KM_PER_AU;
+            const double penumbra = moonRadius + along * (sunRadius + moonRadius) / D;
+            const double umbra = moonRadius - along * (sunRadius - moonRadius) / D;
+            central = along > 0.0 && d < earthRadius + std::fabs(umbra);
+            total = umbra > 0.0;
+            return along > 0.0 ? d - penumbra - earthRadius : HUGE_VAL;
+        }
+    };
+
+    /**
+     * @brief Margin in AU between the moon's limb and the earth's penumbra (negative inside),
+     * with the shadow enlarged by the atmosphere as in the Connaissance des Temps convention
+     */
+    struct LunarShadow {
+        const SkyEphemeris* sky;
+        double operator()(double days) const {
+            double umbraMargin, totalMargin, separation;
+            return evaluate(days, umbraMargin, totalMargin, separation);
+        }
+
+        double evaluate(double days, double& umbraMargin, double& totalMargin, double& separation) const {
+            double xyz[3 * SkyEphemeris::BODIES];
+            sky->positions(days, xyz);
+            const double* sun = &xyz[3 * SkyEphemeris::SUN];
+            const double* moon = &xyz[3 * SkyEphemeris::MOON];
+            const double antiSun[3] = { -sun[0], -sun[1], -sun[2] };
+            separation = angleBetween(antiSun, moon) / DEG_TO_RAD;
+            const double S = length(sun);
+            const double along = (moon[0] * antiSun[0] + moon[1] * antiSun[1] + moon[2] * antiSun[2]) / S;
+            double across[3];
+            for (int k = 0; k < 3; k++)
+                across[k] = moon[k] - along * antiSun[k] / S;
+            const double d = length(across);
+            const double sunRadius = SkyEphemeris::radiusKm(SkyEphemeris::SUN) / KM_PER_AU;
+            const double moonRadius = SkyEphemeris::radiusKm(SkyEphemeris::MOON) / KM_PER_AU;
+            const double earthRadius = EARTH_EQUATORIAL_RADIUS_KM / KM_PER_AU;
+            const double penumbra = EARTH_SHADOW_ENLARGEMENT * (earthRadius + along * (sunRadius + earthRadius) / S);
+            const double umbra = EARTH_SHADOW_ENLARGEMENT * (earthRadius - along * (sunRadius - earthRadius) / S);
+            umbraMargin = d - umbra - moonRadius;
+            totalMargin = d - umbra + moonRadius;
+            return along > 0.0 ? d - penumbra - moonRadius : HUGE_VAL;
+        }
+    };
+
+    /**
+     * @brief Angle in radians between the limbs of the sun and Mercury or Venus, negative once the
+     * planet's disk touches the sun's; planets beyond the sun never transit
+     */
+    struct TransitSeparation {
+        const SkyEphemeris* sky;
+        Body planet;
+        double operator()(double days) const {
+            double inside, separation;
+            return evaluate(days, inside, separation);
+        }
+
+        double evaluate(double days, double& insideMargin, double& separation) const {
+            double xyz[3 * SkyEphemeris::BODIES];
+            sky->positions(days, xyz);
+            const double* sun = &xyz[3 * SkyEphemeris::SUN];
+            const double* body = &xyz[3 * planet];
+            const double angle = angleBetween(sun, body);
+            separation = angle / DEG_TO_RAD;
+            const double sunRadius = std::asin(SkyEphemeris::radiusKm(SkyEphemeris::SUN) / KM_PER_AU / length(sun));
+            const double planetRadius = std::asin(SkyEphemeris::radiusKm(planet) / KM_PER_AU / length(body));
+            insideMargin = angle - sunRadius + planetRadius;
+            return length(body) < length(sun) ? angle - sunRadius - planetRadius : HUGE_VAL;
+        }
+    };
+
+    void scanChunk(double first, std::size_t i0, std::size_t i1, double last, std::vector<SkyEvent>& out) const {
+        double previous[PAIRS], current[PAIRS];
+        double xyz[3 * SkyEphemeris::BODIES];
+        p_Sky.positions(first + i0 * EVENT_STEP_DAYS, xyz);
+        for (int pair = 0; pair < PAIRS; pair++)
+            previous[pair] = pairAngle(pair, xyz);
+
+        for (std::size_t i = i0; i < i1; i++) {
+            const double a = first + i * EVENT_STEP_DAYS;
+            const double b = std::min(a + EVENT_STEP_DAYS, last);
+            p_Sky.positions(b, xyz);
+            for (int pair = 0; pair < PAIRS; pair++) {
+                current[pair] = pairAngle(pair, xyz);
+                // Crossings of zero, not the jump at half a turn
+                const bool crossed = (previous[pair] < 0.0) != (current[pair] < 0.0) &&
+                                     std::fabs(previous[pair]) < TWO_PI / 4 && std::fabs(current[pair]) < TWO_PI / 4;
+                if (crossed) {
+                    PairAngle angle = { &p_Sky, pair };
+                    const double conjunction = brentRoot(angle, a, b, previous[pair], current[pair]);
+                    classify(pair, conjunction, out);
+                }
+                previous[pair] = current[pair];
+            }
+        }
+    }
+
+    void classify(int pair, double conjunction, std::vector<SkyEvent>& out) const {
+        SkyEvent event;
+        pairBodies(pair, event.first, event.second);
+        event.kind = SkyEvent::NONE;
+        event.days = event.begin = event.end = conjunction;
+
+        if (pair == NEW_MOON) {
+            SolarShadow shadow = { &p_Sky };
+            event.type = SkyEvent::SOLAR_ECLIPSE;
+            // The sun and moon close at about half a degree an hour, the eclipse is within hours
+            if (!refine(shadow, conjunction, 0.25, 0.3, event))
+                return;
+            bool central, total;
+            shadow.evaluate(event.days, central, total, event.separation);
+            event.kind = central ? (total ? SkyEvent::TOTAL : SkyEvent::ANNULAR) : SkyEvent::PARTIAL;
+        } else if (pair == FULL_MOON) {
+            LunarShadow shadow = { &p_Sky };
+            event.type = SkyEvent::LUNAR_ECLIPSE;
+            if (!refine(shadow, conjunction, 0.25, 0.3, event))
+                return;
+            double umbra, total;
+            shadow.evaluate(event.days, umbra, total, event.separation);
+            event.kind = total < 0.0 ? SkyEvent::TOTAL : (umbra < 0.0 ? SkyEvent::PARTIAL : SkyEvent::PENUMBRAL);
+        } else if (pair == MERCURY_SUN || pair == VENUS_SUN) {
+            TransitSeparation separation = { &p_Sky, event.second };
+            event.type = SkyEvent::TRANSIT;
+            // A Venus transit lasts up to eight hours, its minimum is within a day of conjunction
+            if (!refine(separation, conjunction, 1.0, 1.0, event))
+                return;
+            double inside;
+            separation.evaluate(event.days, inside, event.separation);
+            event.kind = inside < 0.0 ? SkyEvent::TOTAL : SkyEvent::PARTIAL;
+        } else {
+            event.type = SkyEvent::CONJUNCTION;
+            double xyz[3 * SkyEphemeris::BODIES];
+            p_Sky.positions(conjunction, xyz);
+            event.separation = angleBetween(&xyz[3 * event.first], &xyz[3 * event.second]) / DEG_TO_RAD;
+        }
+        out.push_back(event);
+    }
+
+    /**
+     * @brief Minimises margin within window days of the conjunction and, when it goes negative,
+     * finds where it crosses zero up to reach days either side of the minimum
+     */
+    template <typename Function>
+    static bool refine(const Function& margin, double conjunction, double window, double reach, SkyEvent& event) {
+        double least;
+        const double middle = brentMinimum(margin, conjunction - window, conjunction + window, least);
+        if (!(least < 0.0))
+            return false;
+        event.days = middle;
+        const double before = margin(middle - reach), after = margin(middle + reach);
+        event.begin = before > 0.0 ? brentRoot(margin, middle - reach, middle, before, least) : middle - reach;
+        event.end = after > 0.0 ? brentRoot(margin, middle, middle + reach, least, after) : middle + reach;
+        return true;
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_EVENTSEARCH_HPP_
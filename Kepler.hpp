@@ -0,0 +1,271 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_KEPLER_HPP_
+#define INCLUDE_SOLAR_SYSTEM_KEPLER_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+#include "Simd.hpp"
+
+// Gaussian gravitational constant, sqrt(GM_sun) in AU^(3/2) / day
+const double GAUSS_K = 0.01720209895;
+// GM of the sun in AU^3 / day^2
+const double GM_SUN = GAUSS_K * GAUSS_K;
+const double TWO_PI = 6.283185307179586;
+const double DEG_TO_RAD = 0.017453292519943295;
+const double SECONDS_PER_DAY = 86400.0;
+
+/**
+ * @brief Classical orbital elements, angles in radians, time in days since J2000
+ */
+struct KeplerElements {
+    double semiMajorAxis;       // AU
+    double eccentricity;
+    double inclination;
+    double ascendingNode;       // longitude of the ascending node
+    double argumentOfPeriapsis;
+    double meanAnomalyAtEpoch;
+    double meanMotion;          // rad / day
+
+    KeplerElements()
+        : semiMajorAxis(0.0), eccentricity(0.0), inclination(0.0), ascendingNode(0.0),
+          argumentOfPeriapsis(0.0), meanAnomalyAtEpoch(0.0), meanMotion(0.0) {}
+
+    /**
+     * @brief Builds elements from the longitudes used by the JPL approximate planet tables
+     *
+     * @param[in] a semi-major axis in AU
+     * @param[in] e eccentricity
+     * @param[in] inclinationDeg inclination to the ecliptic in degrees
+     * @param[in] meanLongitudeDeg mean longitude at J2000 in degrees
+     * @param[in] periapsisLongitudeDeg longitude of periapsis in degrees
+     * @param[in] nodeDeg longitude of the ascending node in degrees
+     * @param[in] mu gravitational parameter of the central body, defaults to the sun
+     */
+    static KeplerElements fromLongitudes(double a, double e, double inclinationDeg,
+                                         double meanLongitudeDeg, double periapsisLongitudeDeg,
+                                         double nodeDeg, double mu = GM_SUN) {
+        KeplerElements elements;
+        elements.semiMajorAxis = a;
+        elements.eccentricity = e;
+        elements.inclination = inclinationDeg * DEG_TO_RAD;
+        elements.ascendingNode = nodeDeg * DEG_TO_RAD;
+        elements.argumentOfPeriapsis = (periapsisLongitudeDeg - nodeDeg) * DEG_TO_RAD;
+        elements.meanAnomalyAtEpoch = (meanLongitudeDeg - periapsisLongitudeDeg) * DEG_TO_RAD;
+        elements.meanMotion = std::sqrt(mu / (a * a * a));
+        return elements;
+    }
+};
+
+const int PLANET_COUNT = 8;
+
+/**
+ * @brief JPL's "Keplerian Elements for Approximate Positions of the Major Planets", table 1,
+ * Mercury to Neptune with the Earth-Moon barycentre in the Earth's row: a [AU], e,
+ * inclination, mean longitude, longitude of perihelion, longitude of the ascending node
+ * [deg] at J2000, then their rates per Julian century
+ */
+const double JPL_MEAN_ELEMENTS[PLANET_COUNT][12] = {
+    {  0.38709927,  0.20563593, 7.00497902, 252.25032350,  77.45779628,  48.33076593,
+       0.00000037,  0.00001906, -0.00594749, 149472.67411175, 0.16047689, -0.12534081 },
+    {  0.72333566,  0.00677672, 3.39467605, 181.97909950, 131.60246718,  76.67984255,
+       0.00000390, -0.00004107, -0.00078890, 58517.81538729, 0.00268329, -0.27769418 },
+    {  1.00000261,  0.01671123, -0.00001531, 100.46457166, 102.93768193, 0.0,
+       0.00000562, -0.00004392, -0.01294668, 35999.37244981, 0.32327364, 0.0 },
+    {  1.52371034,  0.09339410, 1.84969142,  -4.55343205, -23.94362959,  49.55953891,
+       0.00001847,  0.00007882, -0.00813131, 19140.30268499, 0.44441088, -0.29257343 },
+    {  5.20288700,  0.04838624, 1.30439695,  34.39644051,  14.72847983, 100.47390909,
+      -0.00011607, -0.00013253, -0.00183714, 3034.74612775, 0.21252668, 0.20469106 },
+    {  9.53667594,  0.05386179, 2.48599187,  49.95424423,  92.59887831, 113.66242448,
+      -0.00125060, -0.00050991, 0.00193609, 1222.49362201, -0.41897216, -0.28867794 },
+    { 19.18916464,  0.04725744, 0.77263783, 313.23810451, 170.95427630,  74.01692503,
+      -0.00196176, -0.00004397, -0.00242939, 428.48202785, 0.40805281, 0.04240589 },
+    { 30.06992276,  0.00859048, 1.77004347, -55.12002969,  44.96476227, 131.78422574,
+       0.00026291,  0.00005105, 0.00035372, 218.45945325, -0.32241464, -0.00508664 },
+};
+
+/**
+ * @brief J2000 mean elements of a planet from JPL_MEAN_ELEMENTS, 0 Mercury ... 7 Neptune
+ */
+inline KeplerElements jplMeanElements(int planet) {
+    const double* e = JPL_MEAN_ELEMENTS[planet];
+    return KeplerElements::fromLongitudes(e[0], e[1], e[2], e[3], e[4], e[5]);
+}
+
+/**
+ * @brief Unit vectors of the orbit's periapsis direction (P) and 90 degrees ahead of it (Q)
+ *
+ * Expressed in ecliptic coordinates, x towards the vernal equinox and z towards the ecliptic pole.
+ */
+inline void orbitBasis(const KeplerElements& elements, double P[3], double Q[3]) {
+    double cosNode = std::cos(elements.ascendingNode), sinNode = std::sin(elements.ascendingNode);
+    double cosPeri = std::cos(elements.argumentOfPeriapsis), sinPeri = std::sin(elements.argumentOfPeriapsis);
+    double cosInc = std::cos(elements.inclination), sinInc = std::sin(elements.inclination);
+
+    P[0] = cosPeri * cosNode - sinPeri * cosInc * sinNode;
+    P[1] = cosPeri * sinNode + sinPeri * cosInc * cosNode;
+    P[2] = sinPeri * sinInc;
+
+    Q[0] = -sinPeri * cosNode - cosPeri * cosInc * sinNode;
+    Q[1] = -sinPeri * sinNode + cosPeri * cosInc * cosNode;
+    Q[2] = cosPeri * sinInc;
+}
+
+/**
+ * @brief Solves Kepler's equation M = E - e sin(E) for a single orbit in double precision
+ */
+inline double solveKepler(double meanAnomaly, double eccentricity) {
+    double M = std::remainder(meanAnomaly, TWO_PI);
+    // Danby's starting value converges for every elliptic orbit
+    double E = M + 0.85 * eccentricity * (M < 0.0 ? -1.0 : 1.0);
+    for (int i = 0; i < 50; i++) {
+        double f = E - eccentricity * std::sin(E) - M;
+        double dE = f / (1.0 - eccentricity * std::cos(E));
+        E -= dE;
+        if (std::fabs(dE) < 1e-14)
+            break;
+    }
+    return E;
+}
+
+/**
+ * @brief Heliocentric ecliptic position (AU) and velocity (AU/day) at time t
+ *
+ * @param[in] elements orbit to evaluate
+ * @param[in] t days since J2000
+ * @param[in] mu gravitational parameter of the central body
+ */
+inline void elementsToState(const KeplerElements& elements, double t, double mu,
+                            double position[3], double velocity[3]) {
+    double a = elements.semiMajorAxis;
+    double e = elements.eccentricity;
+    double E = solveKepler(elements.meanAnomalyAtEpoch + elements.meanMotion * t, e);
+
+    double cosE = std::cos(E), sinE = std::sin(E);
+    double b = a * std::sqrt(1.0 - e * e);
+    double r = a * (1.0 - e * cosE);
+    double vScale = a > 0.0 ? std::sqrt(mu * a) / r : 0.0;
+
+    double P[3], Q[3];
+    orbitBasis(elements, P, Q);
+
+    for (int k = 0; k < 3; k++) {
+        position[k] = a * (cosE - e) * P[k] + b * sinE * Q[k];
+        velocity[k] = vScale * (-sinE * P[k] + std::sqrt(1.0 - e * e) * cosE * Q[k]);
+    }
+}
+
+/**
+ * @brief Batched single precision Kepler propagation over structure-of-arrays orbits
+ *
+ * Every orbit is described by its semi-major and semi-minor axis, eccentricity and its
+ * P/Q basis vectors (see orbitBasis()). The solver runs a fixed number of Newton steps so
+ * that all SIMD lanes stay in lockstep. From Danby's starting value the slowest lanes are
+ * those near perihelion of very eccentric orbits: six steps leave 1.9e-4 rad at e = 0.99,
+ * seven bring every e up to 0.99 to float precision (|dE| < 7e-7 rad).
+ */
+class KeplerSolver {
+public:
+    static const int NEWTON_ITERATIONS = 7;
+
+    /**
+     * @brief Writes the eccentric anomaly for every mean anomaly in [-pi, pi]
+     */
+    static void solve(const float* meanAnomaly, const float* eccentricity, float* eccentricAnomaly,
+                      std::size_t n) {
+        std::size_t i = 0;
+#if defined(SOLAR_SYSTEM_SIMD)
+        using namespace simd;
+        for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+            vfloat M = load(meanAnomaly + i);
+            vfloat e = load(eccentricity + i);
+            vfloat s, c;
+            store(eccentricAnomaly + i, solveLanes(M, e, s, c));
+        }
+#endif
+        for (; i < n; i++) {
+            eccentricAnomaly[i] = solveScalar(meanAnomaly[i], eccentricity[i]);
+        }
+    }
+
+    /**
+     * @brief Computes positions for all orbits from their mean anomalies in [-pi, pi]
+     *
+     * P and Q are passed as separate component arrays so every load is contiguous.
+     */
+    static void propagate(std::size_t n,
+                          const float* meanAnomaly, const float* eccentricity,
+                          const float* semiMajorAxis, const float* semiMinorAxis,
+                          const float* px, const float* py, const float* pz,
+                          const float* qx, const float* qy, const float* qz,
+                          float* x, float* y, float* z) {
+        std::size_t i = 0;
+#if defined(SOLAR_SYSTEM_SIMD)
+        using namespace simd;
+        for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+            vfloat e = load(eccentricity + i);
+            vfloat sinE, cosE;
+            solveLanes(load(meanAnomaly + i), e, sinE, cosE);
+
+            vfloat u = mul(load(semiMajorAxis + i), sub(cosE, e));
+            vfloat v = mul(load(semiMinorAxis + i), sinE);
+
+            store(x + i, fmadd(u, load(px + i), mul(v, load(qx + i))));
+            store(y + i, fmadd(u, load(py + i), mul(v, load(qy + i))));
+            store(z + i, fmadd(u, load(pz + i), mul(v, load(qz + i))));
+        }
+#endif
+        for (; i < n; i++) {
+            float E = solveScalar(meanAnomaly[i], eccentricity[i]);
+            float u = semiMajorAxis[i] * (std::cos(E) - eccentricity[i]);
+            float v = semiMinorAxis[i] * std::sin(E);
+            x[i] = u * px[i] + v * qx[i];
+            y[i] = u * py[i] + v * qy[i];
+            z[i] = u * pz[i] + v * qz[i];
+        }
+    }
+
+    /**
+     * @brief Advances mean anomalies to time t and wraps them into [-pi, pi]
+     *
+     * Done in double precision since n * t grows without bound over long runs.
+     */
+    static void meanAnomalies(std::size_t n, const double* meanAnomalyAtEpoch, const double* meanMotion,
+                              double t, float* meanAnomaly) {
+        const double inverseTwoPi = 1.0 / TWO_PI;
+        for (std::size_t i = 0; i < n; i++) {
+            double M = meanAnomalyAtEpoch[i] + meanMotion[i] * t;
+            M -= TWO_PI * std::floor(M * inverseTwoPi + 0.5);
+            meanAnomaly[i] = static_cast<float>(M);
+        }
+    }
+
+private:
+    static float solveScalar(float M, float e) {
+        float E = M + 0.85f * e * (M < 0.0f ? -1.0f : 1.0f);
+        for (int k = 0; k < NEWTON_ITERATIONS; k++) {
+            E -= (E - e * std::sin(E) - M) / (1.0f - e * std::cos(E));
+        }
+        return E;
+    }
+
+#if defined(SOLAR_SYSTEM_SIMD)
+    /**
+     * @brief Newton iterations on all lanes, also returns sin/cos of the final E
+     */
+    static simd::vfloat solveLanes(simd::vfloat M, simd::vfloat e, simd::vfloat& sinE, simd::vfloat& cosE) {
+        using namespace simd;
+        const vfloat one = set1(1.0f);
+        vfloat E = add(M, copySign(mul(set1(0.85f), e), M));
+        for (int k = 0; k < NEWTON_ITERATIONS; k++) {
+            sincos(E, sinE, cosE);
+            vfloat f = sub(sub(E, mul(e, sinE)), M);
+            vfloat fPrime = sub(one, mul(e, cosE));
+            E = sub(E, div(f, fPrime));
+        }
+        sincos(E, sinE, cosE);
+        return E;
+    }
+#endif
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_KEPLER_HPP_
@@ -0,0 +1,200 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_LAMBERT_HPP_
+#define INCLUDE_SOLAR_SYSTEM_LAMBERT_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief Zero revolution solutions of Lambert's problem with Izzo's method.
+ *
+ * Finds the Kepler arc from r1 to r2 that takes the given time of flight: the time is
+ * written as a function of one variable x on which Householder's method converges in two
+ * or three iterations from Izzo's starting guess, without any trigonometric root finding.
+ *
+ * D. Izzo, "Revisiting Lambert's problem", Celestial Mechanics and Dynamical Astronomy
+ * 121 (2015). Units follow the arguments, AU and days with GM in AU^3 / day^2 here.
+ */
+class LambertSolver {
+public:
+    static const int MAX_ITERATIONS = 15;
+
+    /**
+     * @brief Velocities at both ends of the transfer
+     *
+     * @param[in] r1, r2 start and end positions
+     * @param[in] timeOfFlight positive time between them
+     * @param[in] mu gravitational parameter of the central body
+     * @param[out] v1, v2 velocities on the transfer arc at r1 and r2
+     * @param[in] retrograde take the arc against the direction of the orbit normal (ecliptic north)
+     * @return false if the problem has no solution (non-positive time, r1 and r2 collinear)
+     */
+    static bool solve(const double r1[3], const double r2[3], double timeOfFlight, double mu,
+                      double v1[3], double v2[3], bool retrograde = false) {
+        const double c[3] = { r2[0] - r1[0], r2[1] - r1[1], r2[2] - r1[2] };
+        const double cn = norm(c), r1n = norm(r1), r2n = norm(r2);
+        if (!(timeOfFlight > 0.0) || cn == 0.0 || r1n == 0.0 || r2n == 0.0)
+            return false;
+        const double s = 0.5 * (r1n + r2n + cn);
+
+        double ir1[3], ir2[3], ih[3];
+        for (int k = 0; k < 3; k++) {
+            ir1[k] = r1[k] / r1n;
+            ir2[k] = r2[k] / r2n;
+        }
+        cross(ir1, ir2, ih);
+        const double hn = norm(ih);
+        if (hn < 1e-12)
+            return false;
+        for (int k = 0; k < 3; k++)
+            ih[k] /= hn;
+
+        // Transfers of more than half a turn have a negative lambda
+        double lambda = std::sqrt(1.0 - std::min(1.0, cn / s));
+        double it1[3], it2[3];
+        if (ih[2] < 0.0) {
+            lambda = -lambda;
+            cross(ir1, ih, it1);
+            cross(ir2, ih, it2);
+        } else {
+            cross(ih, ir1, it1);
+            cross(ih, ir2, it2);
+        }
+        if (retrograde) {
+            lambda = -lambda;
+            for (int k = 0; k < 3; k++) {
+                it1[k] = -it1[k];
+                it2[k] = -it2[k];
+            }
+        }
+        const double n1 = norm(it1), n2 = norm(it2);
+        for (int k = 0; k < 3; k++) {
+            it1[k] /= n1;
+            it2[k] /= n2;
+        }
+
+        const double T = std::sqrt(2.0 * mu / (s * s * s)) * timeOfFlight;
+        const double x = findX(lambda, T);
+        if (x != x)
+            return false;
+
+        // Radial and tangential components at both ends
+        const double lambda2 = lambda * lambda;
+        const double gamma = std::sqrt(0.5 * mu * s);
+        const double rho = (r1n - r2n) / cn;
+        const double sigma = std::sqrt(std::max(0.0, 1.0 - rho * rho));
+        const double y = std::sqrt(1.0 - lambda2 + lambda2 * x * x);
+        const double vr1 = gamma * ((lambda * y - x) - rho * (lambda * y + x)) / r1n;
+        const double vr2 = -gamma * ((lambda * y - x) + rho * (lambda * y + x)) / r2n;
+        const double vt = gamma * sigma * (y + lambda * x);
+        const double vt1 = vt / r1n, vt2 = vt / r2n;
+        for (int k = 0; k < 3; k++) {
+            v1[k] = vr1 * ir1[k] + vt1 * it1[k];
+            v2[k] = vr2 * ir2[k] + vt2 * it2[k];
+        }
+        return true;
+    }
+
+private:
+    static double norm(const double v[3]) {
+        return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    }
+
+    static void cross(const double a[3], const double b[3], double out[3]) {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    /**
+     * @brief Householder iterations on x for the non-dimensional time T, NaN if they diverge
+     */
+    static double findX(double lambda, double T) {
+        const double lambda2 = lambda * lambda;
+        const double lambda3 = lambda2 * lambda;
+        const double T00 = std::acos(lambda) + lambda * std::sqrt(1.0 - lambda2);
+        const double T1 = 2.0 / 3.0 * (1.0 - lambda3);
+
+        double x;
+        if (T >= T00)
+            x = -(T - T00) / (T - T00 + 4.0);
+        else if (T <= T1)
+            x = T1 * (T1 - T) / (0.4 * (1.0 - lambda2 * lambda3) * T) + 1.0;
+        else
+            x = std::pow(T / T00, 0.69314718055994529 / std::log(T1 / T00)) - 1.0;
+
+        for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
+            const double tof = timeOfFlight(lambda, x);
+            double dT, ddT, dddT;
+            derivatives(lambda, x, tof, dT, ddT, dddT);
+            const double delta = tof - T;
+            const double dT2 = dT * dT;
+            const double next = x - delta * (dT2 - 0.5 * delta * ddT) /
+                                    (dT * (dT2 - delta * ddT) + dddT * delta * delta / 6.0);
+            const double change = std::fabs(next - x);
+            x = next;
+            if (change < 1e-13)
+                break;
+        }
+        return x > -1.0 ? x : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    /**
+     * @brief Non-dimensional time of flight, with the series that stay accurate near x = 1
+     */
+    static double timeOfFlight(double lambda, double x) {
+        const double distance = std::fabs(x - 1.0);
+        if (distance < 0.2 && distance > 0.01) {
+            // Lagrange's form
+            const double a = 1.0 / (1.0 - x * x);
+            if (a > 0.0) {
+                const double alpha = 2.0 * std::acos(x);
+                double beta = 2.0 * std::asin(std::sqrt(lambda * lambda / a));
+                if (lambda < 0.0)
+                    beta = -beta;
+                return a * std::sqrt(a) * ((alpha - std::sin(alpha)) - (beta - std::sin(beta))) / 2.0;
+            }
+            const double alpha = 2.0 * std::acosh(x);
+            double beta = 2.0 * std::asinh(std::sqrt(-lambda * lambda / a));
+            if (lambda < 0.0)
+                beta = -beta;
+            return -a * std::sqrt(-a) * ((beta - std::sinh(beta)) - (alpha - std::sinh(alpha))) / 2.0;
+        }
+
+        const double E = x * x - 1.0;
+        const double rho = std::fabs(E);
+        const double z = std::sqrt(1.0 + lambda * lambda * E);
+        if (distance <= 0.01) {
+            // Battin's hypergeometric series
+            const double eta = z - lambda * x;
+            const double S1 = 0.5 * (1.0 - lambda - x * eta);
+            double term = 1.0, sum = 1.0;
+            for (int j = 0; std::fabs(term) > 1e-11; j++) {
+                term *= (3.0 + j) * (1.0 + j) / (2.5 + j) * S1 / (j + 1);
+                sum += term;
+            }
+            const double Q = 4.0 / 3.0 * sum;
+            return (eta * eta * eta * Q + 4.0 * lambda * eta) / 2.0;
+        }
+
+        // Lancaster's form
+        const double y = std::sqrt(rho);
+        const double g = x * z - lambda * E;
+        const double d = E < 0.0 ? std::acos(g) : std::log(y * (z - lambda * x) + g);
+        return (x - lambda * z - d / y) / E;
+    }
+
+    static void derivatives(double lambda, double x, double T, double& dT, double& ddT, double& dddT) {
+        const double l2 = lambda * lambda;
+        const double l3 = l2 * lambda;
+        const double umx2 = 1.0 - x * x;
+        const double y = std::sqrt(1.0 - l2 * umx2);
+        const double y2 = y * y;
+        const double y3 = y2 * y;
+        dT = (3.0 * T * x - 2.0 + 2.0 * l3 * x / y) / umx2;
+        ddT = (3.0 * T + 5.0 * x * dT + 2.0 * (1.0 - l2) * l3 / y3) / umx2;
+        dddT = (7.0 * x * ddT + 8.0 * dT - 6.0 * (1.0 - l2) * l2 * l3 * x / (y3 * y2)) / umx2;
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_LAMBERT_HPP_
@@ -0,0 +1,107 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_MAPPEDFILE_HPP_
+#define INCLUDE_SOLAR_SYSTEM_MAPPEDFILE_HPP_
+
+#include <cstddef>
+#include <string>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * Pages are only read from disk when they are touched, so opening a file costs the
+ * same regardless of its size.
+ */
+class MappedFile {
+public:
+    MappedFile() : p_Data(NULL), p_Size(0) {}
+
+    explicit MappedFile(const std::string& path) : p_Data(NULL), p_Size(0) {
+        open(path);
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    /**
+     * @brief Maps the file, returns false if it cannot be opened or is empty
+     */
+    bool open(const std::string& path) {
+        close();
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if (mapping == NULL)
+            return false;
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (data == NULL)
+            return false;
+        p_Data = static_cast<const unsigned char*>(data);
+        p_Size = static_cast<std::size_t>(size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* data = mmap(NULL, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        p_Data = static_cast<const unsigned char*>(data);
+        p_Size = static_cast<std::size_t>(info.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+        if (p_Data == NULL)
+            return;
+#if defined(_WIN32)
+        UnmapViewOfFile(p_Data);
+#else
+        munmap(const_cast<unsigned char*>(p_Data), p_Size);
+#endif
+        p_Data = NULL;
+        p_Size = 0;
+    }
+
+    bool isOpen() const { return p_Data != NULL; }
+    const unsigned char* data() const { return p_Data; }
+    std::size_t size() const { return p_Size; }
+
+private:
+    const unsigned char* p_Data;
+    std::size_t p_Size;
+
+    // A mapping has a single owner
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_MAPPEDFILE_HPP_
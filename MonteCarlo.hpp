@@ -0,0 +1,366 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_MONTECARLO_HPP_
+#define INCLUDE_SOLAR_SYSTEM_MONTECARLO_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "DirectGravity.hpp"
+#include "Kepler.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Dispersed spacecraft trajectories propagated through the planets' gravity.
+ *
+ * Every sample is a massless spacecraft pulled by the sun and by planets that move on
+ * their Kepler orbits, in heliocentric ecliptic coordinates (AU, days, GM in AU^3 / day^2).
+ * The sun's own acceleration towards the planets is subtracted, so the frame stays
+ * heliocentric.
+ *
+ * Samples are integrated with the adaptive Dormand-Prince 5(4) method in batches of
+ * BATCH: a batch shares its step size, chosen from its worst sample, so the planets are
+ * placed once per stage and the accelerations of the whole batch go through the SIMD
+ * DirectGravity kernel with one sample per lane. Batches are independent and spread
+ * over the thread pool; each keeps its step size between calls.
+ */
+class MonteCarloPropagator {
+public:
+    static const std::size_t BATCH = 128;
+    static const int STAGES = 7;
+    static const std::size_t MAX_PERTURBERS = 15;
+
+    /**
+     * @param[in] pool threads the batches are spread over
+     * @param[in] relativeTolerance local error per step relative to the state
+     * @param[in] absoluteTolerance local error per step in AU and AU / day near zero
+     * @param[in] softening softening length in AU, keeps a sample that hits a planet from stalling its batch
+     */
+    explicit MonteCarloPropagator(ThreadPool& pool, double relativeTolerance = 1e-9,
+                                  double absoluteTolerance = 1e-12, double softening = 2e-5)
+        : p_Pool(pool), p_RelativeTolerance(relativeTolerance), p_AbsoluteTolerance(absoluteTolerance),
+          p_Softening2(softening * softening), p_Time(0.0) {}
+
+    /**
+     * @brief Adds a planet that attracts the samples
+     *
+     * @param[in] orbit heliocentric orbit
+     * @param[in] gm gravitational parameter in AU^3 / day^2
+     * @return false once MAX_PERTURBERS planets were added
+     */
+    bool addPerturber(const KeplerElements& orbit, double gm) {
+        if (p_Perturbers.size() >= MAX_PERTURBERS) {
+            std::cerr << "MonteCarloPropagator: at most " << MAX_PERTURBERS << " perturbers" << std::endl;
+            return false;
+        }
+        double P[3], Q[3];
+        orbitBasis(orbit, P, Q);
+        Perturber perturber;
+        perturber.orbit = orbit;
+        perturber.semiMinorAxis = orbit.semiMajorAxis * std::sqrt(1.0 - orbit.eccentricity * orbit.eccentricity);
+        for (int k = 0; k < 3; k++) {
+            perturber.P[k] = P[k];
+            perturber.Q[k] = Q[k];
+        }
+        perturber.gm = gm;
+        p_Perturbers.push_back(perturber);
+        return true;
+    }
+
+    /**
+     * @brief Removes all samples and sets the time of the next ones
+     */
+    void clear(double days) {
+        p_X.clear(); p_Y.clear(); p_Z.clear();
+        p_VX.clear(); p_VY.clear(); p_VZ.clear();
+        p_Step.clear();
+        p_Accepted.clear();
+        p_Rejected.clear();
+        p_Time = days;
+    }
+
+    void addSample(const double position[3], const double velocity[3]) {
+        p_X.push_back(position[0]); p_Y.push_back(position[1]); p_Z.push_back(position[2]);
+        p_VX.push_back(velocity[0]); p_VY.push_back(velocity[1]); p_VZ.push_back(velocity[2]);
+        std::size_t batches = (p_X.size() + BATCH - 1) / BATCH;
+        p_Step.resize(batches, 0.0);
+        p_Accepted.resize(batches, 0);
+        p_Rejected.resize(batches, 0);
+    }
+
+    /**
+     * @brief Adds count samples around a nominal state with Gaussian dispersions
+     *
+     * @param[in] positionSigma standard deviation of each position component in AU
+     * @param[in] velocitySigma standard deviation of each velocity component in AU / day
+     */
+    void disperse(const double position[3], const double velocity[3], double positionSigma, double velocitySigma,
+                  std::size_t count, unsigned int seed = 1) {
+        std::mt19937_64 rng(seed);
+        std::normal_distribution<double> normal(0.0, 1.0);
+        for (std::size_t i = 0; i < count; i++) {
+            double p[3], v[3];
+            for (int k = 0; k < 3; k++)
+                p[k] = position[k] + positionSigma * normal(rng);
+            for (int k = 0; k < 3; k++)
+                v[k] = velocity[k] + velocitySigma * normal(rng);
+            addSample(p, v);
+        }
+    }
+
+    /**
+     * @brief Integrates every sample to the given time, forwards or backwards
+     */
+    void advanceTo(double days) {
+        if (days == p_Time || p_X.empty()) {
+            p_Time = days;
+            return;
+        }
+        const double from = p_Time;
+        const std::size_t batches = p_Step.size();
+        p_Pool.parallelFor(0, batches, 1, [this, from, days](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; b++)
+                integrateBatch(b, from, days);
+        });
+        p_Time = days;
+    }
+
+    std::size_t size() const { return p_X.size(); }
+    bool empty() const { return p_X.empty(); }
+    double getTime() const { return p_Time; }
+
+    const double* x() const { return p_X.data(); }
+    const double* y() const { return p_Y.data(); }
+    const double* z() const { return p_Z.data(); }
+    const double* vx() const { return p_VX.data(); }
+    const double* vy() const { return p_VY.data(); }
+    const double* vz() const { return p_VZ.data(); }
+
+    /**
+     * @brief Steps taken by all batches together since the samples were added
+     */
+    std::uint64_t acceptedSteps() const {
+        std::uint64_t total = 0;
+        for (std::size_t b = 0; b < p_Accepted.size(); b++)
+            total += p_Accepted[b];
+        return total;
+    }
+
+    std::uint64_t rejectedSteps() const {
+        std::uint64_t total = 0;
+        for (std::size_t b = 0; b < p_Rejected.size(); b++)
+            total += p_Rejected[b];
+        return total;
+    }
+
+private:
+    struct Perturber {
+        KeplerElements orbit;
+        double semiMinorAxis;
+        double P[3], Q[3];
+        double gm;
+    };
+
+    /**
+     * @brief Positions of the attracting bodies at one time, the sun first
+     */
+    struct Sources {
+        double x[MAX_PERTURBERS + 1], y[MAX_PERTURBERS + 1], z[MAX_PERTURBERS + 1], gm[MAX_PERTURBERS + 1];
+        double indirect[3];     // acceleration of the sun towards the planets
+        std::size_t count;
+    };
+
+    /**
+     * @brief Stage derivatives and scratch states of one batch, kept on the stack
+     */
+    struct Work {
+        double r[3][BATCH];
+        double v[3][BATCH];
+        double kr[STAGES][3][BATCH];
+        double kv[STAGES][3][BATCH];
+    };
+
+    ThreadPool& p_Pool;
+    double p_RelativeTolerance;
+    double p_AbsoluteTolerance;
+    double p_Softening2;
+    double p_Time;
+    std::vector<Perturber> p_Perturbers;
+    std::vector<double> p_X, p_Y, p_Z;
+    std::vector<double> p_VX, p_VY, p_VZ;
+    std::vector<double> p_Step;             // last step size of each batch, 0 before the first
+    std::vector<std::uint64_t> p_Accepted;
+    std::vector<std::uint64_t> p_Rejected;
+
+    void placeSources(double days, Sources& sources) const {
+        sources.x[0] = sources.y[0] = sources.z[0] = 0.0;
+        sources.gm[0] = GM_SUN;
+        sources.indirect[0] = sources.indirect[1] = sources.indirect[2] = 0.0;
+        sources.count = 1;
+        for (std::size_t k = 0; k < p_Perturbers.size(); k++) {
+            const Perturber& p = p_Perturbers[k];
+            const double e = p.orbit.eccentricity;
+            const double E = solveKepler(p.orbit.meanAnomalyAtEpoch + p.orbit.meanMotion * days, e);
+            const double u = p.orbit.semiMajorAxis * (std::cos(E) - e);
+            const double v = p.semiMinorAxis * std::sin(E);
+            const double x = u * p.P[0] + v * p.Q[0];
+            const double y = u * p.P[1] + v * p.Q[1];
+            const double z = u * p.P[2] + v * p.Q[2];
+            const double r = std::sqrt(x * x + y * y + z * z);
+            const double f = p.gm / (r * r * r);
+            sources.indirect[0] -= f * x;
+            sources.indirect[1] -= f * y;
+            sources.indirect[2] -= f * z;
+            sources.x[sources.count] = x;
+            sources.y[sources.count] = y;
+            sources.z[sources.count] = z;
+            sources.gm[sources.count] = p.gm;
+            sources.count++;
+        }
+    }
+
+    /**
+     * @brief Accelerations of n samples at positions r, time days
+     */
+    void accelerations(double days, std::size_t n, double r[3][BATCH], double a[3][BATCH]) const {
+        Sources sources;
+        placeSources(days, sources);
+        for (std::size_t i = 0; i < n; i++) {
+            a[0][i] = sources.indirect[0];
+            a[1][i] = sources.indirect[1];
+            a[2][i] = sources.indirect[2];
+        }
+        DirectGravity::accumulateTile(p_Softening2, 0, n, r[0], r[1], r[2], 0, sources.count,
+                                      sources.x, sources.y, sources.z, sources.gm, a[0], a[1], a[2]);
+    }
+
+    /**
+     * @brief Runs batch b from time from to time to with Dormand-Prince steps
+     */
+    void integrateBatch(std::size_t b, double from, double to) {
+        // Dormand and Prince (1980); the fifth order solution is the last stage, so its
+        // derivative is the first one of the next step
+        static const double C[STAGES] = { 0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0 };
+        static const double A[STAGES][STAGES - 1] = {
+            { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+            { 1.0 / 5.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+            { 3.0 / 40.0, 9.0 / 40.0, 0.0, 0.0, 0.0, 0.0 },
+            { 44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0, 0.0, 0.0, 0.0 },
+            { 19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0, 0.0, 0.0 },
+            { 9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0, 0.0 },
+            { 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0 },
+        };
+        // Fifth minus fourth order weights
+        static const double E[STAGES] = { 71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0,
+                                          -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0 };
+        const double MIN_STEP = 1e-9;   // days; steps this short are accepted whatever their error
+
+        const std::size_t begin = b * BATCH;
+        const std::size_t n = p_X.size() - begin < BATCH ? p_X.size() - begin : BATCH;
+        double* state[6] = { &p_X[begin], &p_Y[begin], &p_Z[begin], &p_VX[begin], &p_VY[begin], &p_VZ[begin] };
+
+        Work work;
+        double y0[6][BATCH];
+        for (int c = 0; c < 6; c++)
+            std::copy(state[c], state[c] + n, y0[c]);
+
+        // First stage at the start, later ones reuse the last stage of the step before
+        for (int c = 0; c < 3; c++)
+            std::copy(y0[3 + c], y0[3 + c] + n, work.kr[0][c]);
+        accelerations(from, n, y0, work.kv[0]);
+
+        const double direction = to > from ? 1.0 : -1.0;
+        double h = p_Step[b];
+        if (h <= 0.0) {
+            // A hundredth of the time the first sample takes to cover its distance or change its speed
+            double r = std::sqrt(y0[0][0] * y0[0][0] + y0[1][0] * y0[1][0] + y0[2][0] * y0[2][0]);
+            double v = std::sqrt(y0[3][0] * y0[3][0] + y0[4][0] * y0[4][0] + y0[5][0] * y0[5][0]);
+            double a = std::sqrt(work.kv[0][0][0] * work.kv[0][0][0] + work.kv[0][1][0] * work.kv[0][1][0] +
+                                 work.kv[0][2][0] * work.kv[0][2][0]);
+            h = 0.01 * std::min(v > 0.0 ? r / v : 1.0, a > 0.0 ? v / a : 1.0);
+            h = std::max(h, MIN_STEP);
+        }
+
+        double t = from;
+        std::uint64_t accepted = 0, rejected = 0;
+        while (t != to) {
+            const double remaining = std::fabs(to - t);
+            const bool last = h >= remaining;
+            const double dt = direction * (last ? remaining : h);
+
+            for (int s = 1; s < STAGES; s++) {
+                for (int c = 0; c < 3; c++) {
+                    double* r = work.r[c];
+                    double* v = work.v[c];
+                    for (std::size_t i = 0; i < n; i++) {
+                        r[i] = y0[c][i];
+                        v[i] = y0[3 + c][i];
+                    }
+                    for (int j = 0; j < s; j++) {
+                        const double w = dt * A[s][j];
+                        if (w == 0.0)
+                            continue;
+                        const double* kr = work.kr[j][c];
+                        const double* kv = work.kv[j][c];
+                        for (std::size_t i = 0; i < n; i++) {
+                            r[i] += w * kr[i];
+                            v[i] += w * kv[i];
+                        }
+                    }
+                    std::copy(v, v + n, work.kr[s][c]);
+                }
+                accelerations(t + C[s] * dt, n, work.r, work.kv[s]);
+            }
+
+            // The last stage is the new state; its error estimate is scaled per component and sample
+            double error = 0.0;
+            for (int c = 0; c < 6; c++) {
+                const double* y1 = c < 3 ? work.r[c] : work.v[c - 3];
+                const double* k[STAGES];
+                for (int j = 0; j < STAGES; j++)
+                    k[j] = c < 3 ? work.kr[j][c] : work.kv[j][c - 3];
+                for (std::size_t i = 0; i < n; i++) {
+                    double delta = 0.0;
+                    for (int j = 0; j < STAGES; j++)
+                        delta += E[j] * k[j][i];
+                    const double scale = p_AbsoluteTolerance +
+                                         p_RelativeTolerance * std::max(std::fabs(y0[c][i]), std::fabs(y1[i]));
+                    error = std::max(error, std::fabs(dt * delta) / scale);
+                }
+            }
+
+            const double factor = error > 0.0 ? 0.9 * std::pow(error, -0.2) : 5.0;
+            if (error <= 1.0 || std::fabs(dt) <= MIN_STEP) {
+                accepted++;
+                t = last ? to : t + dt;
+                for (int c = 0; c < 3; c++) {
+                    std::copy(work.r[c], work.r[c] + n, y0[c]);
+                    std::copy(work.v[c], work.v[c] + n, y0[3 + c]);
+                    std::copy(work.kr[STAGES - 1][c], work.kr[STAGES - 1][c] + n, work.kr[0][c]);
+                    std::copy(work.kv[STAGES - 1][c], work.kv[STAGES - 1][c] + n, work.kv[0][c]);
+                }
+                // A step cut short to land on the target says nothing about the next one
+                if (!last || remaining >= h)
+                    h = std::fabs(dt) * std::min(5.0, factor);
+            } else {
+                rejected++;
+                h = std::max(MIN_STEP, std::fabs(dt) * std::max(0.2, factor));
+            }
+        }
+
+        for (int c = 0; c < 6; c++)
+            std::copy(y0[c], y0[c] + n, state[c]);
+        p_Step[b] = h;
+        p_Accepted[b] += accepted;
+        p_Rejected[b] += rejected;
+    }
+
+    // Not copyable, the pool is shared
+    MonteCarloPropagator(const MonteCarloPropagator&);
+    MonteCarloPropagator& operator=(const MonteCarloPropagator&);
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_MONTECARLO_HPP_
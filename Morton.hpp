@@ -0,0 +1,139 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_MORTON_HPP_
+#define INCLUDE_SOLAR_SYSTEM_MORTON_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+// Bits per axis in a Morton code, 48 bits in total
+const int MORTON_BITS = 16;
+
+/**
+ * @brief Spreads the low 16 bits of v so that there are two zero bits between each of them
+ */
+inline std::uint64_t spreadBits(std::uint64_t v) {
+    v &= 0xffff;
+    v = (v | (v << 16)) & 0x0000ff0000ffULL;
+    v = (v | (v << 8)) & 0x00f00f00f00fULL;
+    v = (v | (v << 4)) & 0x0c30c30c30c3ULL;
+    v = (v | (v << 2)) & 0x249249249249ULL;
+    return v;
+}
+
+/**
+ * @brief Axis aligned cube that maps positions to Morton cells
+ */
+struct MortonBox {
+    double minX, minY, minZ;
+    double size;        // edge length of the cube
+
+    /**
+     * @brief Smallest cube around all points, slightly padded so the far faces stay inside
+     */
+    static MortonBox around(std::size_t n, const double* x, const double* y, const double* z) {
+        MortonBox box;
+        if (n == 0) {
+            box.minX = box.minY = box.minZ = 0.0;
+            box.size = 1.0;
+            return box;
+        }
+        double maxX = x[0], maxY = y[0], maxZ = z[0];
+        box.minX = x[0]; box.minY = y[0]; box.minZ = z[0];
+        for (std::size_t i = 1; i < n; i++) {
+            if (x[i] < box.minX) box.minX = x[i];
+            if (y[i] < box.minY) box.minY = y[i];
+            if (z[i] < box.minZ) box.minZ = z[i];
+            if (x[i] > maxX) maxX = x[i];
+            if (y[i] > maxY) maxY = y[i];
+            if (z[i] > maxZ) maxZ = z[i];
+        }
+        double size = maxX - box.minX;
+        if (maxY - box.minY > size) size = maxY - box.minY;
+        if (maxZ - box.minZ > size) size = maxZ - box.minZ;
+        box.size = size > 0.0 ? size * 1.0001 : 1.0;
+        return box;
+    }
+
+    /**
+     * @brief Interleaved cell code, points outside the box are clamped to its faces
+     */
+    std::uint64_t code(double px, double py, double pz) const {
+        const double cells = static_cast<double>(1 << MORTON_BITS);
+        double scale = cells / size;
+        return (spreadBits(cell((px - minX) * scale)) << 2) |
+               (spreadBits(cell((py - minY) * scale)) << 1) |
+                spreadBits(cell((pz - minZ) * scale));
+    }
+
+private:
+    static std::uint64_t cell(double v) {
+        const double last = static_cast<double>((1 << MORTON_BITS) - 1);
+        if (!(v > 0.0))
+            return 0;
+        if (v > last)
+            return static_cast<std::uint64_t>(last);
+        return static_cast<std::uint64_t>(v);
+    }
+};
+
+/**
+ * @brief Parallel LSD radix sort of 48-bit keys, carrying a 32-bit value along
+ *
+ * Every 8-bit pass builds per-chunk histograms in parallel, turns them into scatter
+ * offsets serially (256 * chunks entries) and scatters in parallel. Stable.
+ */
+inline void radixSort(ThreadPool& pool, std::vector<std::uint64_t>& keys, std::vector<std::uint32_t>& values) {
+    const std::size_t n = keys.size();
+    const std::size_t chunks = pool.size();
+    const std::size_t chunkSize = (n + chunks - 1) / chunks;
+    if (n < 2)
+        return;
+
+    std::vector<std::uint64_t> keysOut(n);
+    std::vector<std::uint32_t> valuesOut(n);
+    std::vector<std::size_t> offsets(256 * chunks);
+
+    for (int shift = 0; shift < 3 * MORTON_BITS; shift += 8) {
+        std::uint64_t* in = keys.data();
+        std::uint32_t* inValues = values.data();
+        std::uint64_t* out = keysOut.data();
+        std::uint32_t* outValues = valuesOut.data();
+        std::size_t* offset = offsets.data();
+
+        // The pool runs small ranges as a single chunk, so unused histograms must read as empty
+        std::fill(offsets.begin(), offsets.end(), 0);
+
+        pool.parallelFor(0, n, chunkSize, [=](std::size_t begin, std::size_t end) {
+            std::size_t* histogram = offset + 256 * (begin / chunkSize);
+            for (std::size_t i = begin; i < end; i++)
+                histogram[(in[i] >> shift) & 0xff]++;
+        });
+
+        // Bucket-major, chunk-minor prefix sum keeps the sort stable
+        std::size_t sum = 0;
+        for (int b = 0; b < 256; b++) {
+            for (std::size_t c = 0; c < chunks; c++) {
+                std::size_t count = offsets[256 * c + b];
+                offsets[256 * c + b] = sum;
+                sum += count;
+            }
+        }
+
+        pool.parallelFor(0, n, chunkSize, [=](std::size_t begin, std::size_t end) {
+            std::size_t* position = offset + 256 * (begin / chunkSize);
+            for (std::size_t i = begin; i < end; i++) {
+                std::size_t target = position[(in[i] >> shift) & 0xff]++;
+                out[target] = in[i];
+                outValues[target] = inValues[i];
+            }
+        });
+
+        keys.swap(keysOut);
+        values.swap(valuesOut);
+    }
+}
+
+#endif  // INCLUDE_SOLAR_SYSTEM_MORTON_HPP_
@@ -0,0 +1,491 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_NBODY_HPP_
+#define INCLUDE_SOLAR_SYSTEM_NBODY_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "BarnesHut.hpp"
+#include "BlockTimestep.hpp"
+#include "DirectGravity.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Bodies integrated under their mutual gravity with a kick-drift-kick leapfrog.
+ *
+ * Units are AU, days and GM in AU^3 / day^2. Bodies with GM > 0 attract everything,
+ * bodies added with GM == 0 are test particles that only feel the others, so their
+ * cost is linear in the number of massive bodies.
+ *
+ * With useTree() the light sources (debris, self-gravitating disks) go through a Barnes-Hut
+ * octree while the heavy ones, the Sun and planets, stay on exact direct summation.
+ *
+ * With useBlockTimesteps() every body steps at its own power-of-two fraction of the block
+ * step, chosen from eta * |v| / |a| (a fixed fraction of the orbital period for Kepler
+ * orbits), and only the bodies that finish a step get new accelerations.
+ */
+class NBodySystem {
+public:
+    /**
+     * @param[in] pool threads used for the force evaluation
+     * @param[in] softening softening length in AU, keeps close particle encounters finite
+     */
+    explicit NBodySystem(ThreadPool& pool, double softening = 0.0)
+        : p_Pool(pool), p_Softening2(softening * softening), p_Time(0.0), p_AccelerationsValid(false),
+          p_UseTree(false), p_TreeMaxGM(0.0), p_UseBlocks(false), p_Eta(0.02), p_ForceEvaluations(0) {}
+
+    /**
+     * @brief Switches between direct summation and the Barnes-Hut tree for light sources
+     *
+     * @param[in] enabled use the tree
+     * @param[in] theta opening angle of the tree
+     * @param[in] maxGM sources with GM above this are always summed directly; the default is
+     * far below the lightest planet (Mercury, 4.9e-11 AU^3 / day^2)
+     */
+    void useTree(bool enabled, double theta = 0.5, double maxGM = 1e-12) {
+        p_UseTree = enabled;
+        p_Tree.setTheta(theta);
+        p_TreeMaxGM = maxGM;
+        p_AccelerationsValid = false;
+    }
+
+    bool usesTree() const { return p_UseTree; }
+
+    /**
+     * @brief Switches between one global step and hierarchical block timesteps
+     *
+     * @param[in] enabled use block timesteps, advanceTo()'s maxStep becomes the block length
+     * @param[in] eta accuracy parameter, steps are eta * |v| / |a| rounded down to a power of two
+     * @param[in] maxLevel finest level, steps never go below blockDt / 2^maxLevel
+     */
+    void useBlockTimesteps(bool enabled, double eta = 0.02, int maxLevel = 12) {
+        p_UseBlocks = enabled;
+        p_Eta = eta;
+        p_Scheduler.setMaxLevel(maxLevel);
+    }
+
+    bool usesBlockTimesteps() const { return p_UseBlocks; }
+
+    /**
+     * @brief Stretches the block timestep of one body, above 1 trades its accuracy for speed
+     */
+    void setStepScale(std::size_t i, double scale) { p_StepScale[i] = scale; }
+
+    /**
+     * @brief Number of bodies on each timestep level as of the last block
+     */
+    const std::vector<std::size_t>& levelCounts() const { return p_Scheduler.levelCounts(); }
+
+    /**
+     * @brief Accelerations computed since the last clear(), counted per body
+     */
+    std::uint64_t forceEvaluations() const { return p_ForceEvaluations; }
+
+    void setSoftening(double softening) {
+        p_Softening2 = softening * softening;
+        p_AccelerationsValid = false;
+    }
+
+    /**
+     * @brief Adds a body and returns its index, GM == 0 makes it a test particle
+     */
+    std::size_t addBody(double gm, const double position[3], const double velocity[3]) {
+        p_X.push_back(position[0]);
+        p_Y.push_back(position[1]);
+        p_Z.push_back(position[2]);
+        p_Vx.push_back(velocity[0]);
+        p_Vy.push_back(velocity[1]);
+        p_Vz.push_back(velocity[2]);
+        p_Ax.push_back(0.0);
+        p_Ay.push_back(0.0);
+        p_Az.push_back(0.0);
+        p_GM.push_back(gm);
+        p_StepScale.push_back(1.0);
+        p_AccelerationsValid = false;
+        return p_X.size() - 1;
+    }
+
+    /**
+     * @brief Removes all bodies and resets the clock
+     */
+    void clear(double time = 0.0) {
+        p_X.clear(); p_Y.clear(); p_Z.clear();
+        p_Vx.clear(); p_Vy.clear(); p_Vz.clear();
+        p_Ax.clear(); p_Ay.clear(); p_Az.clear();
+        p_GM.clear();
+        p_StepScale.clear();
+        p_Time = time;
+        p_AccelerationsValid = false;
+        p_ForceEvaluations = 0;
+    }
+
+    /**
+     * @brief Replaces all bodies at once, e.g. from a snapshot
+     */
+    void setState(double time, std::size_t n,
+                  const double* x, const double* y, const double* z,
+                  const double* vx, const double* vy, const double* vz, const double* gm) {
+        p_X.assign(x, x + n); p_Y.assign(y, y + n); p_Z.assign(z, z + n);
+        p_Vx.assign(vx, vx + n); p_Vy.assign(vy, vy + n); p_Vz.assign(vz, vz + n);
+        p_GM.assign(gm, gm + n);
+        p_Ax.assign(n, 0.0); p_Ay.assign(n, 0.0); p_Az.assign(n, 0.0);
+        p_StepScale.assign(n, 1.0);
+        p_Time = time;
+        p_AccelerationsValid = false;
+    }
+
+    /**
+     * @brief Merges colliding bodies, conserving mass and momentum
+     *
+     * Each pair merges into the heavier body at the centre of mass, chains of pairs merge
+     * into one body. The lighter bodies are removed and the rest keep their order, so
+     * indices below every removed body stay valid.
+     *
+     * @param[in] pairs indices of colliding bodies
+     * @param[out] remap optional new index of every old index, UINT32_MAX for removed bodies
+     * @return number of bodies removed
+     */
+    std::size_t mergeBodies(const std::vector<std::pair<std::uint32_t, std::uint32_t> >& pairs,
+                            std::vector<std::uint32_t>* remap = NULL) {
+        const std::size_t n = size();
+        if (remap != NULL) {
+            remap->resize(n);
+            for (std::size_t i = 0; i < n; i++)
+                (*remap)[i] = static_cast<std::uint32_t>(i);
+        }
+        if (pairs.empty())
+            return 0;
+
+        // Union-find where the root of a group is the body that survives it
+        p_MergeInto.resize(n);
+        for (std::size_t i = 0; i < n; i++)
+            p_MergeInto[i] = static_cast<std::uint32_t>(i);
+        std::size_t removed = 0;
+        for (std::size_t k = 0; k < pairs.size(); k++) {
+            std::uint32_t a = mergeRoot(pairs[k].first), b = mergeRoot(pairs[k].second);
+            if (a == b)
+                continue;
+            if (p_GM[b] > p_GM[a] || (p_GM[b] == p_GM[a] && b < a))
+                std::swap(a, b);
+
+            // Test particles have no mass to weigh with, they meet halfway
+            double total = p_GM[a] + p_GM[b];
+            double wa = total > 0.0 ? p_GM[a] / total : 0.5, wb = 1.0 - wa;
+            p_X[a] = wa * p_X[a] + wb * p_X[b];
+            p_Y[a] = wa * p_Y[a] + wb * p_Y[b];
+            p_Z[a] = wa * p_Z[a] + wb * p_Z[b];
+            p_Vx[a] = wa * p_Vx[a] + wb * p_Vx[b];
+            p_Vy[a] = wa * p_Vy[a] + wb * p_Vy[b];
+            p_Vz[a] = wa * p_Vz[a] + wb * p_Vz[b];
+            p_GM[a] = total;
+            p_MergeInto[b] = a;
+            removed++;
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            if (p_MergeInto[i] != i) {
+                if (remap != NULL)
+                    (*remap)[i] = UINT32_MAX;
+                continue;
+            }
+            p_X[kept] = p_X[i]; p_Y[kept] = p_Y[i]; p_Z[kept] = p_Z[i];
+            p_Vx[kept] = p_Vx[i]; p_Vy[kept] = p_Vy[i]; p_Vz[kept] = p_Vz[i];
+            p_GM[kept] = p_GM[i];
+            p_StepScale[kept] = p_StepScale[i];
+            if (remap != NULL)
+                (*remap)[i] = static_cast<std::uint32_t>(kept);
+            kept++;
+        }
+        p_X.resize(kept); p_Y.resize(kept); p_Z.resize(kept);
+        p_Vx.resize(kept); p_Vy.resize(kept); p_Vz.resize(kept);
+        p_Ax.resize(kept); p_Ay.resize(kept); p_Az.resize(kept);
+        p_GM.resize(kept);
+        p_StepScale.resize(kept);
+        p_AccelerationsValid = false;
+        return removed;
+    }
+
+    /**
+     * @brief Shifts positions and velocities so the centre of mass rests at the origin
+     */
+    void moveToBarycentre() {
+        double total = 0.0, cx = 0.0, cy = 0.0, cz = 0.0, cvx = 0.0, cvy = 0.0, cvz = 0.0;
+        for (std::size_t i = 0; i < size(); i++) {
+            total += p_GM[i];
+            cx += p_GM[i] * p_X[i]; cy += p_GM[i] * p_Y[i]; cz += p_GM[i] * p_Z[i];
+            cvx += p_GM[i] * p_Vx[i]; cvy += p_GM[i] * p_Vy[i]; cvz += p_GM[i] * p_Vz[i];
+        }
+        if (total <= 0.0)
+            return;
+        for (std::size_t i = 0; i < size(); i++) {
+            p_X[i] -= cx / total; p_Y[i] -= cy / total; p_Z[i] -= cz / total;
+            p_Vx[i] -= cvx / total; p_Vy[i] -= cvy / total; p_Vz[i] -= cvz / total;
+        }
+        p_AccelerationsValid = false;
+    }
+
+    /**
+     * @brief One kick-drift-kick leapfrog step
+     */
+    void step(double dt) {
+        if (!p_AccelerationsValid)
+            computeAccelerations();
+
+        const std::size_t n = size();
+        const double halfDt = 0.5 * dt;
+        kick(halfDt);
+        for (std::size_t i = 0; i < n; i++) {
+            p_X[i] += p_Vx[i] * dt;
+            p_Y[i] += p_Vy[i] * dt;
+            p_Z[i] += p_Vz[i] * dt;
+        }
+        computeAccelerations();
+        kick(halfDt);
+
+        p_Time += dt;
+    }
+
+    /**
+     * @brief One block of hierarchical timesteps, all bodies are synchronised again at its end
+     *
+     * Every body runs kick-drift-kick on its own level. The drifts of all bodies go from
+     * one step boundary of the finest occupied level to the next.
+     */
+    void blockStep(double blockDt) {
+        if (!p_AccelerationsValid)
+            computeAccelerations();
+
+        const std::size_t n = size();
+        p_Scheduler.resize(n);
+        for (std::size_t i = 0; i < n; i++)
+            p_Scheduler.setLevel(i, p_Scheduler.levelFor(stepCriterion(i), std::fabs(blockDt)));
+
+        const std::uint64_t ticks = p_Scheduler.ticksPerBlock();
+        const double tickDt = blockDt / ticks;
+        std::uint64_t tick = 0;
+        while (tick < ticks) {
+            // Opening half kicks of the bodies that start a step
+            for (std::size_t i = 0; i < n; i++) {
+                if (p_Scheduler.onBoundary(i, tick))
+                    kickBody(i, 0.5 * tickDt * p_Scheduler.stepTicks(p_Scheduler.getLevel(i)));
+            }
+
+            std::uint64_t next = p_Scheduler.nextTick(tick);
+            double dt = tickDt * (next - tick);
+            for (std::size_t i = 0; i < n; i++) {
+                p_X[i] += p_Vx[i] * dt;
+                p_Y[i] += p_Vy[i] * dt;
+                p_Z[i] += p_Vz[i] * dt;
+            }
+            tick = next;
+
+            // Closing half kicks of the bodies that end a step here, then pick their next level
+            p_Active.clear();
+            for (std::size_t i = 0; i < n; i++) {
+                if (p_Scheduler.onBoundary(i, tick))
+                    p_Active.push_back(static_cast<std::uint32_t>(i));
+            }
+            computeAccelerations(p_Active);
+            for (std::size_t k = 0; k < p_Active.size(); k++) {
+                std::size_t i = p_Active[k];
+                kickBody(i, 0.5 * tickDt * p_Scheduler.stepTicks(p_Scheduler.getLevel(i)));
+                if (tick < ticks)
+                    p_Scheduler.requestLevel(i, p_Scheduler.levelFor(stepCriterion(i), std::fabs(blockDt)), tick);
+            }
+        }
+
+        p_Time += blockDt;
+    }
+
+    /**
+     * @brief Integrates up to time t in equal steps (or blocks) no longer than maxStep
+     */
+    void advanceTo(double t, double maxStep) {
+        double span = t - p_Time;
+        if (span == 0.0 || maxStep <= 0.0)
+            return;
+        int steps = static_cast<int>(std::ceil(std::fabs(span) / maxStep));
+        double dt = span / steps;
+        for (int i = 0; i < steps; i++) {
+            if (p_UseBlocks)
+                blockStep(dt);
+            else
+                step(dt);
+        }
+        p_Time = t;
+    }
+
+    /**
+     * @brief Total energy of the massive bodies, useful to check the integrator
+     *
+     * The potential is summed over all pairs, so keep this to small systems.
+     */
+    double energy() const {
+        double kinetic = 0.0, potential = 0.0;
+        for (std::size_t i = 0; i < size(); i++) {
+            if (p_GM[i] <= 0.0)
+                continue;
+            kinetic += 0.5 * p_GM[i] * (p_Vx[i] * p_Vx[i] + p_Vy[i] * p_Vy[i] + p_Vz[i] * p_Vz[i]);
+            for (std::size_t j = i + 1; j < size(); j++) {
+                double dx = p_X[i] - p_X[j], dy = p_Y[i] - p_Y[j], dz = p_Z[i] - p_Z[j];
+                potential -= p_GM[i] * p_GM[j] / std::sqrt(dx * dx + dy * dy + dz * dz + p_Softening2);
+            }
+        }
+        return kinetic + potential;
+    }
+
+    std::size_t size() const { return p_X.size(); }
+    double getTime() const { return p_Time; }
+    void setTime(double time) { p_Time = time; }
+
+    const double* x() const { return p_X.data(); }
+    const double* y() const { return p_Y.data(); }
+    const double* z() const { return p_Z.data(); }
+    const double* vx() const { return p_Vx.data(); }
+    const double* vy() const { return p_Vy.data(); }
+    const double* vz() const { return p_Vz.data(); }
+    const double* gm() const { return p_GM.data(); }
+
+private:
+    ThreadPool& p_Pool;
+    double p_Softening2;
+    double p_Time;          // days
+    bool p_AccelerationsValid;
+
+    // State
+    std::vector<double> p_X, p_Y, p_Z;
+    std::vector<double> p_Vx, p_Vy, p_Vz;
+    std::vector<double> p_Ax, p_Ay, p_Az;
+    std::vector<double> p_GM;
+    std::vector<double> p_StepScale;
+    std::vector<std::uint32_t> p_MergeInto;
+
+    // Compacted massive bodies, rebuilt for every force evaluation
+    std::vector<double> p_SourceX, p_SourceY, p_SourceZ, p_SourceGM;
+
+    // Light sources for the tree
+    bool p_UseTree;
+    double p_TreeMaxGM;
+    BarnesHutGravity p_Tree;
+    std::vector<double> p_TreeX, p_TreeY, p_TreeZ, p_TreeGM;
+
+    // Block timesteps
+    bool p_UseBlocks;
+    double p_Eta;
+    BlockScheduler p_Scheduler;
+    std::vector<std::uint32_t> p_Active;
+    std::vector<double> p_ActiveX, p_ActiveY, p_ActiveZ;
+    std::vector<double> p_ActiveAx, p_ActiveAy, p_ActiveAz;
+    std::uint64_t p_ForceEvaluations;
+
+    std::uint32_t mergeRoot(std::uint32_t i) {
+        while (p_MergeInto[i] != i) {
+            p_MergeInto[i] = p_MergeInto[p_MergeInto[i]];
+            i = p_MergeInto[i];
+        }
+        return i;
+    }
+
+    void kick(double dt) {
+        for (std::size_t i = 0; i < size(); i++) {
+            p_Vx[i] += p_Ax[i] * dt;
+            p_Vy[i] += p_Ay[i] * dt;
+            p_Vz[i] += p_Az[i] * dt;
+        }
+    }
+
+    void kickBody(std::size_t i, double dt) {
+        p_Vx[i] += p_Ax[i] * dt;
+        p_Vy[i] += p_Ay[i] * dt;
+        p_Vz[i] += p_Az[i] * dt;
+    }
+
+    /**
+     * @brief Preferred timestep of body i, eta * |v| / |a| times its step scale
+     */
+    double stepCriterion(std::size_t i) const {
+        double v2 = p_Vx[i] * p_Vx[i] + p_Vy[i] * p_Vy[i] + p_Vz[i] * p_Vz[i];
+        double a2 = p_Ax[i] * p_Ax[i] + p_Ay[i] * p_Ay[i] + p_Az[i] * p_Az[i];
+        if (a2 <= 0.0)
+            return HUGE_VAL;
+        return p_Eta * p_StepScale[i] * std::sqrt(v2 / a2);
+    }
+
+    /**
+     * @brief Splits the massive bodies into direct and tree sources
+     */
+    void gatherSources() {
+        p_SourceX.clear(); p_SourceY.clear(); p_SourceZ.clear(); p_SourceGM.clear();
+        p_TreeX.clear(); p_TreeY.clear(); p_TreeZ.clear(); p_TreeGM.clear();
+        for (std::size_t i = 0; i < size(); i++) {
+            if (p_GM[i] <= 0.0)
+                continue;
+            if (p_UseTree && p_GM[i] <= p_TreeMaxGM) {
+                p_TreeX.push_back(p_X[i]);
+                p_TreeY.push_back(p_Y[i]);
+                p_TreeZ.push_back(p_Z[i]);
+                p_TreeGM.push_back(p_GM[i]);
+                continue;
+            }
+            p_SourceX.push_back(p_X[i]);
+            p_SourceY.push_back(p_Y[i]);
+            p_SourceZ.push_back(p_Z[i]);
+            p_SourceGM.push_back(p_GM[i]);
+        }
+        if (!p_TreeGM.empty())
+            p_Tree.build(p_Pool, p_TreeGM.size(), p_TreeX.data(), p_TreeY.data(), p_TreeZ.data(), p_TreeGM.data());
+    }
+
+    /**
+     * @brief Accelerations of n targets due to the sources of the last gatherSources()
+     */
+    void evaluate(std::size_t n, const double* x, const double* y, const double* z,
+                  double* ax, double* ay, double* az) {
+        DirectGravity::accelerations(p_Pool, p_Softening2, n, x, y, z,
+                                     p_SourceX.size(), p_SourceX.data(), p_SourceY.data(), p_SourceZ.data(),
+                                     p_SourceGM.data(), ax, ay, az);
+        if (!p_TreeGM.empty())
+            p_Tree.accelerations(p_Pool, p_Softening2, n, x, y, z, ax, ay, az, true);
+        p_ForceEvaluations += n;
+    }
+
+    void computeAccelerations() {
+        gatherSources();
+        evaluate(size(), p_X.data(), p_Y.data(), p_Z.data(), p_Ax.data(), p_Ay.data(), p_Az.data());
+        p_AccelerationsValid = true;
+    }
+
+    /**
+     * @brief New accelerations for the listed bodies only
+     */
+    void computeAccelerations(const std::vector<std::uint32_t>& active) {
+        const std::size_t n = active.size();
+        if (n == 0)
+            return;
+        if (n == size()) {
+            computeAccelerations();
+            return;
+        }
+
+        p_ActiveX.resize(n); p_ActiveY.resize(n); p_ActiveZ.resize(n);
+        p_ActiveAx.resize(n); p_ActiveAy.resize(n); p_ActiveAz.resize(n);
+        for (std::size_t k = 0; k < n; k++) {
+            p_ActiveX[k] = p_X[active[k]];
+            p_ActiveY[k] = p_Y[active[k]];
+            p_ActiveZ[k] = p_Z[active[k]];
+        }
+        gatherSources();
+        evaluate(n, p_ActiveX.data(), p_ActiveY.data(), p_ActiveZ.data(),
+                 p_ActiveAx.data(), p_ActiveAy.data(), p_ActiveAz.data());
+        for (std::size_t k = 0; k < n; k++) {
+            p_Ax[active[k]] = p_ActiveAx[k];
+            p_Ay[active[k]] = p_ActiveAy[k];
+            p_Az[active[k]] = p_ActiveAz[k];
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_NBODY_HPP_
@@ -0,0 +1,193 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_ORBITRENDERER_HPP_
+#define INCLUDE_SOLAR_SYSTEM_ORBITRENDERER_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Ephemeris.hpp"
+#include "Kepler.hpp"
+#include "Shader.hpp"
+
+/**
+ * @brief Draws orbit ellipses for any number of bodies in one instanced draw call.
+ *
+ * Each orbit is one instance holding its two axis vectors, eccentricity and the body it
+ * goes around; the vertex shader (shaders/orbit.vs) turns the vertex index into an
+ * eccentric anomaly and places the point itself. The instance buffer is only uploaded
+ * when orbits are added, so a frame costs the CPU a handful of uniforms. The shader
+ * collapses vertices of orbits that are small on screen, so far orbits draw few segments.
+ *
+ * Orbits are centred on a body's current position, the sun for planets and asteroids and
+ * the planet for moons. Up to MAX_CENTERS different bodies can be centres.
+ */
+class OrbitRenderer {
+public:
+    static const std::size_t MAX_CENTERS = 32;     // must match orbit.vs
+
+    /**
+     * @param[in] segments most chords per orbit, rounded up to a power of two
+     */
+    explicit OrbitRenderer(int segments = 256)
+        : p_Segments(4), p_Dirty(false), p_Capacity(0) {
+        while (p_Segments < segments)
+            p_Segments *= 2;
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        const GLsizei stride = sizeof(Instance);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, major));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, minor));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, eccentricity));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, center));
+        for (GLuint attribute = 0; attribute < 4; attribute++)
+            glVertexAttribDivisor(attribute, 1);
+        glBindVertexArray(0);
+    }
+
+    ~OrbitRenderer() {
+        glDeleteBuffers(1, &VBO);
+        glDeleteVertexArrays(1, &VAO);
+    }
+
+    /**
+     * @brief Adds the orbit of an ephemeris body around its parent, or around root 0 (the sun)
+     *
+     * @return false for bodies without an orbit, or when there are too many centres
+     */
+    bool add(const Ephemeris& ephemeris, std::size_t index) {
+        glm::vec3 major, minor;
+        float eccentricity;
+        ephemeris.getOrbitAxes(index, major, minor, eccentricity);
+        std::size_t parent = ephemeris.getParent(index);
+        if (parent == Ephemeris::NO_PARENT)
+            parent = ephemeris.root(0);
+        return parent != index && addAxes(major, minor, eccentricity, parent);
+    }
+
+    /**
+     * @brief Adds a heliocentric orbit, e.g. of an asteroid, centred on ephemeris body center
+     *
+     * @param[in] orbit ecliptic elements in AU
+     * @param[in] sceneScale scene units per AU
+     * @param[in] center ephemeris index of the body the orbit goes around
+     */
+    bool add(const KeplerElements& orbit, float sceneScale, std::size_t center) {
+        double P[3], Q[3];
+        orbitBasis(orbit, P, Q);
+        const double e = orbit.eccentricity;
+        const double a = orbit.semiMajorAxis * sceneScale;
+        const double b = a * std::sqrt(1.0 - e * e);
+
+        // ecliptic (x, y, z) -> scene (x, z, -y)
+        glm::vec3 major(static_cast<float>(a * P[0]), static_cast<float>(a * P[2]), static_cast<float>(-a * P[1]));
+        glm::vec3 minor(static_cast<float>(b * Q[0]), static_cast<float>(b * Q[2]), static_cast<float>(-b * Q[1]));
+        return addAxes(major, minor, static_cast<float>(e), center);
+    }
+
+    /**
+     * @brief Removes all orbits
+     */
+    void clear() {
+        p_Instances.clear();
+        p_Centers.clear();
+        p_Dirty = true;
+    }
+
+    std::size_t size() const {
+        return p_Instances.size();
+    }
+
+    /**
+     * @brief Draws every orbit with one instanced call
+     *
+     * @param[in] shader orbit.vs with a fragment shader taking a "color" uniform
+     * @param[in] ephemeris source of the centre positions
+     * @param[in] viewportHeight height of the viewport in pixels
+     * @param[in] tolerance largest distance between an orbit and its chords, in pixels
+     */
+    void Draw(Shader& shader, const Ephemeris& ephemeris, float viewportHeight, float tolerance = 0.5f) {
+        if (p_Instances.empty())
+            return;
+        if (p_Dirty)
+            upload();
+
+        p_CenterPositions.resize(p_Centers.size());
+        for (std::size_t k = 0; k < p_Centers.size(); k++)
+            p_CenterPositions[k] = ephemeris.getPosition(p_Centers[k]);
+        glUniform3fv(glGetUniformLocation(shader.ID, "centers"), static_cast<GLsizei>(p_CenterPositions.size()),
+                     &p_CenterPositions[0][0]);
+        shader.setInt("segments", p_Segments);
+        shader.setFloat("viewportHeight", viewportHeight);
+        shader.setFloat("tolerance", tolerance);
+
+        glBindVertexArray(VAO);
+        glDrawArraysInstanced(GL_LINE_STRIP, 0, p_Segments + 1, static_cast<GLsizei>(p_Instances.size()));
+        glBindVertexArray(0);
+    }
+
+private:
+    struct Instance {
+        glm::vec3 major;
+        glm::vec3 minor;
+        float eccentricity;
+        float center;
+    };
+
+    unsigned int VAO, VBO;
+    int p_Segments;
+    std::vector<Instance> p_Instances;
+    std::vector<std::size_t> p_Centers;         // ephemeris indices
+    std::vector<glm::vec3> p_CenterPositions;
+    bool p_Dirty;                               // instances changed since the last upload
+    std::size_t p_Capacity;
+
+    bool addAxes(const glm::vec3& major, const glm::vec3& minor, float eccentricity, std::size_t center) {
+        if (glm::dot(major, major) == 0.0f)
+            return false;
+
+        std::size_t slot = 0;
+        while (slot < p_Centers.size() && p_Centers[slot] != center)
+            slot++;
+        if (slot == p_Centers.size()) {
+            if (slot == MAX_CENTERS) {
+                std::cerr << "Too many orbit centres, at most " << MAX_CENTERS << std::endl;
+                return false;
+            }
+            p_Centers.push_back(center);
+        }
+
+        Instance instance;
+        instance.major = major;
+        instance.minor = minor;
+        instance.eccentricity = eccentricity;
+        instance.center = static_cast<float>(slot);
+        p_Instances.push_back(instance);
+        p_Dirty = true;
+        return true;
+    }
+
+    void upload() {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (p_Instances.size() > p_Capacity) {
+            glBufferData(GL_ARRAY_BUFFER, p_Instances.size() * sizeof(Instance), p_Instances.data(), GL_STATIC_DRAW);
+            p_Capacity = p_Instances.size();
+        } else {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, p_Instances.size() * sizeof(Instance), p_Instances.data());
+        }
+        p_Dirty = false;
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_ORBITRENDERER_HPP_
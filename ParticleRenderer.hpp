@@ -0,0 +1,82 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_PARTICLERENDERER_HPP_
+#define INCLUDE_SOLAR_SYSTEM_PARTICLERENDERER_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+/**
+ * @brief Draws a large set of simulated points (test particles, debris) as GL_POINTS.
+ *
+ * Positions are streamed into a single vertex buffer every frame, so the whole set is one draw call.
+ */
+class ParticleRenderer {
+public:
+    ParticleRenderer() : p_Count(0), p_Capacity(0) {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glBindVertexArray(0);
+    }
+
+    ~ParticleRenderer() {
+        glDeleteBuffers(1, &VBO);
+        glDeleteVertexArrays(1, &VAO);
+    }
+
+    /**
+     * @brief Uploads ecliptic positions in AU, converted to the scene frame like Ephemeris does
+     */
+    void update(const double* x, const double* y, const double* z, std::size_t count, float sceneScale) {
+        p_Vertices.resize(3 * count);
+        for (std::size_t i = 0; i < count; i++) {
+            p_Vertices[3 * i + 0] = static_cast<float>(x[i]) * sceneScale;
+            p_Vertices[3 * i + 1] = static_cast<float>(z[i]) * sceneScale;
+            p_Vertices[3 * i + 2] = static_cast<float>(-y[i]) * sceneScale;
+        }
+        upload(count);
+    }
+
+    /**
+     * @brief Uploads positions that are already in scene units, packed as x, y, z
+     */
+    void update(const float* xyz, std::size_t count) {
+        p_Vertices.assign(xyz, xyz + 3 * count);
+        upload(count);
+    }
+
+    void Draw() {
+        if (p_Count == 0)
+            return;
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(p_Count));
+        glBindVertexArray(0);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+private:
+    unsigned int VAO, VBO;
+    std::size_t p_Count;
+    std::size_t p_Capacity;
+    std::vector<float> p_Vertices;
+
+    void upload(std::size_t count) {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // Only reallocate when the set grows, otherwise overwrite in place
+        if (count > p_Capacity) {
+            glBufferData(GL_ARRAY_BUFFER, p_Vertices.size() * sizeof(float), NULL, GL_STREAM_DRAW);
+            p_Capacity = count;
+        }
+        if (count > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, 3 * count * sizeof(float), p_Vertices.data());
+        p_Count = count;
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_PARTICLERENDERER_HPP_
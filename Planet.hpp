@@ -7,60 +7,49 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Ephemeris.hpp"
+#include "Kepler.hpp"
 #include "Model.hpp"
 #include "Shader.hpp"
 
-#include <GLFW/glfw3.h>
-
 class Planet {
 public:
-    Planet(const std::string& modelPath,
+    Planet(Ephemeris& ephemeris,
+           const std::string& modelPath,
            float scale,
-           float orbitalRadius,
-           float orbitalSpeed,
+           const KeplerElements& orbit,
            float axialSpeed,
            float axialTiltAngle,
            bool hasGlow = false,
            float glowScale = 0.0f,
-           glm::vec4 glowTint = glm::vec4(0.0f),
-           float ellipticity = 1.0f)
+           glm::vec4 glowTint = glm::vec4(0.0f))
         : model(modelPath),
-          p_Scale(scale),
-          p_OrbitalRadius(orbitalRadius),
-          p_OrbitalSpeed(orbitalSpeed * 0.025), // Changed rate here
-          p_AxialSpeed(axialSpeed),
-          p_AxialTiltAngle(axialTiltAngle),
+          p_Ephemeris(ephemeris),
           p_hasGlow(hasGlow),
           p_glowScale(glowScale),
-          p_glowTint(glowTint),
-          p_Ellipticity(ellipticity) {}
+          p_glowTint(glowTint) {
+        p_Index = ephemeris.addBody(orbit, scale, axialSpeed, axialTiltAngle);
+    }
 
     /**
-     * @brief Calculates and returns the model matrix
+     * @brief Returns the model matrix computed by the last Ephemeris::update()
      */
-    glm::mat4 getModelMatrix() {
-        glm::mat4 modelMatrix = glm::mat4(1.0f);
-
-        // Zeitabhängiger Winkel (Bogenmaß)
-        float angle = static_cast<float>(glfwGetTime()) * p_OrbitalSpeed;
-
-        // Elliptische Umlaufbahn
-        float x = p_OrbitalRadius * glm::cos(angle);
-        float z = p_OrbitalRadius * p_Ellipticity * glm::sin(angle);
-        modelMatrix = glm::translate(modelMatrix, glm::vec3(x, 0.0f, z));
-
-        // Axial Tilt (z.B. Erdneigung 23.5°)
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(p_AxialTiltAngle), glm::vec3(0.0f, 0.0f, 1.0f));
-
-        // Rotation um eigene Achse (Tagesrotation)
-        modelMatrix = glm::rotate(modelMatrix,
-                                  glm::radians(static_cast<float>(glfwGetTime()) * p_AxialSpeed),
-                                  glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 getModelMatrix() const {
+        return p_Ephemeris.getModelMatrix(p_Index);
+    }
 
-        // Skalierung des Planeten
-        modelMatrix = glm::scale(modelMatrix, glm::vec3(p_Scale));
+    /**
+     * @brief Returns the world position computed by the last Ephemeris::update()
+     */
+    glm::vec3 getPosition() const {
+        return p_Ephemeris.getPosition(p_Index);
+    }
 
-        return modelMatrix;
+    /**
+     * @brief Sets the mass in solar masses, only used by the N-body mode
+     */
+    void setMass(double solarMasses) {
+        p_Ephemeris.setGM(p_Index, solarMasses * GM_SUN);
     }
 
     /**
@@ -110,7 +99,7 @@ public:
         if (!p_hasGlow) return;
 
         // Weltposition des Planeten bestimmen
-        glm::vec3 planetPos = glm::vec3(getModelMatrix() * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        glm::vec3 planetPos = getPosition();
 
         // Billboard-Matrix: Position + Ansicht aus View-Matrix extrahiert
         glm::mat4 glowModelMatrix = glm::translate(glm::mat4(1.0f), planetPos);
@@ -127,18 +116,14 @@ public:
 protected:
     Model model;
 
-    float p_Scale;
-    float p_OrbitalRadius;
-    float p_OrbitalSpeed;
-    float p_AxialSpeed;
-    float p_AxialTiltAngle;
+    // Orbit and spin live in the shared ephemeris
+    Ephemeris& p_Ephemeris;
+    std::size_t p_Index;
 
     // Glow properties
     bool p_hasGlow;
     float p_glowScale;
     glm::vec4 p_glowTint;
-
-    float p_Ellipticity; // Verhältnis b/a der Ellipse (z. B. 0.8)
 };
 
 #endif  // INCLUDE_SOLAR_SYSTEM_PLANET_HPP_
@@ -0,0 +1,115 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_PNGWRITER_HPP_
+#define INCLUDE_SOLAR_SYSTEM_PNGWRITER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Writes 8-bit RGB images as PNG files without an image library.
+ *
+ * The zlib stream uses stored (uncompressed) deflate blocks, so files are about as large
+ * as the raw pixels; every PNG reader accepts them, and stb_image.h only reads.
+ */
+class PngWriter {
+public:
+    /**
+     * @brief Writes width x height pixels, rows top to bottom, three bytes per pixel
+     */
+    static bool write(const std::string& path, std::size_t width, std::size_t height, const unsigned char* rgb) {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == NULL)
+            return false;
+
+        static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        bool ok = std::fwrite(signature, 1, sizeof(signature), file) == sizeof(signature);
+
+        std::vector<unsigned char> header;
+        putBigEndian(header, static_cast<std::uint32_t>(width));
+        putBigEndian(header, static_cast<std::uint32_t>(height));
+        header.push_back(8);    // bits per channel
+        header.push_back(2);    // RGB
+        header.push_back(0);    // deflate
+        header.push_back(0);    // adaptive filtering, every row uses filter 0
+        header.push_back(0);    // not interlaced
+        ok = ok && writeChunk(file, "IHDR", header);
+
+        // Each row is a filter byte and the pixels; stored blocks hold at most 65535 bytes
+        const std::size_t rowBytes = 1 + 3 * width;
+        const std::size_t total = rowBytes * height;
+        std::vector<unsigned char> data;
+        data.reserve(total + total / 65535 * 5 + 16);
+        data.push_back(0x78);
+        data.push_back(0x01);
+        std::uint32_t a = 1, b = 0;
+        std::size_t written = 0;
+        std::vector<unsigned char> row(rowBytes, 0);
+        std::size_t rowOffset = rowBytes;
+        std::size_t y = 0;
+        while (written < total) {
+            const std::size_t block = total - written < 65535 ? total - written : 65535;
+            data.push_back(written + block == total ? 1 : 0);
+            data.push_back(static_cast<unsigned char>(block & 0xff));
+            data.push_back(static_cast<unsigned char>(block >> 8));
+            data.push_back(static_cast<unsigned char>(~block & 0xff));
+            data.push_back(static_cast<unsigned char>((~block >> 8) & 0xff));
+            for (std::size_t k = 0; k < block; k++) {
+                if (rowOffset == rowBytes) {
+                    row[0] = 0;
+                    for (std::size_t i = 0; i < 3 * width; i++)
+                        row[1 + i] = rgb[y * 3 * width + i];
+                    rowOffset = 0;
+                    y++;
+                }
+                const unsigned char byte = row[rowOffset++];
+                data.push_back(byte);
+                a = (a + byte) % 65521;
+                b = (b + a) % 65521;
+            }
+            written += block;
+        }
+        putBigEndian(data, (b << 16) | a);
+        ok = ok && writeChunk(file, "IDAT", data);
+        ok = ok && writeChunk(file, "IEND", std::vector<unsigned char>());
+        return std::fclose(file) == 0 && ok;
+    }
+
+private:
+    static void putBigEndian(std::vector<unsigned char>& out, std::uint32_t value) {
+        out.push_back(static_cast<unsigned char>(value >> 24));
+        out.push_back(static_cast<unsigned char>(value >> 16));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    static std::uint32_t crc(std::uint32_t crc, const unsigned char* data, std::size_t size) {
+        static std::uint32_t table[256];
+        static bool ready = false;
+        if (!ready) {
+            for (std::uint32_t n = 0; n < 256; n++) {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+            ready = true;
+        }
+        for (std::size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return crc;
+    }
+
+    static bool writeChunk(std::FILE* file, const char type[4], const std::vector<unsigned char>& data) {
+        std::vector<unsigned char> chunk;
+        putBigEndian(chunk, static_cast<std::uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        std::uint32_t checksum = crc(0xffffffffu, &chunk[4], chunk.size() - 4) ^ 0xffffffffu;
+        putBigEndian(chunk, checksum);
+        return std::fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_PNGWRITER_HPP_
@@ -0,0 +1,179 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_PORKCHOP_HPP_
+#define INCLUDE_SOLAR_SYSTEM_PORKCHOP_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Kepler.hpp"
+#include "Lambert.hpp"
+#include "SpkKernel.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Transfer costs over a grid of departure and arrival dates (a porkchop plot).
+ *
+ * The departure and arrival bodies' states are sampled once per date on each axis, then
+ * every (departure, arrival) cell solves Lambert's problem for the prograde arc between
+ * them. Cells are processed in TILE x TILE tiles spread over the thread pool, so the
+ * states a tile reads and the results it writes stay in cache.
+ *
+ * Each cell stores the launch energy C3 (km^2 / s^2), the hyperbolic excess speed at
+ * arrival (km / s) and the sum of both excess speeds (km / s); cells with no transfer,
+ * arrival before departure, hold NaN.
+ */
+class PorkchopGrid {
+public:
+    static const std::size_t TILE = 32;
+    static const std::uint32_t VERSION = 1;
+
+    enum Field { C3 = 0, ARRIVAL_VINF = 1, TOTAL_VINF = 2, FIELDS = 3 };
+
+    /**
+     * @brief One date axis: the first date, the spacing and the body's state at every date
+     */
+    struct Axis {
+        double firstDays;
+        double stepDays;
+        std::vector<double> x, y, z, vx, vy, vz;
+
+        Axis() : firstDays(0.0), stepDays(0.0) {}
+
+        std::size_t size() const { return x.size(); }
+        double days(std::size_t i) const { return firstDays + stepDays * i; }
+
+        void resize(std::size_t count) {
+            x.resize(count); y.resize(count); z.resize(count);
+            vx.resize(count); vy.resize(count); vz.resize(count);
+        }
+    };
+
+    PorkchopGrid() : p_DepartureBody(0), p_ArrivalBody(0) {}
+
+    /**
+     * @brief Sets both axes, states in AU and AU / day from the ephemeris of the caller's choice
+     *
+     * @param[in] departureBody, arrivalBody identifiers stored in the file, NAIF ids by convention
+     */
+    void setAxes(const Axis& departures, const Axis& arrivals, int departureBody, int arrivalBody) {
+        p_Departures = departures;
+        p_Arrivals = arrivals;
+        p_DepartureBody = departureBody;
+        p_ArrivalBody = arrivalBody;
+        for (int f = 0; f < FIELDS; f++)
+            p_Fields[f].assign(departures.size() * arrivals.size(), 0.0f);
+    }
+
+    /**
+     * @brief Solves every cell, mu is the central body's GM in AU^3 / day^2
+     */
+    void compute(ThreadPool& pool, double mu = GM_SUN) {
+        const std::size_t rows = (p_Departures.size() + TILE - 1) / TILE;
+        const std::size_t columns = (p_Arrivals.size() + TILE - 1) / TILE;
+        pool.parallelFor(0, rows * columns, 1, [this, columns, mu](std::size_t begin, std::size_t end) {
+            for (std::size_t tile = begin; tile < end; tile++)
+                computeTile((tile / columns) * TILE, (tile % columns) * TILE, mu);
+        });
+    }
+
+    std::size_t departures() const { return p_Departures.size(); }
+    std::size_t arrivals() const { return p_Arrivals.size(); }
+    const Axis& departureAxis() const { return p_Departures; }
+    const Axis& arrivalAxis() const { return p_Arrivals; }
+
+    /**
+     * @brief Value of a field at departure i and arrival j, NaN where there is no transfer
+     */
+    float at(Field field, std::size_t i, std::size_t j) const {
+        return p_Fields[field][i * p_Arrivals.size() + j];
+    }
+
+    const float* field(Field field) const { return p_Fields[field].data(); }
+
+    /**
+     * @brief Writes the grid: a fixed header followed by the fields, each departures x arrivals
+     * floats with the arrival index running fastest, little-endian as the host lays them out
+     */
+    bool write(const std::string& path) const {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "PORKCHOP", sizeof(header.magic));
+        header.version = VERSION;
+        header.headerSize = sizeof(Header);
+        header.departures = static_cast<std::uint32_t>(p_Departures.size());
+        header.arrivals = static_cast<std::uint32_t>(p_Arrivals.size());
+        header.fields = FIELDS;
+        header.departureBody = p_DepartureBody;
+        header.arrivalBody = p_ArrivalBody;
+        header.firstDeparture = p_Departures.firstDays;
+        header.departureStep = p_Departures.stepDays;
+        header.firstArrival = p_Arrivals.firstDays;
+        header.arrivalStep = p_Arrivals.stepDays;
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == NULL)
+            return false;
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        for (int f = 0; f < FIELDS && ok; f++)
+            ok = std::fwrite(p_Fields[f].data(), sizeof(float), p_Fields[f].size(), file) == p_Fields[f].size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::uint32_t departures;
+        std::uint32_t arrivals;
+        std::uint32_t fields;
+        std::int32_t departureBody;
+        std::int32_t arrivalBody;
+        std::uint32_t reserved;
+        double firstDeparture;      // days since J2000 (TDB)
+        double departureStep;
+        double firstArrival;
+        double arrivalStep;
+    };
+
+    Axis p_Departures;
+    Axis p_Arrivals;
+    int p_DepartureBody;
+    int p_ArrivalBody;
+    std::vector<float> p_Fields[FIELDS];
+
+    void computeTile(std::size_t i0, std::size_t j0, double mu) {
+        const double kmPerSecond = KM_PER_AU / SECONDS_PER_DAY;
+        const float none = std::numeric_limits<float>::quiet_NaN();
+        const std::size_t i1 = i0 + TILE < p_Departures.size() ? i0 + TILE : p_Departures.size();
+        const std::size_t j1 = j0 + TILE < p_Arrivals.size() ? j0 + TILE : p_Arrivals.size();
+        const Axis& d = p_Departures;
+        const Axis& a = p_Arrivals;
+        for (std::size_t i = i0; i < i1; i++) {
+            const double r1[3] = { d.x[i], d.y[i], d.z[i] };
+            const std::size_t row = i * a.size();
+            for (std::size_t j = j0; j < j1; j++) {
+                const double r2[3] = { a.x[j], a.y[j], a.z[j] };
+                double v1[3], v2[3];
+                if (!LambertSolver::solve(r1, r2, a.days(j) - d.days(i), mu, v1, v2)) {
+                    p_Fields[C3][row + j] = p_Fields[ARRIVAL_VINF][row + j] = p_Fields[TOTAL_VINF][row + j] = none;
+                    continue;
+                }
+                const double dx = v1[0] - d.vx[i], dy = v1[1] - d.vy[i], dz = v1[2] - d.vz[i];
+                const double ax = v2[0] - a.vx[j], ay = v2[1] - a.vy[j], az = v2[2] - a.vz[j];
+                const double departure = std::sqrt(dx * dx + dy * dy + dz * dz) * kmPerSecond;
+                const double arrival = std::sqrt(ax * ax + ay * ay + az * az) * kmPerSecond;
+                p_Fields[C3][row + j] = static_cast<float>(departure * departure);
+                p_Fields[ARRIVAL_VINF][row + j] = static_cast<float>(arrival);
+                p_Fields[TOTAL_VINF][row + j] = static_cast<float>(departure + arrival);
+            }
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_PORKCHOP_HPP_
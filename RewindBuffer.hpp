@@ -0,0 +1,387 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_REWINDBUFFER_HPP_
+#define INCLUDE_SOLAR_SYSTEM_REWINDBUFFER_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "NBody.hpp"
+
+/**
+ * @brief Recent N-body states in a fixed memory budget, for scrubbing back in time.
+ *
+ * Every few records a keyframe stores the positions and velocities as they are. The
+ * records in between store each value as a delta on its bit pattern: the bits are
+ * extrapolated from up to three earlier records as 64-bit integers (exact, so encoder and
+ * decoder always agree), and the zigzagged difference keeps only its non-zero low bytes,
+ * with the byte count in a nibble. Orbits are smooth, so the prediction usually gets the
+ * sign, exponent and top of the mantissa right. The encoding is lossless, so a decoded
+ * state continues exactly like the original.
+ *
+ * Keyframes also hold the masses, and every record its body count. When collisions merge
+ * bodies the next record is a keyframe of the smaller system, so the history from before
+ * the merge stays and seeking into it restores the bodies as they were.
+ *
+ * Records live in a ring of bytes; when it is full the oldest keyframe and the deltas that
+ * depend on it are dropped. seek() finds the last record before the wanted time by binary
+ * search, decodes forward from its keyframe and integrates the rest of the way.
+ */
+class RewindBuffer {
+public:
+    /**
+     * @param[in] budgetBytes size of the ring holding the encoded states
+     * @param[in] keyframeInterval records from one keyframe to the next, bounds the decoding work of a seek
+     */
+    explicit RewindBuffer(std::size_t budgetBytes = 256u << 20, int keyframeInterval = 16)
+        : p_Capacity(budgetBytes), p_KeyframeInterval(keyframeInterval), p_Head(0), p_SinceKeyframe(0),
+          p_Bodies(0), p_UsedBytes(0), p_RawBytes(0), p_SeekMilliseconds(0.0), p_SeekDecoded(0) {}
+
+    /**
+     * @brief Forgets all records, e.g. when the simulation restarts
+     */
+    void clear() {
+        p_Records.clear();
+        p_Head = 0;
+        p_SinceKeyframe = 0;
+        p_Bodies = 0;
+        p_UsedBytes = p_RawBytes = 0;
+    }
+
+    /**
+     * @brief Appends the current state; records at or after its time are dropped first
+     *
+     * @return false if a single state does not fit into the budget
+     */
+    bool record(const NBodySystem& nbody) {
+        const std::size_t n = nbody.size();
+        const double days = nbody.getTime();
+        if (n == 0)
+            return false;
+        if (!p_Storage)
+            p_Storage.reset(new unsigned char[p_Capacity]);
+
+        // Continuing from an earlier time replaces the old future
+        if (!p_Records.empty() && p_Records.back().days >= days)
+            truncate(days);
+
+        // Deltas need the same bodies as the record before, merged bodies start a new keyframe
+        bool keyframe = p_Records.empty() || p_SinceKeyframe >= p_KeyframeInterval || n != p_Bodies;
+        if (n != p_Bodies) {
+            p_Bodies = n;
+            p_Encoder.resize(n);
+        }
+
+        const double* arrays[ARRAYS] = { nbody.x(), nbody.y(), nbody.z(), nbody.vx(), nbody.vy(), nbody.vz() };
+        std::size_t bytes = encodeRecord(arrays, nbody.gm(), keyframe);
+        if (!keyframe && bytes > p_Capacity)
+            bytes = encodeRecord(arrays, nbody.gm(), keyframe = true);
+        if (bytes > p_Capacity) {
+            std::cerr << "Rewind budget of " << p_Capacity << " bytes is too small for one state" << std::endl;
+            clear();
+            return false;
+        }
+
+        // Make room: wrap when the end of the ring is reached, then drop whatever is in the way
+        if (p_Head + bytes > p_Capacity) {
+            while (!p_Records.empty() && p_Records.front().offset >= p_Head)
+                dropOldest();
+            p_Head = 0;
+        }
+        while (!p_Records.empty() && p_Records.front().offset >= p_Head && p_Records.front().offset < p_Head + bytes)
+            dropOldest();
+        // Deltas are useless without their keyframe
+        while (!p_Records.empty() && !p_Records.front().keyframe)
+            dropOldest();
+        if (p_Records.empty() && !keyframe) {
+            bytes = encodeRecord(arrays, nbody.gm(), keyframe = true);
+            p_Head = 0;
+        }
+
+        std::memcpy(p_Storage.get() + p_Head, p_Scratch.data(), bytes);
+        Record entry = { days, p_Head, bytes, n, keyframe };
+        p_Records.push_back(entry);
+        p_Head += bytes;
+        p_UsedBytes += bytes;
+        p_RawBytes += ARRAYS * n * sizeof(double);
+        p_SinceKeyframe = keyframe ? 1 : p_SinceKeyframe + 1;
+        p_Encoder.push(arrays, keyframe);
+        return true;
+    }
+
+    /**
+     * @brief Puts the simulation at the given time from the records
+     *
+     * @param[in] days time to go to, must lie between oldest() and newest()
+     * @param[in,out] nbody simulation to set, it keeps its force and integrator settings
+     * @param[in] maxStep longest step of the re-simulation from the record to days
+     * @return false if no record covers the time
+     */
+    bool seek(double days, NBodySystem& nbody, double maxStep) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (p_Records.empty() || days < oldest() || days > newest())
+            return false;
+
+        // Last record at or before days, then the keyframe it depends on
+        std::size_t index = static_cast<std::size_t>(
+            std::upper_bound(p_Records.begin(), p_Records.end(), days, Record::before) - p_Records.begin()) - 1;
+        std::size_t first = index;
+        while (!p_Records[first].keyframe)
+            first--;
+
+        decodeRecords(first, index, p_Decoder);
+
+        // The masses follow the positions and velocities of the keyframe
+        const std::size_t n = p_Records[first].bodies;
+        for (int a = 0; a < ARRAYS; a++) {
+            p_Decoded[a].resize(n);
+            std::memcpy(p_Decoded[a].data(), p_Decoder.newest(a), n * sizeof(double));
+        }
+        p_DecodedGM.resize(n);
+        std::memcpy(p_DecodedGM.data(), p_Storage.get() + p_Records[first].offset + ARRAYS * n * sizeof(double),
+                    n * sizeof(double));
+        nbody.setState(p_Records[index].days, n, p_Decoded[0].data(), p_Decoded[1].data(), p_Decoded[2].data(),
+                       p_Decoded[3].data(), p_Decoded[4].data(), p_Decoded[5].data(), p_DecodedGM.data());
+        if (days > p_Records[index].days)
+            nbody.advanceTo(days, maxStep);
+
+        p_SeekDecoded = index - first + 1;
+        p_SeekMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    bool empty() const { return p_Records.empty(); }
+    std::size_t size() const { return p_Records.size(); }
+
+    /**
+     * @brief Time span covered by the records in days since J2000
+     */
+    double oldest() const { return p_Records.front().days; }
+    double newest() const { return p_Records.back().days; }
+
+    /**
+     * @brief Bytes of encoded states held, never more than capacity()
+     */
+    std::size_t memoryUsed() const { return p_UsedBytes; }
+    std::size_t capacity() const { return p_Capacity; }
+
+    /**
+     * @brief Raw state size over encoded size of the records held
+     */
+    double compressionRatio() const {
+        return p_UsedBytes > 0 ? static_cast<double>(p_RawBytes) / p_UsedBytes : 1.0;
+    }
+
+    /**
+     * @brief Wall time of the last seek() including the re-simulation, and the records it decoded
+     */
+    double lastSeekMilliseconds() const { return p_SeekMilliseconds; }
+    std::size_t lastSeekDecoded() const { return p_SeekDecoded; }
+
+private:
+    static const int ARRAYS = 6;
+
+    struct Record {
+        double days;
+        std::size_t offset;
+        std::size_t bytes;
+        std::size_t bodies;
+        bool keyframe;
+
+        static bool before(double days, const Record& record) { return days < record.days; }
+    };
+
+    /**
+     * @brief Bit patterns of the last three states since a keyframe, newest first
+     */
+    struct Trail {
+        std::vector<std::uint64_t> bits[3][ARRAYS];
+        int known;
+
+        Trail() : known(0) {}
+
+        void resize(std::size_t n) {
+            for (int h = 0; h < 3; h++)
+                for (int a = 0; a < ARRAYS; a++)
+                    bits[h][a].assign(n, 0);
+            known = 0;
+        }
+
+        const std::uint64_t* newest(int a) const { return bits[0][a].data(); }
+
+        void push(const double* const* arrays, bool keyframe) {
+            shift(keyframe);
+            for (int a = 0; a < ARRAYS; a++)
+                std::memcpy(bits[0][a].data(), arrays[a], bits[0][a].size() * sizeof(std::uint64_t));
+        }
+
+        /**
+         * @brief Makes room for a new newest state, forgetting the history at a keyframe
+         */
+        void shift(bool keyframe) {
+            for (int a = 0; a < ARRAYS; a++) {
+                bits[2][a].swap(bits[1][a]);
+                bits[1][a].swap(bits[0][a]);
+            }
+            known = keyframe ? 1 : std::min(known + 1, 3);
+        }
+
+        /**
+         * @brief Constant, linear or quadratic extrapolation of value i of array a
+         */
+        std::uint64_t predict(int a, std::size_t i) const {
+            const std::uint64_t b0 = bits[0][a][i];
+            if (known == 1)
+                return b0;
+            const std::uint64_t b1 = bits[1][a][i];
+            if (known == 2)
+                return 2 * b0 - b1;
+            return 3 * b0 - 3 * b1 + bits[2][a][i];
+        }
+    };
+
+    std::unique_ptr<unsigned char[]> p_Storage;
+    std::size_t p_Capacity;
+    int p_KeyframeInterval;
+    std::deque<Record> p_Records;
+    std::size_t p_Head;             // where the next record goes
+    int p_SinceKeyframe;            // records since the last keyframe, including it
+
+    std::size_t p_Bodies;           // in the newest record
+    Trail p_Encoder;                // states up to the newest record, the base of the next delta
+    Trail p_Decoder;
+    std::vector<double> p_Decoded[ARRAYS];
+    std::vector<double> p_DecodedGM;
+    std::vector<unsigned char> p_Scratch;
+
+    std::size_t p_UsedBytes;
+    std::size_t p_RawBytes;
+    double p_SeekMilliseconds;
+    std::size_t p_SeekDecoded;
+
+    void dropOldest() {
+        p_UsedBytes -= p_Records.front().bytes;
+        p_RawBytes -= ARRAYS * p_Records.front().bodies * sizeof(double);
+        p_Records.pop_front();
+    }
+
+    /**
+     * @brief Drops the records at or after days and makes the new newest record the delta base
+     */
+    void truncate(double days) {
+        while (!p_Records.empty() && p_Records.back().days >= days) {
+            p_UsedBytes -= p_Records.back().bytes;
+            p_RawBytes -= ARRAYS * p_Records.back().bodies * sizeof(double);
+            p_Records.pop_back();
+        }
+        if (p_Records.empty()) {
+            p_Head = 0;
+            p_SinceKeyframe = 0;
+            return;
+        }
+        p_Head = p_Records.back().offset + p_Records.back().bytes;
+
+        std::size_t first = p_Records.size() - 1;
+        while (!p_Records[first].keyframe)
+            first--;
+        p_SinceKeyframe = static_cast<int>(p_Records.size() - first);
+        p_Bodies = p_Records[first].bodies;
+        decodeRecords(first, p_Records.size() - 1, p_Encoder);
+    }
+
+    /**
+     * @brief Replays the records first..last into trail, first must be a keyframe
+     */
+    void decodeRecords(std::size_t first, std::size_t last, Trail& trail) const {
+        const std::size_t n = p_Records[first].bodies;
+        if (trail.bits[0][0].size() != n)
+            trail.resize(n);
+        for (std::size_t r = first; r <= last; r++) {
+            const unsigned char* in = p_Storage.get() + p_Records[r].offset;
+            const bool keyframe = p_Records[r].keyframe;
+            // The prediction reads the old states, so decode into the slot that is shifted out
+            for (int a = 0; a < ARRAYS; a++) {
+                std::uint64_t* out = trail.bits[2][a].data();
+                if (keyframe) {
+                    std::memcpy(out, in, n * sizeof(std::uint64_t));
+                    in += n * sizeof(std::uint64_t);
+                } else {
+                    in = decode(n, in, trail, a, out);
+                }
+            }
+            trail.shift(keyframe);
+        }
+    }
+
+    /**
+     * @brief Encodes a state into p_Scratch as a keyframe with the masses or as deltas to p_Encoder, returns its size
+     */
+    std::size_t encodeRecord(const double* const* arrays, const double* gm, bool keyframe) {
+        const std::size_t n = p_Bodies;
+        p_Scratch.resize((ARRAYS + 1) * n * sizeof(double) + ARRAYS * ((n + 1) / 2));
+        unsigned char* out = p_Scratch.data();
+        for (int a = 0; a < ARRAYS; a++) {
+            if (keyframe) {
+                std::memcpy(out, arrays[a], n * sizeof(double));
+                out += n * sizeof(double);
+            } else {
+                out = encode(n, arrays[a], p_Encoder, a, out);
+            }
+        }
+        if (keyframe) {
+            std::memcpy(out, gm, n * sizeof(double));
+            out += n * sizeof(double);
+        }
+        return static_cast<std::size_t>(out - p_Scratch.data());
+    }
+
+    /**
+     * @brief Writes the byte counts of all residuals as nibbles, then their non-zero low bytes
+     */
+    static unsigned char* encode(std::size_t n, const double* values, const Trail& trail, int a, unsigned char* out) {
+        unsigned char* counts = out;
+        out += (n + 1) / 2;
+        std::memset(counts, 0, (n + 1) / 2);
+        for (std::size_t i = 0; i < n; i++) {
+            std::uint64_t bits;
+            std::memcpy(&bits, values + i, sizeof(bits));
+            std::uint64_t residual = bits - trail.predict(a, i);
+            // Zigzag, so small negative residuals have few bytes too
+            residual = (residual << 1) ^ (0 - (residual >> 63));
+
+            unsigned char bytes = 0;
+            while (residual != 0) {
+                *out++ = static_cast<unsigned char>(residual);
+                residual >>= 8;
+                bytes++;
+            }
+            counts[i / 2] |= static_cast<unsigned char>(bytes << (4 * (i & 1)));
+        }
+        return out;
+    }
+
+    /**
+     * @brief Inverse of encode(), writes the bit patterns to out
+     */
+    static const unsigned char* decode(std::size_t n, const unsigned char* in, const Trail& trail, int a,
+                                       std::uint64_t* out) {
+        const unsigned char* counts = in;
+        in += (n + 1) / 2;
+        for (std::size_t i = 0; i < n; i++) {
+            unsigned bytes = (counts[i / 2] >> (4 * (i & 1))) & 0xF;
+            std::uint64_t residual = 0;
+            for (unsigned b = 0; b < bytes; b++)
+                residual |= static_cast<std::uint64_t>(*in++) << (8 * b);
+            residual = (residual >> 1) ^ (0 - (residual & 1));
+            out[i] = trail.predict(a, i) + residual;
+        }
+        return in;
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_REWINDBUFFER_HPP_
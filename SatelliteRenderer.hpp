@@ -0,0 +1,107 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_SATELLITERENDERER_HPP_
+#define INCLUDE_SOLAR_SYSTEM_SATELLITERENDERER_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+
+/**
+ * @brief Draws a satellite catalog as instanced points around the earth model.
+ *
+ * Each satellite is one instance holding its position relative to the earth in earth
+ * radii; the vertex shader (shaders/satellite.vs) turns it into the scene with the earth's
+ * current position and an orientation that puts the equator on the drawn earth's, so the
+ * satellites keep their true altitudes relative to the model whatever its scale. Positions
+ * are streamed every frame, the whole catalog is one draw call.
+ */
+class SatelliteRenderer {
+public:
+    /**
+     * @param[in] drawnRadius radius of the earth model in scene units
+     * @param[in] axialTiltAngle tilt the earth model is drawn with, in degrees
+     */
+    SatelliteRenderer(float drawnRadius, float axialTiltAngle) : p_Count(0), p_Capacity(0) {
+        // TEME x stays in the tilted equator, y goes to -z as the ecliptic does, z is the model's pole
+        const float ct = std::cos(glm::radians(axialTiltAngle)), st = std::sin(glm::radians(axialTiltAngle));
+        p_Orientation = drawnRadius * glm::mat3(glm::vec3(ct, st, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                                                glm::vec3(-st, ct, 0.0f));
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glVertexAttribDivisor(0, 1);
+        glBindVertexArray(0);
+    }
+
+    ~SatelliteRenderer() {
+        glDeleteBuffers(1, &VBO);
+        glDeleteVertexArrays(1, &VAO);
+    }
+
+    /**
+     * @brief Uploads TEME positions in km, skipping satellites without one (NaN)
+     */
+    void update(const double* x, const double* y, const double* z, std::size_t count, double earthRadiusKm) {
+        const double scale = 1.0 / earthRadiusKm;
+        p_Vertices.resize(3 * count);
+        std::size_t drawn = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            if (x[i] != x[i])
+                continue;
+            p_Vertices[3 * drawn + 0] = static_cast<float>(x[i] * scale);
+            p_Vertices[3 * drawn + 1] = static_cast<float>(y[i] * scale);
+            p_Vertices[3 * drawn + 2] = static_cast<float>(z[i] * scale);
+            drawn++;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // Only reallocate when the set grows, otherwise overwrite in place
+        if (drawn > p_Capacity) {
+            glBufferData(GL_ARRAY_BUFFER, 3 * drawn * sizeof(float), NULL, GL_STREAM_DRAW);
+            p_Capacity = drawn;
+        }
+        if (drawn > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, 3 * drawn * sizeof(float), p_Vertices.data());
+        p_Count = drawn;
+    }
+
+    std::size_t size() const {
+        return p_Count;
+    }
+
+    /**
+     * @brief Draws every satellite with one instanced call
+     *
+     * @param[in] shader satellite.vs with a fragment shader taking a "color" uniform
+     * @param[in] earthPosition scene position of the earth
+     */
+    void Draw(Shader& shader, const glm::vec3& earthPosition) {
+        if (p_Count == 0)
+            return;
+        shader.setVec3("center", earthPosition);
+        shader.setMat3("orientation", p_Orientation);
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glBindVertexArray(VAO);
+        glDrawArraysInstanced(GL_POINTS, 0, 1, static_cast<GLsizei>(p_Count));
+        glBindVertexArray(0);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+private:
+    unsigned int VAO, VBO;
+    glm::mat3 p_Orientation;
+    std::size_t p_Count;
+    std::size_t p_Capacity;
+    std::vector<float> p_Vertices;
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_SATELLITERENDERER_HPP_
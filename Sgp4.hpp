@@ -0,0 +1,617 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_SGP4_HPP_
+#define INCLUDE_SOLAR_SYSTEM_SGP4_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Calendar.hpp"
+#include "Kepler.hpp"
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
+
+// WGS-72 constants, the ones the element sets are fitted with
+const double SGP4_EARTH_RADIUS_KM = 6378.135;
+const double SGP4_MU = 398600.8;                    // km^3 / s^2
+const double SGP4_J2 = 0.001082616;
+const double SGP4_J3 = -0.00000253881;
+const double SGP4_J4 = -0.00000165597;
+// Element set epochs are UTC, the simulation runs on TDB; TT - UTC since 2017
+const double SGP4_TT_MINUS_UTC = 69.184;            // seconds
+
+/**
+ * @brief Mean elements of one satellite, as read from a two-line element set
+ */
+struct TwoLineElements {
+    std::uint32_t number;
+    double epochDays;           // days since J2000 (TDB)
+    double meanMotion;          // revolutions per day
+    double eccentricity;
+    double inclination;         // degrees
+    double node;
+    double argumentOfPerigee;
+    double meanAnomaly;
+    double bstar;               // 1 / earth radii
+
+    /**
+     * @brief Reads lines 1 and 2 of an element set, false if they are not one
+     */
+    static bool parse(const std::string& line1, const std::string& line2, TwoLineElements& elements) {
+        if (line1.size() < 69 || line2.size() < 69 || line1[0] != '1' || line2[0] != '2')
+            return false;
+        // Alpha-5 numbers put a letter in front of four digits for objects past 99999
+        const char first = line1[2];
+        const int leading = first >= 'A' && first <= 'Z' ? 10 + (first - 'A') - (first > 'I') - (first > 'O')
+                                                         : first - '0';
+        elements.number = static_cast<std::uint32_t>(leading * 10000 + std::atoi(line1.substr(3, 4).c_str()));
+
+        const int year = std::atoi(line1.substr(18, 2).c_str());
+        const double dayOfYear = std::atof(line1.substr(20, 12).c_str());
+        elements.epochDays = calendar::daysFromDate(year < 57 ? 2000 + year : 1900 + year, 1, 1) + dayOfYear - 1.0 +
+                             SGP4_TT_MINUS_UTC / SECONDS_PER_DAY;
+        elements.bstar = assumedDecimal(line1.substr(53, 8));
+
+        elements.inclination = std::atof(line2.substr(8, 8).c_str());
+        elements.node = std::atof(line2.substr(17, 8).c_str());
+        elements.eccentricity = std::atof(("0." + line2.substr(26, 7)).c_str());
+        elements.argumentOfPerigee = std::atof(line2.substr(34, 8).c_str());
+        elements.meanAnomaly = std::atof(line2.substr(43, 8).c_str());
+        elements.meanMotion = std::atof(line2.substr(52, 11).c_str());
+        return elements.meanMotion > 0.0;
+    }
+
+    /**
+     * @brief Reads every element set in a file, with or without name lines
+     *
+     * @return false if the file cannot be read
+     */
+    static bool load(const std::string& path, std::vector<TwoLineElements>& catalog) {
+        std::ifstream file(path.c_str());
+        if (!file) {
+            std::cerr << "Could not open element sets " << path << std::endl;
+            return false;
+        }
+        std::string previous, line;
+        TwoLineElements elements;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                line.erase(line.size() - 1);
+            if (line[0] == '2' && parse(previous, line, elements))
+                catalog.push_back(elements);
+            previous = line;
+        }
+        return true;
+    }
+
+private:
+    // "-11606-4" is -0.11606e-4
+    static double assumedDecimal(const std::string& field) {
+        std::size_t k = 0;
+        while (k < field.size() && field[k] == ' ')
+            k++;
+        std::string text;
+        if (k < field.size() && (field[k] == '-' || field[k] == '+'))
+            text += field[k++];
+        text += "0.";
+        while (k < field.size() && field[k] >= '0' && field[k] <= '9')
+            text += field[k++];
+        if (k < field.size())
+            text += "e" + field.substr(k);
+        return std::atof(text.c_str());
+    }
+};
+
+/**
+ * @brief SGP4 for a whole catalog of satellites, propagated in batches every frame.
+ *
+ * Follows Vallado, Crawford, Hujsak and Kelso, "Revisiting Spacetrack Report #3" (2006):
+ * initialisation runs once per satellite and stores its constants in one array each, so
+ * propagation reads them as streams. Satellites are split into chunks over the thread
+ * pool and every chunk evaluates DOUBLE_WIDTH satellites per SIMD lane set, with the
+ * polynomial sincos from Simd.hpp and a Kepler solve that stops when all lanes converged;
+ * the rest go through the scalar reference state(). Positions are in km in the TEME frame
+ * (true equator, mean equinox of the epoch), relative to the earth's centre.
+ *
+ * Only the near-earth part of the model is implemented. Satellites with periods of 225
+ * minutes or more, which SDP4 would give lunar, solar and resonance terms, are propagated
+ * with the same secular and periodic J2 - J4 and drag terms; that is good enough to draw
+ * them for days around their epoch but drifts by degrees over months.
+ *
+ * update() spends a frame budget: when propagating everything would take longer, it
+ * refreshes the satellites in turns, so each one moves less often but the frame keeps its time.
+ */
+class Sgp4Catalog {
+public:
+    static const std::size_t CHUNK = 256;
+    static const int KEPLER_ITERATIONS = 10;
+
+    /**
+     * @brief Status of a satellite after propagation, following Vallado's error codes
+     */
+    enum Status { OK = 0, BAD_ECCENTRICITY = 1, BAD_MEAN_MOTION = 2, BAD_SEMI_LATUS = 4, DECAYED = 6 };
+
+    Sgp4Catalog() : p_Cursor(0), p_CostPerSatellite(0.0), p_LastCount(0) {}
+
+    /**
+     * @brief Initialises a satellite and adds it, false if its elements are unusable
+     */
+    bool add(const TwoLineElements& elements) {
+        const double xke = 60.0 / std::sqrt(SGP4_EARTH_RADIUS_KM * SGP4_EARTH_RADIUS_KM * SGP4_EARTH_RADIUS_KM / SGP4_MU);
+        const double j3oj2 = SGP4_J3 / SGP4_J2;
+        const double x2o3 = 2.0 / 3.0;
+        const double ecco = elements.eccentricity;
+        const double inclo = elements.inclination * DEG_TO_RAD;
+        const double argpo = elements.argumentOfPerigee * DEG_TO_RAD;
+        const double mo = elements.meanAnomaly * DEG_TO_RAD;
+        const double noKozai = elements.meanMotion * TWO_PI / 1440.0;
+        const double bstar = elements.bstar;
+        if (!(ecco >= 0.0 && ecco < 1.0 && noKozai > 0.0))
+            return false;
+
+        // Brouwer mean motion from the Kozai one in the element set
+        const double eccsq = ecco * ecco;
+        const double omeosq = 1.0 - eccsq;
+        const double rteosq = std::sqrt(omeosq);
+        const double cosio = std::cos(inclo);
+        const double cosio2 = cosio * cosio;
+        const double ak = std::pow(xke / noKozai, x2o3);
+        const double d1 = 0.75 * SGP4_J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+        double del = d1 / (ak * ak);
+        const double adel = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+        del = d1 / (adel * adel);
+        const double no = noKozai / (1.0 + del);
+
+        const double ao = std::pow(xke / no, x2o3);
+        const double sinio = std::sin(inclo);
+        const double po = ao * omeosq;
+        const double con42 = 1.0 - 5.0 * cosio2;
+        const double con41 = -con42 - cosio2 - cosio2;
+        const double posq = po * po;
+        const double rp = ao * (1.0 - ecco);
+        if (rp < 1.0)
+            return false;
+
+        // Drag: density function parameters s and q0 are adjusted for low perigees
+        const double ss = 78.0 / SGP4_EARTH_RADIUS_KM + 1.0;
+        const double qzms2t = std::pow((120.0 - 78.0) / SGP4_EARTH_RADIUS_KM, 4);
+        const bool isimp = rp < 220.0 / SGP4_EARTH_RADIUS_KM + 1.0;
+        double sfour = ss, qzms24 = qzms2t;
+        const double perigee = (rp - 1.0) * SGP4_EARTH_RADIUS_KM;
+        if (perigee < 156.0) {
+            sfour = perigee < 98.0 ? 20.0 : perigee - 78.0;
+            qzms24 = std::pow((120.0 - sfour) / SGP4_EARTH_RADIUS_KM, 4);
+            sfour = sfour / SGP4_EARTH_RADIUS_KM + 1.0;
+        }
+        const double pinvsq = 1.0 / posq;
+        const double tsi = 1.0 / (ao - sfour);
+        const double eta = ao * ecco * tsi;
+        const double etasq = eta * eta;
+        const double eeta = ecco * eta;
+        const double psisq = std::fabs(1.0 - etasq);
+        const double coef = qzms24 * std::pow(tsi, 4);
+        const double coef1 = coef / std::pow(psisq, 3.5);
+        const double cc2 = coef1 * no * (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq)) +
+                           0.375 * SGP4_J2 * tsi / psisq * con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+        const double cc1 = bstar * cc2;
+        const double cc3 = ecco > 1.0e-4 ? -2.0 * coef * tsi * j3oj2 * no * sinio / ecco : 0.0;
+        const double x1mth2 = 1.0 - cosio2;
+        const double cc4 = 2.0 * no * coef1 * ao * omeosq *
+                           (eta * (2.0 + 0.5 * etasq) + ecco * (0.5 + 2.0 * etasq) -
+                            SGP4_J2 * tsi / (ao * psisq) *
+                                (-3.0 * con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta)) +
+                                 0.75 * x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) * std::cos(2.0 * argpo)));
+        const double cc5 = 2.0 * coef1 * ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+
+        // Secular rates from J2 and J4
+        const double cosio4 = cosio2 * cosio2;
+        const double temp1 = 1.5 * SGP4_J2 * pinvsq * no;
+        const double temp2 = 0.5 * temp1 * SGP4_J2 * pinvsq;
+        const double temp3 = -0.46875 * SGP4_J4 * pinvsq * pinvsq * no;
+        const double mdot = no + 0.5 * temp1 * rteosq * con41 + 0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+        const double argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4) +
+                               temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+        const double xhdot1 = -temp1 * cosio;
+        const double nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+
+        double c[FIELDS];
+        c[EPOCH] = elements.epochDays;
+        c[NO] = no;
+        c[AO] = ao;
+        c[ECCO] = ecco;
+        c[INCLO] = inclo;
+        c[NODEO] = elements.node * DEG_TO_RAD;
+        c[ARGPO] = argpo;
+        c[MO] = mo;
+        c[MDOT] = mdot;
+        c[ARGPDOT] = argpdot;
+        c[NODEDOT] = nodedot;
+        c[NODECF] = 3.5 * omeosq * xhdot1 * cc1;
+        c[CC1] = cc1;
+        c[BSTAR_CC4] = bstar * cc4;
+        c[T2COF] = 1.5 * cc1;
+        c[ETA] = eta;
+        c[DELMO] = std::pow(1.0 + eta * std::cos(mo), 3);
+        c[SINMAO] = std::sin(mo);
+        c[AYCOF] = -0.5 * j3oj2 * sinio;
+        const double cosio1 = std::fabs(cosio + 1.0) > 1.5e-12 ? 1.0 + cosio : 1.5e-12;
+        c[XLCOF] = -0.25 * j3oj2 * sinio * (3.0 + 5.0 * cosio) / cosio1;
+        c[CON41] = con41;
+        c[X1MTH2] = x1mth2;
+        c[X7THM1] = 7.0 * cosio2 - 1.0;
+        c[SINIO] = sinio;
+        c[COSIO] = cosio;
+        // Perigees under 220 km keep only the leading drag terms, zeros turn the rest off
+        c[BSTAR_CC5] = c[OMGCOF] = c[XMCOF] = c[D2] = c[D3] = c[D4] = c[T3COF] = c[T4COF] = c[T5COF] = 0.0;
+        if (!isimp) {
+            c[BSTAR_CC5] = bstar * cc5;
+            c[OMGCOF] = bstar * cc3 * std::cos(argpo);
+            c[XMCOF] = ecco > 1.0e-4 ? -x2o3 * coef * bstar / eeta : 0.0;
+            const double cc1sq = cc1 * cc1;
+            c[D2] = 4.0 * ao * tsi * cc1sq;
+            const double temp = c[D2] * tsi * cc1 / 3.0;
+            c[D3] = (17.0 * ao + sfour) * temp;
+            c[D4] = 0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * cc1;
+            c[T3COF] = c[D2] + 2.0 * cc1sq;
+            c[T4COF] = 0.25 * (3.0 * c[D3] + cc1 * (12.0 * c[D2] + 10.0 * cc1sq));
+            c[T5COF] = 0.2 * (3.0 * c[D4] + 12.0 * cc1 * c[D3] + 6.0 * c[D2] * c[D2] + 15.0 * cc1sq * (2.0 * c[D2] + cc1sq));
+        }
+        for (int k = 0; k < FIELDS; k++)
+            p_Fields[k].push_back(c[k]);
+        p_Numbers.push_back(elements.number);
+        p_X.push_back(std::numeric_limits<double>::quiet_NaN());
+        p_Y.push_back(std::numeric_limits<double>::quiet_NaN());
+        p_Z.push_back(std::numeric_limits<double>::quiet_NaN());
+        return true;
+    }
+
+    void clear() {
+        for (int k = 0; k < FIELDS; k++)
+            p_Fields[k].clear();
+        p_Numbers.clear();
+        p_X.clear(); p_Y.clear(); p_Z.clear();
+        p_Cursor = 0;
+        p_LastCount = 0;
+    }
+
+    std::size_t size() const { return p_Numbers.size(); }
+    bool empty() const { return p_Numbers.empty(); }
+    std::uint32_t number(std::size_t i) const { return p_Numbers[i]; }
+    double epochDays(std::size_t i) const { return p_Fields[EPOCH][i]; }
+
+    /**
+     * @brief Satellites with periods of 225 minutes or more, which SDP4 would handle
+     */
+    std::size_t deepSpace() const {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < size(); i++)
+            count += TWO_PI / p_Fields[NO][i] >= 225.0;
+        return count;
+    }
+
+    /**
+     * @brief Positions after the last propagation, km in TEME; NaN where propagation failed
+     */
+    const double* x() const { return p_X.data(); }
+    const double* y() const { return p_Y.data(); }
+    const double* z() const { return p_Z.data(); }
+
+    /**
+     * @brief Propagates every satellite to days since J2000
+     */
+    void propagate(ThreadPool& pool, double days) {
+        propagateRange(pool, days, 0, size());
+    }
+
+    /**
+     * @brief Propagates as many satellites as fit in budget seconds, taking turns from where the
+     * last call stopped; all of them while the measured cost allows
+     *
+     * @return number of satellites propagated
+     */
+    std::size_t update(ThreadPool& pool, double days, double budget) {
+        const std::size_t n = size();
+        if (n == 0)
+            return 0;
+        std::size_t count = n;
+        if (p_CostPerSatellite > 0.0 && budget < p_CostPerSatellite * n) {
+            count = static_cast<std::size_t>(budget / p_CostPerSatellite);
+            count = count < CHUNK ? CHUNK : count;
+            count = count < n ? count : n;
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+        const std::size_t first = count == n ? 0 : p_Cursor;
+        const std::size_t wrapped = first + count > n ? first + count - n : 0;
+        propagateRange(pool, days, first, first + count - wrapped);
+        propagateRange(pool, days, 0, wrapped);
+        p_Cursor = (first + count) % n;
+        p_LastCount = count;
+
+        const double cost = std::chrono::duration<double>(Clock::now() - start).count() / count;
+        p_CostPerSatellite = p_CostPerSatellite > 0.0 ? 0.8 * p_CostPerSatellite + 0.2 * cost : cost;
+        return count;
+    }
+
+    /**
+     * @brief Smoothed wall seconds one satellite costs in update()
+     */
+    double costPerSatellite() const { return p_CostPerSatellite; }
+    std::size_t lastCount() const { return p_LastCount; }
+
+    /**
+     * @brief Scalar reference: position (km) and velocity (km / s) of satellite i in TEME
+     *
+     * @return OK, or why the model has no answer at that time
+     */
+    Status state(std::size_t i, double days, double r[3], double v[3]) const {
+        const double xke = 60.0 / std::sqrt(SGP4_EARTH_RADIUS_KM * SGP4_EARTH_RADIUS_KM * SGP4_EARTH_RADIUS_KM / SGP4_MU);
+        double c[FIELDS];
+        for (int k = 0; k < FIELDS; k++)
+            c[k] = p_Fields[k][i];
+        const double t = (days - c[EPOCH]) * 1440.0;
+
+        // Secular gravity and drag
+        const double xmdf = c[MO] + c[MDOT] * t;
+        const double argpdf = c[ARGPO] + c[ARGPDOT] * t;
+        const double nodedf = c[NODEO] + c[NODEDOT] * t;
+        const double t2 = t * t;
+        double nodem = nodedf + c[NODECF] * t2;
+        double tempa = 1.0 - c[CC1] * t;
+        double tempe = c[BSTAR_CC4] * t;
+        double templ = c[T2COF] * t2;
+        const double delomg = c[OMGCOF] * t;
+        const double delm = c[XMCOF] * (std::pow(1.0 + c[ETA] * std::cos(xmdf), 3) - c[DELMO]);
+        double mm = xmdf + delomg + delm;
+        double argpm = argpdf - delomg - delm;
+        const double t3 = t2 * t, t4 = t3 * t;
+        tempa = tempa - c[D2] * t2 - c[D3] * t3 - c[D4] * t4;
+        tempe = tempe + c[BSTAR_CC5] * (std::sin(mm) - c[SINMAO]);
+        templ = templ + c[T3COF] * t3 + t4 * (c[T4COF] + t * c[T5COF]);
+
+        const double am = c[AO] * tempa * tempa;
+        const double nm = c[NO] / (tempa * tempa * tempa);
+        double em = c[ECCO] - tempe;
+        if (!(nm > 0.0))
+            return BAD_MEAN_MOTION;
+        if (em >= 1.0 || em < -0.001 || am < 0.95)
+            return BAD_ECCENTRICITY;
+        if (em < 1.0e-6)
+            em = 1.0e-6;
+        mm += c[NO] * templ;
+        const double xlm = mm + argpm + nodem;
+        nodem = std::fmod(nodem, TWO_PI);
+        argpm = std::fmod(argpm, TWO_PI);
+        mm = std::fmod(std::fmod(xlm, TWO_PI) - argpm - nodem, TWO_PI);
+
+        // Long period terms from J3
+        const double axnl = em * std::cos(argpm);
+        double temp = 1.0 / (am * (1.0 - em * em));
+        const double aynl = em * std::sin(argpm) + temp * c[AYCOF];
+        const double xl = mm + argpm + nodem + temp * c[XLCOF] * axnl;
+
+        // Kepler's equation for the eccentric longitude
+        const double u = std::fmod(xl - nodem, TWO_PI);
+        double eo1 = u, sineo1 = 0.0, coseo1 = 0.0, tem5 = 1.0;
+        for (int k = 0; k < KEPLER_ITERATIONS && std::fabs(tem5) >= 1.0e-12; k++) {
+            sineo1 = std::sin(eo1);
+            coseo1 = std::cos(eo1);
+            tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / (1.0 - coseo1 * axnl - sineo1 * aynl);
+            if (std::fabs(tem5) >= 0.95)
+                tem5 = tem5 > 0.0 ? 0.95 : -0.95;
+            eo1 += tem5;
+        }
+
+        // Short period terms from J2
+        const double ecose = axnl * coseo1 + aynl * sineo1;
+        const double esine = axnl * sineo1 - aynl * coseo1;
+        const double el2 = axnl * axnl + aynl * aynl;
+        const double pl = am * (1.0 - el2);
+        if (pl < 0.0)
+            return BAD_SEMI_LATUS;
+        const double rl = am * (1.0 - ecose);
+        const double rdotl = std::sqrt(am) * esine / rl;
+        const double rvdotl = std::sqrt(pl) / rl;
+        const double betal = std::sqrt(1.0 - el2);
+        temp = esine / (1.0 + betal);
+        const double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+        const double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+        double su = std::atan2(sinu, cosu);
+        const double sin2u = (cosu + cosu) * sinu;
+        const double cos2u = 1.0 - 2.0 * sinu * sinu;
+        temp = 1.0 / pl;
+        const double temp1 = 0.5 * SGP4_J2 * temp;
+        const double temp2 = temp1 * temp;
+
+        const double mrt = rl * (1.0 - 1.5 * temp2 * betal * c[CON41]) + 0.5 * temp1 * c[X1MTH2] * cos2u;
+        su -= 0.25 * temp2 * c[X7THM1] * sin2u;
+        const double xnode = nodem + 1.5 * temp2 * c[COSIO] * sin2u;
+        const double xinc = c[INCLO] + 1.5 * temp2 * c[COSIO] * c[SINIO] * cos2u;
+        const double mvt = rdotl - nm * temp1 * c[X1MTH2] * sin2u / xke;
+        const double rvdot = rvdotl + nm * temp1 * (c[X1MTH2] * cos2u + 1.5 * c[CON41]) / xke;
+
+        const double sinsu = std::sin(su), cossu = std::cos(su);
+        const double snod = std::sin(xnode), cnod = std::cos(xnode);
+        const double sini = std::sin(xinc), cosi = std::cos(xinc);
+        const double xmx = -snod * cosi, xmy = cnod * cosi;
+        const double ux = xmx * sinsu + cnod * cossu, uy = xmy * sinsu + snod * cossu, uz = sini * sinsu;
+        const double vx = xmx * cossu - cnod * sinsu, vy = xmy * cossu - snod * sinsu, vz = sini * cossu;
+        const double kmPerSecond = SGP4_EARTH_RADIUS_KM * xke / 60.0;
+        r[0] = mrt * ux * SGP4_EARTH_RADIUS_KM;
+        r[1] = mrt * uy * SGP4_EARTH_RADIUS_KM;
+        r[2] = mrt * uz * SGP4_EARTH_RADIUS_KM;
+        v[0] = (mvt * ux + rvdot * vx) * kmPerSecond;
+        v[1] = (mvt * uy + rvdot * vy) * kmPerSecond;
+        v[2] = (mvt * uz + rvdot * vz) * kmPerSecond;
+        return mrt < 1.0 ? DECAYED : OK;
+    }
+
+private:
+    // One array per constant, in this order
+    enum Field {
+        EPOCH, NO, AO, ECCO, INCLO, NODEO, ARGPO, MO, MDOT, ARGPDOT, NODEDOT, NODECF, CC1, BSTAR_CC4, BSTAR_CC5,
+        T2COF, T3COF, T4COF, T5COF, D2, D3, D4, OMGCOF, XMCOF, ETA, DELMO, SINMAO, AYCOF, XLCOF, CON41, X1MTH2,
+        X7THM1, SINIO, COSIO, FIELDS
+    };
+
+    std::vector<double> p_Fields[FIELDS];
+    std::vector<std::uint32_t> p_Numbers;
+    std::vector<double> p_X, p_Y, p_Z;
+    std::size_t p_Cursor;
+    double p_CostPerSatellite;
+    std::size_t p_LastCount;
+
+    void propagateRange(ThreadPool& pool, double days, std::size_t begin, std::size_t end) {
+        if (end <= begin)
+            return;
+        pool.parallelFor(begin, end, CHUNK * 4, [this, days](std::size_t chunkBegin, std::size_t chunkEnd) {
+            for (std::size_t i = chunkBegin; i < chunkEnd; i += CHUNK)
+                propagateChunk(days, i, i + CHUNK < chunkEnd ? i + CHUNK : chunkEnd);
+        });
+    }
+
+    void propagateChunk(double days, std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+#if defined(SOLAR_SYSTEM_SIMD)
+        const double* fields[FIELDS];
+        for (int k = 0; k < FIELDS; k++)
+            fields[k] = p_Fields[k].data();
+        for (; i + simd::DOUBLE_WIDTH <= end; i += simd::DOUBLE_WIDTH)
+            propagateLanes(fields, days, i);
+#endif
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        for (; i < end; i++) {
+            double r[3], v[3];
+            const bool ok = state(i, days, r, v) == OK;
+            p_X[i] = ok ? r[0] : nan;
+            p_Y[i] = ok ? r[1] : nan;
+            p_Z[i] = ok ? r[2] : nan;
+        }
+    }
+
+#if defined(SOLAR_SYSTEM_SIMD)
+    /**
+     * @brief state() for simd::DOUBLE_WIDTH satellites from i on, positions only; f holds the field arrays
+     *
+     * Angles are wrapped to [-pi, pi] instead of [0, 2 pi), which only changes the branch
+     * they are represented in, and the argument of latitude is corrected with an angle sum
+     * instead of atan2.
+     */
+    void propagateLanes(const double* const* f, double days, std::size_t i) {
+        using namespace simd;
+        const vdouble zero = set1d(0.0), one = set1d(1.0);
+        const vdouble t = mul(sub(set1d(days), load(f[EPOCH] + i)), set1d(1440.0));
+
+        const vdouble xmdf = fmadd(load(f[MDOT] + i), t, load(f[MO] + i));
+        const vdouble argpdf = fmadd(load(f[ARGPDOT] + i), t, load(f[ARGPO] + i));
+        const vdouble nodedf = fmadd(load(f[NODEDOT] + i), t, load(f[NODEO] + i));
+        const vdouble t2 = mul(t, t), t3 = mul(t2, t), t4 = mul(t3, t);
+        vdouble nodem = fmadd(load(f[NODECF] + i), t2, nodedf);
+        vdouble sinX, cosX;
+        sincos(wrap(xmdf), sinX, cosX);
+        const vdouble eta = load(f[ETA] + i);
+        const vdouble delta = fmadd(eta, cosX, one);
+        const vdouble delm = mul(load(f[XMCOF] + i), sub(mul(mul(delta, delta), delta), load(f[DELMO] + i)));
+        const vdouble delomg = mul(load(f[OMGCOF] + i), t);
+        vdouble mm = simd::add(xmdf, simd::add(delomg, delm));
+        const vdouble argpm = wrap(sub(argpdf, simd::add(delomg, delm)));
+        vdouble tempa = sub(one, mul(load(f[CC1] + i), t));
+        tempa = sub(tempa, fmadd(load(f[D2] + i), t2, fmadd(load(f[D3] + i), t3, mul(load(f[D4] + i), t4))));
+        vdouble sinM, cosM;
+        sincos(wrap(mm), sinM, cosM);
+        const vdouble tempe = fmadd(load(f[BSTAR_CC5] + i), sub(sinM, load(f[SINMAO] + i)), mul(load(f[BSTAR_CC4] + i), t));
+        const vdouble templ = fmadd(load(f[T2COF] + i), t2,
+                                    fmadd(load(f[T3COF] + i), t3, mul(t4, fmadd(t, load(f[T5COF] + i), load(f[T4COF] + i)))));
+
+        const vdouble am = mul(load(f[AO] + i), mul(tempa, tempa));
+        const vdouble nm = div(load(f[NO] + i), mul(tempa, mul(tempa, tempa)));
+        const vdouble rawEm = sub(load(f[ECCO] + i), tempe);
+        vdouble valid = bitAnd(bitAnd(less(zero, nm), less(rawEm, one)), bitAnd(less(set1d(-0.001), rawEm), less(set1d(0.95), am)));
+        const vdouble em = max(rawEm, set1d(1.0e-6));
+        mm = fmadd(load(f[NO] + i), templ, mm);
+        nodem = wrap(nodem);
+
+        // Long period terms from J3
+        vdouble sinArgp, cosArgp;
+        sincos(argpm, sinArgp, cosArgp);
+        const vdouble axnl = mul(em, cosArgp);
+        const vdouble inverseP = div(one, mul(am, sub(one, mul(em, em))));
+        const vdouble aynl = fmadd(inverseP, load(f[AYCOF] + i), mul(em, sinArgp));
+        const vdouble xl = simd::add(simd::add(mm, argpm), fmadd(mul(inverseP, load(f[XLCOF] + i)), axnl, nodem));
+
+        // Kepler's equation, until every lane converged
+        const vdouble u = wrap(sub(xl, nodem));
+        vdouble eo1 = u, sineo1 = zero, coseo1 = one;
+        const vdouble limit = set1d(0.95);
+        for (int k = 0; k < KEPLER_ITERATIONS; k++) {
+            sincos(eo1, sineo1, coseo1);
+            const vdouble numerator = simd::add(sub(sub(u, mul(aynl, coseo1)), eo1), mul(axnl, sineo1));
+            const vdouble denominator = sub(sub(one, mul(coseo1, axnl)), mul(sineo1, aynl));
+            const vdouble tem5 = max(min(div(numerator, denominator), limit), sub(zero, limit));
+            eo1 = simd::add(eo1, tem5);
+            double steps[DOUBLE_WIDTH];
+            store(steps, tem5);
+            bool converged = true;
+            for (int lane = 0; lane < DOUBLE_WIDTH; lane++)
+                converged = converged && std::fabs(steps[lane]) < 1.0e-12;
+            if (converged)
+                break;
+        }
+
+        // Short period terms from J2
+        const vdouble ecose = fmadd(axnl, coseo1, mul(aynl, sineo1));
+        const vdouble esine = sub(mul(axnl, sineo1), mul(aynl, coseo1));
+        const vdouble el2 = fmadd(axnl, axnl, mul(aynl, aynl));
+        const vdouble pl = mul(am, sub(one, el2));
+        valid = bitAnd(valid, less(zero, pl));
+        const vdouble rl = mul(am, sub(one, ecose));
+        const vdouble betal = sqrt(max(sub(one, el2), zero));
+        const vdouble temp = div(esine, simd::add(one, betal));
+        const vdouble amOverRl = div(am, rl);
+        const vdouble sinu = mul(amOverRl, sub(sub(sineo1, aynl), mul(axnl, temp)));
+        const vdouble cosu = mul(amOverRl, fmadd(aynl, temp, sub(coseo1, axnl)));
+        const vdouble sin2u = mul(simd::add(cosu, cosu), sinu);
+        const vdouble cos2u = sub(one, mul(set1d(2.0), mul(sinu, sinu)));
+        const vdouble inversePl = div(one, pl);
+        const vdouble temp1 = mul(set1d(0.5 * SGP4_J2), inversePl);
+        const vdouble temp2 = mul(temp1, inversePl);
+        const vdouble con41 = load(f[CON41] + i);
+        const vdouble cosio = load(f[COSIO] + i);
+
+        const vdouble mrt = fmadd(mul(set1d(0.5), temp1), mul(load(f[X1MTH2] + i), cos2u),
+                                  mul(rl, sub(one, mul(mul(set1d(1.5), temp2), mul(betal, con41)))));
+        valid = bitAnd(valid, less(one, mrt));
+        // su - delta from sin u, cos u and the small correction delta
+        vdouble sinDelta, cosDelta;
+        sincos(mul(mul(set1d(0.25), temp2), mul(load(f[X7THM1] + i), sin2u)), sinDelta, cosDelta);
+        const vdouble sinsu = sub(mul(sinu, cosDelta), mul(cosu, sinDelta));
+        const vdouble cossu = fmadd(sinu, sinDelta, mul(cosu, cosDelta));
+        const vdouble onePointFiveTemp2Cosio = mul(mul(set1d(1.5), temp2), cosio);
+        vdouble snod, cnod, sini, cosi;
+        sincos(fmadd(onePointFiveTemp2Cosio, sin2u, nodem), snod, cnod);
+        sincos(fmadd(mul(onePointFiveTemp2Cosio, load(f[SINIO] + i)), cos2u, load(f[INCLO] + i)), sini, cosi);
+
+        const vdouble xmx = mul(sub(zero, snod), cosi), xmy = mul(cnod, cosi);
+        const vdouble scale = mul(mrt, set1d(SGP4_EARTH_RADIUS_KM));
+        const vdouble nan = set1d(std::numeric_limits<double>::quiet_NaN());
+        store(&p_X[i], select(valid, mul(scale, fmadd(xmx, sinsu, mul(cnod, cossu))), nan));
+        store(&p_Y[i], select(valid, mul(scale, fmadd(xmy, sinsu, mul(snod, cossu))), nan));
+        store(&p_Z[i], select(valid, mul(scale, mul(sini, sinsu)), nan));
+    }
+
+    static simd::vdouble wrap(simd::vdouble angle) {
+        using namespace simd;
+        return sub(angle, mul(set1d(TWO_PI), roundNearest(mul(angle, set1d(1.0 / TWO_PI)))));
+    }
+#endif
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_SGP4_HPP_
@@ -0,0 +1,255 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_SIMD_HPP_
+#define INCLUDE_SOLAR_SYSTEM_SIMD_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+/**
+ * Thin wrappers over the widest float and double vectors the compiler targets (AVX2, then SSE2).
+ * SIMD_WIDTH and DOUBLE_WIDTH are 1 when neither is available; batched loops then fall through
+ * to their scalar tail, which always uses the standard library math functions.
+ */
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SOLAR_SYSTEM_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SOLAR_SYSTEM_SIMD 1
+#endif
+
+namespace simd {
+
+#if defined(__AVX2__)
+
+const int SIMD_WIDTH = 8;
+typedef __m256 vfloat;
+typedef __m256i vint;
+
+inline vfloat load(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+inline vfloat set1(float s) { return _mm256_set1_ps(s); }
+inline vfloat add(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+inline vfloat sub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+inline vfloat mul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+inline vfloat div(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+inline vfloat min(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+inline vfloat max(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+inline vfloat sqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+#if defined(__FMA__)
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+inline vfloat bitAnd(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+inline vfloat bitXor(vfloat a, vfloat b) { return _mm256_xor_ps(a, b); }
+inline vfloat less(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline vfloat select(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }
+inline vint roundToInt(vfloat a) { return _mm256_cvtps_epi32(a); }
+inline vfloat toFloat(vint a) { return _mm256_cvtepi32_ps(a); }
+inline vint iset1(int s) { return _mm256_set1_epi32(s); }
+inline vint iand(vint a, vint b) { return _mm256_and_si256(a, b); }
+inline vint iadd(vint a, vint b) { return _mm256_add_epi32(a, b); }
+inline vfloat ieq(vint a, vint b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+
+const int DOUBLE_WIDTH = 4;
+typedef __m256d vdouble;
+
+inline vdouble load(const double* p) { return _mm256_loadu_pd(p); }
+inline void store(double* p, vdouble v) { _mm256_storeu_pd(p, v); }
+inline vdouble set1d(double s) { return _mm256_set1_pd(s); }
+inline vdouble add(vdouble a, vdouble b) { return _mm256_add_pd(a, b); }
+inline vdouble sub(vdouble a, vdouble b) { return _mm256_sub_pd(a, b); }
+inline vdouble mul(vdouble a, vdouble b) { return _mm256_mul_pd(a, b); }
+inline vdouble div(vdouble a, vdouble b) { return _mm256_div_pd(a, b); }
+inline vdouble min(vdouble a, vdouble b) { return _mm256_min_pd(a, b); }
+inline vdouble max(vdouble a, vdouble b) { return _mm256_max_pd(a, b); }
+inline vdouble sqrt(vdouble a) { return _mm256_sqrt_pd(a); }
+#if defined(__FMA__)
+inline vdouble fmadd(vdouble a, vdouble b, vdouble c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+inline vdouble fmadd(vdouble a, vdouble b, vdouble c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+inline vdouble bitAnd(vdouble a, vdouble b) { return _mm256_and_pd(a, b); }
+inline vdouble bitXor(vdouble a, vdouble b) { return _mm256_xor_pd(a, b); }
+inline vdouble less(vdouble a, vdouble b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+inline vdouble select(vdouble mask, vdouble a, vdouble b) { return _mm256_blendv_pd(b, a, mask); }
+
+#elif defined(SOLAR_SYSTEM_SIMD)
+
+const int SIMD_WIDTH = 4;
+typedef __m128 vfloat;
+typedef __m128i vint;
+
+inline vfloat load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+inline vfloat set1(float s) { return _mm_set1_ps(s); }
+inline vfloat add(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+inline vfloat sub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+inline vfloat mul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+inline vfloat div(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+inline vfloat min(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+inline vfloat max(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+inline vfloat sqrt(vfloat a) { return _mm_sqrt_ps(a); }
+inline vfloat fmadd(vfloat a, vfloat b, vfloat c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline vfloat bitAnd(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+inline vfloat bitXor(vfloat a, vfloat b) { return _mm_xor_ps(a, b); }
+inline vfloat less(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+// SSE2 has no blendv, so fall back to and/andnot/or
+inline vfloat select(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline vint roundToInt(vfloat a) { return _mm_cvtps_epi32(a); }
+inline vfloat toFloat(vint a) { return _mm_cvtepi32_ps(a); }
+inline vint iset1(int s) { return _mm_set1_epi32(s); }
+inline vint iand(vint a, vint b) { return _mm_and_si128(a, b); }
+inline vint iadd(vint a, vint b) { return _mm_add_epi32(a, b); }
+inline vfloat ieq(vint a, vint b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+
+const int DOUBLE_WIDTH = 2;
+typedef __m128d vdouble;
+
+inline vdouble load(const double* p) { return _mm_loadu_pd(p); }
+inline void store(double* p, vdouble v) { _mm_storeu_pd(p, v); }
+inline vdouble set1d(double s) { return _mm_set1_pd(s); }
+inline vdouble add(vdouble a, vdouble b) { return _mm_add_pd(a, b); }
+inline vdouble sub(vdouble a, vdouble b) { return _mm_sub_pd(a, b); }
+inline vdouble mul(vdouble a, vdouble b) { return _mm_mul_pd(a, b); }
+inline vdouble div(vdouble a, vdouble b) { return _mm_div_pd(a, b); }
+inline vdouble min(vdouble a, vdouble b) { return _mm_min_pd(a, b); }
+inline vdouble max(vdouble a, vdouble b) { return _mm_max_pd(a, b); }
+inline vdouble sqrt(vdouble a) { return _mm_sqrt_pd(a); }
+inline vdouble fmadd(vdouble a, vdouble b, vdouble c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+inline vdouble bitAnd(vdouble a, vdouble b) { return _mm_and_pd(a, b); }
+inline vdouble bitXor(vdouble a, vdouble b) { return _mm_xor_pd(a, b); }
+inline vdouble less(vdouble a, vdouble b) { return _mm_cmplt_pd(a, b); }
+inline vdouble select(vdouble mask, vdouble a, vdouble b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+
+#else
+
+const int SIMD_WIDTH = 1;
+const int DOUBLE_WIDTH = 1;
+
+#endif
+
+#if defined(SOLAR_SYSTEM_SIMD)
+
+inline vfloat signBit() { return set1(-0.0f); }
+inline vfloat abs(vfloat a) { return bitXor(a, bitAnd(a, signBit())); }
+inline vfloat copySign(vfloat magnitude, vfloat sign) {
+    return bitXor(abs(magnitude), bitAnd(sign, signBit()));
+}
+
+/**
+ * @brief Computes sine and cosine of every lane at once
+ *
+ * Reduces to [-pi/4, pi/4] with a three-part Cody-Waite split of pi/2 and evaluates
+ * the Cephes single precision minimax polynomials. Accurate to a few ulp for |x| < 8192.
+ */
+inline void sincos(vfloat x, vfloat& s, vfloat& c) {
+    const vfloat twoOverPi = set1(0.63661977236758134f);
+    vint quadrant = roundToInt(mul(x, twoOverPi));
+    vfloat j = toFloat(quadrant);
+
+    // x - j * pi/2, split so the product stays exact
+    vfloat r = fmadd(j, set1(-1.5703125f), x);
+    r = fmadd(j, set1(-4.837512969970703125e-4f), r);
+    r = fmadd(j, set1(-7.549789948768648e-8f), r);
+
+    vfloat r2 = mul(r, r);
+
+    vfloat sinPoly = fmadd(set1(-1.9515295891e-4f), r2, set1(8.3321608736e-3f));
+    sinPoly = fmadd(sinPoly, r2, set1(-1.6666654611e-1f));
+    sinPoly = fmadd(mul(sinPoly, r2), r, r);
+
+    vfloat cosPoly = fmadd(set1(2.443315711809948e-5f), r2, set1(-1.388731625493765e-3f));
+    cosPoly = fmadd(cosPoly, r2, set1(4.166664568298827e-2f));
+    cosPoly = fmadd(mul(cosPoly, r2), r2, fmadd(set1(-0.5f), r2, set1(1.0f)));
+
+    // Quadrant 1 and 3 swap sine and cosine, quadrant 1 and 2 negate the cosine, 2 and 3 the sine
+    vint q = iand(quadrant, iset1(3));
+    vfloat swap = ieq(iand(q, iset1(1)), iset1(1));
+    vfloat sinValue = select(swap, cosPoly, sinPoly);
+    vfloat cosValue = select(swap, sinPoly, cosPoly);
+
+    vfloat negateSin = bitAnd(ieq(iand(q, iset1(2)), iset1(2)), signBit());
+    vfloat negateCos = bitAnd(ieq(iand(iadd(q, iset1(1)), iset1(2)), iset1(2)), signBit());
+
+    s = bitXor(sinValue, negateSin);
+    c = bitXor(cosValue, negateCos);
+}
+
+/**
+ * @brief Rounds every lane to the nearest integer, valid for |x| < 2^51
+ */
+inline vdouble roundNearest(vdouble x) {
+    const vdouble magic = set1d(6755399441055744.0);   // 1.5 * 2^52
+    return sub(add(x, magic), magic);
+}
+
+/**
+ * @brief Double precision sine and cosine of every lane
+ *
+ * Same scheme as the float version with the Cephes double polynomials; the quadrant is
+ * kept as a double, so no integer vector instructions are needed. Accurate to about
+ * 1 ulp for |x| < 2^20.
+ */
+inline void sincos(vdouble x, vdouble& s, vdouble& c) {
+    vdouble j = roundNearest(mul(x, set1d(0.63661977236758134308)));
+
+    vdouble r = fmadd(j, set1d(-1.57079625129699707031), x);
+    r = fmadd(j, set1d(-7.54978941586159635335e-8), r);
+    r = fmadd(j, set1d(-5.39030285815811905290e-15), r);
+
+    vdouble r2 = mul(r, r);
+
+    vdouble sinPoly = fmadd(set1d(1.58962301576546568060e-10), r2, set1d(-2.50507477628578072866e-8));
+    sinPoly = fmadd(sinPoly, r2, set1d(2.75573136213857245213e-6));
+    sinPoly = fmadd(sinPoly, r2, set1d(-1.98412698295895385996e-4));
+    sinPoly = fmadd(sinPoly, r2, set1d(8.33333333332211858878e-3));
+    sinPoly = fmadd(sinPoly, r2, set1d(-1.66666666666666307295e-1));
+    sinPoly = fmadd(mul(sinPoly, r2), r, r);
+
+    vdouble cosPoly = fmadd(set1d(-1.13585365213876817300e-11), r2, set1d(2.08757008419747316778e-9));
+    cosPoly = fmadd(cosPoly, r2, set1d(-2.75573141792967388112e-7));
+    cosPoly = fmadd(cosPoly, r2, set1d(2.48015872888517045348e-5));
+    cosPoly = fmadd(cosPoly, r2, set1d(-1.38888888888730564116e-3));
+    cosPoly = fmadd(cosPoly, r2, set1d(4.16666666666665929218e-2));
+    cosPoly = fmadd(mul(cosPoly, r2), r2, fmadd(set1d(-0.5), r2, set1d(1.0)));
+
+    // j mod 4 without integers: (j - 1.5) / 4 never rounds a tie
+    vdouble q = sub(j, mul(set1d(4.0), roundNearest(mul(sub(j, set1d(1.5)), set1d(0.25)))));
+    vdouble odd = sub(q, mul(set1d(2.0), roundNearest(mul(sub(q, set1d(0.5)), set1d(0.5)))));
+    vdouble swap = less(set1d(0.5), odd);
+    vdouble sinValue = select(swap, cosPoly, sinPoly);
+    vdouble cosValue = select(swap, sinPoly, cosPoly);
+
+    const vdouble signBit = set1d(-0.0);
+    vdouble negateSin = bitAnd(less(set1d(1.5), q), signBit);
+    vdouble negateCos = bitAnd(bitAnd(less(set1d(0.5), q), less(q, set1d(2.5))), signBit);
+
+    s = bitXor(sinValue, negateSin);
+    c = bitXor(cosValue, negateCos);
+}
+
+#endif
+
+/**
+ * @brief Batched sine and cosine over plain arrays, scalar tail uses std::sin/std::cos
+ */
+inline void sincos(const float* x, float* s, float* c, std::size_t n) {
+    std::size_t i = 0;
+#if defined(SOLAR_SYSTEM_SIMD)
+    for (; i + SIMD_WIDTH <= n; i += SIMD_WIDTH) {
+        vfloat vs, vc;
+        sincos(load(x + i), vs, vc);
+        store(s + i, vs);
+        store(c + i, vc);
+    }
+#endif
+    for (; i < n; i++) {
+        s[i] = std::sin(x[i]);
+        c[i] = std::cos(x[i]);
+    }
+}
+
+} // namespace simd
+
+#endif  // INCLUDE_SOLAR_SYSTEM_SIMD_HPP_
@@ -0,0 +1,191 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_SIMULATIONCLOCK_HPP_
+#define INCLUDE_SOLAR_SYSTEM_SIMULATIONCLOCK_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Fixed-step simulation clock on 64-bit integers.
+ *
+ * Wall time is read from a monotonic clock as integer nanoseconds and collected in an
+ * accumulator; advance() reports how many fixed steps fit into it. Simulated time is a
+ * start day plus an integer count of microseconds. Each step covers its wall length times
+ * the time warp; the fraction of a microsecond that does not fit is carried to the next
+ * step, so changing the warp never makes the clock drift.
+ *
+ * The count alone would overflow after about 85 days of wall time at a warp of 1.25e6, or
+ * a day at TIME_WARP_MAX, so step() moves whole days into the start day once it passes a
+ * century. The sum is a double in getDays(), which resolves single microseconds only up to
+ * 2^16 days (about 180 years) from J2000 and coarser steps beyond.
+ *
+ * getAlpha() is the fraction of a step left in the accumulator, used to interpolate
+ * between the last two simulated states when drawing.
+ */
+class SimulationClock {
+public:
+    static const std::int64_t NANOSECONDS_PER_SECOND = 1000000000;
+    static const std::int64_t MICROSECONDS_PER_DAY = 86400000000LL;
+    static const std::int64_t REBASE_TICKS = 36525 * MICROSECONDS_PER_DAY;   // a century
+
+    /**
+     * @param[in] stepNanoseconds length of one fixed step in wall time
+     * @param[in] warp simulated seconds per wall-clock second
+     * @param[in] maxFrameNanoseconds longest frame that is caught up, longer stalls are dropped
+     */
+    explicit SimulationClock(std::int64_t stepNanoseconds = NANOSECONDS_PER_SECOND / 120,
+                             double warp = 1.0,
+                             std::int64_t maxFrameNanoseconds = NANOSECONDS_PER_SECOND / 4)
+        : p_StepNanoseconds(stepNanoseconds), p_MaxFrameNanoseconds(maxFrameNanoseconds), p_Warp(warp),
+          p_StartDays(0.0), p_Ticks(0), p_LastStepTicks(0), p_TickFraction(0.0), p_Steps(0), p_Accumulator(0),
+          p_StartWall(0), p_LastWall(0), p_FrameNanoseconds(0) {}
+
+    /**
+     * @brief Monotonic wall time in nanoseconds
+     */
+    static std::int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Resets the clock to the given simulated time and starts counting wall time
+     */
+    void start(double days = 0.0, std::int64_t wall = now()) {
+        p_StartDays = days;
+        p_Ticks = p_LastStepTicks = 0;
+        p_TickFraction = 0.0;
+        p_Steps = 0;
+        p_Accumulator = 0;
+        p_StartWall = p_LastWall = wall;
+        p_FrameNanoseconds = 0;
+    }
+
+    /**
+     * @brief Continues from a saved state, e.g. a snapshot; wall time counts from now
+     */
+    void resume(double startDays, std::int64_t ticks, double tickFraction, std::int64_t steps,
+                std::int64_t wall = now()) {
+        start(startDays, wall);
+        p_Ticks = ticks;
+        p_TickFraction = tickFraction;
+        p_Steps = steps;
+    }
+
+    /**
+     * @brief Jumps to another simulated time, wall time and the step accumulator are kept
+     */
+    void seek(double days) {
+        p_StartDays = days;
+        p_Ticks = p_LastStepTicks = 0;
+        p_TickFraction = 0.0;
+    }
+
+    /**
+     * @brief Simulated seconds per wall-clock second, negative runs time backwards
+     */
+    void setWarp(double warp) { p_Warp = warp; }
+    double getWarp() const { return p_Warp; }
+
+    /**
+     * @brief Adds the wall time since the last call and returns the number of steps now due
+     */
+    int advance(std::int64_t wall = now()) {
+        p_FrameNanoseconds = wall - p_LastWall;
+        p_LastWall = wall;
+
+        std::int64_t frame = p_FrameNanoseconds < p_MaxFrameNanoseconds ? p_FrameNanoseconds : p_MaxFrameNanoseconds;
+        p_Accumulator += frame;
+        int steps = static_cast<int>(p_Accumulator / p_StepNanoseconds);
+        p_Accumulator -= steps * p_StepNanoseconds;
+        return steps;
+    }
+
+    /**
+     * @brief Moves simulated time forward by one fixed step at the current warp
+     */
+    void step() {
+        double ticks = static_cast<double>(p_StepNanoseconds) / 1000.0 * p_Warp + p_TickFraction;
+        // No step covers more than a century, so no warp can overflow the count
+        if (!(std::fabs(ticks) < REBASE_TICKS))
+            ticks = ticks < 0.0 ? -static_cast<double>(REBASE_TICKS) : static_cast<double>(REBASE_TICKS);
+        double whole = std::floor(ticks);
+        p_TickFraction = ticks - whole;
+        p_LastStepTicks = static_cast<std::int64_t>(whole);
+        p_Ticks += p_LastStepTicks;
+        p_Steps++;
+
+        if (p_Ticks >= REBASE_TICKS || p_Ticks <= -REBASE_TICKS) {
+            const std::int64_t days = p_Ticks / MICROSECONDS_PER_DAY;
+            p_StartDays += static_cast<double>(days);
+            p_Ticks -= days * MICROSECONDS_PER_DAY;
+        }
+    }
+
+    /**
+     * @brief Simulated time of the last step in days since J2000
+     */
+    double getDays() const {
+        return p_StartDays + static_cast<double>(p_Ticks) / MICROSECONDS_PER_DAY;
+    }
+
+    /**
+     * @brief Simulated time to draw, between the last two steps
+     */
+    double getRenderDays() const {
+        double ticks = static_cast<double>(p_Ticks - p_LastStepTicks) + getAlpha() * p_LastStepTicks;
+        return p_StartDays + ticks / MICROSECONDS_PER_DAY;
+    }
+
+    /**
+     * @brief Fraction of a step between the last simulated state and the wall clock, in [0, 1)
+     */
+    double getAlpha() const {
+        return static_cast<double>(p_Accumulator) / p_StepNanoseconds;
+    }
+
+    /**
+     * @brief Simulated days covered by one step at the current warp
+     */
+    double getStepDays() const {
+        return static_cast<double>(p_StepNanoseconds) / NANOSECONDS_PER_SECOND * p_Warp / 86400.0;
+    }
+
+    double getStepSeconds() const { return static_cast<double>(p_StepNanoseconds) / NANOSECONDS_PER_SECOND; }
+    double getStartDays() const { return p_StartDays; }
+    std::int64_t getTicks() const { return p_Ticks; }
+    double getTickFraction() const { return p_TickFraction; }
+    std::int64_t getSteps() const { return p_Steps; }
+
+    /**
+     * @brief Wall time of the last frame in seconds, for camera movement
+     */
+    double getFrameSeconds() const {
+        return static_cast<double>(p_FrameNanoseconds) / NANOSECONDS_PER_SECOND;
+    }
+
+    /**
+     * @brief Wall time since start() in seconds
+     */
+    double getWallSeconds() const {
+        return static_cast<double>(p_LastWall - p_StartWall) / NANOSECONDS_PER_SECOND;
+    }
+
+private:
+    std::int64_t p_StepNanoseconds;
+    std::int64_t p_MaxFrameNanoseconds;
+    double p_Warp;
+    double p_StartDays;
+
+    std::int64_t p_Ticks;           // simulated microseconds after p_StartDays
+    std::int64_t p_LastStepTicks;
+    double p_TickFraction;          // part of a microsecond not yet added to p_Ticks
+    std::int64_t p_Steps;
+    std::int64_t p_Accumulator;     // wall nanoseconds not yet simulated
+
+    std::int64_t p_StartWall;
+    std::int64_t p_LastWall;
+    std::int64_t p_FrameNanoseconds;
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_SIMULATIONCLOCK_HPP_
@@ -0,0 +1,209 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_SKYEPHEMERIS_HPP_
+#define INCLUDE_SOLAR_SYSTEM_SKYEPHEMERIS_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+#include "Kepler.hpp"
+#include "SpkKernel.hpp"
+
+const double EARTH_MOON_MASS_RATIO = 81.30057;
+
+/**
+ * @brief Geocentric positions of the sun, the moon and the planets, as event searches need them.
+ *
+ * Positions are geometric (no light time or aberration), in the J2000 ecliptic frame and
+ * in AU. They come from an SPK kernel when one is set and covers the time. Otherwise the
+ * planets come from JPL's approximate elements with their secular rates (1800 - 2050 fit,
+ * usable for a few centuries around it), and the moon from the largest terms of the
+ * ELP-2000/82 series as given by Meeus, "Astronomical Algorithms" chapter 47, precessed
+ * from the ecliptic of date to J2000.
+ */
+class SkyEphemeris {
+public:
+    enum Body { SUN, MOON, MERCURY, VENUS, MARS, JUPITER, SATURN, URANUS, NEPTUNE, BODIES };
+
+    SkyEphemeris() : p_Kernel(NULL) {}
+
+    /**
+     * @brief Uses the kernel where it has data, NULL goes back to the analytic theories
+     */
+    void useKernel(const SpkKernel* kernel) {
+        p_Kernel = kernel;
+    }
+
+    /**
+     * @brief Mean radius in km, used for disk sizes and shadow cones
+     */
+    static double radiusKm(Body body) {
+        static const double radii[BODIES] = { 696000.0, 1737.4, 2439.7, 6051.8, 3389.5, 69911.0, 58232.0,
+                                              25362.0, 24622.0 };
+        return radii[body];
+    }
+
+    static const char* name(Body body) {
+        static const char* const names[BODIES] = { "Sun", "Moon", "Mercury", "Venus", "Mars", "Jupiter", "Saturn",
+                                                   "Uranus", "Neptune" };
+        return names[body];
+    }
+
+    /**
+     * @brief Geocentric position of every body at one time, xyz[3 * body + k]
+     */
+    void positions(double days, double xyz[3 * BODIES]) const {
+        static const int naif[BODIES] = { NAIF_SUN, NAIF_MOON, 1, 2, 4, 5, 6, 7, 8 };
+        if (p_Kernel != NULL) {
+            bool covered = true;
+            for (int b = 0; b < BODIES && covered; b++) {
+                double velocity[3];
+                covered = p_Kernel->state(naif[b], NAIF_EARTH, days, &xyz[3 * b], velocity);
+            }
+            if (covered)
+                return;
+        }
+
+        double moon[3];
+        moonPosition(days, moon);
+        // The elements give the Earth-Moon barycentre, the earth is off it by the moon's share
+        double earth[3];
+        heliocentric(EARTH_MOON_BARYCENTRE, days, earth);
+        for (int k = 0; k < 3; k++)
+            earth[k] -= moon[k] / (1.0 + EARTH_MOON_MASS_RATIO);
+
+        for (int k = 0; k < 3; k++) {
+            xyz[3 * SUN + k] = -earth[k];
+            xyz[3 * MOON + k] = moon[k];
+        }
+        for (int b = MERCURY; b < BODIES; b++) {
+            double planet[3];
+            heliocentric(b - MERCURY + (b >= MARS ? 1 : 0), days, planet);
+            for (int k = 0; k < 3; k++)
+                xyz[3 * b + k] = planet[k] - earth[k];
+        }
+    }
+
+private:
+    static const int EARTH_MOON_BARYCENTRE = 2;
+
+    const SpkKernel* p_Kernel;
+
+    /**
+     * @brief Heliocentric position from JPL_MEAN_ELEMENTS, the elements at J2000 moved on by
+     * their rates per Julian century
+     *
+     * @param[in] planet 0 Mercury ... 7 Neptune, 2 is the Earth-Moon barycentre
+     */
+    static void heliocentric(int planet, double days, double position[3]) {
+        const double* e = JPL_MEAN_ELEMENTS[planet];
+        const double T = days / 36525.0;
+        KeplerElements orbit = KeplerElements::fromLongitudes(e[0] + e[6] * T, e[1] + e[7] * T, e[2] + e[8] * T,
+                                                              e[3] + e[9] * T, e[4] + e[10] * T, e[5] + e[11] * T);
+        double velocity[3];
+        // fromLongitudes puts the mean anomaly of these elements at day 0
+        elementsToState(orbit, 0.0, GM_SUN, position, velocity);
+    }
+
+    /**
+     * @brief Geocentric moon from the leading ELP-2000/82 terms, good to about an arcminute
+     */
+    static void moonPosition(double days, double position[3]) {
+        // Multiples of D, M, M', F; longitude (1e-6 deg) and distance (1e-3 km) coefficients
+        static const int longitudeTerms[32][6] = {
+            { 0, 0, 1, 0, 6288774, -20905355 }, { 2, 0, -1, 0, 1274027, -3699111 },
+            { 2, 0, 0, 0, 658314, -2955968 },   { 0, 0, 2, 0, 213618, -569925 },
+            { 0, 1, 0, 0, -185116, 48888 },     { 0, 0, 0, 2, -114332, -3149 },
+            { 2, 0, -2, 0, 58793, 246158 },     { 2, -1, -1, 0, 57066, -152138 },
+            { 2, 0, 1, 0, 53322, -170733 },     { 2, -1, 0, 0, 45758, -204586 },
+            { 0, 1, -1, 0, -40923, -129620 },   { 1, 0, 0, 0, -34720, 108743 },
+            { 0, 1, 1, 0, -30383, 104755 },     { 2, 0, 0, -2, 15327, 10321 },
+            { 0, 0, 1, 2, -12528, 0 },          { 0, 0, 1, -2, 10980, 79661 },
+            { 4, 0, -1, 0, 10675, -34782 },     { 0, 0, 3, 0, 10034, -23210 },
+            { 4, 0, -2, 0, 8548, -21636 },      { 2, 1, -1, 0, -7888, 24208 },
+            { 2, 1, 0, 0, -6766, 30824 },       { 1, 0, -1, 0, -5163, -8379 },
+            { 1, 1, 0, 0, 4987, -16675 },       { 2, -1, 1, 0, 4036, -12831 },
+            { 2, 0, 2, 0, 3994, -10445 },       { 4, 0, 0, 0, 3861, -11650 },
+            { 2, 0, -3, 0, 3665, 14403 },       { 0, 1, -2, 0, -2689, -7003 },
+            { 2, 0, -1, 2, -2602, 0 },          { 2, -1, -2, 0, 2390, 10056 },
+            { 1, 0, 1, 0, -2348, 6322 },        { 2, -2, 0, 0, 2236, -9884 },
+        };
+        // Multiples of D, M, M', F; latitude (1e-6 deg) coefficients
+        static const int latitudeTerms[28][5] = {
+            { 0, 0, 0, 1, 5128122 }, { 0, 0, 1, 1, 280602 },  { 0, 0, 1, -1, 277693 }, { 2, 0, 0, -1, 173237 },
+            { 2, 0, -1, 1, 55413 },  { 2, 0, -1, -1, 46271 }, { 2, 0, 0, 1, 32573 },   { 0, 0, 2, 1, 17198 },
+            { 2, 0, 1, -1, 9266 },   { 0, 0, 2, -1, 8822 },   { 2, -1, 0, -1, 8216 },  { 2, 0, -2, -1, 4324 },
+            { 2, 0, 1, 1, 4200 },    { 2, 1, 0, -1, -3359 },  { 2, -1, -1, 1, 2463 },  { 2, -1, 0, 1, 2211 },
+            { 2, -1, -1, -1, 2065 }, { 0, 1, -1, -1, -1870 }, { 4, 0, -1, -1, 1828 },  { 0, 1, 0, 1, -1794 },
+            { 0, 0, 0, 3, -1749 },   { 0, 1, -1, 1, -1565 },  { 1, 0, 0, 1, -1491 },   { 0, 1, 1, 1, -1475 },
+            { 0, 1, 1, -1, -1410 },  { 0, 1, 0, -1, -1344 },  { 1, 0, 0, -1, -1335 },  { 0, 0, 3, 1, 1107 },
+        };
+
+        const double T = days / 36525.0;
+        const double T2 = T * T, T3 = T2 * T, T4 = T3 * T;
+        const double Lp = (218.3164477 + 481267.88123421 * T - 0.0015786 * T2 + T3 / 538841.0 - T4 / 65194000.0) * DEG_TO_RAD;
+        const double D = (297.8501921 + 445267.1114034 * T - 0.0018819 * T2 + T3 / 545868.0 - T4 / 113065000.0) * DEG_TO_RAD;
+        const double M = (357.5291092 + 35999.0502909 * T - 0.0001536 * T2 + T3 / 24490000.0) * DEG_TO_RAD;
+        const double Mp = (134.9633964 + 477198.8675055 * T + 0.0087414 * T2 + T3 / 69699.0 - T4 / 14712000.0) * DEG_TO_RAD;
+        const double F = (93.2720950 + 483202.0175233 * T - 0.0036539 * T2 - T3 / 3526000.0 + T4 / 863310000.0) * DEG_TO_RAD;
+        const double A1 = (119.75 + 131.849 * T) * DEG_TO_RAD;
+        const double A2 = (53.09 + 479264.290 * T) * DEG_TO_RAD;
+        const double A3 = (313.45 + 481266.484 * T) * DEG_TO_RAD;
+        // Terms with the sun's anomaly shrink with the earth's eccentricity
+        const double E = 1.0 - 0.002516 * T - 0.0000074 * T2;
+        const double eccentricityFactor[3] = { 1.0, E, E * E };
+
+        double sumL = 3958.0 * std::sin(A1) + 1962.0 * std::sin(Lp - F) + 318.0 * std::sin(A2);
+        double sumR = 0.0;
+        for (int i = 0; i < 32; i++) {
+            const int* t = longitudeTerms[i];
+            const double argument = t[0] * D + t[1] * M + t[2] * Mp + t[3] * F;
+            const double factor = eccentricityFactor[t[1] < 0 ? -t[1] : t[1]];
+            sumL += factor * t[4] * std::sin(argument);
+            sumR += factor * t[5] * std::cos(argument);
+        }
+        double sumB = -2235.0 * std::sin(Lp) + 382.0 * std::sin(A3) + 175.0 * std::sin(A1 - F) +
+                      175.0 * std::sin(A1 + F) + 127.0 * std::sin(Lp - Mp) - 115.0 * std::sin(Lp + Mp);
+        for (int i = 0; i < 28; i++) {
+            const int* t = latitudeTerms[i];
+            const double argument = t[0] * D + t[1] * M + t[2] * Mp + t[3] * F;
+            sumB += eccentricityFactor[t[1] < 0 ? -t[1] : t[1]] * t[4] * std::sin(argument);
+        }
+
+        const double longitude = Lp + sumL * 1e-6 * DEG_TO_RAD;
+        const double latitude = sumB * 1e-6 * DEG_TO_RAD;
+        const double distance = (385000.56 + sumR * 1e-3) / KM_PER_AU;
+        const double ofDate[3] = { distance * std::cos(latitude) * std::cos(longitude),
+                                   distance * std::cos(latitude) * std::sin(longitude),
+                                   distance * std::sin(latitude) };
+        precessToJ2000(T, ofDate, position);
+    }
+
+    /**
+     * @brief Rotates ecliptic coordinates of date to the J2000 ecliptic (Meeus 21.5, 21.6)
+     */
+    static void precessToJ2000(double T, const double ofDate[3], double j2000[3]) {
+        const double arcsecond = DEG_TO_RAD / 3600.0;
+        const double eta = (47.0029 - 0.03302 * T + 0.000060 * T * T) * T * arcsecond;
+        const double Pi = 174.876384 * DEG_TO_RAD + (-869.8089 * T + 0.03536 * T * T) * arcsecond;
+        const double p = (5029.0966 + 1.11113 * T - 0.000006 * T * T) * T * arcsecond;
+        // Columns of the J2000 -> date rotation are the images of the J2000 axes; apply its transpose
+        double rotation[3][3];
+        for (int axis = 0; axis < 3; axis++) {
+            double v[3] = { 0.0, 0.0, 0.0 };
+            v[axis] = 1.0;
+            const double lambda0 = std::atan2(v[1], v[0]);
+            const double beta0 = std::asin(v[2]);
+            const double a = std::cos(eta) * std::cos(beta0) * std::sin(Pi - lambda0) - std::sin(eta) * std::sin(beta0);
+            const double b = std::cos(beta0) * std::cos(Pi - lambda0);
+            const double c = std::cos(eta) * std::sin(beta0) + std::sin(eta) * std::cos(beta0) * std::sin(Pi - lambda0);
+            const double lambda = p + Pi - std::atan2(a, b);
+            const double beta = std::asin(c);
+            rotation[0][axis] = std::cos(beta) * std::cos(lambda);
+            rotation[1][axis] = std::cos(beta) * std::sin(lambda);
+            rotation[2][axis] = std::sin(beta);
+        }
+        for (int k = 0; k < 3; k++)
+            j2000[k] = rotation[0][k] * ofDate[0] + rotation[1][k] * ofDate[1] + rotation[2][k] * ofDate[2];
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_SKYEPHEMERIS_HPP_
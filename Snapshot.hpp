@@ -0,0 +1,307 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_SNAPSHOT_HPP_
+#define INCLUDE_SOLAR_SYSTEM_SNAPSHOT_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+/**
+ * @brief Full simulation state as plain data, independent of the classes it came from
+ */
+struct SimulationSnapshot {
+    static const std::uint32_t NBODY_MODE = 1;
+    static const std::uint32_t DEBRIS_MODE = 2;
+
+    // Clock
+    double startDays;
+    std::int64_t ticks;
+    double tickFraction;
+    std::int64_t steps;
+    double warp;
+
+    std::uint32_t flags;
+
+    // Camera
+    float cameraPosition[3];
+    float cameraYaw, cameraPitch, cameraZoom;
+
+    // N-body state, empty when the analytic orbits are running
+    double nbodyTime;
+    std::vector<double> x, y, z, vx, vy, vz, gm;
+
+    SimulationSnapshot()
+        : startDays(0.0), ticks(0), tickFraction(0.0), steps(0), warp(1.0), flags(0),
+          cameraYaw(0.0f), cameraPitch(0.0f), cameraZoom(0.0f), nbodyTime(0.0) {
+        cameraPosition[0] = cameraPosition[1] = cameraPosition[2] = 0.0f;
+    }
+
+    std::size_t bodyCount() const { return x.size(); }
+};
+
+/**
+ * @brief Binary snapshot file: a fixed header followed by seven double arrays.
+ *
+ * Every array starts on a 64 byte boundary, so a mapped file can be copied into place
+ * with one memcpy per array. Files are written little-endian as the host lays them out.
+ */
+class SnapshotFile {
+public:
+    static const std::uint32_t VERSION = 1;
+
+    /**
+     * @brief Writes the snapshot to path + ".tmp" and renames it over path once complete
+     */
+    static bool write(const std::string& path, const SimulationSnapshot& snapshot) {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = VERSION;
+        header.headerSize = sizeof(Header);
+        header.bodyCount = snapshot.bodyCount();
+        header.startDays = snapshot.startDays;
+        header.ticks = snapshot.ticks;
+        header.tickFraction = snapshot.tickFraction;
+        header.steps = snapshot.steps;
+        header.warp = snapshot.warp;
+        header.nbodyTime = snapshot.nbodyTime;
+        header.flags = snapshot.flags;
+        std::memcpy(header.cameraPosition, snapshot.cameraPosition, sizeof(header.cameraPosition));
+        header.cameraYaw = snapshot.cameraYaw;
+        header.cameraPitch = snapshot.cameraPitch;
+        header.cameraZoom = snapshot.cameraZoom;
+
+        std::string temporary = path + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (file == NULL)
+            return false;
+
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        const std::vector<double>* arrays[ARRAYS] = {
+            &snapshot.x, &snapshot.y, &snapshot.z, &snapshot.vx, &snapshot.vy, &snapshot.vz, &snapshot.gm
+        };
+        static const char padding[ALIGNMENT] = { 0 };
+        std::size_t offset = sizeof(header);
+        for (int a = 0; a < ARRAYS && ok; a++) {
+            std::size_t aligned = alignUp(offset);
+            ok = std::fwrite(padding, 1, aligned - offset, file) == aligned - offset;
+            std::size_t count = arrays[a]->size();
+            ok = ok && (count == 0 || std::fwrite(arrays[a]->data(), sizeof(double), count, file) == count);
+            offset = aligned + count * sizeof(double);
+        }
+        ok = std::fclose(file) == 0 && ok;
+
+        if (ok) {
+#if defined(_WIN32)
+            // rename() only replaces existing files atomically on POSIX
+            std::remove(path.c_str());
+#endif
+            ok = std::rename(temporary.c_str(), path.c_str()) == 0;
+        }
+        if (!ok)
+            std::remove(temporary.c_str());
+        return ok;
+    }
+
+    /**
+     * @brief Maps a snapshot and copies it into snapshot, false if the file is missing or invalid
+     */
+    static bool read(const std::string& path, SimulationSnapshot& snapshot) {
+        MappedFile file;
+        if (!file.open(path))
+            return false;
+        if (file.size() < sizeof(Header)) {
+            std::cerr << "Snapshot is truncated: " << path << std::endl;
+            return false;
+        }
+
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, magic(), sizeof(header.magic)) != 0 || header.version != VERSION ||
+            header.headerSize != sizeof(Header)) {
+            std::cerr << "Not a snapshot of this version: " << path << std::endl;
+            return false;
+        }
+
+        // A count the file cannot hold would overflow the offsets below
+        if (header.bodyCount > file.size() / (ARRAYS * sizeof(double))) {
+            std::cerr << "Snapshot is truncated: " << path << std::endl;
+            return false;
+        }
+        const std::size_t n = static_cast<std::size_t>(header.bodyCount);
+        std::size_t offset = sizeof(header);
+        for (int a = 0; a < ARRAYS; a++)
+            offset = alignUp(offset) + n * sizeof(double);
+        if (offset > file.size()) {
+            std::cerr << "Snapshot is truncated: " << path << std::endl;
+            return false;
+        }
+
+        snapshot.startDays = header.startDays;
+        snapshot.ticks = header.ticks;
+        snapshot.tickFraction = header.tickFraction;
+        snapshot.steps = header.steps;
+        snapshot.warp = header.warp;
+        snapshot.nbodyTime = header.nbodyTime;
+        snapshot.flags = header.flags;
+        std::memcpy(snapshot.cameraPosition, header.cameraPosition, sizeof(header.cameraPosition));
+        snapshot.cameraYaw = header.cameraYaw;
+        snapshot.cameraPitch = header.cameraPitch;
+        snapshot.cameraZoom = header.cameraZoom;
+
+        std::vector<double>* arrays[ARRAYS] = {
+            &snapshot.x, &snapshot.y, &snapshot.z, &snapshot.vx, &snapshot.vy, &snapshot.vz, &snapshot.gm
+        };
+        offset = sizeof(header);
+        for (int a = 0; a < ARRAYS; a++) {
+            offset = alignUp(offset);
+            const double* values = reinterpret_cast<const double*>(file.data() + offset);
+            arrays[a]->assign(values, values + n);
+            offset += n * sizeof(double);
+        }
+        return true;
+    }
+
+private:
+    static const int ARRAYS = 7;
+    static const std::size_t ALIGNMENT = 64;
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::uint64_t bodyCount;
+        double startDays;
+        std::int64_t ticks;
+        double tickFraction;
+        std::int64_t steps;
+        double warp;
+        double nbodyTime;
+        std::uint32_t flags;
+        float cameraPosition[3];
+        float cameraYaw, cameraPitch, cameraZoom;
+        std::uint32_t reserved;
+    };
+
+    static const char* magic() {
+        return "SOLSNAP";   // 8 bytes with the terminator
+    }
+
+    static std::size_t alignUp(std::size_t offset) {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+};
+
+/**
+ * @brief Writes snapshots on a background thread.
+ *
+ * The render thread fills the snapshot returned by capture() (its vectors keep their
+ * capacity, so repeated captures do not allocate) and hands it over with submit(). If a
+ * write is still running, the newer snapshot waits in a single slot and an older waiting
+ * one is dropped.
+ */
+class SnapshotWriter {
+public:
+    SnapshotWriter() : p_Stop(false), p_Pending(false), p_Writing(false), p_Written(0), p_Failed(0) {
+        p_Thread = std::thread(&SnapshotWriter::run, this);
+    }
+
+    ~SnapshotWriter() {
+        {
+            std::lock_guard<std::mutex> lock(p_Mutex);
+            p_Stop = true;
+        }
+        p_WakeUp.notify_one();
+        p_Thread.join();
+    }
+
+    /**
+     * @brief Snapshot to fill on the calling thread before submit()
+     */
+    SimulationSnapshot& capture() {
+        return p_Capture;
+    }
+
+    /**
+     * @brief Queues the captured snapshot for writing to path
+     */
+    void submit(const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(p_Mutex);
+            std::swap(p_Capture, p_Queued);
+            p_QueuedPath = path;
+            p_Pending = true;
+        }
+        p_WakeUp.notify_one();
+    }
+
+    /**
+     * @brief True while a snapshot is queued or being written
+     */
+    bool busy() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        return p_Pending || p_Writing;
+    }
+
+    unsigned long written() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        return p_Written;
+    }
+
+    unsigned long failed() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        return p_Failed;
+    }
+
+private:
+    std::thread p_Thread;
+    std::mutex p_Mutex;
+    std::condition_variable p_WakeUp;
+    bool p_Stop;
+    bool p_Pending;
+    bool p_Writing;
+    unsigned long p_Written;
+    unsigned long p_Failed;
+
+    // Filled by the render thread, waiting for the writer, being written
+    SimulationSnapshot p_Capture;
+    SimulationSnapshot p_Queued;
+    SimulationSnapshot p_InFlight;
+    std::string p_QueuedPath;
+
+    void run() {
+        for (;;) {
+            std::string path;
+            {
+                std::unique_lock<std::mutex> lock(p_Mutex);
+                p_WakeUp.wait(lock, [this] { return p_Stop || p_Pending; });
+                if (!p_Pending)
+                    return;
+                std::swap(p_Queued, p_InFlight);
+                path = p_QueuedPath;
+                p_Pending = false;
+                p_Writing = true;
+            }
+
+            bool ok = SnapshotFile::write(path, p_InFlight);
+
+            std::lock_guard<std::mutex> lock(p_Mutex);
+            p_Writing = false;
+            if (ok)
+                p_Written++;
+            else
+                p_Failed++;
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_SNAPSHOT_HPP_
@@ -0,0 +1,417 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_SPKKERNEL_HPP_
+#define INCLUDE_SOLAR_SYSTEM_SPKKERNEL_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Kepler.hpp"
+#include "MappedFile.hpp"
+#include "Simd.hpp"
+
+const double KM_PER_AU = 149597870.7;
+// Mean obliquity of the ecliptic at J2000 (IAU 1976)
+const double J2000_OBLIQUITY = 84381.448 / 3600.0 * DEG_TO_RAD;
+
+// NAIF ids used by the DE4xx kernels
+const int NAIF_SSB = 0;
+const int NAIF_SUN = 10;
+const int NAIF_EARTH = 399;
+const int NAIF_MOON = 301;
+
+/**
+ * @brief Reader for JPL SPK kernels (DE440, DE440s, ...) holding Chebyshev segments.
+ *
+ * The kernel is memory mapped and only the DAF summary records are parsed on open(), so
+ * startup does not depend on the kernel size. Segments of type 2 (position coefficients)
+ * and type 3 (position and velocity coefficients) are supported; their records have a
+ * fixed length, so the record for a time is found by index arithmetic.
+ *
+ * Times are TDB days since J2000. Results are in AU and AU / day, rotated from ICRF to
+ * the J2000 ecliptic used by Kepler.hpp. Batched queries evaluate simd::DOUBLE_WIDTH
+ * times or bodies per register.
+ */
+class SpkKernel {
+public:
+    static const int LANES = simd::DOUBLE_WIDTH;
+
+    SpkKernel() {}
+
+    explicit SpkKernel(const std::string& path) {
+        open(path);
+    }
+
+    /**
+     * @brief Maps the kernel and reads its segment table, returns false on failure
+     */
+    bool open(const std::string& path) {
+        p_Segments.clear();
+        if (!p_File.open(path)) {
+            std::cerr << "SPK kernel could not be opened: " << path << std::endl;
+            return false;
+        }
+        if (!readSegments()) {
+            std::cerr << "Not a valid little-endian SPK kernel: " << path << std::endl;
+            p_File.close();
+            p_Segments.clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool isOpen() const { return p_File.isOpen(); }
+    std::size_t segmentCount() const { return p_Segments.size(); }
+
+    /**
+     * @brief True if some segment has the body as its target
+     */
+    bool hasBody(int target) const {
+        for (std::size_t i = 0; i < p_Segments.size(); i++) {
+            if (p_Segments[i].target == target)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Position and velocity of target relative to center, false if not covered
+     */
+    bool state(int target, int center, double days, double position[3], double velocity[3]) const {
+        double x, y, z, vx, vy, vz;
+        const int targets[1] = { target };
+        const double times[1] = { days };
+        if (!evaluate(1, targets, center, times, &x, &y, &z, &vx, &vy, &vz))
+            return false;
+        position[0] = x; position[1] = y; position[2] = z;
+        velocity[0] = vx; velocity[1] = vy; velocity[2] = vz;
+        return true;
+    }
+
+    /**
+     * @brief Positions of one body at n times, NaN where the kernel has no data
+     */
+    void positions(int target, int center, std::size_t n, const double* days,
+                   double* x, double* y, double* z) const {
+        int targets[LANES];
+        for (int l = 0; l < LANES; l++)
+            targets[l] = target;
+        double vx[LANES], vy[LANES], vz[LANES];
+        for (std::size_t i = 0; i < n; i += LANES) {
+            std::size_t lanes = n - i < LANES ? n - i : LANES;
+            evaluate(lanes, targets, center, days + i, x + i, y + i, z + i, vx, vy, vz);
+        }
+    }
+
+    /**
+     * @brief Positions of n bodies at one time, NaN where the kernel has no data
+     */
+    void positions(std::size_t n, const int* targets, int center, double days,
+                   double* x, double* y, double* z) const {
+        double times[LANES];
+        for (int l = 0; l < LANES; l++)
+            times[l] = days;
+        double vx[LANES], vy[LANES], vz[LANES];
+        for (std::size_t i = 0; i < n; i += LANES) {
+            std::size_t lanes = n - i < LANES ? n - i : LANES;
+            evaluate(lanes, targets + i, center, times, x + i, y + i, z + i, vx, vy, vz);
+        }
+    }
+
+private:
+    struct Segment {
+        int target, center, frame, type;
+        double start, end;          // coverage in TDB seconds past J2000
+        const double* words;        // first word of the segment
+        double init, interval;      // start and length of the first record
+        std::size_t recordSize, records;
+        int coefficients;           // per component
+    };
+
+    MappedFile p_File;
+    std::vector<Segment> p_Segments;
+
+    bool readSegments() {
+        const unsigned char* file = p_File.data();
+        if (p_File.size() < 1024 || std::memcmp(file + 88, "LTL-IEEE", 8) != 0)
+            return false;
+        if (std::memcmp(file, "DAF/SPK ", 8) != 0 && std::memcmp(file, "NAIF/DAF", 8) != 0)
+            return false;
+
+        std::int32_t nd, ni, forward;
+        std::memcpy(&nd, file + 8, 4);
+        std::memcpy(&ni, file + 12, 4);
+        std::memcpy(&forward, file + 76, 4);
+        if (nd != 2 || ni != 6)
+            return false;
+        const std::size_t summarySize = nd + (ni + 1) / 2;
+
+        // Summary records form a linked list of 1024 byte records, numbered from 1; a list
+        // longer than the file has records must loop
+        const std::size_t records = p_File.size() / 1024;
+        std::size_t record;
+        if (!wordIndex(forward, records, record))
+            return false;
+        for (std::size_t visited = 0; record > 0; visited++) {
+            if (visited == records)
+                return false;
+            const double* words = reinterpret_cast<const double*>(file + (record - 1) * 1024);
+            std::size_t count;
+            if (!wordIndex(words[2], (128 - 3) / summarySize, count) || !wordIndex(words[0], records, record))
+                return false;
+            for (std::size_t k = 0; k < count; k++) {
+                const double* summary = words + 3 + k * summarySize;
+                std::int32_t ints[6];
+                std::memcpy(ints, summary + 2, sizeof(ints));
+                addSegment(summary[0], summary[1], ints);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Converts a count or address read from the file, false unless it is a whole number in [0, limit]
+     */
+    static bool wordIndex(double value, std::size_t limit, std::size_t& index) {
+        if (!(value >= 0.0 && value <= static_cast<double>(limit) && value == std::floor(value)))
+            return false;
+        index = static_cast<std::size_t>(value);
+        return true;
+    }
+
+    void addSegment(double start, double end, const std::int32_t ints[6]) {
+        Segment segment;
+        segment.target = ints[0];
+        segment.center = ints[1];
+        segment.frame = ints[2];
+        segment.type = ints[3];
+        segment.start = start;
+        segment.end = end;
+
+        // Only ICRF (1) and ECLIPJ2000 (17) frames with Chebyshev data
+        if ((segment.type != 2 && segment.type != 3) || (segment.frame != 1 && segment.frame != 17))
+            return;
+        std::size_t first, last;
+        const std::size_t words = p_File.size() / 8;
+        if (!wordIndex(ints[4], words, first) || !wordIndex(ints[5], words, last) || first < 1 || last < first + 4)
+            return;
+
+        // Addresses count doubles from 1, the directory sits in the last four words
+        segment.words = reinterpret_cast<const double*>(p_File.data()) + (first - 1);
+        const double* directory = reinterpret_cast<const double*>(p_File.data()) + (last - 4);
+        segment.init = directory[0];
+        segment.interval = directory[1];
+        const std::size_t length = last - first + 1 - 4;
+        const std::size_t components = segment.type == 2 ? 3 : 6;
+        if (!wordIndex(directory[2], length, segment.recordSize) || segment.recordSize < 2 + components ||
+            !wordIndex(directory[3], length / segment.recordSize, segment.records))
+            return;
+        segment.coefficients = static_cast<int>((segment.recordSize - 2) / components);
+        p_Segments.push_back(segment);
+    }
+
+    const Segment* findSegment(int target, double seconds) const {
+        for (std::size_t i = 0; i < p_Segments.size(); i++) {
+            const Segment& segment = p_Segments[i];
+            if (segment.target == target && seconds >= segment.start && seconds <= segment.end)
+                return &segment;
+        }
+        return NULL;
+    }
+
+    /**
+     * @brief States of up to LANES (target, time) pairs relative to center
+     *
+     * Each target is chained through its segment centres down to the solar system
+     * barycentre, and the same chain for center is subtracted.
+     */
+    bool evaluate(std::size_t lanes, const int* targets, int center, const double* days,
+                  double* x, double* y, double* z, double* vx, double* vy, double* vz) const {
+        double seconds[LANES];
+        int body[LANES];
+        bool covered = true;
+        for (std::size_t l = 0; l < lanes; l++) {
+            seconds[l] = days[l] * SECONDS_PER_DAY;
+            x[l] = y[l] = z[l] = vx[l] = vy[l] = vz[l] = 0.0;
+        }
+
+        for (int pass = 0; pass < 2; pass++) {
+            double sign = pass == 0 ? 1.0 : -1.0;
+            for (std::size_t l = 0; l < lanes; l++)
+                body[l] = pass == 0 ? targets[l] : center;
+
+            // DE kernels chain at most three segments, the bound stops malformed loops
+            for (int depth = 0; depth < 8; depth++) {
+                const Segment* segments[LANES];
+                bool any = false;
+                for (std::size_t l = 0; l < lanes; l++) {
+                    segments[l] = NULL;
+                    if (body[l] == NAIF_SSB)
+                        continue;
+                    segments[l] = findSegment(body[l], seconds[l]);
+                    if (segments[l] == NULL) {
+                        x[l] = y[l] = z[l] = vx[l] = vy[l] = vz[l] = std::numeric_limits<double>::quiet_NaN();
+                        covered = false;
+                        body[l] = NAIF_SSB;
+                        continue;
+                    }
+                    body[l] = segments[l]->center;
+                    any = true;
+                }
+                if (!any)
+                    break;
+                accumulate(lanes, segments, seconds, sign, x, y, z, vx, vy, vz);
+            }
+        }
+        return covered;
+    }
+
+    /**
+     * @brief Adds sign times the Chebyshev state of each lane's segment, skipping NULL segments
+     */
+    static void accumulate(std::size_t lanes, const Segment* const* segments, const double* seconds, double sign,
+                           double* x, double* y, double* z, double* vx, double* vy, double* vz) {
+        // Per lane record set up, velocity of type 2 comes from the derivative of the position series
+        const double* record[LANES];
+        double s[LANES], derivativeScale[LANES];
+        int coefficients[LANES], components[LANES];
+        int maxCoefficients = 0;
+        for (std::size_t l = 0; l < LANES; l++) {
+            record[l] = NULL;
+            s[l] = derivativeScale[l] = 0.0;
+            coefficients[l] = components[l] = 0;
+            const Segment* segment = l < lanes ? segments[l] : NULL;
+            if (segment == NULL)
+                continue;
+            double offset = (seconds[l] - segment->init) / segment->interval;
+            std::size_t index = offset > 0.0 ? static_cast<std::size_t>(offset) : 0;
+            if (index >= segment->records)
+                index = segment->records - 1;
+            record[l] = segment->words + index * segment->recordSize;
+            double radius = record[l][1];
+            s[l] = (seconds[l] - record[l][0]) / radius;
+            derivativeScale[l] = segment->type == 2 ? 1.0 / radius : 0.0;
+            coefficients[l] = segment->coefficients;
+            components[l] = segment->type == 2 ? 3 : 6;
+            if (coefficients[l] > maxCoefficients)
+                maxCoefficients = coefficients[l];
+        }
+
+        // Sums of c_k T_k(s) for six components and of c_k T_k'(s) for the first three
+        double value[6][LANES], slope[3][LANES];
+        chebyshev(maxCoefficients, record, coefficients, components, s, value, slope);
+
+        for (std::size_t l = 0; l < lanes; l++) {
+            if (record[l] == NULL)
+                continue;
+            double p[3], v[3];
+            for (int c = 0; c < 3; c++) {
+                p[c] = value[c][l] / KM_PER_AU;
+                v[c] = (slope[c][l] * derivativeScale[l] + value[c + 3][l]) * (SECONDS_PER_DAY / KM_PER_AU);
+            }
+            if (segments[l]->frame == 1) {
+                toEcliptic(p);
+                toEcliptic(v);
+            }
+            x[l] += sign * p[0]; y[l] += sign * p[1]; z[l] += sign * p[2];
+            vx[l] += sign * v[0]; vy[l] += sign * v[1]; vz[l] += sign * v[2];
+        }
+    }
+
+    /**
+     * @brief Chebyshev series of all lanes at once, lanes without a record or past their degree add zero
+     *
+     * Coefficients of component c sit at record[2 + c * coefficients + k].
+     */
+    static void chebyshev(int maxCoefficients, const double* const* record, const int* coefficients,
+                          const int* components, const double* s, double value[6][LANES], double slope[3][LANES]) {
+        double c[6][LANES];
+#if defined(SOLAR_SYSTEM_SIMD)
+        using namespace simd;
+        const vdouble sv = load(s);
+        const vdouble twoS = add(sv, sv);
+        const vdouble two = set1d(2.0);
+        vdouble t0 = set1d(1.0), t1 = sv;         // T_{k-2}, T_{k-1}
+        vdouble d0 = set1d(0.0), d1 = set1d(1.0); // T'_{k-2}, T'_{k-1}
+        vdouble sum[6], sumSlope[3];
+        for (int j = 0; j < 6; j++)
+            sum[j] = set1d(0.0);
+        for (int j = 0; j < 3; j++)
+            sumSlope[j] = set1d(0.0);
+
+        for (int k = 0; k < maxCoefficients; k++) {
+            gatherCoefficients(k, record, coefficients, components, c);
+            vdouble t, d;
+            if (k == 0) {
+                t = set1d(1.0); d = set1d(0.0);
+            } else if (k == 1) {
+                t = sv; d = set1d(1.0);
+            } else {
+                t = sub(mul(twoS, t1), t0);
+                d = sub(fmadd(two, t1, mul(twoS, d1)), d0);
+                t0 = t1; t1 = t;
+                d0 = d1; d1 = d;
+            }
+            for (int j = 0; j < 6; j++)
+                sum[j] = fmadd(load(c[j]), t, sum[j]);
+            for (int j = 0; j < 3; j++)
+                sumSlope[j] = fmadd(load(c[j]), d, sumSlope[j]);
+        }
+        for (int j = 0; j < 6; j++)
+            store(value[j], sum[j]);
+        for (int j = 0; j < 3; j++)
+            store(slope[j], sumSlope[j]);
+#else
+        for (int l = 0; l < LANES; l++) {
+            double t0 = 1.0, t1 = s[l], d0 = 0.0, d1 = 1.0;
+            for (int j = 0; j < 6; j++)
+                value[j][l] = 0.0;
+            for (int j = 0; j < 3; j++)
+                slope[j][l] = 0.0;
+            for (int k = 0; k < maxCoefficients; k++) {
+                gatherCoefficients(k, record, coefficients, components, c);
+                double t = k == 0 ? 1.0 : s[l], d = k == 0 ? 0.0 : 1.0;
+                if (k > 1) {
+                    t = 2.0 * s[l] * t1 - t0;
+                    d = 2.0 * t1 + 2.0 * s[l] * d1 - d0;
+                    t0 = t1; t1 = t;
+                    d0 = d1; d1 = d;
+                }
+                for (int j = 0; j < 6; j++)
+                    value[j][l] += c[j][l] * t;
+                for (int j = 0; j < 3; j++)
+                    slope[j][l] += c[j][l] * d;
+            }
+        }
+#endif
+    }
+
+    static void gatherCoefficients(int k, const double* const* record, const int* coefficients,
+                                   const int* components, double c[6][LANES]) {
+        for (int l = 0; l < LANES; l++) {
+            int n = coefficients[l];
+            int j = 0;
+            if (record[l] != NULL && k < n) {
+                for (; j < components[l]; j++)
+                    c[j][l] = record[l][2 + j * n + k];
+            }
+            // Type 2 records have no velocity series, those terms stay zero
+            for (; j < 6; j++)
+                c[j][l] = 0.0;
+        }
+    }
+
+    static void toEcliptic(double v[3]) {
+        const double c = std::cos(J2000_OBLIQUITY), s = std::sin(J2000_OBLIQUITY);
+        double y = c * v[1] + s * v[2];
+        double z = -s * v[1] + c * v[2];
+        v[1] = y;
+        v[2] = z;
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_SPKKERNEL_HPP_
@@ -0,0 +1,139 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_THREADPOOL_HPP_
+#define INCLUDE_SOLAR_SYSTEM_THREADPOOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads for data parallel loops.
+ *
+ * parallelFor() splits a range into chunks that the workers and the calling thread
+ * pull from a shared counter, and returns once all chunks are done. Calls made from
+ * inside a running loop execute inline instead of deadlocking on the pool.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param[in] threads total threads including the caller, 0 uses every hardware thread
+     */
+    explicit ThreadPool(unsigned int threads = 0) : p_Stop(false), p_Generation(0), p_Active(0) {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+
+        for (unsigned int i = 1; i < threads; i++)
+            p_Workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(p_Mutex);
+            p_Stop = true;
+        }
+        p_WakeUp.notify_all();
+        for (std::size_t i = 0; i < p_Workers.size(); i++)
+            p_Workers[i].join();
+    }
+
+    /**
+     * @brief Number of threads that take part in a loop, including the caller
+     */
+    unsigned int size() const {
+        return static_cast<unsigned int>(p_Workers.size() + 1);
+    }
+
+    /**
+     * @brief Calls body(chunkBegin, chunkEnd) for chunks of at most grain elements covering [begin, end)
+     */
+    void parallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                     const std::function<void(std::size_t, std::size_t)>& body) {
+        if (end <= begin)
+            return;
+        if (grain == 0)
+            grain = 1;
+
+        if (p_Workers.empty() || insideLoop() || end - begin <= grain) {
+            body(begin, end);
+            return;
+        }
+
+        // One loop at a time, other callers queue up here
+        std::lock_guard<std::mutex> submit(p_SubmitMutex);
+        {
+            std::lock_guard<std::mutex> lock(p_Mutex);
+            p_Body = &body;
+            p_Begin = begin;
+            p_End = end;
+            p_Grain = grain;
+            p_Next.store(begin);
+            p_Active = p_Workers.size();
+            p_Generation++;
+        }
+        p_WakeUp.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(p_Mutex);
+        p_Done.wait(lock, [this] { return p_Active == 0; });
+        p_Body = NULL;
+    }
+
+private:
+    std::vector<std::thread> p_Workers;
+    std::mutex p_Mutex;
+    std::mutex p_SubmitMutex;
+    std::condition_variable p_WakeUp;
+    std::condition_variable p_Done;
+    bool p_Stop;
+    unsigned long p_Generation;
+    std::size_t p_Active;
+
+    // Current loop
+    const std::function<void(std::size_t, std::size_t)>* p_Body;
+    std::size_t p_Begin, p_End, p_Grain;
+    std::atomic<std::size_t> p_Next;
+
+    static bool& insideLoop() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    void runChunks() {
+        insideLoop() = true;
+        for (;;) {
+            std::size_t chunk = p_Next.fetch_add(p_Grain);
+            if (chunk >= p_End)
+                break;
+            std::size_t chunkEnd = chunk + p_Grain < p_End ? chunk + p_Grain : p_End;
+            (*p_Body)(chunk, chunkEnd);
+        }
+        insideLoop() = false;
+    }
+
+    void workerLoop() {
+        unsigned long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(p_Mutex);
+                p_WakeUp.wait(lock, [this, seen] { return p_Stop || p_Generation != seen; });
+                if (p_Stop)
+                    return;
+                seen = p_Generation;
+            }
+
+            runChunks();
+
+            std::lock_guard<std::mutex> lock(p_Mutex);
+            if (--p_Active == 0)
+                p_Done.notify_one();
+        }
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_THREADPOOL_HPP_
@@ -0,0 +1,109 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_TIMEWARP_HPP_
+#define INCLUDE_SOLAR_SYSTEM_TIMEWARP_HPP_
+
+#include <cmath>
+
+// Time warp range in simulated seconds per wall-clock second, up to about two centuries a minute
+const double TIME_WARP_MIN = 1.0;
+const double TIME_WARP_MAX = 1e8;
+
+/**
+ * @brief Chooses the time warp and how much accuracy each frame can afford.
+ *
+ * The error side is handled by the integrator: with block timesteps every body picks its
+ * own number of sub-steps from its orbit, so a faster warp just means more sub-steps per
+ * fixed step. The controller watches the wall time the simulation takes per frame and,
+ * when it exceeds the budget, raises a degradation factor. stepScale() turns it into a
+ * timestep multiplier that grows with a body's distance, so far bodies lose accuracy
+ * first. If even the largest degradation does not fit, maxSteps() caps the fixed steps
+ * per frame and the simulation falls behind the wall clock instead of stalling the frame.
+ */
+class TimeWarpController {
+public:
+    static const int MAX_STEPS_PER_FRAME = 32;
+
+    /**
+     * @param[in] warp initial simulated seconds per wall-clock second
+     * @param[in] frameBudget wall-clock seconds the simulation may use per frame
+     * @param[in] maxDegradation largest timestep multiplier given to the farthest bodies
+     */
+    explicit TimeWarpController(double warp, double frameBudget = 0.008, double maxDegradation = 16.0)
+        : p_Warp(warp), p_FrameBudget(frameBudget), p_MaxDegradation(maxDegradation),
+          p_Degradation(1.0), p_StepCost(0.0), p_MaxSteps(MAX_STEPS_PER_FRAME) {
+        setWarp(warp);
+    }
+
+    void setWarp(double warp) {
+        double magnitude = std::fabs(warp);
+        magnitude = magnitude < TIME_WARP_MIN ? TIME_WARP_MIN : magnitude > TIME_WARP_MAX ? TIME_WARP_MAX : magnitude;
+        p_Warp = warp < 0.0 ? -magnitude : magnitude;
+    }
+
+    double getWarp() const { return p_Warp; }
+
+    /**
+     * @brief Multiplies or divides the warp by ten
+     */
+    void faster() { setWarp(p_Warp * 10.0); }
+    void slower() { setWarp(p_Warp / 10.0); }
+
+    void setFrameBudget(double seconds) { p_FrameBudget = seconds; }
+    double getFrameBudget() const { return p_FrameBudget; }
+
+    /**
+     * @brief Current degradation, 1 means full accuracy everywhere
+     */
+    double getDegradation() const { return p_Degradation; }
+
+    /**
+     * @brief Fixed steps the next frame may run
+     */
+    int maxSteps() const { return p_MaxSteps; }
+
+    /**
+     * @brief Timestep multiplier for a body
+     *
+     * @param[in] farness 0 for the nearest body, 1 for the farthest
+     */
+    double stepScale(double farness) const {
+        return 1.0 + (p_Degradation - 1.0) * farness * farness;
+    }
+
+    /**
+     * @brief Feeds back how long the last frame's simulation took
+     *
+     * @param[in] steps fixed steps that were run
+     * @param[in] seconds wall-clock seconds they took
+     */
+    void record(int steps, double seconds) {
+        if (steps <= 0)
+            return;
+
+        // Smoothed cost of one fixed step
+        double cost = seconds / steps;
+        p_StepCost = p_StepCost > 0.0 ? 0.8 * p_StepCost + 0.2 * cost : cost;
+
+        if (seconds > p_FrameBudget) {
+            p_Degradation = std::fmin(p_Degradation * 1.5, p_MaxDegradation);
+        } else if (seconds < 0.5 * p_FrameBudget) {
+            p_Degradation = std::fmax(p_Degradation / 1.2, 1.0);
+        }
+
+        // Out of accuracy to trade, so drop steps rather than frames
+        p_MaxSteps = MAX_STEPS_PER_FRAME;
+        if (p_Degradation >= p_MaxDegradation && p_StepCost > 0.0) {
+            int affordable = static_cast<int>(p_FrameBudget / p_StepCost);
+            p_MaxSteps = affordable < 1 ? 1 : affordable < MAX_STEPS_PER_FRAME ? affordable : MAX_STEPS_PER_FRAME;
+        }
+    }
+
+private:
+    double p_Warp;
+    double p_FrameBudget;
+    double p_MaxDegradation;
+    double p_Degradation;
+    double p_StepCost;      // smoothed wall seconds per fixed step
+    int p_MaxSteps;
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_TIMEWARP_HPP_
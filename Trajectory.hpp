@@ -0,0 +1,816 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_TRAJECTORY_HPP_
+#define INCLUDE_SOLAR_SYSTEM_TRAJECTORY_HPP_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "NBody.hpp"
+
+/**
+ * @brief On-disk layout shared by TrajectoryRecorder and TrajectoryReader.
+ *
+ * A trajectory file is a small header followed by chunks, each holding up to a few dozen
+ * consecutive steps of every body. A chunk starts with its header and the times of its
+ * steps, then an offset table, then six columns (x, y, z, vx, vy, vz). Each column is cut
+ * into groups of GROUP bodies, and a group stores each body's steps in order: the bit
+ * pattern of a value is extrapolated from the body's previous steps in the chunk as a
+ * 64-bit integer, and the zigzagged difference keeps only its non-zero low bytes, with the
+ * byte count in a nibble (the same scheme as RewindBuffer). Chunks never refer to each
+ * other, so any of them can be decoded alone, and a single body needs only its group.
+ *
+ * A sidecar file (path + ".index") lists every chunk's time span and offset, so readers
+ * find a time without touching the data. It is appended after each chunk and rebuilt by
+ * scanning the chunk headers if it is missing or behind.
+ */
+class TrajectoryFormat {
+public:
+    static const std::uint32_t VERSION = 1;
+    static const int COLUMNS = 6;
+    static const std::size_t GROUP = 256;
+    static const std::size_t MAX_STEPS = 64;     // length of the decoder's history
+
+    struct FileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+    };
+
+    struct ChunkHeader {
+        char magic[4];
+        std::uint32_t steps;
+        std::uint64_t bodies;
+        std::uint64_t bytes;        // whole chunk including this header
+        double firstDays;
+        double lastDays;
+    };
+
+    struct IndexEntry {
+        double firstDays;
+        double lastDays;
+        std::uint64_t offset;
+        std::uint32_t steps;
+        std::uint32_t reserved;
+    };
+
+    static const char* dataMagic() { return "SOLTRAJ"; }
+    static const char* indexMagic() { return "SOLTIDX"; }
+    static const char* chunkMagic() { return "TCHK"; }
+
+    static std::size_t groups(std::size_t bodies) {
+        return (bodies + GROUP - 1) / GROUP;
+    }
+
+    /**
+     * @brief Bodies in group g, GROUP except in the last one
+     */
+    static std::size_t groupBodies(std::size_t bodies, std::size_t g) {
+        const std::size_t rest = bodies - g * GROUP;
+        return rest < GROUP ? rest : GROUP;
+    }
+
+    /**
+     * @brief Bytes before the column data: chunk header, step times and the group offset table
+     */
+    static std::size_t prefixBytes(std::size_t steps, std::size_t bodies) {
+        return sizeof(ChunkHeader) + steps * sizeof(double) + (COLUMNS * groups(bodies) + 1) * sizeof(std::uint64_t);
+    }
+
+    /**
+     * @brief Bytes of the byte-count nibbles at the start of a group
+     */
+    static std::size_t nibbleBytes(std::size_t values) {
+        return (values + 1) / 2;
+    }
+
+    /**
+     * @brief Largest encoded size of one group
+     */
+    static std::size_t maxGroupBytes(std::size_t values) {
+        return nibbleBytes(values) + values * sizeof(double);
+    }
+
+    /**
+     * @brief Constant, linear or quadratic extrapolation from the previous steps of one body
+     */
+    static std::uint64_t predict(const std::uint64_t* history, std::size_t t) {
+        if (t == 0)
+            return 0;
+        if (t == 1)
+            return history[0];
+        if (t == 2)
+            return 2 * history[1] - history[0];
+        return 3 * history[t - 1] - 3 * history[t - 2] + history[t - 3];
+    }
+
+    /**
+     * @brief Encodes bodies [first, first + count) of a column stored as column[step * stride + body]
+     */
+    static unsigned char* encodeGroup(const double* column, std::size_t stride, std::size_t steps,
+                                      std::size_t first, std::size_t count, unsigned char* out) {
+        const std::size_t values = count * steps;
+        unsigned char* counts = out;
+        out += nibbleBytes(values);
+        std::memset(counts, 0, nibbleBytes(values));
+
+        std::uint64_t history[MAX_STEPS];
+        std::size_t v = 0;
+        for (std::size_t i = first; i < first + count; i++) {
+            for (std::size_t t = 0; t < steps; t++, v++) {
+                std::memcpy(&history[t], column + t * stride + i, sizeof(std::uint64_t));
+                std::uint64_t residual = history[t] - predict(history, t);
+                residual = (residual << 1) ^ (0 - (residual >> 63));
+
+                unsigned char bytes = 0;
+                while (residual != 0) {
+                    *out++ = static_cast<unsigned char>(residual);
+                    residual >>= 8;
+                    bytes++;
+                }
+                counts[v / 2] |= static_cast<unsigned char>(bytes << (4 * (v & 1)));
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief Decodes a group ending at limit into column[step * stride + body], or only body `only`
+     * into column[step * stride]
+     *
+     * The group must hold at least its nibbles and steps must not exceed MAX_STEPS, which the
+     * reader checks when it opens a chunk.
+     *
+     * @return false if a byte count is over 8 or runs past limit, the rest is left undecoded
+     */
+    static bool decodeGroup(const unsigned char* in, const unsigned char* limit, std::size_t steps,
+                            std::size_t first, std::size_t count, double* column, std::size_t stride,
+                            std::size_t only = SIZE_MAX) {
+        const std::size_t values = count * steps;
+        const unsigned char* counts = in;
+        in += nibbleBytes(values);
+
+        std::size_t begin = first, end = first + count, shift = 0;
+        std::size_t v = 0;
+        if (only != SIZE_MAX) {
+            // Skip the bytes of the bodies before it, their lengths are all in the nibbles
+            for (; v < (only - first) * steps; v++) {
+                const unsigned bytes = (counts[v / 2] >> (4 * (v & 1))) & 0xF;
+                if (bytes > sizeof(std::uint64_t) || static_cast<std::size_t>(limit - in) < bytes)
+                    return false;
+                in += bytes;
+            }
+            begin = shift = only;
+            end = only + 1;
+        }
+
+        std::uint64_t history[MAX_STEPS];
+        for (std::size_t i = begin; i < end; i++) {
+            for (std::size_t t = 0; t < steps; t++, v++) {
+                unsigned bytes = (counts[v / 2] >> (4 * (v & 1))) & 0xF;
+                if (bytes > sizeof(std::uint64_t) || static_cast<std::size_t>(limit - in) < bytes)
+                    return false;
+                std::uint64_t residual = 0;
+                for (unsigned b = 0; b < bytes; b++)
+                    residual |= static_cast<std::uint64_t>(*in++) << (8 * b);
+                residual = (residual >> 1) ^ (0 - (residual & 1));
+                history[t] = predict(history, t) + residual;
+                std::memcpy(column + t * stride + i - shift, &history[t], sizeof(double));
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Streams simulation states into a trajectory file from a background thread.
+ *
+ * record() copies a step into the chunk being filled and returns; full chunks are handed
+ * to the writer thread, which encodes and appends them. Memory is bounded by a fixed set
+ * of chunk buffers sized from the budget. When the writer falls behind and every buffer
+ * is waiting, steps are dropped and counted rather than blocking the caller. Systems too
+ * large for MIN_STEPS_PER_CHUNK steps in the budget only have their first maxBodies()
+ * bodies recorded.
+ */
+class TrajectoryRecorder {
+public:
+    static const std::size_t MAX_STEPS_PER_CHUNK = TrajectoryFormat::MAX_STEPS;
+    static const std::size_t MIN_STEPS_PER_CHUNK = 8;   // shorter chunks barely compress
+    static const std::size_t BUFFERS = 3;               // filling, queued, being written
+
+    /**
+     * @param[in] budgetBytes memory for the chunk buffers and the encoded chunk, sets how many
+     * steps a chunk holds and how many bodies fit
+     */
+    explicit TrajectoryRecorder(std::size_t budgetBytes = 96u << 20)
+        : p_Budget(budgetBytes), p_Data(NULL), p_Index(NULL), p_Offset(0), p_Stop(false), p_Filling(0),
+          p_Recorded(0), p_Dropped(0), p_Written(0), p_EncodedBytes(0), p_RawBytes(0), p_Failed(false) {
+        p_Buffers.resize(BUFFERS);
+        p_Queue.reserve(BUFFERS);
+        p_Free.reserve(BUFFERS);
+        p_Thread = std::thread(&TrajectoryRecorder::run, this);
+    }
+
+    ~TrajectoryRecorder() {
+        close();
+        {
+            std::lock_guard<std::mutex> lock(p_Mutex);
+            p_Stop = true;
+        }
+        p_WakeUp.notify_one();
+        p_Thread.join();
+    }
+
+    /**
+     * @brief Starts a new file at path, replacing an existing one
+     */
+    bool open(const std::string& path) {
+        close();
+        std::FILE* data = std::fopen(path.c_str(), "wb");
+        std::FILE* index = std::fopen((path + ".index").c_str(), "wb");
+        if (data == NULL || index == NULL) {
+            std::cerr << "Could not create trajectory file " << path << std::endl;
+            if (data != NULL)
+                std::fclose(data);
+            if (index != NULL)
+                std::fclose(index);
+            return false;
+        }
+
+        TrajectoryFormat::FileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.version = TrajectoryFormat::VERSION;
+        header.headerSize = sizeof(header);
+        std::memcpy(header.magic, TrajectoryFormat::dataMagic(), sizeof(header.magic));
+        std::fwrite(&header, sizeof(header), 1, data);
+        std::memcpy(header.magic, TrajectoryFormat::indexMagic(), sizeof(header.magic));
+        std::fwrite(&header, sizeof(header), 1, index);
+
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        p_Data = data;
+        p_Index = index;
+        p_Offset = sizeof(header);
+        p_Failed = false;
+        p_Recorded = p_Dropped = p_Written = 0;
+        p_EncodedBytes = p_RawBytes = 0;
+        p_Free.clear();
+        for (std::size_t b = 1; b < BUFFERS; b++)
+            p_Free.push_back(b);
+        p_Filling = 0;
+        p_Buffers[0].steps = 0;
+        return true;
+    }
+
+    bool isOpen() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        return p_Data != NULL;
+    }
+
+    /**
+     * @brief Appends a step, false if it was dropped because the writer is behind
+     *
+     * Times must increase; a change in the body count starts a new chunk. Bodies past
+     * maxBodies() are left out.
+     */
+    bool record(double days, std::size_t n, const double* x, const double* y, const double* z,
+                const double* vx, const double* vy, const double* vz) {
+        if (n > maxBodies())
+            n = maxBodies();
+        std::unique_lock<std::mutex> lock(p_Mutex);
+        if (p_Data == NULL || n == 0)
+            return false;
+
+        Chunk* chunk = &p_Buffers[p_Filling];
+        if (chunk->steps > 0 && (chunk->bodies != n || chunk->steps == chunk->capacity)) {
+            if (!submit()) {
+                p_Dropped++;
+                return false;
+            }
+            chunk = &p_Buffers[p_Filling];
+        }
+        lock.unlock();
+
+        // The filling buffer belongs to this thread until it is submitted
+        if (chunk->steps == 0)
+            chunk->reset(n, stepsPerChunk(n));
+        const double* arrays[TrajectoryFormat::COLUMNS] = { x, y, z, vx, vy, vz };
+        for (int c = 0; c < TrajectoryFormat::COLUMNS; c++)
+            std::memcpy(chunk->columns[c].data() + chunk->steps * n, arrays[c], n * sizeof(double));
+        chunk->days[chunk->steps++] = days;
+
+        lock.lock();
+        p_Recorded++;
+        return true;
+    }
+
+    bool record(const NBodySystem& nbody) {
+        return record(nbody.getTime(), nbody.size(), nbody.x(), nbody.y(), nbody.z(),
+                      nbody.vx(), nbody.vy(), nbody.vz());
+    }
+
+    /**
+     * @brief Writes the partly filled chunk, waits for the writer and closes the files
+     */
+    void close() {
+        std::unique_lock<std::mutex> lock(p_Mutex);
+        if (p_Data == NULL)
+            return;
+        if (p_Buffers[p_Filling].steps > 0) {
+            p_Done.wait(lock, [this] { return !p_Free.empty(); });
+            submit();
+        }
+        p_Done.wait(lock, [this] { return p_Free.size() == BUFFERS - 1 && p_Queue.empty(); });
+        std::fclose(p_Data);
+        std::fclose(p_Index);
+        p_Data = p_Index = NULL;
+    }
+
+    /**
+     * @brief Most bodies a step can hold with MIN_STEPS_PER_CHUNK steps per chunk in the budget
+     */
+    std::size_t maxBodies() const {
+        const std::size_t bodies = p_Budget / (bytesPerBodyStep() * MIN_STEPS_PER_CHUNK);
+        return bodies > 0 ? bodies : 1;
+    }
+
+    /**
+     * @brief Bytes held by the chunk buffers and the encoded chunk, the most the recording used;
+     * only valid while nothing is being recorded, e.g. after close()
+     */
+    std::size_t memory() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        std::size_t bytes = p_Encoded.capacity();
+        for (std::size_t b = 0; b < BUFFERS; b++) {
+            bytes += p_Buffers[b].days.capacity() * sizeof(double);
+            for (int c = 0; c < TrajectoryFormat::COLUMNS; c++)
+                bytes += p_Buffers[b].columns[c].capacity() * sizeof(double);
+        }
+        return bytes;
+    }
+
+    std::size_t recorded() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        return p_Recorded;
+    }
+
+    std::size_t dropped() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        return p_Dropped;
+    }
+
+    std::size_t stepsWritten() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        return p_Written;
+    }
+
+    double compressionRatio() {
+        std::lock_guard<std::mutex> lock(p_Mutex);
+        return p_EncodedBytes > 0 ? static_cast<double>(p_RawBytes) / p_EncodedBytes : 1.0;
+    }
+
+private:
+    struct Chunk {
+        std::size_t bodies;
+        std::size_t steps;
+        std::size_t capacity;
+        std::vector<double> days;
+        std::vector<double> columns[TrajectoryFormat::COLUMNS];    // [step * bodies + body]
+
+        Chunk() : bodies(0), steps(0), capacity(0) {}
+
+        void reset(std::size_t n, std::size_t stepsPerChunk) {
+            bodies = n;
+            steps = 0;
+            capacity = stepsPerChunk;
+            days.resize(capacity);
+            for (int c = 0; c < TrajectoryFormat::COLUMNS; c++)
+                columns[c].resize(capacity * n);
+        }
+    };
+
+    std::size_t p_Budget;
+    std::FILE* p_Data;
+    std::FILE* p_Index;
+    std::uint64_t p_Offset;         // where the next chunk goes in the data file
+
+    std::thread p_Thread;
+    std::mutex p_Mutex;
+    std::condition_variable p_WakeUp;
+    std::condition_variable p_Done;
+    bool p_Stop;
+
+    std::vector<Chunk> p_Buffers;
+    std::size_t p_Filling;
+    std::vector<std::size_t> p_Queue;
+    std::vector<std::size_t> p_Free;
+    std::vector<unsigned char> p_Encoded;
+
+    std::size_t p_Recorded;
+    std::size_t p_Dropped;
+    std::size_t p_Written;
+    std::uint64_t p_EncodedBytes;
+    std::uint64_t p_RawBytes;
+    bool p_Failed;
+
+    /**
+     * @brief Budget taken by one body for one step: a value per column in every buffer, and
+     * in the encoded chunk, which may be a little larger than a raw one, so it counts twice
+     */
+    static std::size_t bytesPerBodyStep() {
+        return (BUFFERS + 2) * TrajectoryFormat::COLUMNS * sizeof(double);
+    }
+
+    // At least MIN_STEPS_PER_CHUNK, since record() keeps n within maxBodies()
+    std::size_t stepsPerChunk(std::size_t n) const {
+        const std::size_t steps = p_Budget / (bytesPerBodyStep() * n);
+        if (steps < MIN_STEPS_PER_CHUNK)
+            return MIN_STEPS_PER_CHUNK;
+        return steps > MAX_STEPS_PER_CHUNK ? MAX_STEPS_PER_CHUNK : steps;
+    }
+
+    /**
+     * @brief Queues the filling chunk and takes a free one, with p_Mutex held; false if none is free
+     */
+    bool submit() {
+        if (p_Free.empty())
+            return false;
+        p_Queue.push_back(p_Filling);
+        p_Filling = p_Free.back();
+        p_Free.pop_back();
+        p_Buffers[p_Filling].steps = 0;
+        p_WakeUp.notify_one();
+        return true;
+    }
+
+    void run() {
+        for (;;) {
+            std::size_t buffer;
+            std::FILE* data;
+            std::FILE* index;
+            std::uint64_t offset;
+            {
+                std::unique_lock<std::mutex> lock(p_Mutex);
+                p_WakeUp.wait(lock, [this] { return p_Stop || !p_Queue.empty(); });
+                if (p_Queue.empty())
+                    return;
+                buffer = p_Queue.front();
+                p_Queue.erase(p_Queue.begin());
+                data = p_Data;
+                index = p_Index;
+                offset = p_Offset;
+            }
+
+            const Chunk& chunk = p_Buffers[buffer];
+            std::size_t bytes = encode(chunk);
+            bool ok = std::fwrite(p_Encoded.data(), 1, bytes, data) == bytes && std::fflush(data) == 0;
+
+            TrajectoryFormat::IndexEntry entry;
+            std::memset(&entry, 0, sizeof(entry));
+            entry.firstDays = chunk.days[0];
+            entry.lastDays = chunk.days[chunk.steps - 1];
+            entry.offset = offset;
+            entry.steps = static_cast<std::uint32_t>(chunk.steps);
+            ok = ok && std::fwrite(&entry, sizeof(entry), 1, index) == 1 && std::fflush(index) == 0;
+
+            std::lock_guard<std::mutex> lock(p_Mutex);
+            if (!ok && !p_Failed)
+                std::cerr << "Could not write the trajectory file" << std::endl;
+            p_Failed = p_Failed || !ok;
+            p_Offset += bytes;
+            p_Written += chunk.steps;
+            p_EncodedBytes += bytes;
+            p_RawBytes += chunk.steps * (chunk.bodies * TrajectoryFormat::COLUMNS + 1) * sizeof(double);
+            p_Free.push_back(buffer);
+            p_Done.notify_all();
+        }
+    }
+
+    /**
+     * @brief Encodes a chunk into p_Encoded and returns its size
+     */
+    std::size_t encode(const Chunk& chunk) {
+        const std::size_t n = chunk.bodies, steps = chunk.steps;
+        const std::size_t groups = TrajectoryFormat::groups(n);
+        const std::size_t prefix = TrajectoryFormat::prefixBytes(steps, n);
+        std::size_t worst = prefix;
+        for (std::size_t g = 0; g < groups; g++)
+            worst += TrajectoryFormat::COLUMNS *
+                     TrajectoryFormat::maxGroupBytes(TrajectoryFormat::groupBodies(n, g) * steps);
+        if (p_Encoded.size() < worst)
+            p_Encoded.resize(worst);
+
+        unsigned char* start = p_Encoded.data();
+        unsigned char* out = start + prefix;
+        std::uint64_t* offsets = reinterpret_cast<std::uint64_t*>(start + sizeof(TrajectoryFormat::ChunkHeader) +
+                                                                  steps * sizeof(double));
+        for (int c = 0; c < TrajectoryFormat::COLUMNS; c++) {
+            for (std::size_t g = 0; g < groups; g++) {
+                std::size_t first = g * TrajectoryFormat::GROUP;
+                std::size_t count = TrajectoryFormat::groupBodies(n, g);
+                std::uint64_t at = static_cast<std::uint64_t>(out - start - prefix);
+                std::memcpy(offsets + c * groups + g, &at, sizeof(at));
+                out = TrajectoryFormat::encodeGroup(chunk.columns[c].data(), n, steps, first, count, out);
+            }
+        }
+        std::uint64_t end = static_cast<std::uint64_t>(out - start - prefix);
+        std::memcpy(offsets + TrajectoryFormat::COLUMNS * groups, &end, sizeof(end));
+
+        TrajectoryFormat::ChunkHeader header;
+        std::memcpy(header.magic, TrajectoryFormat::chunkMagic(), sizeof(header.magic));
+        header.steps = static_cast<std::uint32_t>(steps);
+        header.bodies = n;
+        header.bytes = static_cast<std::uint64_t>(out - start);
+        header.firstDays = chunk.days[0];
+        header.lastDays = chunk.days[steps - 1];
+        std::memcpy(start, &header, sizeof(header));
+        std::memcpy(start + sizeof(header), chunk.days.data(), steps * sizeof(double));
+        return static_cast<std::size_t>(out - start);
+    }
+};
+
+/**
+ * @brief Random access to a trajectory file through a memory mapping.
+ *
+ * Steps are numbered across the whole file. readStep() decodes the chunk holding a step
+ * and keeps it, so reading consecutive steps (a replay) decodes each chunk once.
+ * readBody() decodes only the body's group in every chunk it spans.
+ */
+class TrajectoryReader {
+public:
+    TrajectoryReader() : p_Cached(SIZE_MAX) {}
+
+    /**
+     * @brief Maps the file and loads or rebuilds its index, false if it is not a trajectory file
+     */
+    bool open(const std::string& path) {
+        p_Chunks.clear();
+        p_FirstStep.clear();
+        p_Cached = SIZE_MAX;
+        if (!p_File.open(path))
+            return false;
+        if (!checkHeader(p_File, TrajectoryFormat::dataMagic())) {
+            std::cerr << "Not a trajectory file of this version: " << path << std::endl;
+            return false;
+        }
+
+        // Index entries are trusted as far as they point at complete chunks
+        MappedFile index;
+        std::uint64_t offset = sizeof(TrajectoryFormat::FileHeader);
+        if (index.open(path + ".index") && checkHeader(index, TrajectoryFormat::indexMagic())) {
+            const std::size_t count = (index.size() - sizeof(TrajectoryFormat::FileHeader)) /
+                                      sizeof(TrajectoryFormat::IndexEntry);
+            for (std::size_t k = 0; k < count; k++) {
+                TrajectoryFormat::IndexEntry entry;
+                std::memcpy(&entry, index.data() + sizeof(TrajectoryFormat::FileHeader) + k * sizeof(entry), sizeof(entry));
+                TrajectoryFormat::ChunkHeader header;
+                if (entry.offset != offset || !chunkAt(offset, header))
+                    break;
+                addChunk(offset, header);
+                offset += header.bytes;
+            }
+        }
+
+        // Chunks the index does not list yet, e.g. after a crash
+        TrajectoryFormat::ChunkHeader header;
+        while (chunkAt(offset, header)) {
+            addChunk(offset, header);
+            offset += header.bytes;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Total number of steps
+     */
+    std::size_t steps() const {
+        return p_FirstStep.empty() ? 0 : p_FirstStep.back() + p_Chunks.back().steps;
+    }
+
+    bool empty() const { return steps() == 0; }
+
+    /**
+     * @brief Last step at or before days, 0 if days is before the first step
+     */
+    std::size_t find(double days) const {
+        if (p_Chunks.empty())
+            return 0;
+        std::size_t c = static_cast<std::size_t>(
+            std::upper_bound(p_Chunks.begin(), p_Chunks.end(), days, Chunk::before) - p_Chunks.begin());
+        if (c == 0)
+            return 0;
+        c--;
+        // First step after days
+        std::size_t t = 0, end = p_Chunks[c].steps;
+        while (t < end) {
+            const std::size_t middle = t + (end - t) / 2;
+            if (stepDays(c, middle) <= days)
+                t = middle + 1;
+            else
+                end = middle;
+        }
+        return p_FirstStep[c] + (t > 0 ? t - 1 : 0);
+    }
+
+    double days(std::size_t step) const {
+        std::size_t c = chunkOf(step);
+        return stepDays(c, step - p_FirstStep[c]);
+    }
+
+    std::size_t bodies(std::size_t step) const {
+        return static_cast<std::size_t>(p_Chunks[chunkOf(step)].bodies);
+    }
+
+    /**
+     * @brief Copies every body's state at a step into arrays of bodies(step) values, x..vz may be NULL
+     *
+     * @return false if the step's chunk is corrupt, the arrays are left as they were
+     */
+    bool readStep(std::size_t step, double* x, double* y, double* z, double* vx, double* vy, double* vz) {
+        const std::size_t c = chunkOf(step);
+        if (c != p_Cached) {
+            p_Cached = SIZE_MAX;
+            if (!decodeChunk(c)) {
+                std::cerr << "Corrupt trajectory chunk at offset " << p_Chunks[c].offset << std::endl;
+                return false;
+            }
+            p_Cached = c;
+        }
+        const std::size_t n = static_cast<std::size_t>(p_Chunks[c].bodies), t = step - p_FirstStep[c];
+        double* arrays[TrajectoryFormat::COLUMNS] = { x, y, z, vx, vy, vz };
+        for (int k = 0; k < TrajectoryFormat::COLUMNS; k++) {
+            if (arrays[k] != NULL)
+                std::memcpy(arrays[k], p_Decoded[k].data() + t * n, n * sizeof(double));
+        }
+        return true;
+    }
+
+    /**
+     * @brief One body's positions (and velocities if given) for steps [first, last]
+     *
+     * @return number of steps written; it stops early at a chunk without that body or a corrupt one
+     */
+    std::size_t readBody(std::size_t body, std::size_t first, std::size_t last,
+                         double* x, double* y, double* z, double* vx = NULL, double* vy = NULL, double* vz = NULL) {
+        double* arrays[TrajectoryFormat::COLUMNS] = { x, y, z, vx, vy, vz };
+        std::size_t written = 0;
+        for (std::size_t step = first; step <= last && step < steps();) {
+            const std::size_t c = chunkOf(step);
+            const Chunk& chunk = p_Chunks[c];
+            if (body >= chunk.bodies)
+                break;
+            const std::size_t begin = step - p_FirstStep[c];
+            const std::size_t end = std::min<std::size_t>(chunk.steps, last + 1 - p_FirstStep[c]);
+            for (int k = 0; k < TrajectoryFormat::COLUMNS; k++) {
+                if (arrays[k] == NULL)
+                    continue;
+                p_Series.resize(chunk.steps);
+                if (!decodeGroupOf(c, k, body, p_Series.data())) {
+                    std::cerr << "Corrupt trajectory chunk at offset " << chunk.offset << std::endl;
+                    return written;
+                }
+                std::memcpy(arrays[k] + written, p_Series.data() + begin, (end - begin) * sizeof(double));
+            }
+            written += end - begin;
+            step = p_FirstStep[c] + end;
+        }
+        return written;
+    }
+
+private:
+    struct Chunk {
+        std::uint64_t offset;
+        std::uint64_t bodies;
+        std::uint32_t steps;
+        double firstDays;
+
+        static bool before(double days, const Chunk& chunk) { return days < chunk.firstDays; }
+    };
+
+    MappedFile p_File;
+    std::vector<Chunk> p_Chunks;
+    std::vector<std::size_t> p_FirstStep;
+    std::size_t p_Cached;
+    std::vector<double> p_Decoded[TrajectoryFormat::COLUMNS];
+    std::vector<double> p_Series;
+
+    static bool checkHeader(const MappedFile& file, const char* magic) {
+        TrajectoryFormat::FileHeader header;
+        if (file.size() < sizeof(header))
+            return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        return std::memcmp(header.magic, magic, sizeof(header.magic)) == 0 &&
+               header.version == TrajectoryFormat::VERSION && header.headerSize == sizeof(header);
+    }
+
+    /**
+     * @brief Reads the header of a complete chunk at offset, false if there is none
+     *
+     * The group offsets are checked as well: they must rise through the chunk, leave every
+     * group room for its nibbles and end where the chunk does, so decodeGroup() never starts
+     * outside it. The byte counts in the nibbles are checked as the groups are decoded.
+     */
+    bool chunkAt(std::uint64_t offset, TrajectoryFormat::ChunkHeader& header) const {
+        if (offset > p_File.size() || p_File.size() - offset < sizeof(header))
+            return false;
+        std::memcpy(&header, p_File.data() + offset, sizeof(header));
+        // Every body takes at least a nibble per value, so bodies <= bytes keeps the sizes from overflowing
+        if (std::memcmp(header.magic, TrajectoryFormat::chunkMagic(), sizeof(header.magic)) != 0 ||
+            header.steps == 0 || header.steps > TrajectoryFormat::MAX_STEPS || header.bodies == 0 ||
+            header.bytes > p_File.size() - offset || header.bodies > header.bytes)
+            return false;
+        const std::size_t n = static_cast<std::size_t>(header.bodies);
+        const std::size_t prefix = TrajectoryFormat::prefixBytes(header.steps, n);
+        if (header.bytes < prefix)
+            return false;
+
+        const std::size_t groups = TrajectoryFormat::groups(n);
+        const unsigned char* table = p_File.data() + offset + sizeof(header) + header.steps * sizeof(double);
+        std::uint64_t at = 0;
+        for (std::size_t j = 0; j < TrajectoryFormat::COLUMNS * groups; j++) {
+            std::uint64_t begin, end;
+            std::memcpy(&begin, table + j * sizeof(std::uint64_t), sizeof(begin));
+            std::memcpy(&end, table + (j + 1) * sizeof(std::uint64_t), sizeof(end));
+            const std::size_t values = TrajectoryFormat::groupBodies(n, j % groups) * header.steps;
+            if (begin != at || end < begin || end - begin < TrajectoryFormat::nibbleBytes(values))
+                return false;
+            at = end;
+        }
+        return at == header.bytes - prefix;
+    }
+
+    void addChunk(std::uint64_t offset, const TrajectoryFormat::ChunkHeader& header) {
+        Chunk chunk = { offset, header.bodies, header.steps, header.firstDays };
+        p_FirstStep.push_back(steps());
+        p_Chunks.push_back(chunk);
+    }
+
+    std::size_t chunkOf(std::size_t step) const {
+        return static_cast<std::size_t>(std::upper_bound(p_FirstStep.begin(), p_FirstStep.end(), step) -
+                                        p_FirstStep.begin()) - 1;
+    }
+
+    /**
+     * @brief Time of step t of chunk c; chunks start at any byte, so the times are copied out
+     */
+    double stepDays(std::size_t c, std::size_t t) const {
+        double days;
+        std::memcpy(&days, p_File.data() + p_Chunks[c].offset + sizeof(TrajectoryFormat::ChunkHeader) + t * sizeof(double),
+                    sizeof(days));
+        return days;
+    }
+
+    /**
+     * @brief Start of column k, group g of chunk c, and in limit where the group ends
+     */
+    const unsigned char* groupData(std::size_t c, int k, std::size_t g, const unsigned char*& limit) const {
+        const Chunk& chunk = p_Chunks[c];
+        const std::size_t groups = TrajectoryFormat::groups(chunk.bodies);
+        const unsigned char* base = p_File.data() + chunk.offset;
+        const unsigned char* table = base + sizeof(TrajectoryFormat::ChunkHeader) + chunk.steps * sizeof(double);
+        std::uint64_t offsets[2];
+        std::memcpy(offsets, table + (k * groups + g) * sizeof(std::uint64_t), sizeof(offsets));
+        const unsigned char* data = base + TrajectoryFormat::prefixBytes(chunk.steps, chunk.bodies);
+        limit = data + offsets[1];
+        return data + offsets[0];
+    }
+
+    bool decodeChunk(std::size_t c) {
+        const Chunk& chunk = p_Chunks[c];
+        const std::size_t n = static_cast<std::size_t>(chunk.bodies);
+        for (int k = 0; k < TrajectoryFormat::COLUMNS; k++) {
+            p_Decoded[k].resize(chunk.steps * n);
+            for (std::size_t g = 0; g < TrajectoryFormat::groups(n); g++) {
+                std::size_t first = g * TrajectoryFormat::GROUP;
+                const unsigned char* limit;
+                const unsigned char* data = groupData(c, k, g, limit);
+                if (!TrajectoryFormat::decodeGroup(data, limit, chunk.steps, first,
+                                                   TrajectoryFormat::groupBodies(n, g), p_Decoded[k].data(), n))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief All steps of one body in column k of chunk c, written to series[step]; false if the group is corrupt
+     */
+    bool decodeGroupOf(std::size_t c, int k, std::size_t body, double* series) const {
+        const Chunk& chunk = p_Chunks[c];
+        const std::size_t n = static_cast<std::size_t>(chunk.bodies);
+        const std::size_t g = body / TrajectoryFormat::GROUP, first = g * TrajectoryFormat::GROUP;
+        const unsigned char* limit;
+        const unsigned char* data = groupData(c, k, g, limit);
+        return TrajectoryFormat::decodeGroup(data, limit, chunk.steps, first,
+                                             TrajectoryFormat::groupBodies(n, g), series, 1, body);
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_TRAJECTORY_HPP_
@@ -0,0 +1,374 @@
+#ifndef INCLUDE_SOLAR_SYSTEM_VSOP87_HPP_
+#define INCLUDE_SOLAR_SYSTEM_VSOP87_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Simd.hpp"
+
+const double DAYS_PER_MILLENNIUM = 365250.0;
+
+/**
+ * @brief VSOP87A planetary theory: heliocentric positions from periodic series.
+ *
+ * Reads the IMCCE files VSOP87A.mer ... VSOP87A.nep, which give rectangular coordinates
+ * in AU in the J2000 ecliptic frame, the frame of Kepler.hpp. Each coordinate is a sum
+ * over powers of t (Julian millennia from J2000, TDB) of series A cos(B + C t).
+ *
+ * The terms of every series are packed into one 64 byte aligned buffer, as blocks of A,
+ * B and C padded to whole SIMD registers. positions() for many epochs of one body keeps
+ * a block of epochs on the SIMD lanes and streams the terms once per block; positions()
+ * for every body at one epoch puts consecutive terms on the lanes instead. The scalar
+ * position() sums with std::cos and is the reference for both.
+ *
+ * Terms below a minimum amplitude can be dropped on load, the usual way of trading
+ * accuracy for speed with VSOP87.
+ */
+class Vsop87 {
+public:
+    static const int COORDINATES = 3;
+    static const int POWERS = 6;                    // t^0 ... t^5
+    static const std::size_t EPOCH_VECTORS = 4;     // epoch registers per pass over the terms
+    static const std::size_t ALIGNMENT = 64;        // bytes
+
+    Vsop87() : p_Terms(NULL) {}
+
+    /**
+     * @brief Loads the eight planets, Mercury ... Neptune, from a directory of VSOP87A files
+     *
+     * @param[in] minAmplitude terms with |A| below it (AU) are dropped
+     */
+    bool open(const std::string& directory, double minAmplitude = 0.0) {
+        static const char* const EXTENSIONS[] = { "mer", "ven", "ear", "mar", "jup", "sat", "ura", "nep" };
+        clear();
+        for (std::size_t k = 0; k < sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]); k++) {
+            if (!load(directory + "/VSOP87A." + EXTENSIONS[k], minAmplitude)) {
+                clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Appends a body from one VSOP87A file, false if it cannot be read
+     */
+    bool load(const std::string& path, double minAmplitude = 0.0) {
+        std::FILE* file = std::fopen(path.c_str(), "r");
+        if (file == NULL) {
+            std::cerr << "VSOP87 file could not be opened: " << path << std::endl;
+            return false;
+        }
+
+        std::vector<RawSeries> raw(COORDINATES * POWERS);
+        char line[512];
+        int coordinate = -1, power = -1;
+        long remaining = 0;
+        bool ok = true;
+        while (std::fgets(line, sizeof(line), file) != NULL) {
+            if (remaining == 0) {
+                if (!parseHeader(line, coordinate, power, remaining)) {
+                    ok = false;
+                    break;
+                }
+                continue;
+            }
+            double A, B, C;
+            if (!parseTerm(line, A, B, C)) {
+                ok = false;
+                break;
+            }
+            remaining--;
+            if (std::fabs(A) < minAmplitude)
+                continue;
+            RawSeries& series = raw[coordinate * POWERS + power];
+            series.A.push_back(A);
+            series.B.push_back(B);
+            series.C.push_back(C);
+        }
+        std::fclose(file);
+        if (!ok || remaining != 0 || coordinate < 0) {
+            std::cerr << "Not a VSOP87A file: " << path << std::endl;
+            return false;
+        }
+
+        p_Raw.insert(p_Raw.end(), raw.begin(), raw.end());
+        pack();
+        return true;
+    }
+
+    /**
+     * @brief Appends a body from series given directly, raw[coordinate * POWERS + power]
+     */
+    void add(const std::vector<double> (&A)[COORDINATES * POWERS], const std::vector<double> (&B)[COORDINATES * POWERS],
+             const std::vector<double> (&C)[COORDINATES * POWERS]) {
+        for (int s = 0; s < COORDINATES * POWERS; s++) {
+            RawSeries series;
+            series.A = A[s];
+            series.B = B[s];
+            series.C = C[s];
+            p_Raw.push_back(series);
+        }
+        pack();
+    }
+
+    void clear() {
+        p_Raw.clear();
+        p_Series.clear();
+        p_Storage.clear();
+        p_Terms = NULL;
+    }
+
+    std::size_t size() const {
+        return p_Series.size() / (COORDINATES * POWERS);
+    }
+
+    /**
+     * @brief Number of terms kept for a body, over all coordinates and powers
+     */
+    std::size_t terms(std::size_t body) const {
+        std::size_t count = 0;
+        for (int s = 0; s < COORDINATES * POWERS; s++)
+            count += p_Series[body * COORDINATES * POWERS + s].count;
+        return count;
+    }
+
+    /**
+     * @brief The series are fitted to 4000 years around J2000 (1 arcsecond for the inner planets)
+     */
+    static bool covers(double days) {
+        return std::fabs(days) <= 4.0 * DAYS_PER_MILLENNIUM;
+    }
+
+    /**
+     * @brief Scalar reference, heliocentric ecliptic position in AU
+     *
+     * @param[in] days TDB days since J2000
+     */
+    void position(std::size_t body, double days, double xyz[3]) const {
+        const double t = days / DAYS_PER_MILLENNIUM;
+        for (int c = 0; c < COORDINATES; c++) {
+            double value = 0.0;
+            for (int p = POWERS - 1; p >= 0; p--) {
+                const Series& series = p_Series[(body * COORDINATES + c) * POWERS + p];
+                const double* A = p_Terms + series.offset;
+                const double* B = A + series.padded;
+                const double* C = B + series.padded;
+                double sum = 0.0;
+                for (std::size_t k = 0; k < series.count; k++)
+                    sum += A[k] * std::cos(B[k] + C[k] * t);
+                value = value * t + sum;
+            }
+            xyz[c] = value;
+        }
+    }
+
+    /**
+     * @brief Positions of one body at n epochs, the epochs on the SIMD lanes
+     */
+    void positions(std::size_t body, std::size_t n, const double* days, double* x, double* y, double* z) const {
+        double* out[COORDINATES] = { x, y, z };
+#if defined(SOLAR_SYSTEM_SIMD)
+        using namespace simd;
+        const std::size_t block = EPOCH_VECTORS * DOUBLE_WIDTH;
+        for (std::size_t i = 0; i < n; i += block) {
+            // A short last block repeats its final epoch in the unused lanes
+            double t[EPOCH_VECTORS * DOUBLE_WIDTH];
+            const std::size_t lanes = n - i < block ? n - i : block;
+            for (std::size_t l = 0; l < block; l++)
+                t[l] = days[i + (l < lanes ? l : lanes - 1)] / DAYS_PER_MILLENNIUM;
+            vdouble tv[EPOCH_VECTORS];
+            for (std::size_t v = 0; v < EPOCH_VECTORS; v++)
+                tv[v] = simd::load(t + v * DOUBLE_WIDTH);
+
+            for (int c = 0; c < COORDINATES; c++) {
+                vdouble value[EPOCH_VECTORS];
+                for (std::size_t v = 0; v < EPOCH_VECTORS; v++)
+                    value[v] = set1d(0.0);
+                for (int p = POWERS - 1; p >= 0; p--) {
+                    vdouble sum[EPOCH_VECTORS];
+                    sumEpochs(p_Series[(body * COORDINATES + c) * POWERS + p], tv, sum);
+                    for (std::size_t v = 0; v < EPOCH_VECTORS; v++)
+                        value[v] = fmadd(value[v], tv[v], sum[v]);
+                }
+                double result[EPOCH_VECTORS * DOUBLE_WIDTH];
+                for (std::size_t v = 0; v < EPOCH_VECTORS; v++)
+                    store(result + v * DOUBLE_WIDTH, value[v]);
+                std::memcpy(out[c] + i, result, lanes * sizeof(double));
+            }
+        }
+#else
+        for (std::size_t i = 0; i < n; i++) {
+            double xyz[3];
+            position(body, days[i], xyz);
+            for (int c = 0; c < COORDINATES; c++)
+                out[c][i] = xyz[c];
+        }
+#endif
+    }
+
+    /**
+     * @brief Positions of every body at one epoch, consecutive terms on the SIMD lanes
+     *
+     * @param[out] x, y, z size() values each, Mercury ... Neptune after open()
+     */
+    void positions(double days, double* x, double* y, double* z) const {
+        double* out[COORDINATES] = { x, y, z };
+        const double t = days / DAYS_PER_MILLENNIUM;
+        for (std::size_t body = 0; body < size(); body++) {
+            for (int c = 0; c < COORDINATES; c++) {
+                double value = 0.0;
+                for (int p = POWERS - 1; p >= 0; p--)
+                    value = value * t + sumTerms(p_Series[(body * COORDINATES + c) * POWERS + p], t);
+                out[c][body] = value;
+            }
+        }
+    }
+
+private:
+    struct RawSeries {
+        std::vector<double> A, B, C;
+    };
+
+    struct Series {
+        std::size_t offset;     // of the A block in p_Terms, B and C follow at padded strides
+        std::size_t count;
+        std::size_t padded;     // count rounded up to whole cache lines
+    };
+
+    std::vector<RawSeries> p_Raw;
+    std::vector<Series> p_Series;
+    std::vector<double> p_Storage;
+    const double* p_Terms;      // first aligned double of p_Storage
+
+    // p_Terms points into p_Storage, whose alignment a copy would not keep
+    Vsop87(const Vsop87&);
+    Vsop87& operator=(const Vsop87&);
+
+    /**
+     * @brief Copies every series into one aligned buffer, zero amplitude in the padding
+     */
+    void pack() {
+        const std::size_t lineDoubles = ALIGNMENT / sizeof(double);
+        p_Series.resize(p_Raw.size());
+        std::size_t total = 0;
+        for (std::size_t s = 0; s < p_Raw.size(); s++) {
+            Series& series = p_Series[s];
+            series.count = p_Raw[s].A.size();
+            series.padded = (series.count + lineDoubles - 1) / lineDoubles * lineDoubles;
+            series.offset = total;
+            total += 3 * series.padded;
+        }
+
+        p_Storage.assign(total + lineDoubles, 0.0);
+        std::size_t shift = 0;
+        while (reinterpret_cast<std::uintptr_t>(p_Storage.data() + shift) % ALIGNMENT != 0)
+            shift++;
+        double* terms = p_Storage.data() + shift;
+        for (std::size_t s = 0; s < p_Raw.size(); s++) {
+            const Series& series = p_Series[s];
+            for (std::size_t k = 0; k < series.count; k++) {
+                terms[series.offset + k] = p_Raw[s].A[k];
+                terms[series.offset + series.padded + k] = p_Raw[s].B[k];
+                terms[series.offset + 2 * series.padded + k] = p_Raw[s].C[k];
+            }
+        }
+        p_Terms = terms;
+    }
+
+    /**
+     * @brief Reads " VSOP87 VERSION A1 ... VARIABLE 1 (XYZ) *T**0  1449 TERMS ..."
+     */
+    static bool parseHeader(const char* line, int& coordinate, int& power, long& terms) {
+        const char* variable = std::strstr(line, "VARIABLE");
+        const char* exponent = std::strstr(line, "*T**");
+        if (std::strncmp(line, " VSOP87", 7) != 0 || variable == NULL || exponent == NULL)
+            return false;
+        coordinate = std::atoi(variable + 8) - 1;
+        power = std::atoi(exponent + 4);
+        terms = std::strtol(exponent + 5, NULL, 10);
+        return coordinate >= 0 && coordinate < COORDINATES && power >= 0 && power < POWERS && terms > 0;
+    }
+
+    /**
+     * @brief A, B and C are the last three numbers of a term line
+     */
+    static bool parseTerm(const char* line, double& A, double& B, double& C) {
+        const char* end = line + std::strlen(line);
+        const char* starts[3];
+        for (int k = 2; k >= 0; k--) {
+            while (end > line && (end[-1] == ' ' || end[-1] == '\n' || end[-1] == '\r'))
+                end--;
+            while (end > line && end[-1] != ' ')
+                end--;
+            if (end == line)
+                return false;
+            starts[k] = end;
+        }
+        A = std::strtod(starts[0], NULL);
+        B = std::strtod(starts[1], NULL);
+        C = std::strtod(starts[2], NULL);
+        return true;
+    }
+
+#if defined(SOLAR_SYSTEM_SIMD)
+    /**
+     * @brief One series at EPOCH_VECTORS registers of epochs, each term loaded once
+     */
+    void sumEpochs(const Series& series, const simd::vdouble* t, simd::vdouble* sum) const {
+        using namespace simd;
+        const double* A = p_Terms + series.offset;
+        const double* B = A + series.padded;
+        const double* C = B + series.padded;
+        for (std::size_t v = 0; v < EPOCH_VECTORS; v++)
+            sum[v] = set1d(0.0);
+        for (std::size_t k = 0; k < series.count; k++) {
+            const vdouble a = set1d(A[k]), b = set1d(B[k]), c = set1d(C[k]);
+            for (std::size_t v = 0; v < EPOCH_VECTORS; v++) {
+                vdouble s, cosine;
+                sincos(fmadd(c, t[v], b), s, cosine);
+                sum[v] = fmadd(a, cosine, sum[v]);
+            }
+        }
+    }
+#endif
+
+    /**
+     * @brief One series at one epoch, DOUBLE_WIDTH terms per step from the aligned blocks
+     */
+    double sumTerms(const Series& series, double t) const {
+        const double* A = p_Terms + series.offset;
+        const double* B = A + series.padded;
+        const double* C = B + series.padded;
+        std::size_t k = 0;
+        double sum = 0.0;
+#if defined(SOLAR_SYSTEM_SIMD)
+        using namespace simd;
+        // The padding has zero amplitude, so whole registers can run past count
+        const vdouble tv = set1d(t);
+        vdouble acc = set1d(0.0);
+        for (; k < series.count; k += DOUBLE_WIDTH) {
+            vdouble s, cosine;
+            sincos(fmadd(simd::load(C + k), tv, simd::load(B + k)), s, cosine);
+            acc = fmadd(simd::load(A + k), cosine, acc);
+        }
+        double lanes[DOUBLE_WIDTH];
+        store(lanes, acc);
+        for (int l = 0; l < DOUBLE_WIDTH; l++)
+            sum += lanes[l];
+#else
+        for (; k < series.count; k++)
+            sum += A[k] * std::cos(B[k] + C[k] * t);
+#endif
+        return sum;
+    }
+};
+
+#endif  // INCLUDE_SOLAR_SYSTEM_VSOP87_HPP_
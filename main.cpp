@@ -6,7 +6,14 @@
 #include <glm/ext/vector_float3.hpp>
 #include <glm/geometric.hpp>
 #include <glm/trigonometric.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <vector>
 
 #include <GL/glew.h>
 #ifdef __APPLE__
@@ -25,9 +32,26 @@
 
 #include "Camera.hpp"
 #include "Shader.hpp"
+#include "Ephemeris.hpp"
 #include "Planet.hpp"
 #include "Earth.hpp"
 #include "Skybox.hpp"
+#include "ThreadPool.hpp"
+#include "NBody.hpp"
+#include "ParticleRenderer.hpp"
+#include "SimulationClock.hpp"
+#include "SpkKernel.hpp"
+#include "TimeWarp.hpp"
+#include "Snapshot.hpp"
+#include "RewindBuffer.hpp"
+#include "Trajectory.hpp"
+#include "Vsop87.hpp"
+#include "Encounters.hpp"
+#include "MonteCarlo.hpp"
+#include "OrbitRenderer.hpp"
+#include "Sgp4.hpp"
+#include "AsteroidCatalog.hpp"
+#include "SatelliteRenderer.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -42,9 +66,135 @@ float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
-// timing
+// timing: the simulation runs in fixed steps of SIMULATION_STEP wall-clock nanoseconds
 float deltaTime = 0.0f;
-float lastFrame = 0.0f;
+const std::int64_t SIMULATION_STEP = SimulationClock::NANOSECONDS_PER_SECOND / 120;
+// The cloud layer scrolls by 0.03 per second, so its pattern repeats every 100 seconds
+const double CLOUD_PERIOD = 100.0;
+
+// simulation: N toggles between the analytic orbits and mutual gravity
+bool nbodyMode = false;
+const std::size_t NBODY_TEST_PARTICLES = 20000;
+const double NBODY_MAX_BLOCK = 16.0;    // days, longest block of the block timestep integrator
+const double NBODY_ETA = 0.02;          // timestep as a fraction of the orbital period over 2 pi
+const int NBODY_MAX_LEVEL = 12;
+
+// O shows and hides the orbit lines
+bool showOrbits = true;
+
+// Largest distance in pixels between a body drawn from the analytic orbits and its exact position
+const float POSITION_TOLERANCE = 0.5f;
+
+// K and L slow down and speed up time by factors of ten, starting from DAYS_PER_SECOND
+TimeWarpController timeWarp(DAYS_PER_SECOND * SECONDS_PER_DAY);
+
+// JPL ephemeris, optional: the mean Kepler orbits are used when it is missing or out of range
+const char* const SPK_KERNEL_PATH = "../ephemeris/de440s.bsp";
+// VSOP87A series, optional: used for the planets when the kernel is missing or out of range;
+// terms below VSOP87_MIN_AMPLITUDE AU (about 1500 km) are dropped
+const char* const VSOP87_DIRECTORY = "../ephemeris/vsop87";
+const double VSOP87_MIN_AMPLITUDE = 1e-8;
+// NAIF ids in the order the bodies are added to the ephemeris: Sun, Mercury ... Neptune
+const int SPK_BODIES[] = { NAIF_SUN, 1, 2, NAIF_EARTH, 4, 5, 6, 7, 8 };
+
+// B swaps the test particles for a self-gravitating debris disk on the Barnes-Hut tree
+bool debrisMode = false;
+const std::size_t NBODY_DEBRIS_PARTICLES = 1000000;
+const double NBODY_DEBRIS_MASS = 3e-7;   // solar masses in total, about 0.1 Earth
+const double NBODY_DEBRIS_THETA = 0.7;
+const double NBODY_DEBRIS_TREE_CLUMP = 1000.0;   // merged particles' worth of GM still on the tree
+
+// F5 saves a snapshot, F9 (or --resume on the command line) loads it; it is also saved every few minutes
+const char* const SNAPSHOT_PATH = "solar_system.snap";
+const double SNAPSHOT_INTERVAL = 300.0;   // wall-clock seconds between autosaves
+bool saveRequested = false;
+bool loadRequested = false;
+
+// [ and ] jump back and forward by REWIND_JUMP wall-clock seconds of simulated time; the
+// N-body state is recorded every REWIND_RECORD_STEPS fixed steps into REWIND_BUDGET bytes
+const double REWIND_JUMP = 10.0;
+const int REWIND_RECORD_STEPS = 120;
+const std::size_t REWIND_BUDGET = 256u << 20;
+int rewindRequest = 0;
+
+// R records the N-body state to TRAJECTORY_PATH every TRAJECTORY_RECORD_STEPS fixed steps,
+// P replays the recording on the simulation clock; a jump in time ends the recording
+const char* const TRAJECTORY_PATH = "solar_system.traj";
+const int TRAJECTORY_RECORD_STEPS = 12;
+const std::size_t TRAJECTORY_BUDGET = 96u << 20;
+bool recordRequested = false;
+bool replayRequested = false;
+
+// Close encounters and collisions are checked every ENCOUNTER_STEPS fixed steps; colliding bodies merge
+const int ENCOUNTER_STEPS = 12;
+const char* const BODY_NAMES[] = { "Sun", "Mercury", "Venus", "Earth", "Mars", "Jupiter", "Saturn", "Uranus", "Neptune" };
+const double BODY_RADII_KM[] = { 696000.0, 2440.0, 6052.0, 6371.0, 3390.0, 69911.0, 58232.0, 25362.0, 24622.0 };
+
+// M launches MONTE_CARLO_SAMPLES spacecraft from Earth towards Mars with dispersed departure
+// states, propagated through the planets' gravity; M again removes them
+const std::size_t MONTE_CARLO_SAMPLES = 100000;
+const double MONTE_CARLO_POSITION_SIGMA = 1e-5;   // AU, about 1500 km
+const double MONTE_CARLO_VELOCITY_SIGMA = 1e-5;   // AU / day, about 17 m/s
+const double MONTE_CARLO_DEPARTURE = 0.01;        // AU from Earth, the edge of its Hill sphere
+bool launchRequested = false;
+
+// T shows the satellites in SATELLITE_TLE_PATH around the earth and, in the analytic mode, jumps
+// to their epoch at real time; T again hides them. SGP4 gets SATELLITE_BUDGET wall seconds per
+// frame, less when the time warp degrades the simulation, and refreshes them in turns beyond it
+const char* const SATELLITE_TLE_PATH = "../data/catalog.tle";
+const double SATELLITE_BUDGET = 0.002;
+bool satellitesRequested = false;
+
+// The earth model and the satellites drawn around it share its size and tilt
+const float EARTH_DRAWN_RADIUS = 4.01f;   // scene units
+const float EARTH_AXIAL_TILT = 23.5f;     // degrees
+
+// C shows the orbits of the asteroid catalog at ASTEROID_CATALOG_PATH as points, C again hides
+// them. The first load parses the text and leaves a binary cache beside it for the next runs;
+// propagation gets ASTEROID_BUDGET wall seconds per frame and moves the asteroids in turns beyond it
+const char* const ASTEROID_CATALOG_PATH = "../data/MPCORB.DAT";
+const double ASTEROID_BUDGET = 0.004;
+bool asteroidsRequested = false;
+
+/**
+ * @brief Mean orbit of a moon around its planet
+ *
+ * Regular moons orbit in their planet's equator, which in this scene is tilted about the
+ * ecliptic node at 270 degrees by the planet's axial tilt. Phases are not real.
+ */
+struct MoonOrbit {
+    std::size_t planet;         // index into the ephemeris roots, as in SPK_BODIES
+    double semiMajorAxisKm;
+    double eccentricity;
+    double inclination;         // degrees to the ecliptic
+    double node;                // degrees
+};
+
+const MoonOrbit MOONS[] = {
+    { 3,  384400.0, 0.0549,   5.1, 125.1 },     // Moon
+    { 4,    9376.0, 0.0151,  25.2, 270.0 },     // Phobos
+    { 4,   23463.0, 0.0002,  25.2, 270.0 },     // Deimos
+    { 5,  421700.0, 0.0041,   3.1, 270.0 },     // Io
+    { 5,  671034.0, 0.0090,   3.1, 270.0 },     // Europa
+    { 5, 1070412.0, 0.0013,   3.1, 270.0 },     // Ganymede
+    { 5, 1882709.0, 0.0074,   3.1, 270.0 },     // Callisto
+    { 6,  185539.0, 0.0196,  26.7, 270.0 },     // Mimas
+    { 6,  237948.0, 0.0047,  26.7, 270.0 },     // Enceladus
+    { 6,  294619.0, 0.0001,  26.7, 270.0 },     // Tethys
+    { 6,  377396.0, 0.0022,  26.7, 270.0 },     // Dione
+    { 6,  527108.0, 0.0013,  26.7, 270.0 },     // Rhea
+    { 6, 1221870.0, 0.0288,  26.7, 270.0 },     // Titan
+    { 6, 3560820.0, 0.0286,  15.5, 270.0 },     // Iapetus
+    { 7,  129390.0, 0.0013,  97.8, 270.0 },     // Miranda
+    { 7,  191020.0, 0.0012,  97.8, 270.0 },     // Ariel
+    { 7,  266000.0, 0.0039,  97.8, 270.0 },     // Umbriel
+    { 7,  435910.0, 0.0011,  97.8, 270.0 },     // Titania
+    { 7,  583520.0, 0.0014,  97.8, 270.0 },     // Oberon
+    { 8,  354759.0, 0.0000, 130.0, 270.0 },     // Triton, retrograde
+    { 8, 5513818.0, 0.7507,   7.2,   0.0 },     // Nereid
+};
+// Moon orbits are drawn this much wider than they are, so they clear the enlarged planet models
+const float MOON_DISTANCE_SCALE = 20.0f;
 
 /**
  * @brief This helper function prints only if there is an error; it is useful since by default, openGL only gives error codes
@@ -100,6 +250,100 @@ void processInput(GLFWwindow *window) {
    zeroPressedLastFrame = zeroPressedThisFrame;
    onePressedLastFrame = onePressedThisFrame;
 
+   static bool nPressedLastFrame = false;
+   bool nPressedThisFrame = glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS;
+   if (nPressedThisFrame && !nPressedLastFrame) {
+       nbodyMode = !nbodyMode;
+   }
+   nPressedLastFrame = nPressedThisFrame;
+
+   static bool oPressedLastFrame = false;
+   bool oPressedThisFrame = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+   if (oPressedThisFrame && !oPressedLastFrame) {
+       showOrbits = !showOrbits;
+   }
+   oPressedLastFrame = oPressedThisFrame;
+
+   static bool bPressedLastFrame = false;
+   bool bPressedThisFrame = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+   if (bPressedThisFrame && !bPressedLastFrame) {
+       debrisMode = !debrisMode;
+   }
+   bPressedLastFrame = bPressedThisFrame;
+
+   static bool kPressedLastFrame = false;
+   static bool lPressedLastFrame = false;
+   bool kPressedThisFrame = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+   bool lPressedThisFrame = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+   if (kPressedThisFrame && !kPressedLastFrame) {
+       timeWarp.slower();
+   }
+   if (lPressedThisFrame && !lPressedLastFrame) {
+       timeWarp.faster();
+   }
+   kPressedLastFrame = kPressedThisFrame;
+   lPressedLastFrame = lPressedThisFrame;
+
+   static bool f5PressedLastFrame = false;
+   static bool f9PressedLastFrame = false;
+   bool f5PressedThisFrame = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+   bool f9PressedThisFrame = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+   if (f5PressedThisFrame && !f5PressedLastFrame) {
+       saveRequested = true;
+   }
+   if (f9PressedThisFrame && !f9PressedLastFrame) {
+       loadRequested = true;
+   }
+   f5PressedLastFrame = f5PressedThisFrame;
+   f9PressedLastFrame = f9PressedThisFrame;
+
+   static bool rPressedLastFrame = false;
+   static bool pPressedLastFrame = false;
+   bool rPressedThisFrame = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+   bool pPressedThisFrame = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+   if (rPressedThisFrame && !rPressedLastFrame) {
+       recordRequested = true;
+   }
+   if (pPressedThisFrame && !pPressedLastFrame) {
+       replayRequested = true;
+   }
+   rPressedLastFrame = rPressedThisFrame;
+   pPressedLastFrame = pPressedThisFrame;
+
+   static bool mPressedLastFrame = false;
+   bool mPressedThisFrame = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+   if (mPressedThisFrame && !mPressedLastFrame) {
+       launchRequested = true;
+   }
+   mPressedLastFrame = mPressedThisFrame;
+
+   static bool tPressedLastFrame = false;
+   bool tPressedThisFrame = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+   if (tPressedThisFrame && !tPressedLastFrame) {
+       satellitesRequested = true;
+   }
+   tPressedLastFrame = tPressedThisFrame;
+
+   static bool cPressedLastFrame = false;
+   bool cPressedThisFrame = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+   if (cPressedThisFrame && !cPressedLastFrame) {
+       asteroidsRequested = true;
+   }
+   cPressedLastFrame = cPressedThisFrame;
+
+   static bool backPressedLastFrame = false;
+   static bool forwardPressedLastFrame = false;
+   bool backPressedThisFrame = glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS;
+   bool forwardPressedThisFrame = glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS;
+   if (backPressedThisFrame && !backPressedLastFrame) {
+       rewindRequest--;
+   }
+   if (forwardPressedThisFrame && !forwardPressedLastFrame) {
+       rewindRequest++;
+   }
+   backPressedLastFrame = backPressedThisFrame;
+   forwardPressedLastFrame = forwardPressedThisFrame;
+
    // --- NEW: If camera is orbiting, do not process any other movement input ---
    if (camera.isOrbiting) {
        return;
@@ -164,6 +408,340 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
+/**
+ * @brief Heliocentric positions of the ephemeris bodies from the JPL kernel
+ *
+ * @return false if the kernel does not cover the time, the caller then falls back to the orbits
+ */
+bool kernelPositions(const SpkKernel& kernel, std::size_t bodies, double days,
+                     std::vector<double>& x, std::vector<double>& y, std::vector<double>& z) {
+    const std::size_t count = sizeof(SPK_BODIES) / sizeof(SPK_BODIES[0]);
+    if (bodies != count)
+        return false;
+    x.resize(count); y.resize(count); z.resize(count);
+    kernel.positions(count, SPK_BODIES, NAIF_SUN, days, x.data(), y.data(), z.data());
+    for (std::size_t i = 0; i < count; i++) {
+        if (x[i] != x[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Sun and planet positions from VSOP87 in the order of SPK_BODIES, false outside its time span
+ */
+bool vsopPositions(const Vsop87& vsop, std::size_t bodies, double days,
+                   std::vector<double>& x, std::vector<double>& y, std::vector<double>& z) {
+    if (bodies != vsop.size() + 1 || !Vsop87::covers(days))
+        return false;
+    x.resize(bodies); y.resize(bodies); z.resize(bodies);
+    x[0] = y[0] = z[0] = 0.0;
+    vsop.positions(days, x.data() + 1, y.data() + 1, z.data() + 1);
+    return true;
+}
+
+/**
+ * @brief Adds the moons as children of their planets, after the planet masses are set
+ *
+ * @return ephemeris indices of the moons
+ */
+std::vector<std::size_t> addMoons(Ephemeris& ephemeris) {
+    std::vector<std::size_t> moons;
+    const std::size_t count = sizeof(MOONS) / sizeof(MOONS[0]);
+    for (std::size_t k = 0; k < count; k++) {
+        const MoonOrbit& moon = MOONS[k];
+        std::size_t planet = ephemeris.root(moon.planet);
+        KeplerElements orbit = KeplerElements::fromLongitudes(moon.semiMajorAxisKm / KM_PER_AU, moon.eccentricity,
+                                                              moon.inclination, 47.0 * k, moon.node + 90.0,
+                                                              moon.node, ephemeris.getGM(planet));
+        moons.push_back(ephemeris.addBody(orbit, 0.0f, 0.0f, 0.0f, planet, MOON_DISTANCE_SCALE));
+    }
+    return moons;
+}
+
+/**
+ * @brief Gives far bodies longer timesteps when the time warp controller is over budget
+ *
+ * Distance is measured from the camera, so the bodies in view keep their accuracy longest.
+ */
+void applyStepScales(NBodySystem& nbody, const TimeWarpController& timeWarp, const glm::vec3& cameraPosition,
+                     float sceneScale) {
+    static double appliedDegradation = 1.0;
+    if (timeWarp.getDegradation() == 1.0 && appliedDegradation == 1.0)
+        return;
+    appliedDegradation = timeWarp.getDegradation();
+
+    // scene (x, y, z) -> ecliptic (x, -z, y)
+    double cx = cameraPosition.x / sceneScale, cy = -cameraPosition.z / sceneScale, cz = cameraPosition.y / sceneScale;
+    const std::size_t n = nbody.size();
+    std::vector<double> distance(n);
+    double farthest = 0.0;
+    for (std::size_t i = 0; i < n; i++) {
+        double dx = nbody.x()[i] - cx, dy = nbody.y()[i] - cy, dz = nbody.z()[i] - cz;
+        distance[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+        farthest = std::max(farthest, distance[i]);
+    }
+    for (std::size_t i = 0; i < n; i++)
+        nbody.setStepScale(i, timeWarp.stepScale(farthest > 0.0 ? distance[i] / farthest : 0.0));
+}
+
+/**
+ * @brief (Re)starts the N-body simulation from the current analytic orbits
+ *
+ * The ephemeris roots come first so their indices match, followed by particles spread
+ * through the main asteroid belt. Moons are not simulated, they stay on their orbits
+ * around the simulated planets.
+ *
+ * @param[out] nbody simulation to fill
+ * @param[in] ephemeris bodies to take the orbits and masses from
+ * @param[in] days current time in days since J2000
+ * @param[in] particles number of particles to add
+ * @param[in] particleGM GM of each particle, 0 for test particles
+ */
+void startNBody(NBodySystem& nbody, const Ephemeris& ephemeris, double days, std::size_t particles,
+                double particleGM) {
+    nbody.clear(days);
+
+    double position[3], velocity[3];
+    for (std::size_t k = 0; k < ephemeris.rootCount(); k++) {
+        ephemeris.getState(ephemeris.root(k), days, position, velocity);
+        nbody.addBody(ephemeris.getGM(ephemeris.root(k)), position, velocity);
+    }
+
+    std::srand(1);
+    for (std::size_t i = 0; i < particles; i++) {
+        float a = 2.1f + 1.2f * std::rand() / RAND_MAX;
+        float e = 0.15f * std::rand() / RAND_MAX;
+        float inclination = 10.0f * std::rand() / RAND_MAX;
+        KeplerElements orbit = KeplerElements::fromLongitudes(a, e, inclination,
+                                                              360.0 * std::rand() / RAND_MAX,
+                                                              360.0 * std::rand() / RAND_MAX,
+                                                              360.0 * std::rand() / RAND_MAX);
+        elementsToState(orbit, days, GM_SUN, position, velocity);
+        nbody.addBody(particleGM, position, velocity);
+    }
+
+    nbody.moveToBarycentre();
+}
+
+/**
+ * @brief Sets the force backend and integrator for test particles or the self-gravitating debris disk
+ */
+void configureNBody(NBodySystem& nbody, bool debris) {
+    if (debris) {
+        // Debris clumps go through the tree, the planets never do: Mercury has 500 times this GM
+        nbody.useTree(true, NBODY_DEBRIS_THETA,
+                      NBODY_DEBRIS_TREE_CLUMP * NBODY_DEBRIS_MASS * GM_SUN / NBODY_DEBRIS_PARTICLES);
+        nbody.setSoftening(1e-4);
+    } else {
+        nbody.useTree(false);
+        nbody.setSoftening(0.0);
+    }
+    nbody.useBlockTimesteps(true, NBODY_ETA, NBODY_MAX_LEVEL);
+}
+
+/**
+ * @brief Copies the clock, camera and N-body state into a snapshot
+ *
+ * The snapshot's vectors keep their capacity, so this only allocates the first time.
+ */
+void captureSnapshot(SimulationSnapshot& snapshot, const SimulationClock& clock, const NBodySystem& nbody,
+                     bool nbodyRunning) {
+    snapshot.startDays = clock.getStartDays();
+    snapshot.ticks = clock.getTicks();
+    snapshot.tickFraction = clock.getTickFraction();
+    snapshot.steps = clock.getSteps();
+    snapshot.warp = timeWarp.getWarp();
+
+    snapshot.flags = (nbodyMode ? SimulationSnapshot::NBODY_MODE : 0u) |
+                     (debrisMode ? SimulationSnapshot::DEBRIS_MODE : 0u);
+
+    snapshot.cameraPosition[0] = camera.Position.x;
+    snapshot.cameraPosition[1] = camera.Position.y;
+    snapshot.cameraPosition[2] = camera.Position.z;
+    snapshot.cameraYaw = camera.Yaw;
+    snapshot.cameraPitch = camera.Pitch;
+    snapshot.cameraZoom = camera.Zoom;
+
+    const std::size_t n = nbodyRunning ? nbody.size() : 0;
+    snapshot.nbodyTime = nbody.getTime();
+    snapshot.x.assign(nbody.x(), nbody.x() + n);
+    snapshot.y.assign(nbody.y(), nbody.y() + n);
+    snapshot.z.assign(nbody.z(), nbody.z() + n);
+    snapshot.vx.assign(nbody.vx(), nbody.vx() + n);
+    snapshot.vy.assign(nbody.vy(), nbody.vy() + n);
+    snapshot.vz.assign(nbody.vz(), nbody.vz() + n);
+    snapshot.gm.assign(nbody.gm(), nbody.gm() + n);
+}
+
+/**
+ * @brief Puts the clock, camera and N-body state of a snapshot back
+ *
+ * @return true if the N-body simulation was restored and is running
+ */
+bool restoreSnapshot(const SimulationSnapshot& snapshot, SimulationClock& clock, NBodySystem& nbody) {
+    timeWarp.setWarp(snapshot.warp);
+    clock.setWarp(timeWarp.getWarp());
+    clock.resume(snapshot.startDays, snapshot.ticks, snapshot.tickFraction, snapshot.steps);
+
+    camera.SetView(glm::vec3(snapshot.cameraPosition[0], snapshot.cameraPosition[1], snapshot.cameraPosition[2]),
+                   snapshot.cameraYaw, snapshot.cameraPitch, snapshot.cameraZoom);
+    firstMouse = true;
+
+    nbodyMode = (snapshot.flags & SimulationSnapshot::NBODY_MODE) != 0;
+    debrisMode = (snapshot.flags & SimulationSnapshot::DEBRIS_MODE) != 0;
+    if (snapshot.bodyCount() == 0)
+        return false;
+
+    configureNBody(nbody, debrisMode);
+    nbody.setState(snapshot.nbodyTime, snapshot.bodyCount(), snapshot.x.data(), snapshot.y.data(), snapshot.z.data(),
+                   snapshot.vx.data(), snapshot.vy.data(), snapshot.vz.data(), snapshot.gm.data());
+    return true;
+}
+
+/**
+ * @brief Shows an N-body state that does not follow from the last one, e.g. after a load or a seek
+ */
+void showNBodyState(const NBodySystem& nbody, Ephemeris& ephemeris, ParticleRenderer& particles) {
+    std::size_t bodies = ephemeris.rootCount();
+    ephemeris.resetHistory();
+    ephemeris.update(nbody.getTime(), nbody.x(), nbody.y(), nbody.z());
+    particles.update(nbody.x() + bodies, nbody.y() + bodies, nbody.z() + bodies,
+                     nbody.size() - bodies, ephemeris.getSceneScale());
+}
+
+/**
+ * @brief Closes the trajectory file if one is being recorded and says how it went
+ */
+void stopRecording(TrajectoryRecorder& recorder) {
+    if (!recorder.isOpen())
+        return;
+    recorder.close();
+    std::cout << "Recorded " << recorder.stepsWritten() << " steps to " << TRAJECTORY_PATH << ", compressed "
+              << recorder.compressionRatio() << ":1, " << recorder.dropped() << " dropped, "
+              << (recorder.memory() >> 20) << " MB of buffers" << std::endl;
+}
+
+/**
+ * @brief Two recorded steps, the state shown during a replay is interpolated between them
+ */
+struct ReplayState {
+    std::vector<double> x, y, z;
+    std::vector<double> nextX, nextY, nextZ;
+};
+
+/**
+ * @brief Shows the recorded N-body state at days, linearly interpolated between the steps around it
+ *
+ * @return false once days is past the end of the recording or the recording cannot be read
+ */
+bool showRecordedState(TrajectoryReader& reader, double days, ReplayState& state, Ephemeris& ephemeris,
+                       ParticleRenderer& particles) {
+    if (reader.empty())
+        return false;
+    const std::size_t last = reader.steps() - 1;
+    if (days > reader.days(last))
+        return false;
+
+    const std::size_t step = reader.find(days);
+    const std::size_t n = reader.bodies(step);
+    state.x.resize(n);
+    state.y.resize(n);
+    state.z.resize(n);
+    if (!reader.readStep(step, state.x.data(), state.y.data(), state.z.data(), NULL, NULL, NULL))
+        return false;
+
+    const std::size_t next = step < last ? step + 1 : step;
+    const double span = reader.days(next) - reader.days(step);
+    state.nextX.resize(n);
+    state.nextY.resize(n);
+    state.nextZ.resize(n);
+    if (next != step && reader.bodies(next) == n && span > 0.0 && days > reader.days(step) &&
+        reader.readStep(next, state.nextX.data(), state.nextY.data(), state.nextZ.data(), NULL, NULL, NULL)) {
+        const double alpha = (days - reader.days(step)) / span;
+        for (std::size_t i = 0; i < n; i++) {
+            state.x[i] += alpha * (state.nextX[i] - state.x[i]);
+            state.y[i] += alpha * (state.nextY[i] - state.y[i]);
+            state.z[i] += alpha * (state.nextZ[i] - state.z[i]);
+        }
+    }
+
+    const std::size_t bodies = ephemeris.rootCount();
+    if (n < bodies)
+        return true;
+    ephemeris.update(days, state.x.data(), state.y.data(), state.z.data());
+    particles.update(state.x.data() + bodies, state.y.data() + bodies, state.z.data() + bodies,
+                     n - bodies, ephemeris.getSceneScale());
+    return true;
+}
+
+/**
+ * @brief Merges the colliding bodies of the last check and prints what happened to the ephemeris bodies
+ *
+ * @return true if bodies were merged, so the body count changed
+ */
+bool handleEncounters(EncounterDetector& detector, NBodySystem& nbody, std::size_t named) {
+    static std::vector<std::uint32_t> remap;
+    for (std::size_t k = 0; k < detector.encounters().size(); k++) {
+        const Encounter& encounter = detector.encounters()[k];
+        if (encounter.first >= named || !(encounter.entering || encounter.collision))
+            continue;
+        std::cout << (encounter.collision ? "Collision with " : "Close encounter with ") << BODY_NAMES[encounter.first]
+                  << ": body " << encounter.second << " at " << encounter.distance * KM_PER_AU << " km on day "
+                  << nbody.getTime() << std::endl;
+    }
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t> > pairs = detector.collisions();
+    if (pairs.empty())
+        return false;
+    std::size_t merged = nbody.mergeBodies(pairs, &remap);
+    detector.renumber(remap);
+    std::cout << "Merged " << merged << " bodies, " << nbody.size() << " left" << std::endl;
+    return true;
+}
+
+/**
+ * @brief Replaces the spacecraft with a dispersed cloud leaving Earth towards Mars
+ *
+ * The nominal departure is just outside Earth's Hill sphere, radially outwards, at the
+ * perihelion speed of a transfer orbit reaching Mars' mean distance.
+ */
+void launchDispersion(MonteCarloPropagator& dispersion, const Ephemeris& ephemeris, double days) {
+    double earthPosition[3], earthVelocity[3];
+    ephemeris.getState(ephemeris.root(3), days, earthPosition, earthVelocity);
+    double r = std::sqrt(earthPosition[0] * earthPosition[0] + earthPosition[1] * earthPosition[1] +
+                         earthPosition[2] * earthPosition[2]);
+    double marsDistance = ephemeris.getOrbit(ephemeris.root(4)).semiMajorAxis;
+    double boost = std::sqrt(2.0 * marsDistance / (r + marsDistance));
+
+    double position[3], velocity[3];
+    for (int k = 0; k < 3; k++) {
+        position[k] = earthPosition[k] * (1.0 + MONTE_CARLO_DEPARTURE / r);
+        velocity[k] = earthVelocity[k] * boost;
+    }
+    dispersion.clear(days);
+    dispersion.disperse(position, velocity, MONTE_CARLO_POSITION_SIGMA, MONTE_CARLO_VELOCITY_SIGMA,
+                        MONTE_CARLO_SAMPLES);
+}
+
+/**
+ * @brief Loads the satellite catalog once
+ *
+ * @return epoch of the newest element set in days since J2000, NaN if none could be used
+ */
+double loadSatellites(Sgp4Catalog& satellites) {
+    std::vector<TwoLineElements> elements;
+    TwoLineElements::load(SATELLITE_TLE_PATH, elements);
+    double newest = std::numeric_limits<double>::quiet_NaN();
+    for (std::size_t i = 0; i < elements.size(); i++) {
+        if (satellites.add(elements[i]) && !(elements[i].epochDays <= newest))
+            newest = elements[i].epochDays;
+    }
+    std::cout << "Loaded " << satellites.size() << " of " << elements.size() << " satellites from "
+              << SATELLITE_TLE_PATH << std::endl;
+    return newest;
+}
+
 /**
  * @brief Function to call when the window size changes so that our viewport keeps the correct size
  *
@@ -175,7 +753,12 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-int main(void) {
+int main(int argc, char** argv) {
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--resume") == 0)
+            loadRequested = true;
+    }
 
     if (!glfwInit()) {
         fprintf(stderr, "Failed to initialize GLFW\n");
@@ -238,33 +821,96 @@ int main(void) {
 
     float AU = 120.0f; // Astronomical Unit, used to scale the solar system
 
+    // All orbits are evaluated here once per frame, the planets only read the results
+    Ephemeris ephemeris(AU);
 
-    Planet sun("../models/Sun_1_1391000.glb", 50.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-
-    // Planeten mit elliptischer Umlaufbahn (letzter Parameter = ellipticity)
-    Planet mercury("../models/Mercury_1_4878.glb", 0.0038f, AU * 0.39f, 42.0f, 10.0f, 0.03f,
-                false, 0.0f, glm::vec4(0.0f), 0.8f);  // sehr elliptisch
-
-    Planet venus("../models/Venus_1_12103.glb", 0.0095f, AU * 0.72f, 16.0f, 10.0f, 177.4f,
-                false, 0.0f, glm::vec4(0.0f), 0.95f);  // fast kreisförmig
+    // Mean J2000 elements from JPL's "Keplerian Elements for Approximate Positions of the Major Planets"
+    KeplerElements mercuryOrbit = jplMeanElements(0);
+    KeplerElements venusOrbit   = jplMeanElements(1);
+    KeplerElements earthOrbit   = jplMeanElements(2);
+    KeplerElements marsOrbit    = jplMeanElements(3);
+    KeplerElements jupiterOrbit = jplMeanElements(4);
+    KeplerElements saturnOrbit  = jplMeanElements(5);
+    KeplerElements uranusOrbit  = jplMeanElements(6);
+    KeplerElements neptuneOrbit = jplMeanElements(7);
 
-    Earth earth("../models/earth(1).glb", "../images/2k_earth_daymap.jpg", "../images/2k_earth_nightmap.jpg", "../images/2k_earth_clouds.jpg", 4.01f, AU * 1.0f, 10.0f, 10.0f, 23.5f, 0.98f,
-                 true, 10.0f, glm::vec4(0.9f, 0.5f, 0.8f, 0.5f));
+    SpkKernel kernel;
+    bool useKernel = kernel.open(SPK_KERNEL_PATH);
+    Vsop87 vsop;
+    bool useVsop = !useKernel && vsop.open(VSOP87_DIRECTORY, VSOP87_MIN_AMPLITUDE);
+    std::vector<double> kernelX, kernelY, kernelZ;
 
-    Planet mars("../models/24881_Mars_1_6792.glb", 0.0053f, AU * 1.52f, 5.0f, 10.0f, 25.2f,
-                true, 5.0f, glm::vec4(0.9f, 0.4f, 0.2f, 0.4f), 0.92f);
+    Planet sun(ephemeris, "../models/Sun_1_1391000.glb", 50.0f, KeplerElements(), 1.0f, 0.0f);
 
-    Planet jupiter("../models/Jupiter_1_142984.glb", 0.112f, AU * 5.20f, 1.0f, 10.0f, 3.1f,
-                false, 0.0f, glm::vec4(0.0f), 0.96f);
+    Planet mercury(ephemeris, "../models/Mercury_1_4878.glb", 0.0038f, mercuryOrbit, 10.0f, 0.03f);
 
-    Planet saturn("../models/Saturn_1_120536.glb", 0.093f, AU * 9.58f, 0.6f, 10.0f, 26.7f,
-                false, 0.0f, glm::vec4(0.0f), 0.95f);
+    Planet venus(ephemeris, "../models/Venus_1_12103.glb", 0.0095f, venusOrbit, 10.0f, 177.4f);
 
-    Planet uranus("../models/Uranus_1_51118.glb", 0.04f, AU * 19.2f, 0.2f, 10.0f, 97.8f,
-                false, 0.0f, glm::vec4(0.0f), 0.94f);
+    Earth earth(ephemeris, "../models/earth(1).glb", "../images/2k_earth_daymap.jpg", "../images/2k_earth_nightmap.jpg", "../images/2k_earth_clouds.jpg", EARTH_DRAWN_RADIUS, earthOrbit, 10.0f, EARTH_AXIAL_TILT,
+                 true, 10.0f, glm::vec4(0.9f, 0.5f, 0.8f, 0.5f));
 
-    Planet neptune("../models/Neptune_1_49528.glb", 0.038f, AU * 30.1f, 0.1f, 10.0f, 28.3f,
-               false, 0.0f, glm::vec4(0.0f), 0.96f);
+    Planet mars(ephemeris, "../models/24881_Mars_1_6792.glb", 0.0053f, marsOrbit, 10.0f, 25.2f,
+                true, 5.0f, glm::vec4(0.9f, 0.4f, 0.2f, 0.4f));
+
+    Planet jupiter(ephemeris, "../models/Jupiter_1_142984.glb", 0.112f, jupiterOrbit, 10.0f, 3.1f);
+
+    Planet saturn(ephemeris, "../models/Saturn_1_120536.glb", 0.093f, saturnOrbit, 10.0f, 26.7f);
+
+    Planet uranus(ephemeris, "../models/Uranus_1_51118.glb", 0.04f, uranusOrbit, 10.0f, 97.8f);
+
+    Planet neptune(ephemeris, "../models/Neptune_1_49528.glb", 0.038f, neptuneOrbit, 10.0f, 28.3f);
+
+    // Masses for the N-body mode, in solar masses (Earth includes the Moon)
+    sun.setMass(1.0);
+    mercury.setMass(1.0 / 6023600.0);
+    venus.setMass(1.0 / 408523.71);
+    earth.setMass(1.0 / 328900.56);
+    mars.setMass(1.0 / 3098708.0);
+    jupiter.setMass(1.0 / 1047.3486);
+    saturn.setMass(1.0 / 3497.898);
+    uranus.setMass(1.0 / 22902.98);
+    neptune.setMass(1.0 / 19412.24);
+
+    // Moons are drawn as points, their positions are the ephemeris' flattened hierarchy
+    std::vector<std::size_t> moons = addMoons(ephemeris);
+    std::vector<float> moonPositions(3 * moons.size());
+
+    ThreadPool threadPool;
+    NBodySystem nbody(threadPool);
+    bool nbodyRunning = false;
+    bool nbodyDebris = false;
+
+    Shader particleShader("../shaders/particle.vs", "../shaders/particle.fs");
+    ParticleRenderer particles;
+    ParticleRenderer moonPoints;
+
+    // Spacecraft feel the sun and the planets on their mean orbits, whatever drives the drawn planets
+    MonteCarloPropagator dispersion(threadPool);
+    for (std::size_t k = 1; k < ephemeris.rootCount(); k++)
+        dispersion.addPerturber(ephemeris.getOrbit(ephemeris.root(k)), ephemeris.getGM(ephemeris.root(k)));
+    ParticleRenderer dispersionPoints;
+
+    // Satellites are drawn relative to the earth model, which has unit radius before its scale
+    Shader satelliteShader("../shaders/satellite.vs", "../shaders/particle.fs");
+    Sgp4Catalog satellites;
+    double satelliteEpoch = std::numeric_limits<double>::quiet_NaN();
+    bool showSatellites = false;
+    SatelliteRenderer satellitePoints(EARTH_DRAWN_RADIUS, EARTH_AXIAL_TILT);
+
+    AsteroidCatalog asteroids;
+    bool showAsteroids = false;
+    ParticleRenderer asteroidPoints;
+
+    // Orbit lines are evaluated on the GPU from elements uploaded once
+    Shader orbitShader("../shaders/orbit.vs", "../shaders/particle.fs");
+    OrbitRenderer planetOrbits;
+    OrbitRenderer moonOrbits;
+    for (std::size_t i = 0; i < ephemeris.size(); i++) {
+        if (ephemeris.getParent(i) == Ephemeris::NO_PARENT)
+            planetOrbits.add(ephemeris, i);
+        else
+            moonOrbits.add(ephemeris, i);
+    }
 
 
 
@@ -327,24 +973,267 @@ int main(void) {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 
+    SimulationClock simulationClock(SIMULATION_STEP, timeWarp.getWarp());
+    simulationClock.start();
+
+    RewindBuffer rewind(REWIND_BUDGET);
+    EncounterDetector encounters;
+    std::vector<double> bodyRadii;
+    for (std::size_t i = 0; i < sizeof(BODY_RADII_KM) / sizeof(BODY_RADII_KM[0]); i++)
+        bodyRadii.push_back(BODY_RADII_KM[i] / KM_PER_AU);
+    encounters.setRadii(bodyRadii.size(), bodyRadii.data());
+    double lastEncounterDays = 0.0;
+    SnapshotWriter snapshotWriter;
+    SimulationSnapshot loadedSnapshot;
+    double lastSnapshotSeconds = 0.0;
+    TrajectoryRecorder trajectoryRecorder(TRAJECTORY_BUDGET);
+    TrajectoryReader trajectoryReader;
+    ReplayState replayState;
+    bool replaying = false;
+
     // main drawing loop
     while (!glfwWindowShouldClose(window)) {
         // per-frame time logic
         // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        int simulationSteps = simulationClock.advance();
+        deltaTime = static_cast<float>(simulationClock.getFrameSeconds());
 
         // input
         // -----
         processInput(window);
 
+        // Snapshots: written on a background thread, loaded through a file mapping
+        // -----
+        if (loadRequested) {
+            loadRequested = false;
+            std::int64_t loadStart = SimulationClock::now();
+            if (SnapshotFile::read(SNAPSHOT_PATH, loadedSnapshot)) {
+                nbodyRunning = restoreSnapshot(loadedSnapshot, simulationClock, nbody);
+                nbodyDebris = debrisMode;
+                simulationSteps = 0;
+                lastSnapshotSeconds = 0.0;
+                rewind.clear();
+                encounters.reset();
+                lastEncounterDays = nbody.getTime();
+                stopRecording(trajectoryRecorder);
+                replaying = false;
+                if (nbodyRunning)
+                    showNBodyState(nbody, ephemeris, particles);
+                std::cout << "Loaded " << loadedSnapshot.bodyCount() << " bodies from " << SNAPSHOT_PATH << " in "
+                          << (SimulationClock::now() - loadStart) * 1e-6 << " ms" << std::endl;
+            } else {
+                std::cerr << "Could not load snapshot " << SNAPSHOT_PATH << std::endl;
+            }
+        }
+
+        // Rewind: the analytic orbits and a replay can go anywhere, the N-body state only as far back as it was recorded
+        // -----
+        if (rewindRequest != 0) {
+            double target = simulationClock.getDays() + rewindRequest * REWIND_JUMP * timeWarp.getWarp() / SECONDS_PER_DAY;
+            rewindRequest = 0;
+            if (nbodyMode && nbodyRunning && !rewind.empty()) {
+                target = std::min(std::max(target, rewind.oldest()), rewind.newest());
+                if (rewind.seek(target, nbody, NBODY_MAX_BLOCK)) {
+                    simulationClock.seek(target);
+                    simulationSteps = 0;
+                    encounters.reset();
+                    lastEncounterDays = target;
+                    stopRecording(trajectoryRecorder);
+                    showNBodyState(nbody, ephemeris, particles);
+                    std::cout << "Rewound to day " << target << " with " << nbody.size() << " bodies in " << rewind.lastSeekMilliseconds() << " ms ("
+                              << rewind.lastSeekDecoded() << " states decoded); history of " << rewind.size()
+                              << " states from day " << rewind.oldest() << " uses "
+                              << rewind.memoryUsed() / 1048576.0 << " of " << rewind.capacity() / 1048576.0
+                              << " MB, compressed " << rewind.compressionRatio() << ":1" << std::endl;
+                }
+            } else if (!nbodyMode || replaying) {
+                simulationClock.seek(target);
+                ephemeris.resetHistory();
+            }
+        }
+
+        // Trajectory recording and replay, both in the N-body mode only
+        // -----
+        if (recordRequested) {
+            recordRequested = false;
+            if (trajectoryRecorder.isOpen())
+                stopRecording(trajectoryRecorder);
+            else if (nbodyMode && nbodyRunning && !replaying && trajectoryRecorder.open(TRAJECTORY_PATH)) {
+                std::cout << "Recording to " << TRAJECTORY_PATH << std::endl;
+                if (nbody.size() > trajectoryRecorder.maxBodies())
+                    std::cout << "Only the first " << trajectoryRecorder.maxBodies() << " of " << nbody.size()
+                              << " bodies fit the " << (TRAJECTORY_BUDGET >> 20) << " MB recording budget"
+                              << std::endl;
+            }
+        }
+        if (replayRequested || (replaying && !nbodyMode)) {
+            replayRequested = false;
+            if (replaying || !nbodyMode) {
+                replaying = false;
+            } else {
+                stopRecording(trajectoryRecorder);
+                if (trajectoryReader.open(TRAJECTORY_PATH) && !trajectoryReader.empty()) {
+                    // The simulation restarts from the orbits at wherever the replay stops
+                    replaying = true;
+                    nbodyRunning = false;
+                    simulationClock.seek(trajectoryReader.days(0));
+                    simulationSteps = 0;
+                    ephemeris.resetHistory();
+                    std::cout << "Replaying " << trajectoryReader.steps() << " steps from " << TRAJECTORY_PATH
+                              << std::endl;
+                } else {
+                    std::cerr << "Nothing recorded in " << TRAJECTORY_PATH << std::endl;
+                }
+            }
+        }
+
+        // Monte Carlo spacecraft, launched at the drawn time
+        // -----
+        if (launchRequested) {
+            launchRequested = false;
+            if (dispersion.empty()) {
+                launchDispersion(dispersion, ephemeris, simulationClock.getRenderDays());
+                std::cout << "Launched " << dispersion.size() << " spacecraft towards Mars" << std::endl;
+            } else {
+                std::cout << "Removed " << dispersion.size() << " spacecraft after " << dispersion.acceptedSteps()
+                          << " batch steps (" << dispersion.rejectedSteps() << " rejected)" << std::endl;
+                dispersion.clear(0.0);
+                dispersionPoints.update(dispersion.x(), dispersion.y(), dispersion.z(), 0, AU);
+            }
+        }
+
+        // Satellites, loaded the first time they are shown
+        // -----
+        if (satellitesRequested) {
+            satellitesRequested = false;
+            if (!showSatellites && satellites.empty())
+                satelliteEpoch = loadSatellites(satellites);
+            showSatellites = !showSatellites && !satellites.empty();
+            if (showSatellites && !nbodyMode && satelliteEpoch == satelliteEpoch) {
+                simulationClock.seek(satelliteEpoch);
+                ephemeris.resetHistory();
+                timeWarp.setWarp(1.0);
+            }
+        }
+
+        // Asteroids, loaded the first time they are shown
+        // -----
+        if (asteroidsRequested) {
+            asteroidsRequested = false;
+            if (!showAsteroids && asteroids.empty()) {
+                const double start = glfwGetTime();
+                if (asteroids.load(threadPool, ASTEROID_CATALOG_PATH))
+                    std::cout << "Loaded " << asteroids.size() << " asteroids from the "
+                              << (asteroids.fromCache() ? "cache" : "text") << " in " << glfwGetTime() - start << " s"
+                              << std::endl;
+            }
+            showAsteroids = !showAsteroids && !asteroids.empty();
+        }
+
+        if (saveRequested || simulationClock.getWallSeconds() - lastSnapshotSeconds >= SNAPSHOT_INTERVAL) {
+            saveRequested = false;
+            lastSnapshotSeconds = simulationClock.getWallSeconds();
+            captureSnapshot(snapshotWriter.capture(), simulationClock, nbody, nbodyRunning);
+            snapshotWriter.submit(SNAPSHOT_PATH);
+        }
+
+        // Fixed simulation steps, the N-body integrator sub-steps each one as its bodies need
+        // -----
+        simulationClock.setWarp(timeWarp.getWarp());
+        if (nbodyMode && nbodyRunning)
+            applyStepScales(nbody, timeWarp, camera.Position, AU);
+        if (simulationSteps > timeWarp.maxSteps())
+            simulationSteps = timeWarp.maxSteps();
+        std::int64_t simulationStart = SimulationClock::now();
+        for (int step = 0; step < simulationSteps; step++) {
+            simulationClock.step();
+            if (!nbodyMode || replaying)
+                continue;
+
+            double simulationDays = simulationClock.getDays();
+            if (!nbodyRunning || nbodyDebris != debrisMode) {
+                configureNBody(nbody, debrisMode);
+                if (debrisMode)
+                    startNBody(nbody, ephemeris, simulationDays, NBODY_DEBRIS_PARTICLES,
+                               NBODY_DEBRIS_MASS * GM_SUN / NBODY_DEBRIS_PARTICLES);
+                else
+                    startNBody(nbody, ephemeris, simulationDays, NBODY_TEST_PARTICLES, 0.0);
+                rewind.clear();
+                encounters.reset();
+                lastEncounterDays = simulationDays;
+                stopRecording(trajectoryRecorder);
+                nbodyRunning = true;
+                nbodyDebris = debrisMode;
+            }
+            nbody.advanceTo(simulationDays, NBODY_MAX_BLOCK);
+            if (simulationClock.getSteps() % ENCOUNTER_STEPS == 0) {
+                // Swept over the time since the last check, so fast bodies cannot pass through each other
+                encounters.detect(threadPool, nbody.size(), nbody.x(), nbody.y(), nbody.z(),
+                                  nbody.vx(), nbody.vy(), nbody.vz(), nbody.gm(), simulationDays - lastEncounterDays);
+                lastEncounterDays = simulationDays;
+                handleEncounters(encounters, nbody, ephemeris.rootCount());
+            }
+            ephemeris.update(simulationDays, nbody.x(), nbody.y(), nbody.z());
+            if (simulationClock.getSteps() % REWIND_RECORD_STEPS == 0 && simulationClock.getWarp() > 0.0)
+                rewind.record(nbody);
+            // Never waits for the disk; steps the writer cannot keep up with are dropped and counted
+            if (simulationClock.getSteps() % TRAJECTORY_RECORD_STEPS == 0 && simulationClock.getWarp() > 0.0 &&
+                trajectoryRecorder.isOpen())
+                trajectoryRecorder.record(nbody);
+        }
+        timeWarp.record(simulationSteps, (SimulationClock::now() - simulationStart) * 1e-9);
+
+        if (replaying) {
+            if (!showRecordedState(trajectoryReader, simulationClock.getRenderDays(), replayState, ephemeris, particles)) {
+                replaying = false;
+                std::cout << "Replay finished" << std::endl;
+            }
+        } else if (nbodyMode) {
+            // Draw the simulated bodies between the last two steps so motion stays smooth at any frame rate
+            ephemeris.interpolate(simulationClock.getAlpha());
+            if (simulationSteps > 0) {
+                std::size_t bodies = ephemeris.rootCount();
+                particles.update(nbody.x() + bodies, nbody.y() + bodies, nbody.z() + bodies,
+                                 nbody.size() - bodies, ephemeris.getSceneScale());
+            }
+        } else {
+            // The orbits and the kernel are exact at any time, so they are evaluated at the drawn time;
+            // the orbits only for the bodies that moved far enough on screen to tell
+            nbodyRunning = false;
+            double renderDays = simulationClock.getRenderDays();
+            float pixelsPerRadian = 0.5f * SCR_HEIGHT / std::tan(0.5f * glm::radians(camera.Zoom));
+            if (useKernel && kernelPositions(kernel, ephemeris.rootCount(), renderDays, kernelX, kernelY, kernelZ))
+                ephemeris.update(renderDays, kernelX.data(), kernelY.data(), kernelZ.data());
+            else if (useVsop && vsopPositions(vsop, ephemeris.rootCount(), renderDays, kernelX, kernelY, kernelZ))
+                ephemeris.update(renderDays, kernelX.data(), kernelY.data(), kernelZ.data());
+            else
+                ephemeris.updateMultiRate(renderDays, camera.Position, pixelsPerRadian, POSITION_TOLERANCE);
+        }
+
+        // The spacecraft integrate forwards or backwards to the drawn time, so they follow rewinds too
+        if (!dispersion.empty()) {
+            dispersion.advanceTo(simulationClock.getRenderDays());
+            dispersionPoints.update(dispersion.x(), dispersion.y(), dispersion.z(), dispersion.size(),
+                                    ephemeris.getSceneScale());
+        }
+
+        if (showSatellites) {
+            satellites.update(threadPool, simulationClock.getRenderDays(), SATELLITE_BUDGET / timeWarp.getDegradation());
+            satellitePoints.update(satellites.x(), satellites.y(), satellites.z(), satellites.size(),
+                                   SGP4_EARTH_RADIUS_KM);
+        }
+
+        if (showAsteroids) {
+            asteroids.update(threadPool, simulationClock.getRenderDays(), ephemeris.getSceneScale(),
+                             ASTEROID_BUDGET / timeWarp.getDegradation());
+            asteroidPoints.update(asteroids.positions(), asteroids.size());
+        }
 
         // Camera orbiting logic
         // -----
         if (camera.isOrbiting) {
             // Get the Earth current world position
-            glm::vec3 earthPos = glm::vec3(earth.getModelMatrix() * glm::vec4(0.0, 0.0, 0.0, 1.0));
+            glm::vec3 earthPos = earth.getPosition();
 
             // Define orbit parameters
             float orbitRadius = 15.0f;  // How far from the Earth to orbit
@@ -352,8 +1241,10 @@ int main(void) {
             float orbitHeight = 1.0f;   // How high above the Earth's equator to be
 
             // Calculate the new camera position
-            camera.Position.x = earthPos.x + orbitRadius * cos(currentFrame * orbitSpeed);
-            camera.Position.z = earthPos.z + orbitRadius * sin(currentFrame * orbitSpeed);
+            // Reduced in double precision, a float clock loses its fraction after a few days of uptime
+            float orbitAngle = static_cast<float>(std::fmod(simulationClock.getWallSeconds() * orbitSpeed, TWO_PI));
+            camera.Position.x = earthPos.x + orbitRadius * cos(orbitAngle);
+            camera.Position.z = earthPos.z + orbitRadius * sin(orbitAngle);
             camera.Position.y = earthPos.y + orbitHeight;
 
             camera.lookAt(earthPos);
@@ -369,8 +1260,7 @@ int main(void) {
         // -----
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 4000.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 sunModelMatrix = sun.getModelMatrix();
-        glm::vec3 sunPos = glm::vec3(sunModelMatrix * glm::vec4(0.0, 0.0, 0.0, 1.0));
+        glm::vec3 sunPos = sun.getPosition();
 
         // Skybox
         // ------
@@ -409,7 +1299,7 @@ int main(void) {
         earthShader.setMat4("projection", projection);
         earthShader.setMat4("view", view);
         earthShader.setVec3("lightPos", sunPos);
-        earthShader.setFloat("u_time", (float)glfwGetTime());
+        earthShader.setFloat("u_time", static_cast<float>(std::fmod(simulationClock.getWallSeconds(), CLOUD_PERIOD)));
         earth.Draw(earthShader);
 
         // Other planets
@@ -426,6 +1316,71 @@ int main(void) {
         uranus.Draw(planetShader);
         neptune.Draw(planetShader);
 
+        // Orbits, blended over the planets without hiding anything behind them
+        if (showOrbits) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            orbitShader.use();
+            orbitShader.setMat4("projection", projection);
+            orbitShader.setMat4("view", view);
+            orbitShader.setVec4("color", 0.4f, 0.6f, 0.9f, 0.35f);
+            planetOrbits.Draw(orbitShader, ephemeris, static_cast<float>(SCR_HEIGHT));
+            orbitShader.setVec4("color", 0.7f, 0.7f, 0.7f, 0.25f);
+            moonOrbits.Draw(orbitShader, ephemeris, static_cast<float>(SCR_HEIGHT));
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
+        }
+
+        // Moons
+        for (std::size_t k = 0; k < moons.size(); k++) {
+            glm::vec3 position = ephemeris.getPosition(moons[k]);
+            moonPositions[3 * k + 0] = position.x;
+            moonPositions[3 * k + 1] = position.y;
+            moonPositions[3 * k + 2] = position.z;
+        }
+        moonPoints.update(moonPositions.data(), moons.size());
+        particleShader.use();
+        particleShader.setMat4("projection", projection);
+        particleShader.setMat4("view", view);
+        particleShader.setFloat("pointSize", 4.0f);
+        particleShader.setVec4("color", 0.75f, 0.75f, 0.7f, 1.0f);
+        moonPoints.Draw();
+
+        // Monte Carlo spacecraft
+        if (!dispersion.empty()) {
+            particleShader.setFloat("pointSize", 1.5f);
+            particleShader.setVec4("color", 0.4f, 0.95f, 0.6f, 1.0f);
+            dispersionPoints.Draw();
+        }
+
+        // Asteroid catalog
+        if (showAsteroids) {
+            particleShader.setFloat("pointSize", 1.0f);
+            particleShader.setVec4("color", 0.6f, 0.55f, 0.5f, 1.0f);
+            asteroidPoints.Draw();
+        }
+
+        // Satellites
+        if (showSatellites) {
+            satelliteShader.use();
+            satelliteShader.setMat4("projection", projection);
+            satelliteShader.setMat4("view", view);
+            satelliteShader.setFloat("pointSize", 1.5f);
+            satelliteShader.setVec4("color", 0.95f, 0.85f, 0.45f, 1.0f);
+            satellitePoints.Draw(satelliteShader, earth.getPosition());
+        }
+
+        // Test particles of the N-body mode
+        if (nbodyMode) {
+            particleShader.use();
+            particleShader.setMat4("projection", projection);
+            particleShader.setMat4("view", view);
+            particleShader.setFloat("pointSize", 2.0f);
+            particleShader.setVec4("color", 0.8f, 0.75f, 0.65f, 1.0f);
+            particles.Draw();
+        }
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
@@ -0,0 +1,37 @@
+#version 330 core
+// One orbit per instance, one point of the ellipse per vertex; no vertex buffer is read
+layout (location = 0) in vec3 aMajor;           // periapsis direction times the semi-major axis
+layout (location = 1) in vec3 aMinor;           // 90 degrees ahead times the semi-minor axis
+layout (location = 2) in float aEccentricity;
+layout (location = 3) in float aCenter;         // index into centers
+
+const int MAX_CENTERS = 32;
+const float TWO_PI = 6.28318530718;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 centers[MAX_CENTERS];
+uniform int segments;           // power of two, the draw call has segments + 1 vertices
+uniform float viewportHeight;   // pixels
+uniform float tolerance;        // largest gap between the ellipse and its chords, pixels
+
+void main() {
+    vec3 ellipseCenter = centers[int(aCenter)] - aEccentricity * aMajor;
+    float a = length(aMajor);
+
+    // Radius in pixels as seen from the nearest point of the orbit
+    float distance = max(length((view * vec4(ellipseCenter, 1.0)).xyz) - a, 1e-3 * a);
+    float radius = a * projection[1][1] * 0.5 * viewportHeight / distance;
+
+    // A chord of angle d strays r d^2 / 8 from the circle, so tolerance fixes the chord count;
+    // uniform steps in eccentric anomaly are already denser near periapsis, where curvature is highest
+    float needed = TWO_PI / sqrt(8.0 * tolerance / max(radius, 1e-6));
+    int count = int(exp2(ceil(log2(clamp(needed, 4.0, float(segments))))));
+    int stride = max(segments / count, 1);
+
+    // Vertices between the kept ones collapse onto them, their zero-length segments draw nothing
+    int index = gl_VertexID / stride * stride;
+    float E = TWO_PI * float(index) / float(segments);
+    vec3 position = ellipseCenter + cos(E) * aMajor + sin(E) * aMinor;
+    gl_Position = projection * view * vec4(position, 1.0);
+}
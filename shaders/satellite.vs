@@ -0,0 +1,14 @@
+#version 330 core
+// One satellite per instance, a single point each; positions stay relative to the earth
+layout (location = 0) in vec3 aPosition;        // TEME, earth radii
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 center;            // the earth in the scene
+uniform mat3 orientation;       // TEME -> scene axes, times the drawn earth radius
+uniform float pointSize;
+
+void main() {
+    gl_Position = projection * view * vec4(center + orientation * aPosition, 1.0);
+    gl_PointSize = pointSize;
+}
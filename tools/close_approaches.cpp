@@ -0,0 +1,160 @@
+/**
+ * @brief Screens an asteroid catalog for close approaches to a planet
+ *
+ * Usage: close_approaches [catalog] [first] [days] [distance] [body] [bucket days] [output]
+ *
+ * Loads the Minor Planet Center catalog (../data/MPCORB.DAT by default, see AsteroidCatalog)
+ * or, when it is missing, makes up 300000 orbits with a share of near-earth ones. Builds
+ * the close-approach index from first (YYYY-MM-DD or days since J2000, 2026-01-01 by
+ * default) over days (365) and lists every approach to within distance AU (0.05) of the
+ * body (earth; mercury to mars), all on two-body orbits. Writes them to output
+ * (approaches.csv) and checks the index against a scan without it over part of the catalog.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AsteroidCatalog.hpp"
+#include "Calendar.hpp"
+#include "CloseApproaches.hpp"
+#include "Kepler.hpp"
+#include "SpkKernel.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+const std::size_t SYNTHETIC_ORBITS = 300000;
+const std::size_t SCAN_ORBITS = 20000;
+
+struct Body {
+    const char* name;
+    int planet;     // row of JPL_MEAN_ELEMENTS
+};
+
+const Body BODIES[] = {
+    { "mercury", 0 },
+    { "venus",   1 },
+    { "earth",   2 },
+    { "mars",    3 },
+};
+
+const Body* findBody(const char* name) {
+    for (std::size_t i = 0; i < sizeof(BODIES) / sizeof(BODIES[0]); i++) {
+        if (std::strcmp(BODIES[i].name, name) == 0)
+            return &BODIES[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Mostly main belt orbits, one in ten crossing the inner planets'
+ */
+std::vector<KeplerElements> syntheticOrbits(std::size_t count) {
+    std::vector<KeplerElements> orbits(count);
+    std::srand(5);
+    for (std::size_t i = 0; i < count; i++) {
+        const double u = static_cast<double>(std::rand()) / RAND_MAX;
+        const double r = static_cast<double>(std::rand()) / RAND_MAX;
+        const bool nearEarth = u < 0.1;
+        const double a = nearEarth ? 0.8 + 1.6 * r : 2.1 + 1.3 * r;
+        const double e = nearEarth ? 0.7 * std::rand() / RAND_MAX : 0.25 * std::rand() / RAND_MAX;
+        const double incl = (nearEarth ? 30.0 : 20.0) * std::rand() / RAND_MAX;
+        orbits[i] = KeplerElements::fromLongitudes(a, e, incl, 360.0 * std::rand() / RAND_MAX,
+                                                   360.0 * std::rand() / RAND_MAX, 360.0 * std::rand() / RAND_MAX);
+    }
+    return orbits;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : "../data/MPCORB.DAT";
+    const double first = calendar::parse(argc > 2 ? argv[2] : "2026-01-01");
+    const double days = argc > 3 ? std::atof(argv[3]) : 365.0;
+    const double distance = argc > 4 ? std::atof(argv[4]) : 0.05;
+    const Body* body = findBody(argc > 5 ? argv[5] : "earth");
+    const double bucketDays = argc > 6 ? std::atof(argv[6]) : 16.0;
+    const std::string output = argc > 7 ? argv[7] : "approaches.csv";
+    if (body == NULL || !(days > 0.0) || !(distance > 0.0) || !(bucketDays > 0.0)) {
+        std::fprintf(stderr, "usage: close_approaches [catalog] [first date] [days] [distance AU] "
+                             "[mercury|venus|earth|mars] [bucket days] [output]\n");
+        return 1;
+    }
+    const KeplerElements bodyOrbit = jplMeanElements(body->planet);
+
+    ThreadPool pool;
+    AsteroidCatalog catalog;
+    CloseApproachIndex index;
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    const bool fromCatalog = catalog.load(pool, path);
+    if (fromCatalog) {
+        index.setOrbits(pool, catalog);
+    } else {
+        std::printf("Screening %zu made-up orbits instead\n", SYNTHETIC_ORBITS);
+        index.setOrbits(syntheticOrbits(SYNTHETIC_ORBITS));
+    }
+    const double loadSeconds = secondsSince(start);
+
+    start = Clock::now();
+    index.build(pool, first, first + days, bucketDays);
+    const double buildSeconds = secondsSince(start);
+
+    std::vector<CloseApproach> approaches;
+    start = Clock::now();
+    index.query(pool, bodyOrbit, first, first + days, distance, approaches);
+    const double querySeconds = secondsSince(start);
+
+    // The same screening without the index, over the first orbits only
+    const std::size_t scanned = std::min(SCAN_ORBITS, index.size());
+    std::vector<CloseApproach> reference;
+    start = Clock::now();
+    index.scan(pool, bodyOrbit, first, first + days, distance, reference, scanned);
+    const double scanSeconds = secondsSince(start);
+    std::size_t matched = 0, expected = 0;
+    for (std::size_t i = 0; i < approaches.size(); i++)
+        expected += approaches[i].object < scanned;
+    for (std::size_t i = 0; i < reference.size(); i++) {
+        for (std::size_t k = 0; k < approaches.size(); k++) {
+            if (approaches[k].object == reference[i].object &&
+                std::fabs(approaches[k].days - reference[i].days) < 1e-6) {
+                matched++;
+                break;
+            }
+        }
+    }
+
+    const std::size_t shown = approaches.size() < 20 ? approaches.size() : 20;
+    for (std::size_t i = 0; i < shown; i++) {
+        const CloseApproach& a = approaches[i];
+        std::printf("%s  %-8s %.5f AU  %5.2f km/s\n", calendar::format(a.days, true).c_str(),
+                    fromCatalog ? catalog.designation(a.object).c_str() : std::to_string(a.object).c_str(),
+                    a.distance, a.speed * KM_PER_AU / SECONDS_PER_DAY);
+    }
+    if (shown < approaches.size())
+        std::printf("... %zu more\n", approaches.size() - shown);
+
+    if (!CloseApproachIndex::write(output, approaches, fromCatalog ? &catalog : NULL, KM_PER_AU)) {
+        std::fprintf(stderr, "Could not write %s\n", output.c_str());
+        return 1;
+    }
+    std::printf("\n%zu orbits, %s to %s, within %.3f AU of %s\n", index.size(), calendar::format(first).c_str(),
+                calendar::format(first + days).c_str(), distance, body->name);
+    std::printf("load:   %.3f s\n", loadSeconds);
+    std::printf("build:  %.3f s for %zu buckets of %.0f days, %.0f MB, on %u threads\n", buildSeconds,
+                index.buckets(), bucketDays, index.memory() / 1048576.0, pool.size());
+    std::printf("query:  %.3f s, %zu approaches written to %s\n", querySeconds, approaches.size(), output.c_str());
+    std::printf("scan:   %.3f s for %zu orbits without the index, about %.0f s for all of them\n", scanSeconds,
+                scanned, scanSeconds * index.size() / (scanned > 0 ? scanned : 1));
+    std::printf("check:  %zu of %zu approaches the scan found are in the query, which has %zu for those orbits\n",
+                matched, reference.size(), expected);
+    return matched == reference.size() && expected == reference.size() ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/**
+ * @brief Measures Monte Carlo propagation of dispersed spacecraft through the planets
+ *
+ * Usage: dispersion_bench [samples] [days]
+ *
+ * Disperses samples around a Hohmann transfer from Earth towards Mars and propagates them
+ * on one thread and on all of them. A few samples are propagated again on their own with a
+ * much tighter tolerance to check that sharing a step within a batch costs no accuracy.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "MonteCarlo.hpp"
+
+namespace {
+
+const std::size_t REFERENCE_SAMPLES = 16;
+
+void addPlanets(MonteCarloPropagator& propagator, const KeplerElements* orbits, const double* masses,
+                std::size_t planets) {
+    for (std::size_t k = 0; k < planets; k++)
+        propagator.addPerturber(orbits[k], masses[k] * GM_SUN);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::size_t samples = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 100000;
+    double days = argc > 2 ? std::atof(argv[2]) : 200.0;
+
+    KeplerElements orbits[PLANET_COUNT];
+    for (int k = 0; k < PLANET_COUNT; k++)
+        orbits[k] = jplMeanElements(k);
+    const double masses[] = { 1.0 / 6023600.0, 1.0 / 408523.71, 1.0 / 328900.56, 1.0 / 3098708.0,
+                              1.0 / 1047.3486, 1.0 / 3497.898, 1.0 / 22902.98, 1.0 / 19412.24 };
+    const std::size_t planets = PLANET_COUNT;
+
+    // Just outside Earth's Hill sphere, with the perihelion speed of a transfer to Mars' distance
+    double earthPosition[3], earthVelocity[3];
+    elementsToState(orbits[2], 0.0, GM_SUN, earthPosition, earthVelocity);
+    double r = std::sqrt(earthPosition[0] * earthPosition[0] + earthPosition[1] * earthPosition[1] +
+                         earthPosition[2] * earthPosition[2]);
+    double boost = std::sqrt(2.0 * orbits[3].semiMajorAxis / (r + orbits[3].semiMajorAxis));
+    double position[3], velocity[3];
+    for (int k = 0; k < 3; k++) {
+        position[k] = earthPosition[k] * (1.0 + 0.01 / r);
+        velocity[k] = earthVelocity[k] * boost;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    double seconds[2] = { 0.0, 0.0 };
+    std::uint64_t accepted = 0, rejected = 0;
+    std::vector<double> initial[6], final[6];
+    const unsigned int threadCounts[2] = { 1, 0 };
+    unsigned int threads = 1;
+    for (int run = 0; run < 2; run++) {
+        ThreadPool pool(threadCounts[run]);
+        MonteCarloPropagator propagator(pool);
+        addPlanets(propagator, orbits, masses, planets);
+        propagator.clear(0.0);
+        propagator.disperse(position, velocity, 1e-5, 1e-5, samples);
+        if (run == 1) {
+            threads = pool.size();
+            const double* columns[6] = { propagator.x(), propagator.y(), propagator.z(),
+                                         propagator.vx(), propagator.vy(), propagator.vz() };
+            for (int c = 0; c < 6; c++)
+                initial[c].assign(columns[c], columns[c] + samples);
+        }
+
+        Clock::time_point start = Clock::now();
+        propagator.advanceTo(days);
+        seconds[run] = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (run == 1) {
+            accepted = propagator.acceptedSteps();
+            rejected = propagator.rejectedSteps();
+            const double* columns[6] = { propagator.x(), propagator.y(), propagator.z(),
+                                         propagator.vx(), propagator.vy(), propagator.vz() };
+            for (int c = 0; c < 6; c++)
+                final[c].assign(columns[c], columns[c] + samples);
+        }
+    }
+
+    // Samples spread over the batches, each on its own with a tight tolerance
+    double maxError = 0.0;
+    {
+        ThreadPool pool(1);
+        const std::size_t references = samples < REFERENCE_SAMPLES ? samples : REFERENCE_SAMPLES;
+        for (std::size_t k = 0; k < references; k++) {
+            std::size_t i = k * (samples / references);
+            MonteCarloPropagator reference(pool, 1e-13, 1e-16);
+            addPlanets(reference, orbits, masses, planets);
+            reference.clear(0.0);
+            double p[3] = { initial[0][i], initial[1][i], initial[2][i] };
+            double v[3] = { initial[3][i], initial[4][i], initial[5][i] };
+            reference.addSample(p, v);
+            reference.advanceTo(days);
+            double dx = reference.x()[0] - final[0][i], dy = reference.y()[0] - final[1][i];
+            double dz = reference.z()[0] - final[2][i];
+            maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+    }
+
+    // Spread of the cloud at the end
+    double mean[3] = { 0.0, 0.0, 0.0 }, spread = 0.0;
+    for (std::size_t i = 0; i < samples; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += final[c][i] / samples;
+    for (std::size_t i = 0; i < samples; i++)
+        for (int c = 0; c < 3; c++)
+            spread += (final[c][i] - mean[c]) * (final[c][i] - mean[c]) / samples;
+
+    char label[32];
+    std::snprintf(label, sizeof(label), "%u threads:", threads);
+    const double sampleSteps = static_cast<double>(accepted + rejected) * MonteCarloPropagator::BATCH;
+    std::printf("samples:              %zu over %.0f days\n", samples, days);
+    std::printf("batch steps:          %llu accepted, %llu rejected (%.1f per batch)\n",
+                static_cast<unsigned long long>(accepted), static_cast<unsigned long long>(rejected),
+                (accepted + rejected) / std::ceil(static_cast<double>(samples) / MonteCarloPropagator::BATCH));
+    std::printf("simd width:           %d doubles\n", simd::DOUBLE_WIDTH);
+    std::printf("1 thread:             %.3f s, %.3e sample steps/s\n", seconds[0], sampleSteps / seconds[0]);
+    std::printf("%-22s%.3f s, %.3e sample steps/s (%.1fx)\n", label, seconds[1],
+                sampleSteps / seconds[1], seconds[0] / seconds[1]);
+    std::printf("max error vs single:  %.3e AU\n", maxError);
+    std::printf("cloud spread:         %.3e AU rms\n", std::sqrt(spread));
+    return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @brief Runs an ensemble of perturbed solar systems and writes how each one fared
+ *
+ * Usage: ensemble [variants] [years] [step days] [mass spread] [eccentricity spread] [output]
+ *
+ * Starts the sun and the eight planets from their J2000 orbits, makes variants (1024 by
+ * default) whose planet masses and eccentricities are drawn around the nominal ones with
+ * the given relative mass spread (0.1) and eccentricity spread (0.01), integrates all of
+ * them for years (100) with a fixed step (2 days) and writes one line per variant to
+ * output (ensemble.csv). For comparison, a few variants are integrated one at a time with
+ * NBodySystem, as separate runs would, and variant 0 is checked against that.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Ensemble.hpp"
+#include "NBody.hpp"
+
+namespace {
+
+const std::size_t SEPARATE_RUNS = 4;
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t variants = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1024;
+    const double years = argc > 2 ? std::atof(argv[2]) : 100.0;
+    const double step = argc > 3 ? std::atof(argv[3]) : 2.0;
+    const double massSpread = argc > 4 ? std::atof(argv[4]) : 0.1;
+    const double eccentricitySpread = argc > 5 ? std::atof(argv[5]) : 0.01;
+    const std::string output = argc > 6 ? argv[6] : "ensemble.csv";
+    if (variants == 0 || !(years > 0.0) || !(step > 0.0)) {
+        std::fprintf(stderr, "usage: ensemble [variants] [years] [step days] [mass spread] "
+                             "[eccentricity spread] [output]\n");
+        return 1;
+    }
+    const double days = years * 365.25;
+
+    const char* names[] = { "mercury", "venus", "earth", "mars", "jupiter", "saturn", "uranus", "neptune" };
+    const double masses[] = { 1.0 / 6023600.0, 1.0 / 408523.71, 1.0 / 328900.56, 1.0 / 3098708.0,
+                              1.0 / 1047.3486, 1.0 / 3497.898, 1.0 / 22902.98, 1.0 / 19412.24 };
+    const std::size_t planets = PLANET_COUNT;
+
+    ThreadPool single(1);
+    ThreadPool pool;
+    EnsembleSystem ensemble(pool);
+    for (std::size_t k = 0; k < planets; k++)
+        ensemble.addBody(names[k], jplMeanElements(static_cast<int>(k)), masses[k] * GM_SUN);
+    ensemble.createVariants(variants, massSpread, eccentricitySpread, 0.0);
+
+    // Separate runs: the same variants one system at a time, through the plain N-body integrator
+    const std::size_t separate = variants < SEPARATE_RUNS ? variants : SEPARATE_RUNS;
+    const std::size_t steps = static_cast<std::size_t>(std::ceil(days / step));
+    std::vector<double> x0(planets + 1), y0(planets + 1), z0(planets + 1);
+    Clock::time_point start = Clock::now();
+    for (std::size_t v = 0; v < separate; v++) {
+        NBodySystem system(single);
+        std::vector<double> x(planets + 1), y(planets + 1), z(planets + 1), vx(planets + 1), vy(planets + 1),
+            vz(planets + 1), gm(planets + 1);
+        for (std::size_t b = 0; b <= planets; b++) {
+            x[b] = ensemble.x(b)[v]; y[b] = ensemble.y(b)[v]; z[b] = ensemble.z(b)[v];
+            vx[b] = ensemble.vx(b)[v]; vy[b] = ensemble.vy(b)[v]; vz[b] = ensemble.vz(b)[v];
+            gm[b] = ensemble.gm(v, b);
+        }
+        system.setState(0.0, planets + 1, x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data(), gm.data());
+        for (std::size_t s = 0; s < steps; s++)
+            system.step(days / steps);
+        if (v == 0) {
+            x0.assign(system.x(), system.x() + planets + 1);
+            y0.assign(system.y(), system.y() + planets + 1);
+            z0.assign(system.z(), system.z() + planets + 1);
+        }
+    }
+    const double separateSeconds = secondsSince(start) / separate;
+
+    start = Clock::now();
+    ensemble.run(days, step);
+    const double ensembleSeconds = secondsSince(start);
+
+    double difference = 0.0;
+    for (std::size_t b = 0; b <= planets; b++) {
+        const double dx = ensemble.x(b)[0] - x0[b], dy = ensemble.y(b)[0] - y0[b], dz = ensemble.z(b)[0] - z0[b];
+        difference = std::max(difference, std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+
+    std::size_t unstable = 0;
+    double worstEnergy = 0.0;
+    for (std::size_t v = 0; v < ensemble.size(); v++) {
+        unstable += ensemble.unstableAt(v) >= 0.0;
+        worstEnergy = std::max(worstEnergy, ensemble.energyError(v));
+    }
+    if (!ensemble.write(output)) {
+        std::fprintf(stderr, "Could not write %s\n", output.c_str());
+        return 1;
+    }
+
+    const double perVariant = ensembleSeconds / variants;
+    std::printf("%zu variants of the sun and %zu planets, %.0f years in %zu steps of %.2f days\n", variants,
+                planets, years, steps, days / steps);
+    std::printf("ensemble: %.3f s on %u threads, %.2f ms per variant\n", ensembleSeconds, pool.size(),
+                perVariant * 1e3);
+    std::printf("separate: %.2f ms per variant, about %.1f s for all of them, %.1fx slower\n",
+                separateSeconds * 1e3, separateSeconds * variants, separateSeconds / perVariant);
+    std::printf("results:  %zu unstable, worst energy error %.2e, written to %s\n", unstable, worstEnergy,
+                output.c_str());
+    std::printf("check:    variant 0 is %.2e AU from the separate run\n", difference);
+    return difference < 1e-6 ? 0 : 1;
+}
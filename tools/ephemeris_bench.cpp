@@ -0,0 +1,84 @@
+/**
+ * @brief Measures headless batch ephemeris queries against the scalar double precision path
+ *
+ * Usage: ephemeris_bench [queries] [bodies]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BatchEphemeris.hpp"
+
+int main(int argc, char** argv) {
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 4000000;
+    std::size_t bodies = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 1000;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // Heliocentric bodies, every tenth one with a moon around the one before it
+    BatchEphemeris ephemeris;
+    std::vector<KeplerElements> orbits;
+    std::vector<double> mu;
+    for (std::size_t i = 0; i < bodies; i++) {
+        bool moon = i % 10 == 9;
+        double a = moon ? 0.001 + 0.01 * uniform(rng) : 0.3 + 40.0 * uniform(rng);
+        double centralMu = moon ? GM_SUN * 1e-3 : GM_SUN;
+        orbits.push_back(KeplerElements::fromLongitudes(a, 0.99 * uniform(rng), 180.0 * uniform(rng),
+                                                        360.0 * uniform(rng), 360.0 * uniform(rng),
+                                                        360.0 * uniform(rng), centralMu));
+        mu.push_back(centralMu);
+        if (moon)
+            ephemeris.addBody(orbits.back(), static_cast<std::uint32_t>(i - 1));
+        else
+            ephemeris.addBody(orbits.back());
+    }
+
+    std::vector<std::uint32_t> body(n);
+    std::vector<double> days(n), x(n), y(n), z(n);
+    for (std::size_t i = 0; i < n; i++) {
+        body[i] = static_cast<std::uint32_t>(uniform(rng) * bodies) % bodies;
+        days[i] = -36525.0 + 73050.0 * uniform(rng);
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    ThreadPool pool;
+
+    Clock::time_point start = Clock::now();
+    ephemeris.positions(pool, n, body.data(), days.data(), x.data(), y.data(), z.data());
+    double batchSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Scalar reference on a sample, moons add their parent's state
+    const std::size_t sample = n < 200000 ? n : 200000;
+    double maxError = 0.0;
+    start = Clock::now();
+    for (std::size_t i = 0; i < sample; i++) {
+        double position[3], velocity[3], total[3] = { 0.0, 0.0, 0.0 };
+        for (std::uint32_t b = body[i];; b--) {
+            elementsToState(orbits[b], days[i], mu[b], position, velocity);
+            total[0] += position[0]; total[1] += position[1]; total[2] += position[2];
+            if (b % 10 != 9)
+                break;
+        }
+        double dx = total[0] - x[i], dy = total[1] - y[i], dz = total[2] - z[i];
+        double r = std::sqrt(total[0] * total[0] + total[1] * total[1] + total[2] * total[2]);
+        double error = std::sqrt(dx * dx + dy * dy + dz * dz) / r;
+        if (error > maxError)
+            maxError = error;
+    }
+    double scalarSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double batchRate = n / batchSeconds;
+    double scalarRate = sample / scalarSeconds;
+
+    std::printf("queries:              %zu over %zu bodies\n", n, bodies);
+    std::printf("threads:              %u, double width %d\n", pool.size(), simd::DOUBLE_WIDTH);
+    std::printf("batch:                %.3e queries/s (%.1f ms)\n", batchRate, 1e3 * batchSeconds);
+    std::printf("scalar double:        %.3e queries/s\n", scalarRate);
+    std::printf("speedup:              %.1fx\n", batchRate / scalarRate);
+    std::printf("max relative error:   %.3e\n", maxError);
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+/**
+ * @brief Eclipse, transit and conjunction search over a span of years
+ *
+ * Usage: event_search [first] [years] [output] [kernel]
+ *
+ * first is a year (2000 by default) or a YYYY-MM-DD date, the search covers years from it
+ * (100 by default). Positions come from the SPK kernel (../ephemeris/de440s.bsp by default)
+ * where it covers them and from the analytic theories otherwise. Writes every event to
+ * output (events.csv by default) and prints the counts and the eclipses and transits.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Calendar.hpp"
+#include "EventSearch.hpp"
+#include "SkyEphemeris.hpp"
+#include "SpkKernel.hpp"
+#include "ThreadPool.hpp"
+
+int main(int argc, char** argv) {
+    const char* firstText = argc > 1 ? argv[1] : "2000";
+    double years = argc > 2 ? std::atof(argv[2]) : 100.0;
+    std::string output = argc > 3 ? argv[3] : "events.csv";
+    std::string kernelPath = argc > 4 ? argv[4] : "../ephemeris/de440s.bsp";
+
+    const double first = std::strchr(firstText + 1, '-') != NULL ? calendar::parse(firstText)
+                                                                  : calendar::daysFromDate(std::atoi(firstText), 1, 1);
+    const double last = first + years * 365.25;
+    if (!(years > 0.0)) {
+        std::fprintf(stderr, "usage: event_search [first year or date] [years] [output] [kernel]\n");
+        return 1;
+    }
+
+    SpkKernel kernel;
+    SkyEphemeris sky;
+    const bool useKernel = kernel.open(kernelPath);
+    if (useKernel)
+        sky.useKernel(&kernel);
+
+    ThreadPool pool;
+    EventSearch search(sky);
+    std::vector<SkyEvent> events;
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    search.search(pool, first, last, events);
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (!EventSearch::write(output, events)) {
+        std::fprintf(stderr, "Could not write %s\n", output.c_str());
+        return 1;
+    }
+
+    std::size_t counts[4][5] = {};
+    for (std::size_t i = 0; i < events.size(); i++)
+        counts[events[i].type][events[i].kind]++;
+    for (std::size_t i = 0; i < events.size(); i++) {
+        const SkyEvent& e = events[i];
+        if (e.type == SkyEvent::CONJUNCTION || (e.type == SkyEvent::LUNAR_ECLIPSE && e.kind == SkyEvent::PENUMBRAL))
+            continue;
+        std::printf("%s  %-13s %-9s %-7s %s - %s\n", calendar::format(e.days, true).c_str(),
+                    SkyEvent::typeName(e.type), SkyEvent::kindName(e.kind),
+                    e.type == SkyEvent::TRANSIT ? SkyEphemeris::name(e.second) : "",
+                    calendar::format(e.begin, true).c_str() + 11, calendar::format(e.end, true).c_str() + 11);
+    }
+
+    std::printf("\n%s to %s, positions from %s\n", calendar::format(first).c_str(), calendar::format(last).c_str(),
+                useKernel ? kernelPath.c_str() : "the analytic theories");
+    std::printf("solar eclipses:  %zu (%zu total, %zu annular, %zu partial)\n",
+                counts[SkyEvent::SOLAR_ECLIPSE][SkyEvent::TOTAL] + counts[SkyEvent::SOLAR_ECLIPSE][SkyEvent::ANNULAR] +
+                    counts[SkyEvent::SOLAR_ECLIPSE][SkyEvent::PARTIAL],
+                counts[SkyEvent::SOLAR_ECLIPSE][SkyEvent::TOTAL], counts[SkyEvent::SOLAR_ECLIPSE][SkyEvent::ANNULAR],
+                counts[SkyEvent::SOLAR_ECLIPSE][SkyEvent::PARTIAL]);
+    std::printf("lunar eclipses:  %zu (%zu total, %zu partial, %zu penumbral)\n",
+                counts[SkyEvent::LUNAR_ECLIPSE][SkyEvent::TOTAL] + counts[SkyEvent::LUNAR_ECLIPSE][SkyEvent::PARTIAL] +
+                    counts[SkyEvent::LUNAR_ECLIPSE][SkyEvent::PENUMBRAL],
+                counts[SkyEvent::LUNAR_ECLIPSE][SkyEvent::TOTAL], counts[SkyEvent::LUNAR_ECLIPSE][SkyEvent::PARTIAL],
+                counts[SkyEvent::LUNAR_ECLIPSE][SkyEvent::PENUMBRAL]);
+    std::printf("transits:        %zu\n",
+                counts[SkyEvent::TRANSIT][SkyEvent::TOTAL] + counts[SkyEvent::TRANSIT][SkyEvent::PARTIAL]);
+    std::printf("conjunctions:    %zu\n", counts[SkyEvent::CONJUNCTION][SkyEvent::NONE]);
+    std::printf("search:          %.3f s on %u threads, %zu events written to %s\n", seconds, pool.size(),
+                events.size(), output.c_str());
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * @brief Compares Barnes-Hut accuracy and speed against direct summation
+ *
+ * Places N equal mass particles in a Plummer sphere, times one Barnes-Hut force evaluation
+ * (tree build included) for several opening angles and measures the relative force error
+ * against direct summation on a random sample of targets. The direct time for all N targets
+ * is extrapolated from the sample.
+ *
+ * Usage: gravity_bench [particles] [sampled targets]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BarnesHut.hpp"
+#include "NBody.hpp"
+#include "ThreadPool.hpp"
+
+int main(int argc, char** argv) {
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1000000;
+    std::size_t samples = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 512;
+    samples = std::min(samples, n);
+
+    ThreadPool pool;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<double> x(n), y(n), z(n), gm(n, 1.0 / n);
+    for (std::size_t i = 0; i < n; i++) {
+        // Plummer radius from the inverse cumulative mass, isotropic direction
+        double r = 1.0 / std::sqrt(std::pow(uniform(rng) * 0.999 + 1e-6, -2.0 / 3.0) - 1.0);
+        double cosTheta = 2.0 * uniform(rng) - 1.0;
+        double sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+        double phi = 6.283185307179586 * uniform(rng);
+        x[i] = r * sinTheta * std::cos(phi);
+        y[i] = r * sinTheta * std::sin(phi);
+        z[i] = r * cosTheta;
+    }
+    const double softening2 = 1e-6;
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Direct summation reference on a sample of targets
+    std::vector<double> sx(samples), sy(samples), sz(samples);
+    std::vector<std::size_t> sampleIndex(samples);
+    for (std::size_t k = 0; k < samples; k++) {
+        sampleIndex[k] = static_cast<std::size_t>(uniform(rng) * (n - 1));
+        sx[k] = x[sampleIndex[k]]; sy[k] = y[sampleIndex[k]]; sz[k] = z[sampleIndex[k]];
+    }
+    std::vector<double> refX(samples), refY(samples), refZ(samples);
+    Clock::time_point start = Clock::now();
+    DirectGravity::accelerations(pool, softening2, samples, sx.data(), sy.data(), sz.data(),
+                                 n, x.data(), y.data(), z.data(), gm.data(),
+                                 refX.data(), refY.data(), refZ.data());
+    double directSample = std::chrono::duration<double>(Clock::now() - start).count();
+    double directFull = directSample * n / samples;
+
+    std::printf("particles:            %zu (%u threads)\n", n, pool.size());
+    std::printf("direct summation:     %.3f s per evaluation (extrapolated from %zu targets)\n", directFull, samples);
+    std::printf("\n  theta   build [ms]   forces [ms]   speedup   median err   99%% err     max err\n");
+
+    std::vector<double> ax(n), ay(n), az(n);
+    const double thetas[] = { 0.3, 0.5, 0.7, 1.0 };
+    for (int t = 0; t < 4; t++) {
+        BarnesHutGravity tree(thetas[t]);
+
+        start = Clock::now();
+        tree.build(pool, n, x.data(), y.data(), z.data(), gm.data());
+        double build = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        tree.accelerations(pool, softening2, n, x.data(), y.data(), z.data(), ax.data(), ay.data(), az.data());
+        double forces = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::vector<double> errors(samples);
+        for (std::size_t k = 0; k < samples; k++) {
+            std::size_t i = sampleIndex[k];
+            double dx = ax[i] - refX[k], dy = ay[i] - refY[k], dz = az[i] - refZ[k];
+            double norm = std::sqrt(refX[k] * refX[k] + refY[k] * refY[k] + refZ[k] * refZ[k]);
+            errors[k] = std::sqrt(dx * dx + dy * dy + dz * dz) / norm;
+        }
+        std::sort(errors.begin(), errors.end());
+
+        std::printf("  %.1f   %10.1f   %11.1f   %7.1fx   %.2e   %.2e   %.2e\n", thetas[t],
+                    1e3 * build, 1e3 * forces, directFull / (build + forces),
+                    errors[samples / 2], errors[samples * 99 / 100], errors[samples - 1]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * @brief Measures batched Kepler propagation throughput against the scalar double precision path
+ *
+ * Usage: kepler_bench [bodies] [repetitions]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Kepler.hpp"
+
+int main(int argc, char** argv) {
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1000000;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<KeplerElements> orbits(n);
+    std::vector<double> meanAnomalyAtEpoch(n), meanMotion(n);
+    std::vector<float> meanAnomaly(n), eccentricity(n), semiMajorAxis(n), semiMinorAxis(n);
+    std::vector<float> px(n), py(n), pz(n), qx(n), qy(n), qz(n);
+    std::vector<float> x(n), y(n), z(n);
+
+    for (std::size_t i = 0; i < n; i++) {
+        orbits[i] = KeplerElements::fromLongitudes(0.5 + 40.0 * uniform(rng), 0.9 * uniform(rng),
+                                                   30.0 * uniform(rng), 360.0 * uniform(rng),
+                                                   360.0 * uniform(rng), 360.0 * uniform(rng));
+        const KeplerElements& o = orbits[i];
+        double P[3], Q[3];
+        orbitBasis(o, P, Q);
+        px[i] = P[0]; py[i] = P[1]; pz[i] = P[2];
+        qx[i] = Q[0]; qy[i] = Q[1]; qz[i] = Q[2];
+        eccentricity[i] = o.eccentricity;
+        semiMajorAxis[i] = o.semiMajorAxis;
+        semiMinorAxis[i] = o.semiMajorAxis * std::sqrt(1.0 - o.eccentricity * o.eccentricity);
+        meanAnomalyAtEpoch[i] = o.meanAnomalyAtEpoch;
+        meanMotion[i] = o.meanMotion;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Batched float path, the one Ephemeris::update() uses every frame
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repetitions; r++) {
+        double t = 100.0 * r;
+        KeplerSolver::meanAnomalies(n, meanAnomalyAtEpoch.data(), meanMotion.data(), t, meanAnomaly.data());
+        KeplerSolver::propagate(n, meanAnomaly.data(), eccentricity.data(),
+                                semiMajorAxis.data(), semiMinorAxis.data(),
+                                px.data(), py.data(), pz.data(), qx.data(), qy.data(), qz.data(),
+                                x.data(), y.data(), z.data());
+    }
+    double batchedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Scalar double reference, also used to measure the error of the last batched pass
+    double t = 100.0 * (repetitions - 1);
+    double maxError = 0.0;
+    start = Clock::now();
+    for (std::size_t i = 0; i < n; i++) {
+        double position[3], velocity[3];
+        elementsToState(orbits[i], t, GM_SUN, position, velocity);
+        double dx = position[0] - x[i], dy = position[1] - y[i], dz = position[2] - z[i];
+        double error = std::sqrt(dx * dx + dy * dy + dz * dz) / orbits[i].semiMajorAxis;
+        if (error > maxError)
+            maxError = error;
+    }
+    double scalarSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double batchedRate = n * static_cast<double>(repetitions) / batchedSeconds;
+    double scalarRate = n / scalarSeconds;
+
+    std::printf("bodies:               %zu\n", n);
+    std::printf("simd width:           %d\n", simd::SIMD_WIDTH);
+    std::printf("batched float:        %.3e solves/s (%.3f ms per pass)\n", batchedRate, 1e3 * batchedSeconds / repetitions);
+    std::printf("scalar double:        %.3e solves/s\n", scalarRate);
+    std::printf("speedup:              %.1fx\n", batchedRate / scalarRate);
+    std::printf("max relative error:   %.3e\n", maxError);
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @brief Measures loading the Minor Planet Center's orbit catalog cold and from its cache
+ *
+ * Usage: mpcorb_bench [catalog]
+ *
+ * Parses the catalog (../data/MPCORB.DAT by default) from text and writes its binary
+ * cache, then loads it again through the cache and checks both give the same orbits.
+ * When the file is missing, a made-up catalog of 1.3 million orbits in the same format
+ * is written to the working directory and removed afterwards. Also reports the time to
+ * propagate every orbit for drawing.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AsteroidCatalog.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+const std::size_t SYNTHETIC_ORBITS = 1300000;
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * @brief Packed designation of a numbered minor planet, e.g. "A0345" for 100345
+ */
+std::string packedNumber(std::size_t number) {
+    char text[8];
+    if (number < 100000) {
+        std::snprintf(text, sizeof(text), "%05u", static_cast<unsigned int>(number));
+    } else {
+        const unsigned int leading = static_cast<unsigned int>(number / 10000);
+        const char letter = static_cast<char>(leading < 36 ? 'A' + leading - 10 : 'a' + leading - 36);
+        std::snprintf(text, sizeof(text), "%c%04u", letter, static_cast<unsigned int>(number % 10000));
+    }
+    return text;
+}
+
+/**
+ * @brief Writes a catalog in the MPCORB layout: a header, numbered orbits, a blank line, more orbits
+ *
+ * @param[out] first the first orbit as written, to check the parser against
+ */
+bool writeSynthetic(const std::string& path, std::size_t count, double first[AsteroidCatalog::FIELDS]) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == NULL)
+        return false;
+    std::fprintf(file, "MINOR PLANET CENTER ORBIT DATABASE (MPCORB)\n\nMade-up orbits for mpcorb_bench\n\n");
+    std::fprintf(file, "Des'n     H     G   Epoch     M        Peri.      Node       Incl.       e            n"
+                       "           a        Reference #Obs #Opp    Arc    rms  Perts   Computer\n");
+    std::fprintf(file, "%s\n", std::string(202, '-').c_str());
+
+    std::srand(11);
+    for (std::size_t i = 0; i < count; i++) {
+        if (i == count / 2)
+            std::fprintf(file, "\n");
+        const double r = static_cast<double>(std::rand()) / RAND_MAX;
+        const double a = 1.8 + 1.7 * r + (i % 97 == 0 ? 2.0 : 0.0);
+        const double e = 0.3 * std::rand() / RAND_MAX;
+        const double incl = 25.0 * std::rand() / RAND_MAX;
+        const double M = 360.0 * std::rand() / RAND_MAX;
+        const double peri = 360.0 * std::rand() / RAND_MAX;
+        const double node = 360.0 * std::rand() / RAND_MAX;
+        const double n = 0.9856076686 / (a * std::sqrt(a));
+        const double H = 10.0 + 10.0 * r;
+        std::fprintf(file,
+                     "%-7s %5.2f  0.15 K25BL %9.5f  %9.5f  %9.5f  %9.5f  %9.7f %11.8f %11.7f  0 E2025-A11  "
+                     "1234  12 1998-2025 0.52 M-v 3Ek MPCLINUX   0000      (%u)                   20250115\n",
+                     packedNumber(i + 1).c_str(), H, M, peri, node, incl, e, n, a, static_cast<unsigned int>(i + 1));
+        if (i == 0) {
+            first[AsteroidCatalog::MEAN_ANOMALY] = M;
+            first[AsteroidCatalog::ECCENTRICITY] = e;
+            first[AsteroidCatalog::MEAN_MOTION] = n;
+            first[AsteroidCatalog::SEMI_MAJOR_AXIS] = a;
+        }
+    }
+    return std::fclose(file) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "../data/MPCORB.DAT";
+
+    std::uint64_t size = 0;
+    std::int64_t modified = 0;
+    double first[AsteroidCatalog::FIELDS] = {};
+    bool synthetic = false;
+    if (!AsteroidCatalog::sourceStamp(path, size, modified)) {
+        path = "mpcorb_synthetic.dat";
+        synthetic = true;
+        if (!writeSynthetic(path, SYNTHETIC_ORBITS, first) || !AsteroidCatalog::sourceStamp(path, size, modified)) {
+            std::fprintf(stderr, "Could not write %s\n", path.c_str());
+            return 1;
+        }
+    }
+    const std::string cachePath = path + ".cache";
+
+    ThreadPool single(1);
+    ThreadPool pool;
+
+    AsteroidCatalog cold;
+    Clock::time_point start = Clock::now();
+    if (!cold.parse(single, path))
+        return 1;
+    const double parseSingle = secondsSince(start);
+    start = Clock::now();
+    cold.parse(pool, path);
+    const double parseAll = secondsSince(start);
+    start = Clock::now();
+    const bool written = cold.writeCache(cachePath, size, modified);
+    const double writeSeconds = secondsSince(start);
+
+    AsteroidCatalog warm;
+    start = Clock::now();
+    const bool loaded = warm.load(pool, path);
+    const double warmSeconds = secondsSince(start);
+
+    std::printf("%zu orbits from %s (%.1f MB)\n", cold.size(), synthetic ? "a made-up catalog" : path.c_str(),
+                size / 1048576.0);
+    std::printf("parse:      %.3f s on 1 thread, %.3f s on %u threads, %.0f MB/s\n", parseSingle, parseAll,
+                pool.size(), size / 1048576.0 / parseAll);
+    std::printf("cache:      %s in %.3f s\n", written ? "written" : "NOT written", writeSeconds);
+    std::printf("warm start: %.2f ms from the %s\n", warmSeconds * 1e3,
+                loaded && warm.fromCache() ? "cache" : "text, the cache was not used");
+
+    // The cache has to give back exactly what was parsed
+    std::size_t differing = warm.size() == cold.size() ? 0 : cold.size();
+    for (int f = 0; f < AsteroidCatalog::FIELDS && differing == 0; f++) {
+        const AsteroidCatalog::Field field = static_cast<AsteroidCatalog::Field>(f);
+        for (std::size_t i = 0; i < cold.size(); i++)
+            differing += std::memcmp(&cold.field(field)[i], &warm.field(field)[i], sizeof(double)) != 0;
+    }
+    std::printf("check:      %zu orbits differ between text and cache", differing);
+    if (synthetic && !cold.empty()) {
+        const double dM = cold.field(AsteroidCatalog::MEAN_ANOMALY)[0] / DEG_TO_RAD - first[AsteroidCatalog::MEAN_ANOMALY];
+        const double da = cold.field(AsteroidCatalog::SEMI_MAJOR_AXIS)[0] - first[AsteroidCatalog::SEMI_MAJOR_AXIS];
+        std::printf(", first orbit %s off by %.1e deg in M and %.1e AU in a", cold.designation(0).c_str(),
+                    std::fabs(dM), std::fabs(da));
+    }
+    std::printf("\n");
+
+    // Drawing: the first update sets up the orbits, the next ones propagate all of them
+    const double days = calendar::daysFromDate(2026, 1, 1);
+    warm.update(pool, days, 120.0f, 1.0);
+    const int frames = 20;
+    start = Clock::now();
+    for (int f = 0; f < frames; f++)
+        warm.update(single, days + f, 120.0f, 1.0);
+    const double oneThread = secondsSince(start) / frames;
+    start = Clock::now();
+    for (int f = 0; f < frames; f++)
+        warm.update(pool, days + f, 120.0f, 1.0);
+    const double allThreads = secondsSince(start) / frames;
+    std::printf("propagate:  %.2f ms per frame on 1 thread, %.2f ms on %u threads\n", oneThread * 1e3,
+                allThreads * 1e3, pool.size());
+
+    if (synthetic) {
+        warm.clear();
+        std::remove(path.c_str());
+        std::remove(cachePath.c_str());
+    }
+    return differing == 0 && loaded ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/**
+ * @brief Runs a Plummer sphere on DistributedNBody and records how it scales with processes
+ *
+ * Usage: mpirun -np P mpi_nbody [particles] [steps] [strong|weak] [threads] [output]
+ *
+ * In strong mode particles (200000 by default) are shared by all processes, in weak mode
+ * every process gets that many. Each process makes its own share of an equal mass Plummer
+ * sphere (G M = 1, scale radius 1), so nothing ever sits on one process in full. After the
+ * first decomposition the accelerations of a few particles are checked against direct
+ * summation, then steps (20) leapfrog steps are timed with threads (1) per process,
+ * redrawing the domains every REBALANCE_STEPS steps. The timing is printed and appended
+ * as a line to output (mpi_scaling.csv); runs with -np 1, 2, 4, ... in both modes make
+ * the strong and weak scaling tables.
+ */
+#include <mpi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DirectGravity.hpp"
+#include "DistributedNBody.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+const std::size_t CHECKED = 256;
+const double SOFTENING = 0.01;
+const double STEP = 0.01;
+const int REBALANCE_STEPS = 10;
+
+/**
+ * @brief Adds count Plummer sphere particles with ids from first, velocities from the local dispersion
+ */
+void addPlummer(DistributedNBody& system, std::uint64_t first, std::size_t count, double gm, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    for (std::size_t i = 0; i < count; i++) {
+        double r = 1.0 / std::sqrt(std::pow(uniform(rng) * 0.999 + 1e-6, -2.0 / 3.0) - 1.0);
+        double cosTheta = 2.0 * uniform(rng) - 1.0;
+        double sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+        double phi = 6.283185307179586 * uniform(rng);
+        const double position[3] = { r * sinTheta * std::cos(phi), r * sinTheta * std::sin(phi), r * cosTheta };
+        const double sigma = std::sqrt(1.0 / (6.0 * std::sqrt(1.0 + r * r)));
+        const double velocity[3] = { sigma * normal(rng), sigma * normal(rng), sigma * normal(rng) };
+        system.addParticle(first + i, gm, position, velocity);
+    }
+}
+
+/**
+ * @brief Median and largest relative error of the distributed accelerations of particles 0 to CHECKED - 1
+ */
+void checkAccelerations(ThreadPool& pool, const DistributedNBody& system, std::size_t checked,
+                        double& median, double& worst) {
+    // Positions and accelerations of the checked particles, each filled in by its owner
+    std::vector<double> state(6 * checked, 0.0);
+    for (std::size_t i = 0; i < system.size(); i++) {
+        const std::uint64_t id = system.ids()[i];
+        if (id < checked) {
+            double* s = &state[6 * id];
+            s[0] = system.x()[i]; s[1] = system.y()[i]; s[2] = system.z()[i];
+            s[3] = system.ax()[i]; s[4] = system.ay()[i]; s[5] = system.az()[i];
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, state.data(), static_cast<int>(state.size()), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    // Direct sums over every process's particles add up to the reference
+    std::vector<double> x(checked), y(checked), z(checked), reference(3 * checked);
+    for (std::size_t k = 0; k < checked; k++) {
+        x[k] = state[6 * k]; y[k] = state[6 * k + 1]; z[k] = state[6 * k + 2];
+    }
+    DirectGravity::accelerations(pool, SOFTENING * SOFTENING, checked, x.data(), y.data(), z.data(),
+                                 system.size(), system.x(), system.y(), system.z(), system.gm(),
+                                 &reference[0], &reference[checked], &reference[2 * checked]);
+    MPI_Allreduce(MPI_IN_PLACE, reference.data(), static_cast<int>(reference.size()), MPI_DOUBLE, MPI_SUM,
+                  MPI_COMM_WORLD);
+
+    std::vector<double> errors(checked);
+    for (std::size_t k = 0; k < checked; k++) {
+        const double rx = reference[k], ry = reference[checked + k], rz = reference[2 * checked + k];
+        const double dx = state[6 * k + 3] - rx, dy = state[6 * k + 4] - ry, dz = state[6 * k + 5] - rz;
+        errors[k] = std::sqrt((dx * dx + dy * dy + dz * dz) / (rx * rx + ry * ry + rz * rz));
+    }
+    std::sort(errors.begin(), errors.end());
+    median = errors[checked / 2];
+    worst = errors.back();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank = 0, ranks = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    const std::size_t particles = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 200000;
+    const int steps = argc > 2 ? std::atoi(argv[2]) : 20;
+    const bool weak = argc > 3 && std::strcmp(argv[3], "weak") == 0;
+    const unsigned int threads = argc > 4 ? static_cast<unsigned int>(std::atoi(argv[4])) : 1;
+    const std::string output = argc > 5 ? argv[5] : "mpi_scaling.csv";
+    const std::size_t total = weak ? particles * ranks : particles;
+    if (total < CHECKED || steps <= 0 || threads == 0) {
+        if (rank == 0)
+            std::fprintf(stderr, "usage: mpirun -np P mpi_nbody [particles >= %zu] [steps] [strong|weak] "
+                                 "[threads] [output]\n", CHECKED);
+        MPI_Finalize();
+        return 1;
+    }
+
+    int status = 0;
+    {
+        ThreadPool pool(threads);
+        DistributedNBody system(pool, MPI_COMM_WORLD, 0.5, SOFTENING);
+        system.setRebalance(REBALANCE_STEPS, 1.25);
+
+        // This process's share and where its ids start
+        const std::size_t share = total / ranks + (static_cast<std::size_t>(rank) < total % ranks ? 1 : 0);
+        std::uint64_t count = share, first = 0;
+        MPI_Exscan(&count, &first, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        if (rank == 0)
+            first = 0;
+        addPlummer(system, first, share, 1.0 / total, 7u + rank);
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        system.prepare();
+        const double prepareSeconds = MPI_Wtime() - start;
+        double median = 0.0, worst = 0.0;
+        checkAccelerations(pool, system, CHECKED, median, worst);
+
+        const DistributedStats before = system.stats();
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+        for (int s = 0; s < steps; s++)
+            system.step(STEP);
+        MPI_Barrier(MPI_COMM_WORLD);
+        const double stepSeconds = (MPI_Wtime() - start) / steps;
+
+        // Slowest process per phase, totals of what moved, spread of the domains
+        const DistributedStats& after = system.stats();
+        double phases[4] = { after.decompose - before.decompose, after.exchange - before.exchange,
+                             after.gravity - before.gravity, after.integrate - before.integrate };
+        MPI_Allreduce(MPI_IN_PLACE, phases, 4, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        std::uint64_t moved[2] = { after.migrated - before.migrated, after.ghosts - before.ghosts };
+        MPI_Allreduce(MPI_IN_PLACE, moved, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        std::uint64_t owned[2] = { system.size(), system.size() };
+        MPI_Allreduce(MPI_IN_PLACE, &owned[0], 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &owned[1], 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+        const int decompositions = after.decompositions - before.decompositions;
+        const std::uint64_t globalSize = system.globalSize();
+
+        if (rank == 0) {
+            std::printf("%s scaling: %llu particles on %d processes with %u threads each\n", weak ? "weak" : "strong",
+                        static_cast<unsigned long long>(globalSize), ranks, threads);
+            std::printf("prepare:    %.3f s for the first domains and forces\n", prepareSeconds);
+            std::printf("forces:     median error %.2e, largest %.2e against direct summation\n", median, worst);
+            std::printf("step:       %.3f s, slowest process per step: %.3f s domains, %.3f s ghosts, "
+                        "%.3f s gravity, %.3f s leapfrog\n", stepSeconds, phases[0] / steps, phases[1] / steps,
+                        phases[2] / steps, phases[3] / steps);
+            std::printf("domains:    %llu to %llu particles per process, %d redrawn, %llu particles moved, "
+                        "imbalance %.2f\n", static_cast<unsigned long long>(owned[0]),
+                        static_cast<unsigned long long>(owned[1]), decompositions,
+                        static_cast<unsigned long long>(moved[0]), system.imbalance());
+            std::printf("ghosts:     %.0f per process per step\n", static_cast<double>(moved[1]) / steps / ranks);
+
+            std::FILE* file = std::fopen(output.c_str(), "a");
+            if (file == NULL) {
+                std::fprintf(stderr, "Could not write %s\n", output.c_str());
+                status = 1;
+            } else {
+                if (std::ftell(file) == 0)
+                    std::fprintf(file, "mode,processes,threads,particles,step_s,domains_s,ghosts_s,gravity_s,"
+                                       "leapfrog_s,ghosts_per_process,imbalance,median_error\n");
+                std::fprintf(file, "%s,%d,%u,%llu,%.6f,%.6f,%.6f,%.6f,%.6f,%.0f,%.3f,%.3e\n", weak ? "weak" : "strong",
+                             ranks, threads, static_cast<unsigned long long>(globalSize), stepSeconds,
+                             phases[0] / steps, phases[1] / steps, phases[2] / steps, phases[3] / steps,
+                             static_cast<double>(moved[1]) / steps / ranks, system.imbalance(), median);
+                status = std::fclose(file) == 0 ? 0 : 1;
+            }
+            if (globalSize != total || !(worst < 0.05))
+                status = 1;
+        }
+    }
+    MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Finalize();
+    return status;
+}
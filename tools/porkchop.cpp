@@ -0,0 +1,224 @@
+/**
+ * @brief Porkchop plot generator: Lambert transfers over a grid of launch and arrival dates
+ *
+ * Usage: porkchop [from] [to] [first departure] [departure span] [first arrival] [arrival span]
+ *                 [size] [output] [kernel]
+ *
+ * Bodies are planet names (mercury ... neptune). Dates are days since J2000 or YYYY-MM-DD,
+ * spans are in days and the grid has size x size cells (1000 by default). Planet states
+ * come from the SPK kernel (../ephemeris/de440s.bsp by default) where it covers them and
+ * from the mean Kepler orbits otherwise. Writes output.grid (see PorkchopGrid::write) and
+ * output.png: C3 in filled bands with black contours, arrival excess speed in white contours
+ * inside them.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Calendar.hpp"
+#include "Kepler.hpp"
+#include "PngWriter.hpp"
+#include "Porkchop.hpp"
+#include "SpkKernel.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+const double C3_BAND = 2.5;         // km^2 / s^2 between filled bands
+const int C3_BANDS = 16;
+const double VINF_CONTOUR = 0.5;    // km / s between arrival contours
+const int VINF_CONTOURS = 10;
+
+struct Body {
+    const char* name;
+    int naif;
+    int planet;     // row of JPL_MEAN_ELEMENTS
+};
+
+const Body BODIES[] = {
+    { "mercury", 1,          0 },
+    { "venus",   2,          1 },
+    { "earth",   NAIF_EARTH, 2 },
+    { "mars",    4,          3 },
+    { "jupiter", 5,          4 },
+    { "saturn",  6,          5 },
+    { "uranus",  7,          6 },
+    { "neptune", 8,          7 },
+};
+
+const Body* findBody(const char* name) {
+    for (std::size_t i = 0; i < sizeof(BODIES) / sizeof(BODIES[0]); i++) {
+        if (std::strcmp(BODIES[i].name, name) == 0)
+            return &BODIES[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Samples a body's heliocentric state at count dates, from the kernel where it has them
+ *
+ * @return number of dates that fell back to the Kepler orbit
+ */
+std::size_t sampleAxis(const SpkKernel* kernel, const Body& body, double firstDays, double spanDays,
+                       std::size_t count, PorkchopGrid::Axis& axis) {
+    axis.firstDays = firstDays;
+    axis.stepDays = count > 1 ? spanDays / (count - 1) : 0.0;
+    axis.resize(count);
+    const KeplerElements orbit = jplMeanElements(body.planet);
+    std::size_t fallbacks = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        double position[3], velocity[3];
+        if (kernel == NULL || !kernel->state(body.naif, NAIF_SUN, axis.days(i), position, velocity)) {
+            elementsToState(orbit, axis.days(i), GM_SUN, position, velocity);
+            fallbacks++;
+        }
+        axis.x[i] = position[0]; axis.y[i] = position[1]; axis.z[i] = position[2];
+        axis.vx[i] = velocity[0]; axis.vy[i] = velocity[1]; axis.vz[i] = velocity[2];
+    }
+    return fallbacks;
+}
+
+/**
+ * @brief Blue to red ramp for t in [0, 1]
+ */
+void ramp(double t, unsigned char rgb[3]) {
+    static const double stops[5][3] = {
+        { 0.10, 0.15, 0.55 }, { 0.10, 0.60, 0.85 }, { 0.25, 0.75, 0.30 }, { 0.95, 0.85, 0.20 }, { 0.85, 0.20, 0.15 },
+    };
+    const double position = std::min(std::max(t, 0.0), 1.0) * 4.0;
+    const int k = std::min(static_cast<int>(position), 3);
+    const double f = position - k;
+    for (int c = 0; c < 3; c++)
+        rgb[c] = static_cast<unsigned char>(255.0 * (stops[k][c] + f * (stops[k + 1][c] - stops[k][c])));
+}
+
+/**
+ * @brief Departure date to the right, arrival date upwards
+ */
+std::vector<unsigned char> render(const PorkchopGrid& grid, double minC3, double minArrival) {
+    const std::size_t width = grid.departures(), height = grid.arrivals();
+    std::vector<int> c3Band(width * height), vinfLevel(width * height);
+    for (std::size_t i = 0; i < width; i++) {
+        for (std::size_t j = 0; j < height; j++) {
+            const float c3 = grid.at(PorkchopGrid::C3, i, j);
+            const float vinf = grid.at(PorkchopGrid::ARRIVAL_VINF, i, j);
+            const int band = c3 == c3 ? static_cast<int>(std::floor((c3 - minC3) / C3_BAND)) : -1;
+            const int level = vinf == vinf ? static_cast<int>(std::floor((vinf - minArrival) / VINF_CONTOUR)) : -1;
+            c3Band[i * height + j] = band < C3_BANDS ? band : -2;
+            vinfLevel[i * height + j] = level < VINF_CONTOURS ? level : -2;
+        }
+    }
+
+    std::vector<unsigned char> rgb(3 * width * height);
+    for (std::size_t i = 0; i < width; i++) {
+        for (std::size_t j = 0; j < height; j++) {
+            unsigned char* pixel = &rgb[3 * ((height - 1 - j) * width + i)];
+            const int band = c3Band[i * height + j];
+            const int level = vinfLevel[i * height + j];
+            const int rightBand = i + 1 < width ? c3Band[(i + 1) * height + j] : band;
+            const int upBand = j + 1 < height ? c3Band[i * height + j + 1] : band;
+            const int rightLevel = i + 1 < width ? vinfLevel[(i + 1) * height + j] : level;
+            const int upLevel = j + 1 < height ? vinfLevel[i * height + j + 1] : level;
+            if (band == -1) {
+                pixel[0] = pixel[1] = pixel[2] = 0;
+            } else if (band >= 0 && level >= 0 && (level != rightLevel || level != upLevel) && rightLevel != -1 && upLevel != -1) {
+                pixel[0] = pixel[1] = pixel[2] = 255;
+            } else if (band >= 0 && (band != rightBand || band != upBand) && rightBand != -1 && upBand != -1) {
+                pixel[0] = pixel[1] = pixel[2] = 20;
+            } else if (band >= 0) {
+                ramp((band + 0.5) / C3_BANDS, pixel);
+            } else {
+                pixel[0] = pixel[1] = pixel[2] = 60;
+            }
+        }
+    }
+    return rgb;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* from = argc > 1 ? argv[1] : "earth";
+    const char* to = argc > 2 ? argv[2] : "mars";
+    double firstDeparture = argc > 3 ? calendar::parse(argv[3]) : calendar::parse("2026-08-01");
+    double departureSpan = argc > 4 ? std::atof(argv[4]) : 240.0;
+    double firstArrival = argc > 5 ? calendar::parse(argv[5]) : calendar::parse("2027-01-01");
+    double arrivalSpan = argc > 6 ? std::atof(argv[6]) : 480.0;
+    std::size_t size = argc > 7 ? std::strtoul(argv[7], NULL, 10) : 1000;
+    std::string output = argc > 8 ? argv[8] : "porkchop";
+    std::string kernelPath = argc > 9 ? argv[9] : "../ephemeris/de440s.bsp";
+
+    const Body* departureBody = findBody(from);
+    const Body* arrivalBody = findBody(to);
+    if (departureBody == NULL || arrivalBody == NULL || size == 0) {
+        std::fprintf(stderr, "usage: porkchop [from] [to] [first departure] [departure span] [first arrival] "
+                             "[arrival span] [size] [output] [kernel]\n");
+        return 1;
+    }
+
+    SpkKernel kernel;
+    const bool useKernel = kernel.open(kernelPath);
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    PorkchopGrid::Axis departures, arrivals;
+    std::size_t fallbacks = sampleAxis(useKernel ? &kernel : NULL, *departureBody, firstDeparture, departureSpan,
+                                       size, departures);
+    fallbacks += sampleAxis(useKernel ? &kernel : NULL, *arrivalBody, firstArrival, arrivalSpan, size, arrivals);
+    double sampleSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    PorkchopGrid grid;
+    grid.setAxes(departures, arrivals, departureBody->naif, arrivalBody->naif);
+    ThreadPool pool;
+    start = Clock::now();
+    grid.compute(pool);
+    double solveSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Cheapest launch, and the lowest arrival speed, over the whole grid
+    std::size_t bestI = 0, bestJ = 0;
+    double minC3 = HUGE_VAL, minArrival = HUGE_VAL;
+    for (std::size_t i = 0; i < grid.departures(); i++) {
+        for (std::size_t j = 0; j < grid.arrivals(); j++) {
+            const float c3 = grid.at(PorkchopGrid::C3, i, j);
+            const float vinf = grid.at(PorkchopGrid::ARRIVAL_VINF, i, j);
+            if (c3 == c3 && c3 < minC3) {
+                minC3 = c3;
+                bestI = i;
+                bestJ = j;
+            }
+            if (vinf == vinf && vinf < minArrival)
+                minArrival = vinf;
+        }
+    }
+    if (minC3 == HUGE_VAL) {
+        std::fprintf(stderr, "No transfers: every arrival date is before every departure date\n");
+        return 1;
+    }
+
+    start = Clock::now();
+    bool ok = grid.write(output + ".grid");
+    std::vector<unsigned char> image = render(grid, minC3, minArrival);
+    ok = PngWriter::write(output + ".png", grid.departures(), grid.arrivals(), image.data()) && ok;
+    double writeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!ok) {
+        std::fprintf(stderr, "Could not write %s.grid / %s.png\n", output.c_str(), output.c_str());
+        return 1;
+    }
+
+    const double cells = static_cast<double>(grid.departures() * grid.arrivals());
+    std::printf("%s -> %s, %zu x %zu grid\n", departureBody->name, arrivalBody->name, grid.departures(),
+                grid.arrivals());
+    std::printf("states:       %s (%zu of %zu dates from the mean orbits), %.3f s\n",
+                useKernel ? kernelPath.c_str() : "mean Kepler orbits", fallbacks, 2 * size, sampleSeconds);
+    std::printf("lambert:      %.3f s on %u threads, %.3e transfers/s\n", solveSeconds, pool.size(),
+                cells / solveSeconds);
+    std::printf("output:       %s.grid, %s.png in %.3f s\n", output.c_str(), output.c_str(), writeSeconds);
+    std::printf("minimum C3:   %.2f km^2/s^2 leaving %s, arriving %s (%.0f days), arrival v-inf %.2f km/s\n",
+                minC3, calendar::format(departures.days(bestI)).c_str(), calendar::format(arrivals.days(bestJ)).c_str(),
+                arrivals.days(bestJ) - departures.days(bestI),
+                grid.at(PorkchopGrid::ARRIVAL_VINF, bestI, bestJ));
+    return 0;
+}
@@ -0,0 +1,159 @@
+/**
+ * @brief Measures SGP4 propagation of a full satellite catalog per frame
+ *
+ * Usage: sgp4_bench [element sets] [frames]
+ *
+ * Loads the element sets (../data/catalog.tle by default) or, when the file is missing,
+ * makes up a catalog of 30000 satellites with a realistic mix of orbits. Propagates the
+ * whole catalog at real time for a number of frames on one thread and on all of them,
+ * compares the SIMD lanes with the scalar reference and checks the reference against
+ * the published test case for satellite 00005.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Sgp4.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+const std::size_t SYNTHETIC_SATELLITES = 30000;
+
+/**
+ * @brief Mostly low orbits, then navigation, geostationary and Molniya-like ones
+ */
+std::vector<TwoLineElements> syntheticCatalog(std::size_t count, double epochDays) {
+    std::vector<TwoLineElements> catalog(count);
+    std::srand(7);
+    for (std::size_t i = 0; i < count; i++) {
+        TwoLineElements& e = catalog[i];
+        const double u = static_cast<double>(std::rand()) / RAND_MAX;
+        const double r = static_cast<double>(std::rand()) / RAND_MAX;
+        e.number = static_cast<std::uint32_t>(i + 1);
+        e.epochDays = epochDays - 3.0 * r;
+        e.node = 360.0 * std::rand() / RAND_MAX;
+        e.argumentOfPerigee = 360.0 * std::rand() / RAND_MAX;
+        e.meanAnomaly = 360.0 * std::rand() / RAND_MAX;
+        if (u < 0.85) {
+            e.meanMotion = 13.0 + 3.0 * r;
+            e.eccentricity = 0.02 * r * r;
+            e.inclination = 40.0 + 60.0 * u;
+            e.bstar = 1e-4 * r;
+        } else if (u < 0.9) {
+            e.meanMotion = 2.0 + 0.1 * r;
+            e.eccentricity = 0.01 * r;
+            e.inclination = 55.0 + 10.0 * r;
+            e.bstar = 0.0;
+        } else if (u < 0.97) {
+            e.meanMotion = 1.0027 + 0.01 * (r - 0.5);
+            e.eccentricity = 0.001 * r;
+            e.inclination = 15.0 * r;
+            e.bstar = 0.0;
+        } else {
+            e.meanMotion = 2.006 + 0.05 * r;
+            e.eccentricity = 0.7 + 0.03 * r;
+            e.inclination = 63.4;
+            e.argumentOfPerigee = 270.0;
+            e.bstar = 1e-5 * r;
+        }
+    }
+    return catalog;
+}
+
+/**
+ * @brief Vallado's test case 00005 at 0 and 360 minutes, returns the largest position error in km
+ */
+double referenceError() {
+    TwoLineElements elements;
+    TwoLineElements::parse("1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+                           "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667", elements);
+    Sgp4Catalog catalog;
+    catalog.add(elements);
+    const double expected[2][3] = { { 7022.46529266, -1400.08296755, 0.03995155 },
+                                    { -7154.03120202, -3783.17682504, -3536.19412294 } };
+    const double minutes[2] = { 0.0, 360.0 };
+    double worst = 0.0;
+    for (int k = 0; k < 2; k++) {
+        double r[3], v[3];
+        catalog.state(0, elements.epochDays + minutes[k] / 1440.0, r, v);
+        for (int c = 0; c < 3; c++)
+            worst = std::max(worst, std::fabs(r[c] - expected[k][c]));
+    }
+    return worst;
+}
+
+double secondsPerFrame(Sgp4Catalog& catalog, ThreadPool& pool, double days, int frames) {
+    typedef std::chrono::steady_clock Clock;
+    catalog.propagate(pool, days);
+    Clock::time_point start = Clock::now();
+    for (int f = 0; f < frames; f++)
+        catalog.propagate(pool, days + f / (60.0 * SECONDS_PER_DAY));
+    return std::chrono::duration<double>(Clock::now() - start).count() / frames;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "../data/catalog.tle";
+    int frames = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::vector<TwoLineElements> elements;
+    double days = 0.0;
+    if (TwoLineElements::load(path, elements) && !elements.empty()) {
+        for (std::size_t i = 0; i < elements.size(); i++)
+            days = std::max(days, elements[i].epochDays);
+    } else {
+        days = calendar::daysFromDate(2026, 1, 1);
+        elements = syntheticCatalog(SYNTHETIC_SATELLITES, days);
+        path = "synthetic catalog";
+    }
+
+    Sgp4Catalog catalog;
+    for (std::size_t i = 0; i < elements.size(); i++)
+        catalog.add(elements[i]);
+    std::printf("%zu satellites from %s (%zu rejected, %zu with periods of 225 minutes or more)\n", catalog.size(),
+                path.c_str(), elements.size() - catalog.size(), catalog.deepSpace());
+    std::printf("reference:    test case 00005 within %.2e km of the published positions\n", referenceError());
+
+    ThreadPool single(1);
+    ThreadPool pool;
+    const double oneThread = secondsPerFrame(catalog, single, days, frames);
+    const double allThreads = secondsPerFrame(catalog, pool, days, frames);
+    std::printf("1 thread:     %.3f ms per frame, %.1f ns per satellite\n", oneThread * 1e3,
+                oneThread * 1e9 / catalog.size());
+    std::printf("%u threads:    %.3f ms per frame, %.1f ns per satellite\n", pool.size(), allThreads * 1e3,
+                allThreads * 1e9 / catalog.size());
+
+    // Lanes against the scalar reference, a day after the newest epoch
+    catalog.propagate(pool, days + 1.0);
+    double worst = 0.0;
+    std::size_t failed = 0, mismatched = 0;
+    for (std::size_t i = 0; i < catalog.size(); i++) {
+        double r[3], v[3];
+        const bool ok = catalog.state(i, days + 1.0, r, v) == Sgp4Catalog::OK;
+        const bool lanesOk = catalog.x()[i] == catalog.x()[i];
+        failed += !ok;
+        if (ok != lanesOk) {
+            mismatched++;
+            continue;
+        }
+        if (ok) {
+            const double dx = catalog.x()[i] - r[0], dy = catalog.y()[i] - r[1], dz = catalog.z()[i] - r[2];
+            worst = std::max(worst, std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+    }
+    std::printf("lanes:        within %.2e km of the scalar reference, %zu failed, %zu disagree on failing\n",
+                worst, failed, mismatched);
+
+    // A frame budget smaller than the full catalog takes turns
+    std::size_t updated = 0;
+    for (int f = 0; f < 20; f++)
+        updated = catalog.update(pool, days + f / (60.0 * SECONDS_PER_DAY), 0.25 * allThreads);
+    std::printf("budget:       %zu of %zu satellites per frame at a quarter of the full cost\n", updated,
+                catalog.size());
+    return 0;
+}
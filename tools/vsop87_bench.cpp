@@ -0,0 +1,146 @@
+/**
+ * @brief Measures VSOP87 series evaluation against the analytic Kepler ellipses
+ *
+ * Usage: vsop87_bench [vsop87 directory] [epochs]
+ *
+ * Loads VSOP87A.mer ... VSOP87A.nep from the directory, or without it synthetic series of
+ * the same size (about 6000 terms per planet), and evaluates every planet at the epochs
+ * with the multi-epoch SIMD path, the one-epoch SIMD path and the scalar reference.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Kepler.hpp"
+#include "Vsop87.hpp"
+
+namespace {
+
+/**
+ * @brief Series with the shape of VSOP87A: amplitudes falling off, fewer terms at higher powers
+ */
+void addSyntheticBody(Vsop87& vsop, std::mt19937& rng, double semiMajorAxis, double meanMotion) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<double> A[Vsop87::COORDINATES * Vsop87::POWERS];
+    std::vector<double> B[Vsop87::COORDINATES * Vsop87::POWERS];
+    std::vector<double> C[Vsop87::COORDINATES * Vsop87::POWERS];
+    for (int c = 0; c < Vsop87::COORDINATES; c++) {
+        for (int p = 0; p < Vsop87::POWERS; p++) {
+            const int count = 1000 >> p;
+            std::vector<double>& a = A[c * Vsop87::POWERS + p];
+            std::vector<double>& b = B[c * Vsop87::POWERS + p];
+            std::vector<double>& f = C[c * Vsop87::POWERS + p];
+            for (int k = 0; k < count; k++) {
+                a.push_back(semiMajorAxis * std::pow(10.0, -2.0 - 8.0 * uniform(rng)));
+                b.push_back(TWO_PI * uniform(rng));
+                f.push_back(meanMotion * 365250.0 * std::floor(1.0 + 20.0 * uniform(rng)));
+            }
+        }
+    }
+    vsop.add(A, B, C);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string directory = argc > 1 ? argv[1] : "";
+    std::size_t epochs = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 4096;
+
+    // Mean J2000 elements, the path the renderer falls back to
+    KeplerElements orbits[PLANET_COUNT];
+    for (int k = 0; k < PLANET_COUNT; k++)
+        orbits[k] = jplMeanElements(k);
+    const std::size_t planets = PLANET_COUNT;
+
+    Vsop87 vsop;
+    bool real = !directory.empty() && vsop.open(directory);
+    if (!real) {
+        std::mt19937 rng(42);
+        for (std::size_t k = 0; k < planets; k++)
+            addSyntheticBody(vsop, rng, orbits[k].semiMajorAxis, orbits[k].meanMotion);
+    }
+    std::size_t terms = 0;
+    for (std::size_t k = 0; k < vsop.size(); k++)
+        terms += vsop.terms(k);
+
+    // A century either side of J2000
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uniform(-36525.0, 36525.0);
+    std::vector<double> days(epochs);
+    for (std::size_t i = 0; i < epochs; i++)
+        days[i] = uniform(rng);
+    std::vector<double> x(epochs), y(epochs), z(epochs);
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Many epochs per body, the epochs on the lanes
+    Clock::time_point start = Clock::now();
+    std::vector<double> simdX(planets * epochs), simdY(planets * epochs), simdZ(planets * epochs);
+    for (std::size_t k = 0; k < planets; k++)
+        vsop.positions(k, epochs, days.data(), &simdX[k * epochs], &simdY[k * epochs], &simdZ[k * epochs]);
+    double epochSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // One epoch for all bodies, as a frame would ask, the terms on the lanes
+    std::vector<double> frameX(planets), frameY(planets), frameZ(planets);
+    const std::size_t frames = epochs < 256 ? epochs : 256;
+    double maxFrameError = 0.0;
+    start = Clock::now();
+    for (std::size_t i = 0; i < frames; i++) {
+        vsop.positions(days[i], frameX.data(), frameY.data(), frameZ.data());
+        for (std::size_t k = 0; k < planets; k++) {
+            double dx = frameX[k] - simdX[k * epochs + i], dy = frameY[k] - simdY[k * epochs + i];
+            double dz = frameZ[k] - simdZ[k * epochs + i];
+            maxFrameError = std::max(maxFrameError, std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+    }
+    double frameSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Scalar reference on the same frames
+    double maxError = 0.0;
+    start = Clock::now();
+    for (std::size_t i = 0; i < frames; i++) {
+        for (std::size_t k = 0; k < planets; k++) {
+            double xyz[3];
+            vsop.position(k, days[i], xyz);
+            double dx = xyz[0] - simdX[k * epochs + i], dy = xyz[1] - simdY[k * epochs + i];
+            double dz = xyz[2] - simdZ[k * epochs + i];
+            maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+    }
+    double scalarSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // The analytic ellipses, and how far they are from the series
+    double maxKeplerDistance = 0.0;
+    start = Clock::now();
+    for (std::size_t i = 0; i < epochs; i++) {
+        for (std::size_t k = 0; k < planets; k++) {
+            double position[3], velocity[3];
+            elementsToState(orbits[k], days[i], GM_SUN, position, velocity);
+            x[i] = position[0];
+            if (real) {
+                double dx = position[0] - simdX[k * epochs + i], dy = position[1] - simdY[k * epochs + i];
+                double dz = position[2] - simdZ[k * epochs + i];
+                maxKeplerDistance = std::max(maxKeplerDistance, std::sqrt(dx * dx + dy * dy + dz * dz));
+            }
+        }
+    }
+    double keplerSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const double evaluations = static_cast<double>(planets * epochs);
+    std::printf("series:               %s, %zu terms\n", real ? directory.c_str() : "synthetic", terms);
+    std::printf("epochs:               %zu\n", epochs);
+    std::printf("simd width:           %d doubles\n", simd::DOUBLE_WIDTH);
+    std::printf("vsop87 epoch lanes:   %.3e evaluations/s\n", evaluations / epochSeconds);
+    std::printf("vsop87 term lanes:    %.3e evaluations/s\n", frames * planets / frameSeconds);
+    std::printf("vsop87 scalar:        %.3e evaluations/s\n", frames * planets / scalarSeconds);
+    std::printf("kepler ellipse:       %.3e evaluations/s\n", evaluations / keplerSeconds);
+    std::printf("speedup over scalar:  %.1fx\n", (evaluations / epochSeconds) / (frames * planets / scalarSeconds));
+    std::printf("max simd error:       %.3e AU (term lanes %.3e AU)\n", maxError, maxFrameError);
+    if (real)
+        std::printf("max kepler - vsop87:  %.3e AU\n", maxKeplerDistance);
+    return 0;
+}